@@ -18,6 +18,7 @@ enum
   AZ_HTTP_REQUEST_BODY_BUF_SIZE = 1024, ///< Default maximum buffer size for a HTTP request body.
 
   AZ_LOG_MSG_BUF_SIZE = 1024, ///< The maximum size of a log message.
+  AZ_LOG_RECORD_URL_BUF_SIZE = 128, ///< The maximum length of a URL kept in a deferred log record.
 };
 
 #include <_az_cfg_suffix.h>
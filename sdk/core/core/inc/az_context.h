@@ -32,11 +32,20 @@ struct az_context
     int64_t expiration; // Time when context expires
     void* key; // Pointers to the key & value (usually NULL)
     void* value;
+    int64_t effective_expiration; // Soonest expiration of this node and its parents at creation
+    uint32_t cancel_generation; // _az_context_cancel_generation when effective_expiration was set
   } _internal;
 };
 
 #define _az_CONTEXT_MAX_EXPIRATION 0x7FFFFFFFFFFFFFFF
 
+// Incremented by every call to az_context_cancel. The effective expiration cached by a node is only
+// valid as long as no node was canceled since it was computed.
+extern uint32_t volatile _az_context_cancel_generation;
+
+// Reads _az_context_cancel_generation, and orders it before the reads of expirations that follow.
+AZ_NODISCARD uint32_t _az_context_get_cancel_generation();
+
 /**
  * @brief az_context_app is the ultimate root of all az_context instances. It allows you to cancel
  * your entire application. The az_context_app never expires but you can explciit cancel it by
@@ -45,6 +54,16 @@ struct az_context
  */
 extern az_context az_context_app;
 
+/**
+ * @brief az_context_get_expiration returns the soonest expiration time of this az_context node or
+ * any of its parent nodes. Nodes cache it when they are created, and only walk their parent nodes
+ * once a node was canceled after their creation.
+ *
+ * @param context A pointer to an az_context node
+ * @return the soonest expiration time from this context and its parents
+ */
+AZ_NODISCARD int64_t az_context_get_expiration(az_context const* context);
+
 /**
  * @brief az_context_with_expiration creates a newexpiring az_context node that is a child of the
  * specified parent.
@@ -57,8 +76,19 @@ extern az_context az_context_app;
 AZ_NODISCARD AZ_INLINE az_context
 az_context_with_expiration(az_context const* parent, int64_t expiration)
 {
-  return (az_context){ ._internal = { .parent = ((parent != NULL) ? parent : &az_context_app),
-                                      .expiration = expiration } };
+  parent = (parent != NULL) ? parent : &az_context_app;
+
+  // Read the generation first: a cancellation racing with this call makes the cache stale.
+  uint32_t const cancel_generation = _az_context_get_cancel_generation();
+  int64_t const parent_expiration = az_context_get_expiration(parent);
+
+  return (az_context){ ._internal = {
+                           .parent = parent,
+                           .expiration = expiration,
+                           .effective_expiration
+                           = (expiration < parent_expiration) ? expiration : parent_expiration,
+                           .cancel_generation = cancel_generation,
+                       } };
 }
 
 /**
@@ -74,33 +104,29 @@ az_context_with_expiration(az_context const* parent, int64_t expiration)
 AZ_NODISCARD AZ_INLINE az_context
 az_context_with_value(az_context const* parent, void* key, void* value)
 {
-  return (az_context){ ._internal = { .parent = (parent != NULL) ? parent : &az_context_app,
+  parent = (parent != NULL) ? parent : &az_context_app;
+
+  // Read the generation first: a cancellation racing with this call makes the cache stale.
+  uint32_t const cancel_generation = _az_context_get_cancel_generation();
+  int64_t const parent_expiration = az_context_get_expiration(parent);
+
+  return (az_context){ ._internal = { .parent = parent,
                                       .expiration = _az_CONTEXT_MAX_EXPIRATION,
                                       .key = key,
-                                      .value = value } };
+                                      .value = value,
+                                      .effective_expiration = parent_expiration,
+                                      .cancel_generation = cancel_generation } };
 }
 
 /**
  * @brief az_context_cancel cancels the specified az_context node; this cancels all the child nodes
- * as well.
+ * as well. The cancel callbacks registered on the node or on its children are invoked before it
+ * returns.
  *
  * @param[in] context A pointer to the az_context node to be canceled; passing NULL cancels the root
  * az_context_app.
  */
-AZ_INLINE void az_context_cancel(az_context* context)
-{
-  context = ((context != NULL) ? context : &az_context_app);
-  context->_internal.expiration = 0; // The beginning of time
-}
-
-/**
- * @brief az_context_get_expiration returns the soonest expiration time of this az_context node or
- * any of its parent nodes.
- *
- * @param context A pointer to an az_context node
- * @return the soonest expiration time from this context and its parents
- */
-AZ_NODISCARD int64_t az_context_get_expiration(az_context const* context);
+void az_context_cancel(az_context* context);
 
 /**
  * @brief az_context_has_expired returns true if this az_context node or any of its parent nodes'
@@ -128,6 +154,70 @@ AZ_NODISCARD AZ_INLINE bool az_context_has_expired(az_context const* context, in
  */
 AZ_NODISCARD az_result az_context_get_value(az_context const* context, void* key, void** out_value);
 
+/**
+ * @brief az_context_cancel_fn defines the signature of the callback invoked when a context, or one
+ * of its parents, is canceled. It is called from the thread that calls az_context_cancel, without
+ * holding the lock of the registered callbacks, and must not unregister its own registration. To
+ * wake up a thread blocked on another object (an eventfd, a condition variable, a socket, ...),
+ * signal that object from the callback.
+ *
+ * @param[in] context The context the callback was registered on.
+ * @param[in] user_context The user_context passed to az_context_register_cancel_callback.
+ */
+typedef void (*az_context_cancel_fn)(az_context const* context, void* user_context);
+
+typedef struct az_context_cancel_callback az_context_cancel_callback;
+
+/**
+ * @brief A registration of an az_context_cancel_fn. The caller owns the storage, which must stay
+ * valid until the callback is unregistered or invoked.
+ *
+ * User should not access _internal field.
+ */
+struct az_context_cancel_callback
+{
+  struct
+  {
+    az_context const* context;
+    az_context_cancel_fn callback;
+    void* user_context;
+    az_context_cancel_callback* next;
+  } _internal;
+};
+
+/**
+ * @brief az_context_register_cancel_callback registers a callback that az_context_cancel invokes
+ * once, when \p context or any of its parents is canceled. The callback is unregistered when it is
+ * invoked.
+ *
+ * Contexts reaching their expiration time are not canceled, and don't invoke the callback.
+ *
+ * @param[in] context The context to watch.
+ * @param[out] registration Storage of the registration.
+ * @param[in] callback The function to invoke.
+ * @param[in] user_context A pointer passed to the callback.
+ * @return  #AZ_OK if the callback is registered
+ *          #AZ_ERROR_CANCELED if the context is already canceled; the callback is not registered.
+ */
+AZ_NODISCARD az_result az_context_register_cancel_callback(
+    az_context const* context,
+    az_context_cancel_callback* registration,
+    az_context_cancel_fn callback,
+    void* user_context);
+
+/**
+ * @brief az_context_unregister_cancel_callback unregisters a callback. Once it returns, the
+ * callback is not running and is not going to be invoked: if az_context_cancel is invoking it on
+ * another thread, it waits for the callback to return.
+ *
+ * A callback must not unregister its own registration, which az_context_cancel already removed
+ * before invoking it: waiting for the callback to return would never end. It is detected as a
+ * precondition failure.
+ *
+ * @param[in] registration The registration to remove.
+ */
+void az_context_unregister_cancel_callback(az_context_cancel_callback* registration);
+
 #include <_az_cfg_suffix.h>
 
 #endif // _az_CONTEXT_H
@@ -14,6 +14,7 @@
 #include <az_result.h>
 #include <az_span.h>
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -22,6 +23,7 @@
 enum
 {
   _az_TOKEN_BUF_SIZE = 2 * 1024,
+  _az_TOKEN_CACHE_KEY_BUF_SIZE = 256,
 };
 
 /**
@@ -39,6 +41,49 @@ typedef struct
   } _internal;
 } _az_token;
 
+/**
+ * @brief An entry of the shared token cache. It holds a copy of the (tenant_id, client_id, scopes)
+ * key and the token that was issued for it. User should not access _internal field.
+ *
+ */
+typedef struct
+{
+  struct
+  {
+    uint8_t key[_az_TOKEN_CACHE_KEY_BUF_SIZE];
+    int16_t tenant_id_length;
+    int16_t client_id_length;
+    int16_t scopes_length;
+    _az_token token;
+  } _internal;
+} az_credential_token_cache_entry;
+
+/**
+ * @brief Initialize the process-wide token cache that credentials can opt into to share access
+ * tokens issued for the same tenant, client and scopes.
+ *
+ * @remark This function must be called before any credential that uses the cache is created. The
+ * cache is guarded by a platform mutex, initialized once by the first call. On platforms without
+ * mutexes, the cache is not locked, and credentials using it must be used by one thread at a time.
+ *
+ * @param entries Storage for the cache entries. It must outlive every credential using the cache.
+ * When all entries are in use, the one closest to expiration is replaced.
+ * @param entries_length Number of elements in \p entries.
+ * @return AZ_OK = Successfull initialization <br>
+ * Other value = Initialization failed
+ */
+AZ_NODISCARD az_result az_credential_token_cache_init(
+    az_credential_token_cache_entry* entries,
+    int32_t entries_length);
+
+/**
+ * @brief Remove every token from the process-wide token cache.
+ *
+ * @return AZ_OK = Cache cleared <br>
+ * Other value = Cache is not initialized or it could not be locked
+ */
+AZ_NODISCARD az_result az_credential_token_cache_clear();
+
 /**
  * @brief function callback definition as a contract to be implemented for a credential
  *
@@ -88,6 +133,7 @@ typedef struct
     az_span client_secret;
     az_span scopes;
     _az_token token;
+    bool use_token_cache;
   } _internal;
 } az_credential_client_secret;
 
@@ -108,6 +154,21 @@ AZ_NODISCARD az_result az_credential_client_secret_init(
     az_span client_id,
     az_span client_secret);
 
+/**
+ * @brief Make a client secret credential look up and store its tokens in the process-wide token
+ * cache, so that credentials with the same tenant, client and scopes share a single token.
+ *
+ * @param self reference to a client secret credential
+ * @param use_token_cache `true` to use the token cache, `false` to keep a private token only
+ * @remark When the token cache was not initialized, or it fails to be locked, the credential keeps
+ * using its own token.
+ *
+ * @return AZ_OK = Success
+ */
+AZ_NODISCARD az_result az_credential_client_secret_set_use_token_cache(
+    az_credential_client_secret* self,
+    bool use_token_cache);
+
 #include <_az_cfg_suffix.h>
 
 #endif // _az_CREDENTIALS_H
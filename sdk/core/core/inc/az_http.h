@@ -36,6 +36,31 @@ typedef az_span az_http_method;
  */
 typedef az_span _az_http_headers;
 
+/**
+ * @brief Latency breakdown of an HTTP request going through the HTTP pipeline. Durations are in
+ * milliseconds, a duration of -1 means it was not measured (for example, the transport doesn't
+ * report connection phases).
+ *
+ * Connection phases (DNS, connect, TLS, first byte) are reported by the transport for the last
+ * attempt only.
+ *
+ */
+typedef struct
+{
+  int64_t queue_msec; ///< Time in the pipeline before the request first reached the transport.
+  int64_t dns_msec; ///< Time to resolve the host name.
+  int64_t connect_msec; ///< Time to establish the TCP connection, after name resolution.
+  int64_t tls_msec; ///< Time of the TLS handshake, after the TCP connection was established.
+  int64_t first_byte_msec; ///< Time from the start of the attempt until the first response byte.
+  int64_t total_msec; ///< Total time spent in the pipeline, including retries.
+  int32_t retry_count; ///< Number of times the request was retried.
+  int64_t retry_delay_msec; ///< Total time spent waiting before retries.
+  struct
+  {
+    int64_t start_msec;
+  } _internal;
+} az_http_request_metrics;
+
 /**
  * @brief Defines an az_http_request. This is an internal structure that is used to perform an http
  * request to Azure. It contains an HTTP method, url, headers and body. It also contains another
@@ -54,9 +79,31 @@ typedef struct
     int32_t max_headers;
     int32_t retry_headers_start_byte_offset;
     az_span body;
+    az_span const* body_parts; // NULL when the body is the single span above
+    int32_t body_parts_length;
+    az_http_request_metrics* metrics; // NULL when metrics are not collected
+    bool api_version_set; // The api version policy doesn't set it again.
   } _internal;
 } _az_http_request;
 
+/**
+ * @brief The constant parts of the requests of an operation: method, URL with its constant path and
+ * query, and constant headers. They are built once, e.g. when a client is initialized, and copied
+ * into each request, which then only gets its variable parts.
+ *
+ */
+typedef struct
+{
+  struct
+  {
+    az_http_method method;
+    az_span url;
+    int32_t query_start;
+    _az_http_headers headers; // Contains az_pairs
+    bool api_version_set;
+  } _internal;
+} _az_http_prepared_request;
+
 typedef enum
 {
   AZ_HTTP_RESPONSE_KIND_STATUS_LINE = 0,
@@ -130,6 +177,36 @@ struct _az_http_policy
   } _internal;
 };
 
+/**
+ * @brief Where a policy provided by the application runs in the pipeline of a client.
+ *
+ */
+typedef enum
+{
+  AZ_HTTP_POLICY_POSITION_PER_CALL = 0, ///< Once per operation, before the retry policy.
+  AZ_HTTP_POLICY_POSITION_PER_RETRY = 1, ///< Once per attempt, after the credential policy.
+} az_http_policy_position;
+
+/**
+ * @brief A policy provided by the application, e.g. to cache, compress or throttle requests.
+ *
+ * Its process callback gets the rest of the pipeline, and calls az_http_pipeline_nextpolicy() to
+ * send the request, unless it provides the response itself.
+ *
+ */
+typedef struct
+{
+  _az_http_policy_process_fn process;
+  void* options; ///< Passed to process. It must stay valid while the client is used.
+  az_http_policy_position position;
+} az_http_user_policy;
+
+enum
+{
+  /// The maximum number of policies an application can add to the pipeline of a client.
+  AZ_HTTP_PIPELINE_USER_POLICIES_MAX = 6,
+};
+
 /**
  * @brief Internal definition of an HTTP pipeline.
  *
@@ -142,7 +219,7 @@ typedef struct
 {
   struct
   {
-    _az_http_policy p_policies[10];
+    _az_http_policy p_policies[10 + AZ_HTTP_PIPELINE_USER_POLICIES_MAX];
   } _internal;
 } _az_http_pipeline;
 
@@ -0,0 +1,186 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file az_http_cache.h
+ *
+ * @brief A client-side cache of HTTP GET responses, served by a pipeline policy without sending
+ * the requests.
+ *
+ * @details Responses are stored whole (status line, headers and body) in a buffer provided by the
+ * application, which is split into one slot per entry: a response bigger than a slot is not
+ * cached. Entries are spread over shards by the hash of their URL. Each shard has its own lock
+ * and least recently used list, so that requests for different URLs rarely wait for each other.
+ * The locks are platform mutexes shared by all the caches: the first shard of each cache uses the
+ * first one, and so on.
+ *
+ * A response is fresh for the `max-age` of its `Cache-Control` header, or else for the default
+ * time to live of the cache. Once stale, a response with an `ETag` is revalidated with an
+ * `If-None-Match` request: a `304 Not Modified` response makes it fresh again, and the cached
+ * response is returned instead. Responses with `Cache-Control: no-store` are not cached, and any
+ * other request than GET removes the response cached for its URL.
+ *
+ * The key of an entry is the URL of the request. Requests sent with different credentials must not
+ * share a cache.
+ */
+
+#ifndef _az_HTTP_CACHE_H
+#define _az_HTTP_CACHE_H
+
+#include <az_http.h>
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdint.h>
+
+#include <_az_cfg_prefix.h>
+
+enum
+{
+  AZ_HTTP_CACHE_SHARDS_MAX = 8, ///< The maximum number of shards of an az_http_cache.
+};
+
+/**
+ * @brief An entry of an az_http_cache. User should not access _internal field.
+ *
+ */
+typedef struct
+{
+  struct
+  {
+    uint8_t* slot; // The URL, followed by the response.
+    uint32_t hash; // Of the URL.
+    int32_t url_length; // 0 when the entry is empty.
+    int32_t response_length;
+    int64_t expires_at_msec;
+    int32_t previous; // More recently used entry of the shard, -1 for the first one.
+    int32_t next; // Less recently used entry of the shard, -1 for the last one.
+    int32_t pins; // Revalidations in progress. A pinned entry is not evicted.
+  } _internal;
+} az_http_cache_entry;
+
+/**
+ * @brief A part of an az_http_cache with its own lock. User should not access _internal field.
+ *
+ */
+typedef struct
+{
+  struct
+  {
+    az_http_cache_entry* entries;
+    int32_t entries_length;
+    int32_t first; // The most recently used entry, -1 if the shard is empty.
+    int32_t last; // The least recently used entry, -1 if the shard is empty.
+    int64_t hits;
+    int64_t revalidations;
+    int64_t misses;
+  } _internal;
+} _az_http_cache_shard;
+
+/**
+ * @brief Options of an az_http_cache.
+ *
+ */
+typedef struct
+{
+  int32_t shards; ///< Number of shards, up to #AZ_HTTP_CACHE_SHARDS_MAX.
+  int32_t default_ttl_msec; ///< How long responses without `max-age` are fresh.
+} az_http_cache_options;
+
+/**
+ * @brief A client-side cache of HTTP GET responses. User should not access _internal field.
+ *
+ */
+typedef struct
+{
+  struct
+  {
+    _az_http_cache_shard shards[AZ_HTTP_CACHE_SHARDS_MAX];
+    int32_t shards_length;
+    int32_t slot_size;
+    int32_t default_ttl_msec;
+  } _internal;
+} az_http_cache;
+
+/**
+ * @brief Counters of an az_http_cache.
+ *
+ */
+typedef struct
+{
+  int64_t hits; ///< Requests served from fresh responses.
+  int64_t revalidations; ///< Requests served from stale responses after a `304 Not Modified`.
+  int64_t misses; ///< GET requests sent, including revalidations which got a new response.
+} az_http_cache_stats;
+
+/**
+ * @brief Get the default options of an az_http_cache: 4 shards, and a time to live of 1 minute.
+ *
+ */
+AZ_NODISCARD az_http_cache_options az_http_cache_options_default();
+
+/**
+ * @brief Initialize an empty az_http_cache.
+ *
+ * @remark Shards are guarded by platform mutexes, initialized by the first call, which must not run
+ * while other caches are used. On platforms without mutexes, caches must be used by one thread at
+ * a time.
+ *
+ * @param cache az_http_cache to initialize
+ * @param entries Storage for the entries, split evenly between the shards. It must outlive the
+ * cache.
+ * @param entries_length Number of elements in \p entries, at least one per shard.
+ * @param buffer Storage for the URLs and responses, split evenly between the entries. Its capacity
+ * is the memory used by the cache. It must outlive the cache.
+ * @param options Options of the cache, NULL for the default ones.
+ * @return AZ_OK = Successfull initialization <br>
+ * AZ_ERROR_ARG = There are more shards than entries, or than #AZ_HTTP_CACHE_SHARDS_MAX <br>
+ * Other value = A mutex could not be initialized
+ */
+AZ_NODISCARD az_result az_http_cache_init(
+    az_http_cache* cache,
+    az_http_cache_entry* entries,
+    int32_t entries_length,
+    az_span buffer,
+    az_http_cache_options const* options);
+
+/**
+ * @brief Get the counters of an az_http_cache.
+ *
+ * @param cache az_http_cache to read
+ * @param out_stats receives the counters, summed over all the shards
+ * @return AZ_OK = Counters read <br>
+ * Other value = A shard could not be locked
+ */
+AZ_NODISCARD az_result
+az_http_cache_get_stats(az_http_cache* cache, az_http_cache_stats* out_stats);
+
+/**
+ * @brief The policy serving requests from an az_http_cache, given as options.
+ *
+ */
+AZ_NODISCARD az_result az_http_pipeline_policy_cache(
+    _az_http_policy* p_policies,
+    void* p_options,
+    _az_http_request* p_request,
+    az_http_response* p_response);
+
+/**
+ * @brief Get the policy to add to the options of a client to use an az_http_cache. It runs once
+ * per call, before the retry policy, so that cache hits are not retried.
+ *
+ * @param cache az_http_cache to use
+ * @return The policy to add to the pipeline
+ */
+AZ_NODISCARD AZ_INLINE az_http_user_policy az_http_cache_user_policy(az_http_cache* cache)
+{
+  return (az_http_user_policy){
+    .process = az_http_pipeline_policy_cache,
+    .options = cache,
+    .position = AZ_HTTP_POLICY_POSITION_PER_CALL,
+  };
+}
+
+#include <_az_cfg_suffix.h>
+
+#endif // _az_HTTP_CACHE_H
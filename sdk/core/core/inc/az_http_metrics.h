@@ -0,0 +1,188 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file az_http_metrics.h
+ *
+ * @brief Latency histograms of the requests sent through an HTTP pipeline.
+ */
+
+#ifndef _az_HTTP_METRICS_H
+#define _az_HTTP_METRICS_H
+
+#include <az_context.h>
+#include <az_http.h>
+#include <az_result.h>
+
+#include <stdint.h>
+
+#include <_az_cfg_prefix.h>
+
+enum
+{
+  _az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS = 4,
+  _az_HTTP_METRICS_HISTOGRAM_BUCKETS = 64,
+};
+
+/**
+ * @brief A histogram of durations in milliseconds. Each power of two is split into 4 buckets, so
+ * recorded values are kept with a precision of 25%. The last bucket holds the durations from
+ * 114688 ms up to 131071 ms (about 131 s), and every longer one: percentiles that fall in it are
+ * reported as the max duration recorded.
+ *
+ * @remark Recording is lock free, a histogram can be updated by several threads at once.
+ *
+ * User should not access _internal field.
+ *
+ */
+typedef struct
+{
+  struct
+  {
+    int32_t volatile counts[_az_HTTP_METRICS_HISTOGRAM_BUCKETS];
+    int64_t volatile count;
+    int64_t volatile sum;
+    int64_t volatile min_plus_one; // 0 when nothing was recorded yet.
+    int64_t volatile max;
+  } _internal;
+} az_http_metrics_histogram;
+
+/**
+ * @brief Summary of an az_http_metrics_histogram. Percentiles are the highest value of the bucket
+ * where they fall. All values are 0 when the histogram is empty.
+ *
+ */
+typedef struct
+{
+  int64_t count;
+  int64_t min_msec;
+  int64_t max_msec;
+  int64_t mean_msec;
+  int64_t p50_msec;
+  int64_t p90_msec;
+  int64_t p99_msec;
+} az_http_metrics_histogram_snapshot;
+
+/**
+ * @brief Latency histograms for a set of requests, one per phase of az_http_request_metrics.
+ *
+ * One az_http_metrics can be given to a client in its options, to collect the metrics of all the
+ * requests it sends. To collect metrics per operation, use az_context_with_http_metrics.
+ *
+ * @remark Recording is lock free, so one az_http_metrics can be shared by requests sent
+ * concurrently.
+ *
+ * User should not access _internal field.
+ *
+ */
+typedef struct
+{
+  struct
+  {
+    az_http_metrics_histogram queue;
+    az_http_metrics_histogram dns;
+    az_http_metrics_histogram connect;
+    az_http_metrics_histogram tls;
+    az_http_metrics_histogram first_byte;
+    az_http_metrics_histogram total;
+    az_http_metrics_histogram retry_delay;
+    int64_t volatile retry_count;
+    uint32_t volatile last_request_sequence; // Odd while last_request is written.
+    az_http_request_metrics last_request;
+  } _internal;
+} az_http_metrics;
+
+/**
+ * @brief A snapshot of az_http_metrics.
+ *
+ */
+typedef struct
+{
+  int64_t request_count;
+  int64_t retry_count;
+  az_http_metrics_histogram_snapshot queue;
+  az_http_metrics_histogram_snapshot dns;
+  az_http_metrics_histogram_snapshot connect;
+  az_http_metrics_histogram_snapshot tls;
+  az_http_metrics_histogram_snapshot first_byte;
+  az_http_metrics_histogram_snapshot total;
+  az_http_metrics_histogram_snapshot retry_delay;
+} az_http_metrics_snapshot;
+
+/**
+ * @brief Initialize az_http_metrics with empty histograms.
+ *
+ * @param self az_http_metrics to initialize
+ * @return AZ_OK = Successfull initialization
+ */
+AZ_NODISCARD az_result az_http_metrics_init(az_http_metrics* self);
+
+/**
+ * @brief Record a duration into a histogram. Negative durations are ignored.
+ *
+ * @param self histogram to record to
+ * @param value_msec duration in milliseconds
+ */
+void az_http_metrics_histogram_record(az_http_metrics_histogram* self, int64_t value_msec);
+
+/**
+ * @brief Get the value below which the given percentage of the recorded durations fall.
+ *
+ * @param self histogram to read
+ * @param percentile a percentage, from 0 to 100
+ * @return the highest value of the bucket where the percentile falls, or 0 if the histogram is
+ * empty
+ */
+AZ_NODISCARD int64_t
+az_http_metrics_histogram_get_percentile(az_http_metrics_histogram const* self, int32_t percentile);
+
+/**
+ * @brief Summarize a histogram.
+ *
+ * @param self histogram to summarize
+ * @param out_snapshot receives the summary
+ */
+void az_http_metrics_histogram_get_snapshot(
+    az_http_metrics_histogram const* self,
+    az_http_metrics_histogram_snapshot* out_snapshot);
+
+/**
+ * @brief Record the metrics of one request.
+ *
+ * @param self az_http_metrics to record to
+ * @param request_metrics metrics of a request
+ */
+void az_http_metrics_record(az_http_metrics* self, az_http_request_metrics const* request_metrics);
+
+/**
+ * @brief Take a snapshot of all the histograms.
+ *
+ * @param self az_http_metrics to read
+ * @param out_snapshot receives the summary of every histogram
+ */
+void az_http_metrics_get_snapshot(
+    az_http_metrics const* self,
+    az_http_metrics_snapshot* out_snapshot);
+
+/**
+ * @brief Get the metrics of the last request recorded.
+ *
+ * @param self az_http_metrics to read
+ * @return the metrics of the last request
+ */
+AZ_NODISCARD az_http_request_metrics az_http_metrics_get_last_request(az_http_metrics const* self);
+
+/**
+ * @brief Create a context that makes the metrics policy record the requests sent with it to
+ * \p metrics, instead of the az_http_metrics of the client.
+ *
+ * @param[in] parent The parent az_context; passing NULL sets the parent to az_context_app.
+ * @param[in] metrics az_http_metrics to record requests to
+ * @return The new child az_context node
+ */
+AZ_NODISCARD az_context
+az_context_with_http_metrics(az_context const* parent, az_http_metrics* metrics);
+
+#include <_az_cfg_suffix.h>
+
+#endif // _az_HTTP_METRICS_H
@@ -0,0 +1,143 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file az_http_tracing.h
+ *
+ * @brief Distributed tracing of the requests sent through an HTTP pipeline, compatible with W3C
+ * Trace Context and OpenTelemetry.
+ */
+
+#ifndef _az_HTTP_TRACING_H
+#define _az_HTTP_TRACING_H
+
+#include <az_context.h>
+#include <az_http.h>
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <_az_cfg_prefix.h>
+
+enum
+{
+  AZ_HTTP_TRACING_TRACE_ID_SIZE = 16, ///< Size in bytes of a trace id.
+  AZ_HTTP_TRACING_SPAN_ID_SIZE = 8, ///< Size in bytes of a span id.
+  AZ_HTTP_TRACING_TRACEPARENT_SIZE = 55, ///< Length of a `traceparent` header value.
+};
+
+typedef struct az_http_tracing_span az_http_tracing_span;
+
+/**
+ * @brief az_http_tracing_export_fn defines the signature of the callback that receives every
+ * finished span. The span is only valid during the call.
+ *
+ * @param span The finished span.
+ * @param exporter_context The exporter_context of az_http_tracing_options.
+ */
+typedef void (*az_http_tracing_export_fn)(az_http_tracing_span const* span, void* exporter_context);
+
+/**
+ * @brief Options of the tracing policy.
+ *
+ */
+typedef struct
+{
+  az_http_tracing_export_fn exporter; ///< Receives finished spans.
+  void* exporter_context; ///< Passed to the exporter.
+  /// Unix time in milliseconds at which the platform clock read 0, to convert the times of spans
+  /// to Unix time. When 0, it is taken once from the wall clock, with a precision of one second.
+  int64_t clock_epoch_msec;
+} az_http_tracing_options;
+
+/**
+ * @brief A span of a trace. The tracing policy starts one span for each operation sent through the
+ * pipeline, and the retry policy starts one child span for each attempt.
+ *
+ * Times are measured with the platform clock, in milliseconds. az_http_tracing_span_to_json
+ * converts them to Unix time.
+ *
+ * User should not access _internal field.
+ *
+ */
+struct az_http_tracing_span
+{
+  uint8_t trace_id[AZ_HTTP_TRACING_TRACE_ID_SIZE];
+  uint8_t span_id[AZ_HTTP_TRACING_SPAN_ID_SIZE];
+  uint8_t parent_span_id[AZ_HTTP_TRACING_SPAN_ID_SIZE];
+  bool has_parent; ///< `false` for the root span of a trace.
+  az_span name; ///< HTTP method of the request.
+  az_span url; ///< URL of the request, only valid until the span is exported.
+  int16_t attempt; ///< 0 for an operation span, otherwise the number of the attempt.
+  int64_t start_msec;
+  int64_t end_msec;
+  az_result result; ///< Result of the operation or attempt.
+  az_http_status_code status_code; ///< HTTP status code, or AZ_HTTP_STATUS_CODE_NONE.
+  int32_t request_body_length;
+  int32_t response_length;
+  struct
+  {
+    az_http_tracing_options const* options;
+    uint8_t traceparent[AZ_HTTP_TRACING_TRACEPARENT_SIZE]; // value of the request header
+  } _internal;
+};
+
+/**
+ * @brief Format the `traceparent` header value of a span: `00-<trace id>-<span id>-01`.
+ *
+ * @param span a span
+ * @param destination buffer where to write the header value. It needs a capacity of at least
+ * AZ_HTTP_TRACING_TRACEPARENT_SIZE bytes.
+ * @param out_traceparent receives the header value
+ * @return AZ_OK = success <br>
+ * AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY = destination is too small
+ */
+AZ_NODISCARD az_result az_http_tracing_span_get_traceparent(
+    az_http_tracing_span const* span,
+    az_span destination,
+    az_span* out_traceparent);
+
+/**
+ * @brief Serialize a span as an OTLP/JSON span object, so that exporters can write it to a file
+ * or send it to a collector. Its times are the platform clock times of the span plus the
+ * clock_epoch_msec of the options the span was started with, or the epoch taken from the wall
+ * clock for spans started without options.
+ *
+ * @param span a span
+ * @param destination buffer where to write the JSON object
+ * @param out_json receives the JSON object
+ * @return AZ_OK = success <br>
+ * AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY = destination is too small
+ */
+AZ_NODISCARD az_result az_http_tracing_span_to_json(
+    az_http_tracing_span const* span,
+    az_span destination,
+    az_span* out_json);
+
+/**
+ * @brief Create a context that carries a span. Operations sent with this context start their
+ * spans as children of \p span, in the same trace.
+ *
+ * @param[in] parent The parent az_context; passing NULL sets the parent to az_context_app.
+ * @param[in] span The span to carry.
+ * @return The new child az_context node
+ */
+AZ_NODISCARD az_context
+az_context_with_http_tracing_span(az_context const* parent, az_http_tracing_span* span);
+
+/**
+ * @brief Get the span carried by a context or one of its parents.
+ *
+ * @param[in] context The az_context node where lookup starts.
+ * @param[out] out_span receives the span
+ * @return AZ_OK = a span was found <br>
+ * AZ_ERROR_ITEM_NOT_FOUND = the context doesn't carry a span
+ */
+AZ_NODISCARD az_result
+az_context_get_http_tracing_span(az_context const* context, az_http_tracing_span** out_span);
+
+#include <_az_cfg_suffix.h>
+
+#endif // _az_HTTP_TRACING_H
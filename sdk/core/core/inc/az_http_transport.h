@@ -51,7 +51,8 @@ az_http_request_get_header(_az_http_request const* request, int32_t index, az_pa
  * @param request HTTP request to get parts from.
  * @param out_method Pointer to write HTTP method to.
  * @param out_url Pointer to write URL to.
- * @param out_body Pointer to write HTTP request body to.
+ * @param out_body Pointer to write HTTP request body to. It is empty if the body is made of several
+ * parts: see az_http_request_get_body_parts().
  *
  * @retval AZ_OK Success.
  */
@@ -61,6 +62,57 @@ AZ_NODISCARD az_result az_http_request_get_parts(
     az_span* out_url,
     az_span* out_body);
 
+/**
+ * @brief Get the parts of an HTTP request body, to be sent one after the other.
+ *
+ * @param request HTTP request to get the body parts from.
+ * @param out_parts Pointer to write the array of body parts to. A body that is a single span is
+ * one part.
+ * @param out_parts_length Pointer to write the number of body parts to.
+ *
+ * @retval AZ_OK Success.
+ */
+AZ_NODISCARD az_result az_http_request_get_body_parts(
+    _az_http_request const* request,
+    az_span const** out_parts,
+    int32_t* out_parts_length);
+
+/**
+ * @brief Get the length of an HTTP request body, all parts included.
+ *
+ * @param request HTTP request to get the body length of.
+ *
+ * @return The length of the body.
+ */
+AZ_NODISCARD int32_t az_http_request_get_body_length(_az_http_request const* request);
+
+/**
+ * @brief Sends a request to the next policies of a pipeline, e.g. from the process callback of an
+ * #az_http_user_policy.
+ *
+ * @param p_policies The policies received by the calling policy.
+ * @param p_request HTTP request to send.
+ * @param p_response HTTP response the next policies write the response to.
+ *
+ * @retval AZ_OK Success.
+ * @retval AZ_ERROR_HTTP_PIPELINE_INVALID_POLICY The calling policy is the last one.
+ */
+AZ_NODISCARD AZ_INLINE az_result az_http_pipeline_nextpolicy(
+    _az_http_policy* p_policies,
+    _az_http_request* p_request,
+    az_http_response* p_response)
+{
+  // Transport Policy is the last policy in the pipeline
+  //  it returns without calling nextpolicy
+  if (p_policies[0]._internal.process == NULL)
+  {
+    return AZ_ERROR_HTTP_PIPELINE_INVALID_POLICY;
+  }
+
+  return p_policies[0]._internal.process(
+      &(p_policies[1]), p_policies[0]._internal.p_options, p_request, p_response);
+}
+
 #include <_az_cfg_suffix.h>
 
 #endif // _az_HTTP_TRANSPORT_H
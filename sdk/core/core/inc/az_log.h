@@ -11,6 +11,7 @@
 #ifndef _az_LOG_H
 #define _az_LOG_H
 
+#include <az_config.h>
 #include <az_result.h>
 #include <az_span.h>
 
@@ -57,7 +58,9 @@ typedef void (*az_log_message_fn)(az_log_classification classification, az_span
  * (NULL), the application will receive log messages for all az_log_classification values.
  *
  * @param classifications An array of az_log_classification values.
- *                        The last element of the array must be AZ_LOG_END_OF_LIST.
+ *                        The last element of the array must be AZ_LOG_END_OF_LIST. It must stay
+ *                        valid until classifications are set again: the ones with a facility or
+ *                        a code of 8 or more are looked up in it.
  */
 void az_log_set_classifications(az_log_classification const classifications[]);
 
@@ -71,6 +74,67 @@ void az_log_set_classifications(az_log_classification const classifications[]);
  */
 void az_log_set_callback(az_log_message_fn az_log_message_callback);
 
+enum
+{
+  _az_LOG_RECORD_METHOD_BUF_SIZE = 8,
+};
+
+/**
+ * @brief az_log_record is a fixed-size binary log record that the Azure SDK client libraries
+ * capture instead of formatting a log message, when deferred logging is enabled. User should not
+ * access _internal field.
+ */
+typedef struct
+{
+  struct
+  {
+    az_log_classification classification;
+    int64_t duration_msec; ///< Time spent waiting for the HTTP response.
+    int32_t status_code; ///< HTTP status code of the response.
+    int32_t headers_count; ///< Number of HTTP request or response headers.
+    int32_t body_length; ///< Size of the HTTP request or response body.
+    int32_t retry_attempt;
+    int32_t retry_delay_msec;
+    int32_t url_length; ///< Length of the URL, it may be longer than the copy kept in the record.
+    uint8_t url[AZ_LOG_RECORD_URL_BUF_SIZE];
+    uint8_t method[_az_LOG_RECORD_METHOD_BUF_SIZE];
+    int8_t method_length;
+    uint32_t volatile sequence; ///< Ring position the record is free for, or published at plus 1.
+  } _internal;
+} az_log_record;
+
+/**
+ * @brief az_log_set_deferred switches logging to deferred mode, where the Azure SDK client
+ * libraries only copy a few fields of each request, response and retry into a ring of
+ * az_log_record instead of formatting a log message and invoking the log callback while the
+ * request is being processed. Messages are formatted and passed to the log callback when
+ * az_log_flush is called.
+ *
+ * @remark The records ring is a multi-producer, single-consumer queue: any number of threads
+ * may send requests while one thread at a time calls az_log_flush. When the ring is full, new
+ * records are dropped.
+ *
+ * @param records An array of az_log_record values used as the ring, or NULL to go back to
+ * logging synchronously. It must stay valid until deferred logging is turned off.
+ * @param records_length The number of elements in \p records. Only the largest power of two that
+ * is not above it is used.
+ */
+void az_log_set_deferred(az_log_record* records, int32_t records_length);
+
+/**
+ * @brief az_log_flush formats every pending deferred log record and passes it to the log
+ * callback.
+ *
+ * @return The number of records that were flushed.
+ */
+int32_t az_log_flush();
+
+/**
+ * @brief az_log_get_dropped_count returns the number of deferred log records that were dropped
+ * because the ring was full.
+ */
+int32_t az_log_get_dropped_count();
+
 #include <_az_cfg_suffix.h>
 
 #endif // _az_LOG_H
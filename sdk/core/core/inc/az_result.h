@@ -113,6 +113,14 @@ typedef enum
 
   AZ_ERROR_HTTP_RESPONSE_OVERFLOW = _az_RESULT_MAKE_ERROR(_az_FACILITY_HTTP, 5),
   AZ_ERROR_HTTP_RESPONSE_COULDNT_RESOLVE_HOST = _az_RESULT_MAKE_ERROR(_az_FACILITY_HTTP, 6),
+
+  AZ_ERROR_HTTP_UNEXPECTED_STATUS_CODE = _az_RESULT_MAKE_ERROR(
+      _az_FACILITY_HTTP,
+      7), ///< The service answered with an error status code the caller doesn't handle.
+
+  // IoT error codes
+  AZ_ERROR_IOT_TOPIC_NO_MATCH
+  = _az_RESULT_MAKE_ERROR(_az_FACILITY_IOT, 1), ///< The topic is not of the expected kind.
 } az_result;
 
 /// Checks wheteher the \a result provided indicates a failure.
@@ -206,6 +206,33 @@ AZ_NODISCARD AZ_INLINE bool az_span_is_content_equal(az_span span1, az_span span
  */
 AZ_NODISCARD bool az_span_is_content_equal_ignoring_case(az_span span1, az_span span2);
 
+/**
+ * @brief az_span_find_byte searches \p span for a byte
+ *
+ * @param[in] span The span to search
+ * @param[in] byte The byte to search for
+ * @return The index of the first occurrence of \p byte in \p span, or -1 if not found.
+ */
+AZ_NODISCARD int32_t az_span_find_byte(az_span span, uint8_t byte);
+
+/**
+ * @brief az_span_find_any searches \p span for any of the bytes of a set
+ *
+ * @param[in] span The span to search
+ * @param[in] set The bytes to search for, e.g. delimiters
+ * @return The index of the first byte of \p span found in \p set, or -1 if not found.
+ */
+AZ_NODISCARD int32_t az_span_find_any(az_span span, az_span set);
+
+/**
+ * @brief az_span_find searches \p span for the content of \p target
+ *
+ * @param[in] span The span to search
+ * @param[in] target The content to search for
+ * @return The index of the first occurrence of \p target in \p span, or -1 if not found.
+ */
+AZ_NODISCARD int32_t az_span_find(az_span span, az_span target);
+
 /**
  * @brief az_span_to_str copies a source span containing a string (not 0-terminated) to a
  destination char buffer and appends the 0-terminating byte.
@@ -408,11 +435,38 @@ AZ_NODISCARD az_result az_span_copy(az_span destination, az_span source, az_span
  * @return An #az_result value indicating the result of the operation.
  *          #AZ_OK if successful
  *          #AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY if the \p destination is not big enough to
- * hold the source's length
+ * hold the url-encoded source. The source is encoded in a single pass, so the destination is then
+ * partially written: #az_span_url_encode_length gives the capacity needed.
  */
 AZ_NODISCARD az_result
 az_span_copy_url_encode(az_span destination, az_span source, az_span* out_span);
 
+/**
+ * @brief az_span_url_encode_length gets the length of the source span once url-encoded
+ *
+ * @param[in] source The span containing the non-url-encoded bytes
+ * @return The length of the url-encoded source
+ */
+AZ_NODISCARD int32_t az_span_url_encode_length(az_span source);
+
+/**
+ * @brief az_span_copy_url_decode copies the source span to the destination span by decoding its
+ * url-encoded (percent-encoded) characters. The destination can be the source span itself.
+ *
+ * @param[in] destination The span whose bytes will receive the decoded source
+ * @param[in] source The span containing the url-encoded bytes
+ * @param[out] out_span A pointer to an az_span that receives the span referring to the
+ * destination span with its length updated
+ * @return An #az_result value indicating the result of the operation.
+ *          #AZ_OK if successful
+ *          #AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY if the \p destination is not big enough to
+ * hold the decoded source
+ *          #AZ_ERROR_PARSER_UNEXPECTED_CHAR or #AZ_ERROR_EOF if a '%' is not followed by two
+ * hexadecimal digits
+ */
+AZ_NODISCARD az_result
+az_span_copy_url_decode(az_span destination, az_span source, az_span* out_span);
+
 /******************************  SPAN PAIR  */
 
 /**
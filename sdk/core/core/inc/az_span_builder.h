@@ -0,0 +1,182 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file az_span_builder.h
+ *
+ * @brief An az_span_builder builds a span of unknown size (a URL, a header value, a JSON payload)
+ * in an az_span_arena, instead of in a buffer whose capacity has to be guessed.
+ *
+ * @details An az_span_arena hands out spans from one or more memory blocks provided by the
+ * application, which are reused for each request by resetting the arena. A builder always takes
+ * the rest of the current block, and grows in place. When the block is full, the content of the
+ * builder moves to the next block. Spans allocated before the builder are never moved.
+ */
+
+#ifndef _az_SPAN_BUILDER_H
+#define _az_SPAN_BUILDER_H
+
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdint.h>
+
+#include <_az_cfg_prefix.h>
+
+/**
+ * An az_span_arena allocates spans from a chain of memory blocks.
+ */
+typedef struct
+{
+  struct
+  {
+    az_span* blocks;
+    int32_t blocks_length;
+    int32_t block; // The block allocations are made from.
+    int32_t used; // The size allocated in that block.
+  } _internal;
+} az_span_arena;
+
+/**
+ * An az_span_builder appends content to the last allocation of an az_span_arena.
+ */
+typedef struct
+{
+  struct
+  {
+    az_span_arena* arena;
+    uint8_t* ptr;
+    int32_t length;
+  } _internal;
+} az_span_builder;
+
+/******************************  SPAN ARENA */
+
+/**
+ * @brief az_span_arena_init initializes an arena over memory blocks
+ *
+ * @param[out] arena The az_span_arena to initialize
+ * @param[in] blocks The memory blocks, used in order. Their capacity is used.
+ * @param[in] blocks_length The number of blocks
+ * @return An #az_result value indicating the result of the operation.
+ *          #AZ_OK if successful
+ */
+AZ_NODISCARD az_result
+az_span_arena_init(az_span_arena* arena, az_span* blocks, int32_t blocks_length);
+
+/**
+ * @brief az_span_arena_reset frees all the spans allocated from an arena, e.g. once a request is
+ * sent.
+ *
+ * @param[in,out] arena The az_span_arena to reset
+ */
+AZ_INLINE void az_span_arena_reset(az_span_arena* arena)
+{
+  arena->_internal.block = 0;
+  arena->_internal.used = 0;
+}
+
+/**
+ * @brief az_span_arena_allocate allocates an empty span from an arena
+ *
+ * @param[in,out] arena The az_span_arena to allocate from
+ * @param[in] capacity The capacity of the span
+ * @param[out] out_span A pointer to an az_span that receives an empty span of \p capacity bytes
+ * @return An #az_result value indicating the result of the operation.
+ *          #AZ_OK if successful
+ *          #AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY if none of the remaining blocks has \p capacity
+ * bytes left
+ */
+AZ_NODISCARD az_result
+az_span_arena_allocate(az_span_arena* arena, int32_t capacity, az_span* out_span);
+
+/******************************  SPAN BUILDER */
+
+/**
+ * @brief az_span_builder_init starts building a span at the end of an arena
+ *
+ * @details Until the span is built, nothing else can be allocated from the arena.
+ *
+ * @param[out] builder The az_span_builder to initialize
+ * @param[in] arena The az_span_arena the span is built in
+ * @return An #az_result value indicating the result of the operation.
+ *          #AZ_OK if successful
+ */
+AZ_NODISCARD az_result az_span_builder_init(az_span_builder* builder, az_span_arena* arena);
+
+/**
+ * @brief az_span_builder_span_get gets the content of a builder
+ *
+ * @param[in] builder The az_span_builder to get the content of
+ * @return The span built so far. It stays valid until the arena is reset, but is moved if more
+ * content is appended.
+ */
+AZ_NODISCARD AZ_INLINE az_span az_span_builder_span_get(az_span_builder const* builder)
+{
+  return az_span_init(builder->_internal.ptr, builder->_internal.length, builder->_internal.length);
+}
+
+/**
+ * @brief az_span_builder_reserve gets room to append at least \p size bytes to a builder
+ *
+ * @details The bytes are appended to the returned span, e.g. with any of the az_span_append
+ * functions, and are then added to the builder by az_span_builder_commit.
+ *
+ * @param[in,out] builder The az_span_builder to append to
+ * @param[in] size The number of bytes to append
+ * @param[out] out_span A pointer to an az_span that receives an empty span of at least \p size
+ * bytes, following the content of the builder
+ * @return An #az_result value indicating the result of the operation.
+ *          #AZ_OK if successful
+ *          #AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY if none of the remaining blocks of the arena can
+ * hold the content of the builder and \p size more bytes
+ */
+AZ_NODISCARD az_result
+az_span_builder_reserve(az_span_builder* builder, int32_t size, az_span* out_span);
+
+/**
+ * @brief az_span_builder_commit adds the bytes appended to a span from az_span_builder_reserve
+ * to a builder
+ *
+ * @param[in,out] builder The az_span_builder to append to
+ * @param[in] appended The span from az_span_builder_reserve, with the appended bytes
+ */
+void az_span_builder_commit(az_span_builder* builder, az_span appended);
+
+/**
+ * @brief az_span_builder_append appends the bytes of a span to a builder
+ *
+ * @param[in,out] builder The az_span_builder to append to
+ * @param[in] source The bytes to append
+ * @return An #az_result value indicating the result of the operation.
+ *          #AZ_OK if successful
+ *          #AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY if the arena is full
+ */
+AZ_NODISCARD az_result az_span_builder_append(az_span_builder* builder, az_span source);
+
+/**
+ * @brief az_span_builder_append_i64toa appends an int64 as digit characters to a builder
+ *
+ * @param[in,out] builder The az_span_builder to append to
+ * @param[in] source The int64 to append
+ * @return An #az_result value indicating the result of the operation.
+ *          #AZ_OK if successful
+ *          #AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY if the arena is full
+ */
+AZ_NODISCARD az_result az_span_builder_append_i64toa(az_span_builder* builder, int64_t source);
+
+/**
+ * @brief az_span_builder_append_url_encode appends the URL encoding of a span to a builder
+ *
+ * @param[in,out] builder The az_span_builder to append to
+ * @param[in] source The bytes to encode
+ * @return An #az_result value indicating the result of the operation.
+ *          #AZ_OK if successful
+ *          #AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY if the arena is full
+ */
+AZ_NODISCARD az_result
+az_span_builder_append_url_encode(az_span_builder* builder, az_span source);
+
+#include <_az_cfg_suffix.h>
+
+#endif // _az_SPAN_BUILDER_H
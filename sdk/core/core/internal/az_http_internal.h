@@ -31,6 +31,7 @@ AZ_NODISCARD AZ_INLINE int32_t _az_http_request_headers_count(_az_http_request c
 //   Transport p_policies can only allocate if the transport layer they call allocates
 // Client ->
 //  ===HttpPipelinePolicies===
+//    Metrics
 //    UniqueRequestID
 //    Retry
 //    Authentication
@@ -42,6 +43,31 @@ AZ_NODISCARD AZ_INLINE int32_t _az_http_request_headers_count(_az_http_request c
 // PipelinePolicies must implement the process function
 //
 
+/**
+ * @brief Initializes the pipeline of a client with the policies of the SDK and of the application.
+ *
+ * @details The policies of the application are inserted in order: the per-call ones before the
+ * retry policy, and the per-retry ones before the logging policy (or the transport policy, the
+ * last one). They are copied to the pipeline: nothing is allocated when requests are sent.
+ *
+ * @param pipeline The pipeline to initialize.
+ * @param policies The policies of the SDK, ending with the transport policy.
+ * @param policies_length The number of policies of the SDK.
+ * @param user_policies The policies of the application. It can be NULL if there are none.
+ * @param user_policies_length The number of policies of the application.
+ *
+ * @return
+ *   - *`AZ_OK`* success.
+ *   - *`AZ_ERROR_ARG`* there are more than #AZ_HTTP_PIPELINE_USER_POLICIES_MAX policies of the
+ * application, or an application policy has no process callback or an unknown position.
+ */
+AZ_NODISCARD az_result az_http_pipeline_init(
+    _az_http_pipeline* pipeline,
+    _az_http_policy const* policies,
+    int32_t policies_length,
+    az_http_user_policy const* user_policies,
+    int32_t user_policies_length);
+
 // Start the pipeline
 AZ_NODISCARD az_result az_http_pipeline_process(
     _az_http_pipeline* pipeline,
@@ -78,6 +104,18 @@ AZ_NODISCARD az_result az_http_pipeline_policy_credential(
     _az_http_request* p_request,
     az_http_response* p_response);
 
+AZ_NODISCARD az_result az_http_pipeline_policy_metrics(
+    _az_http_policy* p_policies,
+    void* p_options,
+    _az_http_request* p_request,
+    az_http_response* p_response);
+
+AZ_NODISCARD az_result az_http_pipeline_policy_tracing(
+    _az_http_policy* p_policies,
+    void* p_options,
+    _az_http_request* p_request,
+    az_http_response* p_response);
+
 AZ_NODISCARD az_result az_http_pipeline_policy_logging(
     _az_http_policy* p_policies,
     void* p_data,
@@ -170,6 +208,79 @@ az_http_request_set_query_parameter(_az_http_request* p_request, az_span name, a
 AZ_NODISCARD az_result
 az_http_request_append_header(_az_http_request* p_request, az_span key, az_span value);
 
+/**
+ * @brief Adds the API version to a request, as a header or a query parameter. The API version
+ * policy then doesn't add it again.
+ *
+ * @param p_request HTTP request builder to add the API version to.
+ * @param options The name, value and location of the API version.
+ *
+ * @return
+ *   - *`AZ_OK`* success.
+ *   - *`AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY`* the URL or headers buffer is full.
+ */
+AZ_NODISCARD az_result az_http_request_set_api_version(
+    _az_http_request* p_request,
+    _az_http_policy_apiversion_options const* options);
+
+/**
+ * @brief Captures the constant parts of the requests of an operation from a request built with
+ * them, e.g. with its constant path, query parameters and headers.
+ *
+ * @param prepared The prepared request to initialize.
+ * @param method HTTP verb of the operation.
+ * @param request The request to capture. Its URL and headers buffers must stay valid and unchanged
+ * while the prepared request is used, and can be shared by several prepared requests as long as
+ * they are only appended to.
+ *
+ * @return
+ *   - *`AZ_OK`* success.
+ */
+AZ_NODISCARD az_result az_http_prepared_request_init(
+    _az_http_prepared_request* prepared,
+    az_http_method method,
+    _az_http_request const* request);
+
+/**
+ * @brief Initializes a request from a prepared request, whose URL and headers are copied to the
+ * request buffers. The request only needs its variable parts next.
+ *
+ * @param p_request HTTP request builder to initialize.
+ * @param context The context of the request.
+ * @param prepared The prepared request of the operation.
+ * @param url_buffer The buffer of the request URL.
+ * @param headers_buffer The buffer of the request headers.
+ * @param body The request body.
+ *
+ * @return
+ *   - *`AZ_OK`* success.
+ *   - *`AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY`* a buffer is too small for the prepared URL or headers.
+ */
+AZ_NODISCARD az_result az_http_request_init_prepared(
+    _az_http_request* p_request,
+    az_context* context,
+    _az_http_prepared_request const* prepared,
+    az_span url_buffer,
+    az_span headers_buffer,
+    az_span body);
+
+/**
+ * @brief Sets the body of a request to several spans, sent one after the other, so that a body
+ * made of several pieces (e.g. a JSON envelope around binary content) is not copied into one
+ * buffer first.
+ *
+ * @param p_request HTTP request builder to set the body of.
+ * @param parts The body parts. The array must stay valid until the request is sent.
+ * @param parts_length The number of body parts.
+ *
+ * @return
+ *   - *`AZ_OK`* success.
+ */
+AZ_NODISCARD az_result az_http_request_set_body_parts(
+    _az_http_request* p_request,
+    az_span const* parts,
+    int32_t parts_length);
+
 #include <_az_cfg_suffix.h>
 
 #endif // _az_HTTP_INTERNAL_H
@@ -8,14 +8,79 @@
 #include <az_span.h>
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <_az_cfg_prefix.h>
 
+/*
+ * Each classification with a facility and a code below 8 maps to one bit of a 64-bit mask, so that
+ * checking whether a classification should be logged does not depend on how many classifications
+ * the user has set. The other ones map to no bit, and are looked up in the list the user set.
+ */
+enum
+{
+  _az_LOG_CLASSIFICATION_MAX_FACILITIES = 8,
+  _az_LOG_CLASSIFICATION_MAX_CODES = 8,
+};
+
+#define _az_LOG_CLASSIFICATIONS_MASK_ALL (~(uint64_t)0)
+
+AZ_NODISCARD AZ_INLINE uint64_t _az_log_classification_to_bit(az_log_classification classification)
+{
+  uint32_t const facility = (uint32_t)classification >> 16;
+  uint32_t const code = (uint32_t)classification & 0xFFFF;
+
+  return (facility < _az_LOG_CLASSIFICATION_MAX_FACILITIES
+          && code < _az_LOG_CLASSIFICATION_MAX_CODES)
+      ? (uint64_t)1 << ((facility * _az_LOG_CLASSIFICATION_MAX_CODES) + code)
+      : 0;
+}
+
+#ifndef AZ_NO_LOGGING
+
+// Classifications that are written to the log callback, or 0 when no callback is set.
+extern uint64_t _az_log_write_mask;
+
+// Looks up a classification that maps to no bit in the list set by the user.
+bool _az_log_should_write_unmapped(az_log_classification classification);
+
 // If the user hasn't registered any classifications, then we log everything.
-bool az_log_should_write(az_log_classification classification);
+AZ_NODISCARD AZ_INLINE bool az_log_should_write(az_log_classification classification)
+{
+  uint64_t const bit = _az_log_classification_to_bit(classification);
+  return bit != 0 ? (_az_log_write_mask & bit) != 0
+                  : _az_log_should_write_unmapped(classification);
+}
 
 void az_log_write(az_log_classification classification, az_span message);
 
+#else // AZ_NO_LOGGING
+
+// Logging is compiled out, every call site guarded by az_log_should_write() is eliminated.
+AZ_NODISCARD AZ_INLINE bool az_log_should_write(az_log_classification classification)
+{
+  (void)classification;
+  return false;
+}
+
+AZ_INLINE void az_log_write(az_log_classification classification, az_span message)
+{
+  (void)classification;
+  (void)message;
+}
+
+#endif // AZ_NO_LOGGING
+
+// Returns true when log messages are captured as az_log_record and formatted by az_log_flush.
+bool az_log_is_deferred();
+
+// Reserves the next free record in the deferred log ring, or returns NULL if the ring is full. It
+// can be called from any thread. The record is only published to az_log_flush by
+// az_log_record_commit.
+az_log_record* az_log_record_acquire(az_log_classification classification);
+
+void az_log_record_commit(az_log_record* record);
+
 #include <_az_cfg_suffix.h>
 
 #endif // _az_LOG_INTERNAL_H
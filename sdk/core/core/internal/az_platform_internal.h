@@ -7,6 +7,7 @@
 #include <az_platform_impl.h>
 #include <az_result.h>
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <_az_cfg_prefix.h>
@@ -22,6 +23,35 @@ AZ_NODISCARD az_result az_platform_mtx_init(az_platform_mtx* mtx);
 AZ_NODISCARD az_result az_platform_mtx_lock(az_platform_mtx* mtx);
 AZ_NODISCARD az_result az_platform_mtx_unlock(az_platform_mtx* mtx);
 
+typedef struct az_platform_cond az_platform_cond;
+
+void az_platform_cond_destroy(az_platform_cond* cond);
+AZ_NODISCARD az_result az_platform_cond_init(az_platform_cond* cond);
+// Unlocks mtx while waiting, and locks it again before returning.
+AZ_NODISCARD az_result az_platform_cond_wait(az_platform_cond* cond, az_platform_mtx* mtx);
+AZ_NODISCARD az_result az_platform_cond_broadcast(az_platform_cond* cond);
+
+typedef struct az_platform_thread_id az_platform_thread_id;
+
+void az_platform_thread_get_id(az_platform_thread_id* out_id);
+AZ_NODISCARD bool az_platform_thread_is_current(az_platform_thread_id const* id);
+
+typedef struct az_platform_thread az_platform_thread;
+typedef void (*az_platform_thread_fn)(void* arg);
+
+// Starts a thread calling fn with arg. thread must stay valid until it is joined.
+AZ_NODISCARD az_result
+az_platform_thread_create(az_platform_thread* thread, az_platform_thread_fn fn, void* arg);
+// Waits for a thread started by az_platform_thread_create to return.
+AZ_NODISCARD az_result az_platform_thread_join(az_platform_thread* thread);
+
+// An az_platform_once is statically initialized with AZ_PLATFORM_ONCE_INIT.
+typedef struct az_platform_once az_platform_once;
+typedef void (*az_platform_once_fn)(void);
+
+// Calls fn the first time it is called with once. Other callers return once fn has returned.
+AZ_NODISCARD az_result az_platform_call_once(az_platform_once* once, az_platform_once_fn fn);
+
 #include <_az_cfg_suffix.h>
 
 #endif // _az_PLATFORM_INTERNAL_H
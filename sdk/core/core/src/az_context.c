@@ -2,8 +2,12 @@
 // SPDX-License-Identifier: MIT
 
 #include <az_context.h>
+#include <az_platform_internal.h>
+#include <az_precondition_internal.h>
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include <_az_cfg.h>
 
@@ -11,22 +15,325 @@
 // never expires. Call az_context_cancel passing a pointer to this node to cancel the entire
 // application (which cancels all the child nodes).
 az_context az_context_app = {
-  ._internal
-  = { .parent = NULL, .expiration = _az_CONTEXT_MAX_EXPIRATION, .key = NULL, .value = NULL }
+  ._internal = {
+    .parent = NULL,
+    .expiration = _az_CONTEXT_MAX_EXPIRATION,
+    .key = NULL,
+    .value = NULL,
+    .effective_expiration = _az_CONTEXT_MAX_EXPIRATION,
+    .cancel_generation = 0,
+  }
+};
+
+uint32_t volatile _az_context_cancel_generation = 0;
+
+// Expirations are 64 bits, and must not be read half written by az_context_cancel on 32 bits
+// targets. The generation is incremented once the expiration is set, both with full barriers.
+#if defined(__GNUC__) || defined(__clang__)
+#define _az_CONTEXT_MEMORY_BARRIER() __sync_synchronize()
+#define _az_CONTEXT_INCREMENT(ptr) ((void)__sync_add_and_fetch(ptr, 1))
+#define _az_CONTEXT_LOAD64(ptr) __sync_fetch_and_add((int64_t volatile*)(uintptr_t)(ptr), 0)
+#define _az_CONTEXT_COMPARE_AND_SWAP64(ptr, expected, desired) \
+  __sync_bool_compare_and_swap(ptr, expected, desired)
+#elif defined(_MSC_VER)
+#include <windows.h>
+#define _az_CONTEXT_MEMORY_BARRIER() MemoryBarrier()
+#define _az_CONTEXT_INCREMENT(ptr) ((void)InterlockedIncrement((LONG volatile*)(ptr)))
+#define _az_CONTEXT_LOAD64(ptr) \
+  ((int64_t)InterlockedCompareExchange64((LONG64 volatile*)(uintptr_t)(ptr), 0, 0))
+#define _az_CONTEXT_COMPARE_AND_SWAP64(ptr, expected, desired) \
+  (InterlockedCompareExchange64((LONG64 volatile*)(ptr), (LONG64)(desired), (LONG64)(expected)) \
+   == (LONG64)(expected))
+#else
+// Without atomics, contexts can only be canceled by the thread that uses them.
+#define _az_CONTEXT_MEMORY_BARRIER()
+#define _az_CONTEXT_INCREMENT(ptr) ((void)++*(ptr))
+#define _az_CONTEXT_LOAD64(ptr) (*(ptr))
+#define _az_CONTEXT_COMPARE_AND_SWAP64(ptr, expected, desired) (*(ptr) = (desired), true)
+#endif
+
+// Registered cancel callbacks, of all the contexts.
+static az_context_cancel_callback* _az_context_cancel_callbacks = NULL;
+static az_platform_mtx _az_context_cancel_callbacks_mtx;
+static az_platform_cond _az_context_cancel_callbacks_cond; // Signaled when a callback returns.
+static az_platform_once _az_context_cancel_callbacks_mtx_once = AZ_PLATFORM_ONCE_INIT;
+static az_result _az_context_cancel_callbacks_mtx_result = AZ_OK;
+
+// A callback az_context_cancel is invoking, outside the lock. The storage of the registration may
+// be released by the callback, so it is only compared, never read.
+typedef struct _az_context_cancel_invocation _az_context_cancel_invocation;
+struct _az_context_cancel_invocation
+{
+  az_context_cancel_callback const* registration;
+  az_platform_thread_id thread; // Invoking the callback.
+  _az_context_cancel_invocation* next;
 };
 
+static _az_context_cancel_invocation* _az_context_cancel_invocations = NULL;
+
+static void _az_context_cancel_callbacks_mtx_init(void)
+{
+  _az_context_cancel_callbacks_mtx_result
+      = az_platform_mtx_init(&_az_context_cancel_callbacks_mtx);
+  if (az_succeeded(_az_context_cancel_callbacks_mtx_result))
+  {
+    _az_context_cancel_callbacks_mtx_result
+        = az_platform_cond_init(&_az_context_cancel_callbacks_cond);
+    if (az_failed(_az_context_cancel_callbacks_mtx_result))
+    {
+      az_platform_mtx_destroy(&_az_context_cancel_callbacks_mtx);
+    }
+  }
+}
+
+// Platforms without threads don't implement mutexes, the list doesn't need to be locked there.
+// Returns whether the list is locked.
+static bool _az_context_cancel_callbacks_lock()
+{
+  if (az_failed(az_platform_call_once(
+          &_az_context_cancel_callbacks_mtx_once, _az_context_cancel_callbacks_mtx_init))
+      || az_failed(_az_context_cancel_callbacks_mtx_result))
+  {
+    return false;
+  }
+
+  return az_succeeded(az_platform_mtx_lock(&_az_context_cancel_callbacks_mtx));
+}
+
+static void _az_context_cancel_callbacks_unlock(bool locked)
+{
+  if (locked)
+  {
+    az_result const result = az_platform_mtx_unlock(&_az_context_cancel_callbacks_mtx);
+    (void)result;
+  }
+}
+
+static _az_context_cancel_invocation const*
+_az_context_cancel_find_invocation(az_context_cancel_callback const* registration)
+{
+  for (_az_context_cancel_invocation const* invocation = _az_context_cancel_invocations;
+       invocation != NULL;
+       invocation = invocation->next)
+  {
+    if (invocation->registration == registration)
+    {
+      return invocation;
+    }
+  }
+  return NULL;
+}
+
+static bool _az_context_is_descendant_of(az_context const* context, az_context const* ancestor)
+{
+  for (; context != NULL; context = context->_internal.parent)
+  {
+    if (context == ancestor)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+AZ_NODISCARD uint32_t _az_context_get_cancel_generation()
+{
+  uint32_t const cancel_generation = _az_context_cancel_generation;
+  _az_CONTEXT_MEMORY_BARRIER();
+  return cancel_generation;
+}
+
 // Returns the soonest expiration time of this az_context node or any of its parent nodes.
 AZ_NODISCARD int64_t az_context_get_expiration(az_context const* context)
 {
+  if (context == NULL)
+  {
+    return _az_CONTEXT_MAX_EXPIRATION;
+  }
+
+  // The cached value is up to date unless a node was canceled since it was computed: a cancellation
+  // may have moved the expiration of a parent node. The generation is read first, so that a
+  // cancellation racing with the walk is seen by the next call. The cache of a node is only written
+  // when it is created, before other threads can see it.
+  uint32_t const cancel_generation = _az_context_get_cancel_generation();
+  if (context->_internal.cancel_generation == cancel_generation)
+  {
+    return context->_internal.effective_expiration;
+  }
+
+  // The walk stops at the first parent whose cache is up to date.
   int64_t expiration = _az_CONTEXT_MAX_EXPIRATION;
-  for (; context != NULL; context = context->_internal.parent)
+  for (az_context const* node = context; node != NULL; node = node->_internal.parent)
   {
-    if (context->_internal.expiration < expiration)
-      expiration = context->_internal.expiration;
+    bool const is_cached
+        = node != context && node->_internal.cancel_generation == cancel_generation;
+    int64_t const node_expiration = is_cached ? node->_internal.effective_expiration
+                                              : _az_CONTEXT_LOAD64(&node->_internal.expiration);
+    if (node_expiration < expiration)
+    {
+      expiration = node_expiration;
+    }
+
+    if (is_cached)
+    {
+      break;
+    }
   }
+
   return expiration;
 }
 
+void az_context_cancel(az_context* context)
+{
+  context = ((context != NULL) ? context : &az_context_app);
+
+  // The beginning of time
+  while (true)
+  {
+    int64_t const expiration = _az_CONTEXT_LOAD64(&context->_internal.expiration);
+    if (_az_CONTEXT_COMPARE_AND_SWAP64(&context->_internal.expiration, expiration, 0))
+    {
+      break;
+    }
+  }
+
+  // Invalidates the expiration cached by every node, including this one and its children. The
+  // expiration is written first, so that a node whose cache looks valid never misses it.
+  _az_CONTEXT_INCREMENT(&_az_context_cancel_generation);
+
+  _az_context_cancel_invocation invocation = { .registration = NULL, .next = NULL };
+  az_platform_thread_get_id(&invocation.thread);
+  bool const locked = _az_context_cancel_callbacks_lock();
+  invocation.next = _az_context_cancel_invocations;
+  _az_context_cancel_invocations = &invocation;
+
+  // Callbacks are invoked with the list unlocked, so that they can't block the threads
+  // registering callbacks. The list may change meanwhile, so each search starts over.
+  while (true)
+  {
+    az_context_cancel_callback** next = &_az_context_cancel_callbacks;
+    while (*next != NULL && !_az_context_is_descendant_of((*next)->_internal.context, context))
+    {
+      next = &(*next)->_internal.next;
+    }
+
+    az_context_cancel_callback* const registration = *next;
+    if (registration == NULL)
+    {
+      break;
+    }
+
+    // Unlink before invoking: the callback may release the storage of the registration.
+    *next = registration->_internal.next;
+    registration->_internal.next = NULL;
+    invocation.registration = registration;
+    az_context_cancel_fn const callback = registration->_internal.callback;
+    az_context const* const registered_context = registration->_internal.context;
+    void* const user_context = registration->_internal.user_context;
+    _az_context_cancel_callbacks_unlock(locked);
+
+    callback(registered_context, user_context);
+
+    bool const relocked = _az_context_cancel_callbacks_lock();
+    (void)relocked;
+    invocation.registration = NULL;
+    if (locked)
+    {
+      // Wakes up the threads unregistering the callback.
+      az_result const result = az_platform_cond_broadcast(&_az_context_cancel_callbacks_cond);
+      (void)result;
+    }
+  }
+
+  for (_az_context_cancel_invocation** next = &_az_context_cancel_invocations; *next != NULL;
+       next = &(*next)->next)
+  {
+    if (*next == &invocation)
+    {
+      *next = invocation.next;
+      break;
+    }
+  }
+
+  _az_context_cancel_callbacks_unlock(locked);
+}
+
+AZ_NODISCARD az_result az_context_register_cancel_callback(
+    az_context const* context,
+    az_context_cancel_callback* registration,
+    az_context_cancel_fn callback,
+    void* user_context)
+{
+  AZ_PRECONDITION_NOT_NULL(context);
+  AZ_PRECONDITION_NOT_NULL(registration);
+  AZ_PRECONDITION_NOT_NULL(callback);
+
+  *registration = (az_context_cancel_callback){
+    ._internal = {
+      .context = context,
+      .callback = callback,
+      .user_context = user_context,
+      .next = NULL,
+    },
+  };
+
+  bool const locked = _az_context_cancel_callbacks_lock();
+
+  // Checked with the list locked, so that a concurrent az_context_cancel either sees the
+  // registration or has already set the expiration.
+  az_result result = AZ_ERROR_CANCELED;
+  if (az_context_get_expiration(context) != 0)
+  {
+    registration->_internal.next = _az_context_cancel_callbacks;
+    _az_context_cancel_callbacks = registration;
+    result = AZ_OK;
+  }
+
+  _az_context_cancel_callbacks_unlock(locked);
+  return result;
+}
+
+void az_context_unregister_cancel_callback(az_context_cancel_callback* registration)
+{
+  AZ_PRECONDITION_NOT_NULL(registration);
+
+  bool const locked = _az_context_cancel_callbacks_lock();
+
+  for (az_context_cancel_callback** next = &_az_context_cancel_callbacks; *next != NULL;
+       next = &(*next)->_internal.next)
+  {
+    if (*next == registration)
+    {
+      *next = registration->_internal.next;
+      break;
+    }
+  }
+  registration->_internal.next = NULL;
+
+  // A callback being invoked by az_context_cancel on another thread is waited for. A callback
+  // can't unregister itself: it would wait for its own return.
+  while (true)
+  {
+    _az_context_cancel_invocation const* const invocation
+        = _az_context_cancel_find_invocation(registration);
+    if (invocation == NULL)
+    {
+      break;
+    }
+
+    bool const is_invoking_thread = az_platform_thread_is_current(&invocation->thread);
+    AZ_PRECONDITION(!is_invoking_thread);
+    if (is_invoking_thread || !locked
+        || az_failed(az_platform_cond_wait(
+            &_az_context_cancel_callbacks_cond, &_az_context_cancel_callbacks_mtx)))
+    {
+      break;
+    }
+  }
+
+  _az_context_cancel_callbacks_unlock(locked);
+}
+
 // Walks up this az_context node's parent until it find a node whose key matches the specified key
 // and return the corresponding value. Returns AZ_ERROR_ITEM_NOT_FOUND is there are no nodes
 // matching the specified key.
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: MIT
 
 #include "az_aad_private.h"
+#include "az_credential_token_cache_private.h"
 #include <az_credentials.h>
 #include <az_http.h>
 #include <az_http_internal.h>
@@ -36,6 +37,37 @@ static AZ_NODISCARD az_result _az_credential_client_secret_request_token(
   return _az_aad_request_token(&request, &credential->_internal.token);
 }
 
+static AZ_NODISCARD az_result _az_credential_client_secret_refresh_token(
+    az_credential_client_secret* credential,
+    az_context* context)
+{
+  if (!credential->_internal.use_token_cache)
+  {
+    return _az_credential_client_secret_request_token(credential, context);
+  }
+
+  if (az_succeeded(_az_credential_token_cache_get(
+          credential->_internal.tenant_id,
+          credential->_internal.client_id,
+          credential->_internal.scopes,
+          &credential->_internal.token)))
+  {
+    return AZ_OK;
+  }
+
+  AZ_RETURN_IF_FAILED(_az_credential_client_secret_request_token(credential, context));
+
+  // Failing to share the token is not an error, this credential keeps its own copy.
+  az_result const cache_result = _az_credential_token_cache_set(
+      credential->_internal.tenant_id,
+      credential->_internal.client_id,
+      credential->_internal.scopes,
+      &credential->_internal.token);
+  (void)cache_result;
+
+  return AZ_OK;
+}
+
 // This gets called from the http credential policy
 static AZ_NODISCARD az_result _az_credential_client_secret_apply(
     az_credential_client_secret* credential,
@@ -45,7 +77,7 @@ static AZ_NODISCARD az_result _az_credential_client_secret_apply(
   if (_az_token_expired(&(credential->_internal.token)))
   {
     AZ_RETURN_IF_FAILED(
-        _az_credential_client_secret_request_token(credential, ref_request->_internal.context));
+        _az_credential_client_secret_refresh_token(credential, ref_request->_internal.context));
   }
 
   int16_t const token_length = credential->_internal.token._internal.token_length;
@@ -83,9 +115,18 @@ AZ_NODISCARD az_result az_credential_client_secret_init(
         .client_id = client_id,
         .client_secret = client_secret,
         .scopes = { 0 },
-        .token = { 0 }
+        .token = { 0 },
+        .use_token_cache = false,
       },
     };
 
   return AZ_OK;
 }
+
+AZ_NODISCARD az_result az_credential_client_secret_set_use_token_cache(
+    az_credential_client_secret* self,
+    bool use_token_cache)
+{
+  self->_internal.use_token_cache = use_token_cache;
+  return AZ_OK;
+}
@@ -0,0 +1,270 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "az_credential_token_cache_private.h"
+#include <az_credentials.h>
+#include <az_platform_internal.h>
+#include <az_precondition_internal.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <_az_cfg.h>
+
+static _az_token_cache _az_credential_token_cache = { 0 };
+static az_platform_mtx _az_credential_token_cache_mtx;
+static az_platform_once _az_credential_token_cache_mtx_once = AZ_PLATFORM_ONCE_INIT;
+static az_result _az_credential_token_cache_mtx_result = AZ_OK;
+static bool _az_credential_token_cache_initialized = false;
+
+static void _az_credential_token_cache_mtx_init(void)
+{
+  _az_credential_token_cache_mtx_result = az_platform_mtx_init(&_az_credential_token_cache_mtx);
+}
+
+// Without platform mutexes, the cache is not locked.
+static AZ_NODISCARD az_result _az_credential_token_cache_lock()
+{
+  return _az_credential_token_cache_mtx_result == AZ_ERROR_NOT_IMPLEMENTED
+      ? AZ_OK
+      : az_platform_mtx_lock(&_az_credential_token_cache_mtx);
+}
+
+static AZ_NODISCARD az_result _az_credential_token_cache_unlock()
+{
+  return _az_credential_token_cache_mtx_result == AZ_ERROR_NOT_IMPLEMENTED
+      ? AZ_OK
+      : az_platform_mtx_unlock(&_az_credential_token_cache_mtx);
+}
+
+AZ_NODISCARD AZ_INLINE bool _az_token_cache_entry_is_expired(
+    az_credential_token_cache_entry const* entry,
+    int64_t now_msec)
+{
+  int64_t const expires_at_msec = entry->_internal.token._internal.expires_at_msec;
+  return expires_at_msec <= 0 || now_msec > expires_at_msec;
+}
+
+static AZ_NODISCARD bool _az_token_cache_entry_key_equals(
+    az_credential_token_cache_entry const* entry,
+    az_span tenant_id,
+    az_span client_id,
+    az_span scopes)
+{
+  int32_t const tenant_id_length = entry->_internal.tenant_id_length;
+  int32_t const client_id_length = entry->_internal.client_id_length;
+  int32_t const scopes_length = entry->_internal.scopes_length;
+
+  // The key is stored as tenant_id, client_id and scopes concatenated together.
+  uint8_t* key = (uint8_t*)entry->_internal.key;
+  return az_span_is_content_equal(
+             az_span_init(key, tenant_id_length, tenant_id_length), tenant_id)
+      && az_span_is_content_equal(
+             az_span_init(key + tenant_id_length, client_id_length, client_id_length), client_id)
+      && az_span_is_content_equal(
+             az_span_init(key + tenant_id_length + client_id_length, scopes_length, scopes_length),
+             scopes);
+}
+
+static AZ_NODISCARD az_credential_token_cache_entry* _az_token_cache_find(
+    _az_token_cache const* cache,
+    az_span tenant_id,
+    az_span client_id,
+    az_span scopes)
+{
+  for (int32_t i = 0; i < cache->entries_length; ++i)
+  {
+    az_credential_token_cache_entry* const entry = &cache->entries[i];
+    if (entry->_internal.token._internal.token_length > 0
+        && _az_token_cache_entry_key_equals(entry, tenant_id, client_id, scopes))
+    {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+AZ_NODISCARD az_result _az_token_cache_get(
+    _az_token_cache const* cache,
+    az_span tenant_id,
+    az_span client_id,
+    az_span scopes,
+    int64_t now_msec,
+    _az_token* out_token)
+{
+  AZ_PRECONDITION_NOT_NULL(cache);
+  AZ_PRECONDITION_NOT_NULL(out_token);
+
+  az_credential_token_cache_entry const* const entry
+      = _az_token_cache_find(cache, tenant_id, client_id, scopes);
+
+  if (entry == NULL || _az_token_cache_entry_is_expired(entry, now_msec))
+  {
+    return AZ_ERROR_ITEM_NOT_FOUND;
+  }
+
+  *out_token = entry->_internal.token;
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result _az_token_cache_set(
+    _az_token_cache* cache,
+    az_span tenant_id,
+    az_span client_id,
+    az_span scopes,
+    int64_t now_msec,
+    _az_token const* token)
+{
+  AZ_PRECONDITION_NOT_NULL(cache);
+  AZ_PRECONDITION_NOT_NULL(token);
+
+  int32_t const tenant_id_length = az_span_length(tenant_id);
+  int32_t const client_id_length = az_span_length(client_id);
+  int32_t const scopes_length = az_span_length(scopes);
+
+  if (cache->entries_length <= 0
+      || tenant_id_length + client_id_length + scopes_length > _az_TOKEN_CACHE_KEY_BUF_SIZE)
+  {
+    return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+  }
+
+  az_credential_token_cache_entry* entry
+      = _az_token_cache_find(cache, tenant_id, client_id, scopes);
+
+  // Take an unused or expired entry, otherwise evict the one that is going to expire first.
+  for (int32_t i = 0; entry == NULL && i < cache->entries_length; ++i)
+  {
+    az_credential_token_cache_entry* const candidate = &cache->entries[i];
+    if (candidate->_internal.token._internal.token_length == 0
+        || _az_token_cache_entry_is_expired(candidate, now_msec))
+    {
+      entry = candidate;
+    }
+  }
+
+  if (entry == NULL)
+  {
+    entry = &cache->entries[0];
+    for (int32_t i = 1; i < cache->entries_length; ++i)
+    {
+      az_credential_token_cache_entry* const candidate = &cache->entries[i];
+      if (candidate->_internal.token._internal.expires_at_msec
+          < entry->_internal.token._internal.expires_at_msec)
+      {
+        entry = candidate;
+      }
+    }
+  }
+
+  az_span key = AZ_SPAN_FROM_BUFFER(entry->_internal.key);
+  AZ_RETURN_IF_FAILED(az_span_append(key, tenant_id, &key));
+  AZ_RETURN_IF_FAILED(az_span_append(key, client_id, &key));
+  AZ_RETURN_IF_FAILED(az_span_append(key, scopes, &key));
+
+  entry->_internal.tenant_id_length = (int16_t)tenant_id_length;
+  entry->_internal.client_id_length = (int16_t)client_id_length;
+  entry->_internal.scopes_length = (int16_t)scopes_length;
+  entry->_internal.token = *token;
+
+  return AZ_OK;
+}
+
+void _az_token_cache_clear(_az_token_cache* cache)
+{
+  AZ_PRECONDITION_NOT_NULL(cache);
+
+  for (int32_t i = 0; i < cache->entries_length; ++i)
+  {
+    cache->entries[i] = (az_credential_token_cache_entry){ 0 };
+  }
+}
+
+AZ_NODISCARD az_result az_credential_token_cache_init(
+    az_credential_token_cache_entry* entries,
+    int32_t entries_length)
+{
+  AZ_PRECONDITION_NOT_NULL(entries);
+  AZ_PRECONDITION(entries_length > 0);
+
+  AZ_RETURN_IF_FAILED(az_platform_call_once(
+      &_az_credential_token_cache_mtx_once, _az_credential_token_cache_mtx_init));
+  if (_az_credential_token_cache_mtx_result != AZ_ERROR_NOT_IMPLEMENTED)
+  {
+    AZ_RETURN_IF_FAILED(_az_credential_token_cache_mtx_result);
+  }
+
+  AZ_RETURN_IF_FAILED(_az_credential_token_cache_lock());
+
+  _az_credential_token_cache = (_az_token_cache){
+    .entries = entries,
+    .entries_length = entries_length,
+  };
+
+  _az_token_cache_clear(&_az_credential_token_cache);
+  _az_credential_token_cache_initialized = true;
+
+  return _az_credential_token_cache_unlock();
+}
+
+AZ_NODISCARD az_result az_credential_token_cache_clear()
+{
+  if (!_az_credential_token_cache_initialized)
+  {
+    return AZ_ERROR_ITEM_NOT_FOUND;
+  }
+
+  AZ_RETURN_IF_FAILED(_az_credential_token_cache_lock());
+  _az_token_cache_clear(&_az_credential_token_cache);
+  return _az_credential_token_cache_unlock();
+}
+
+AZ_NODISCARD az_result _az_credential_token_cache_get(
+    az_span tenant_id,
+    az_span client_id,
+    az_span scopes,
+    _az_token* out_token)
+{
+  if (!_az_credential_token_cache_initialized)
+  {
+    return AZ_ERROR_ITEM_NOT_FOUND;
+  }
+
+  AZ_RETURN_IF_FAILED(_az_credential_token_cache_lock());
+
+  az_result const result = _az_token_cache_get(
+      &_az_credential_token_cache,
+      tenant_id,
+      client_id,
+      scopes,
+      az_platform_clock_msec(),
+      out_token);
+
+  AZ_RETURN_IF_FAILED(_az_credential_token_cache_unlock());
+  return result;
+}
+
+AZ_NODISCARD az_result _az_credential_token_cache_set(
+    az_span tenant_id,
+    az_span client_id,
+    az_span scopes,
+    _az_token const* token)
+{
+  if (!_az_credential_token_cache_initialized)
+  {
+    return AZ_ERROR_ITEM_NOT_FOUND;
+  }
+
+  AZ_RETURN_IF_FAILED(_az_credential_token_cache_lock());
+
+  az_result const result = _az_token_cache_set(
+      &_az_credential_token_cache,
+      tenant_id,
+      client_id,
+      scopes,
+      az_platform_clock_msec(),
+      token);
+
+  AZ_RETURN_IF_FAILED(_az_credential_token_cache_unlock());
+  return result;
+}
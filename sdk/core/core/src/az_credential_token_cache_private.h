@@ -0,0 +1,57 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#ifndef _az_CREDENTIAL_TOKEN_CACHE_PRIVATE_H
+#define _az_CREDENTIAL_TOKEN_CACHE_PRIVATE_H
+
+#include <az_credentials.h>
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdint.h>
+
+#include <_az_cfg_prefix.h>
+
+typedef struct
+{
+  az_credential_token_cache_entry* entries;
+  int32_t entries_length;
+} _az_token_cache;
+
+/*
+ * Functions below do not lock. They are used by the process-wide cache while it holds its mutex.
+ */
+
+AZ_NODISCARD az_result _az_token_cache_get(
+    _az_token_cache const* cache,
+    az_span tenant_id,
+    az_span client_id,
+    az_span scopes,
+    int64_t now_msec,
+    _az_token* out_token);
+
+AZ_NODISCARD az_result _az_token_cache_set(
+    _az_token_cache* cache,
+    az_span tenant_id,
+    az_span client_id,
+    az_span scopes,
+    int64_t now_msec,
+    _az_token const* token);
+
+void _az_token_cache_clear(_az_token_cache* cache);
+
+AZ_NODISCARD az_result _az_credential_token_cache_get(
+    az_span tenant_id,
+    az_span client_id,
+    az_span scopes,
+    _az_token* out_token);
+
+AZ_NODISCARD az_result _az_credential_token_cache_set(
+    az_span tenant_id,
+    az_span client_id,
+    az_span scopes,
+    _az_token const* token);
+
+#include <_az_cfg_suffix.h>
+
+#endif // _az_CREDENTIAL_TOKEN_CACHE_PRIVATE_H
@@ -22,6 +22,14 @@ AZ_NODISCARD AZ_INLINE uint8_t _az_number_to_upper_hex(uint8_t number)
   return number + (number < 10 ? '0' : _az_HEX_UPPER_OFFSET);
 }
 
+/**
+ * Converts a number [0..15] into lowercase hexadecimal digit character (base16).
+ */
+AZ_NODISCARD AZ_INLINE uint8_t _az_number_to_lower_hex(uint8_t number)
+{
+  return number + (number < 10 ? '0' : _az_HEX_LOWER_OFFSET);
+}
+
 #include <_az_cfg_suffix.h>
 
 #endif // _az_HEX_PRIVATE_H
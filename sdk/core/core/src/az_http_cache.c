@@ -0,0 +1,580 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_config_internal.h>
+#include <az_http.h>
+#include <az_http_cache.h>
+#include <az_http_internal.h>
+#include <az_http_transport.h>
+#include <az_platform_internal.h>
+#include <az_precondition_internal.h>
+#include <az_span.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <_az_cfg.h>
+
+enum
+{
+  _az_HTTP_CACHE_ETAG_MAX_SIZE = 128,
+  _az_HTTP_CACHE_MAX_AGE_MAX_SEC = 365 * 24 * 60 * 60,
+};
+
+static az_span const _az_HTTP_CACHE_HEADER_CACHE_CONTROL
+    = AZ_SPAN_LITERAL_FROM_STR("Cache-Control");
+static az_span const _az_HTTP_CACHE_HEADER_ETAG = AZ_SPAN_LITERAL_FROM_STR("ETag");
+static az_span const _az_HTTP_CACHE_HEADER_IF_NONE_MATCH
+    = AZ_SPAN_LITERAL_FROM_STR("If-None-Match");
+
+// Shard i of every cache is guarded by mutex i, unless the platform has no mutexes.
+static az_platform_mtx _az_http_cache_mtx[AZ_HTTP_CACHE_SHARDS_MAX];
+static az_platform_once _az_http_cache_mtx_once = AZ_PLATFORM_ONCE_INIT;
+static az_result _az_http_cache_mtx_result = AZ_OK;
+
+static void _az_http_cache_mtx_init(void)
+{
+  for (int32_t s = 0; s < AZ_HTTP_CACHE_SHARDS_MAX; ++s)
+  {
+    _az_http_cache_mtx_result = az_platform_mtx_init(&_az_http_cache_mtx[s]);
+    if (az_failed(_az_http_cache_mtx_result))
+    {
+      return;
+    }
+  }
+}
+
+static AZ_NODISCARD az_result _az_http_cache_lock(int32_t shard)
+{
+  return _az_http_cache_mtx_result == AZ_ERROR_NOT_IMPLEMENTED
+      ? AZ_OK
+      : az_platform_mtx_lock(&_az_http_cache_mtx[shard]);
+}
+
+static AZ_NODISCARD az_result _az_http_cache_unlock(int32_t shard)
+{
+  return _az_http_cache_mtx_result == AZ_ERROR_NOT_IMPLEMENTED
+      ? AZ_OK
+      : az_platform_mtx_unlock(&_az_http_cache_mtx[shard]);
+}
+
+AZ_NODISCARD az_http_cache_options az_http_cache_options_default()
+{
+  return (az_http_cache_options){
+    .shards = 4,
+    .default_ttl_msec = 1 * _az_TIME_SECONDS_PER_MINUTE * _az_TIME_MILLISECONDS_PER_SECOND,
+  };
+}
+
+AZ_NODISCARD az_result az_http_cache_init(
+    az_http_cache* cache,
+    az_http_cache_entry* entries,
+    int32_t entries_length,
+    az_span buffer,
+    az_http_cache_options const* options)
+{
+  AZ_PRECONDITION_NOT_NULL(cache);
+  AZ_PRECONDITION_NOT_NULL(entries);
+  AZ_PRECONDITION(entries_length > 0);
+  AZ_PRECONDITION_VALID_SPAN(buffer, 0, false);
+
+  az_http_cache_options const default_options = az_http_cache_options_default();
+  if (options == NULL)
+  {
+    options = &default_options;
+  }
+
+  int32_t const shards_length = options->shards;
+  if (shards_length < 1 || shards_length > AZ_HTTP_CACHE_SHARDS_MAX
+      || shards_length > entries_length)
+  {
+    return AZ_ERROR_ARG;
+  }
+
+  AZ_RETURN_IF_FAILED(az_platform_call_once(&_az_http_cache_mtx_once, _az_http_cache_mtx_init));
+  if (_az_http_cache_mtx_result != AZ_ERROR_NOT_IMPLEMENTED)
+  {
+    AZ_RETURN_IF_FAILED(_az_http_cache_mtx_result);
+  }
+
+  // Entries left over by the split between shards are not used.
+  int32_t const shard_entries_length = entries_length / shards_length;
+  int32_t const slot_size = az_span_capacity(buffer) / (shard_entries_length * shards_length);
+
+  *cache = (az_http_cache){
+    ._internal = {
+      .shards = { 0 },
+      .shards_length = shards_length,
+      .slot_size = slot_size,
+      .default_ttl_msec = options->default_ttl_msec,
+    },
+  };
+
+  for (int32_t s = 0; s < shards_length; ++s)
+  {
+    _az_http_cache_shard* const shard = &cache->_internal.shards[s];
+    az_http_cache_entry* const shard_entries = entries + (s * shard_entries_length);
+
+    // All the entries are in the list of the shard, the empty ones last.
+    for (int32_t i = 0; i < shard_entries_length; ++i)
+    {
+      shard_entries[i] = (az_http_cache_entry){
+        ._internal = {
+          .slot = az_span_ptr(buffer) + ((s * shard_entries_length) + i) * slot_size,
+          .hash = 0,
+          .url_length = 0,
+          .response_length = 0,
+          .expires_at_msec = 0,
+          .previous = i - 1,
+          .next = i + 1 < shard_entries_length ? i + 1 : -1,
+          .pins = 0,
+        },
+      };
+    }
+
+    shard->_internal.entries = shard_entries;
+    shard->_internal.entries_length = shard_entries_length;
+    shard->_internal.first = 0;
+    shard->_internal.last = shard_entries_length - 1;
+  }
+
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result
+az_http_cache_get_stats(az_http_cache* cache, az_http_cache_stats* out_stats)
+{
+  AZ_PRECONDITION_NOT_NULL(cache);
+  AZ_PRECONDITION_NOT_NULL(out_stats);
+
+  *out_stats = (az_http_cache_stats){ .hits = 0, .revalidations = 0, .misses = 0 };
+  for (int32_t s = 0; s < cache->_internal.shards_length; ++s)
+  {
+    _az_http_cache_shard* const shard = &cache->_internal.shards[s];
+    AZ_RETURN_IF_FAILED(_az_http_cache_lock(s));
+    out_stats->hits += shard->_internal.hits;
+    out_stats->revalidations += shard->_internal.revalidations;
+    out_stats->misses += shard->_internal.misses;
+    AZ_RETURN_IF_FAILED(_az_http_cache_unlock(s));
+  }
+
+  return AZ_OK;
+}
+
+// FNV-1a
+static AZ_NODISCARD uint32_t _az_http_cache_hash(az_span url)
+{
+  uint8_t const* const ptr = az_span_ptr(url);
+  int32_t const length = az_span_length(url);
+  uint32_t hash = 2166136261u;
+  for (int32_t i = 0; i < length; ++i)
+  {
+    hash = (hash ^ ptr[i]) * 16777619u;
+  }
+  return hash;
+}
+
+AZ_NODISCARD AZ_INLINE az_span _az_http_cache_entry_url(az_http_cache_entry const* entry)
+{
+  return az_span_init(
+      entry->_internal.slot, entry->_internal.url_length, entry->_internal.url_length);
+}
+
+AZ_NODISCARD AZ_INLINE az_span _az_http_cache_entry_response(az_http_cache_entry const* entry)
+{
+  return az_span_init(
+      entry->_internal.slot + entry->_internal.url_length,
+      entry->_internal.response_length,
+      entry->_internal.response_length);
+}
+
+/******************************  LEAST RECENTLY USED LIST, the shard lock being held */
+
+static void _az_http_cache_unlink(_az_http_cache_shard* shard, int32_t index)
+{
+  az_http_cache_entry* const entries = shard->_internal.entries;
+  int32_t const previous = entries[index]._internal.previous;
+  int32_t const next = entries[index]._internal.next;
+
+  if (previous == -1)
+  {
+    shard->_internal.first = next;
+  }
+  else
+  {
+    entries[previous]._internal.next = next;
+  }
+
+  if (next == -1)
+  {
+    shard->_internal.last = previous;
+  }
+  else
+  {
+    entries[next]._internal.previous = previous;
+  }
+}
+
+static void _az_http_cache_link_first(_az_http_cache_shard* shard, int32_t index)
+{
+  az_http_cache_entry* const entries = shard->_internal.entries;
+  int32_t const first = shard->_internal.first;
+
+  entries[index]._internal.previous = -1;
+  entries[index]._internal.next = first;
+  if (first == -1)
+  {
+    shard->_internal.last = index;
+  }
+  else
+  {
+    entries[first]._internal.previous = index;
+  }
+  shard->_internal.first = index;
+}
+
+static void _az_http_cache_link_last(_az_http_cache_shard* shard, int32_t index)
+{
+  az_http_cache_entry* const entries = shard->_internal.entries;
+  int32_t const last = shard->_internal.last;
+
+  entries[index]._internal.previous = last;
+  entries[index]._internal.next = -1;
+  if (last == -1)
+  {
+    shard->_internal.first = index;
+  }
+  else
+  {
+    entries[last]._internal.next = index;
+  }
+  shard->_internal.last = index;
+}
+
+static AZ_NODISCARD int32_t
+_az_http_cache_find(_az_http_cache_shard const* shard, uint32_t hash, az_span url)
+{
+  az_http_cache_entry const* const entries = shard->_internal.entries;
+  for (int32_t i = 0; i < shard->_internal.entries_length; ++i)
+  {
+    if (entries[i]._internal.hash == hash && entries[i]._internal.url_length > 0
+        && az_span_is_content_equal(_az_http_cache_entry_url(&entries[i]), url))
+    {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+// Gets an empty entry, or else the least recently used one that is not pinned.
+static AZ_NODISCARD int32_t _az_http_cache_take(_az_http_cache_shard const* shard)
+{
+  az_http_cache_entry const* const entries = shard->_internal.entries;
+  for (int32_t i = shard->_internal.last; i != -1; i = entries[i]._internal.previous)
+  {
+    if (entries[i]._internal.pins == 0)
+    {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static void _az_http_cache_remove(_az_http_cache_shard* shard, int32_t index)
+{
+  az_http_cache_entry* const entry = &shard->_internal.entries[index];
+  entry->_internal.hash = 0;
+  entry->_internal.url_length = 0;
+  entry->_internal.response_length = 0;
+
+  _az_http_cache_unlink(shard, index);
+  _az_http_cache_link_last(shard, index);
+}
+
+// Copies a cached response to the response of the request.
+static AZ_NODISCARD az_result
+_az_http_cache_serve(_az_http_cache_shard* shard, int32_t index, az_http_response* ref_response)
+{
+  az_span const cached = _az_http_cache_entry_response(&shard->_internal.entries[index]);
+  az_span response = ref_response->_internal.http_response;
+  AZ_RETURN_IF_FAILED(az_span_copy(response, cached, &response));
+  AZ_RETURN_IF_FAILED(az_http_response_init(ref_response, response));
+
+  _az_http_cache_unlink(shard, index);
+  _az_http_cache_link_first(shard, index);
+  return AZ_OK;
+}
+
+/******************************  RESPONSE HEADERS */
+
+static AZ_NODISCARD az_result
+_az_http_cache_get_etag(az_http_cache_entry const* entry, az_span etag_buffer, az_span* out_etag)
+{
+  az_http_response response = { 0 };
+  AZ_RETURN_IF_FAILED(az_http_response_init(&response, _az_http_cache_entry_response(entry)));
+
+  az_http_response_status_line status_line = { 0 };
+  AZ_RETURN_IF_FAILED(az_http_response_get_status_line(&response, &status_line));
+
+  az_pair header = { 0 };
+  while (az_succeeded(az_http_response_get_next_header(&response, &header)))
+  {
+    if (az_span_is_content_equal_ignoring_case(header.key, _az_HTTP_CACHE_HEADER_ETAG))
+    {
+      return az_span_copy(etag_buffer, header.value, out_etag);
+    }
+  }
+
+  return AZ_ERROR_ITEM_NOT_FOUND;
+}
+
+// Gets how long a response is fresh, or -1 if it must not be stored.
+static AZ_NODISCARD int64_t
+_az_http_cache_get_ttl_msec(az_http_cache const* cache, az_http_response* ref_response)
+{
+  az_pair header = { 0 };
+  while (az_succeeded(az_http_response_get_next_header(ref_response, &header)))
+  {
+    if (!az_span_is_content_equal_ignoring_case(header.key, _az_HTTP_CACHE_HEADER_CACHE_CONTROL))
+    {
+      continue;
+    }
+
+    az_span const value = header.value;
+    if (az_span_find(value, AZ_SPAN_FROM_STR("no-store")) != -1)
+    {
+      return -1;
+    }
+
+    if (az_span_find(value, AZ_SPAN_FROM_STR("no-cache")) != -1)
+    {
+      return 0;
+    }
+
+    int32_t const max_age = az_span_find(value, AZ_SPAN_FROM_STR("max-age="));
+    if (max_age != -1)
+    {
+      az_span seconds = az_span_slice(value, max_age + (int32_t)sizeof("max-age=") - 1, -1);
+      int32_t const end = az_span_find_any(seconds, AZ_SPAN_FROM_STR(", "));
+      if (end != -1)
+      {
+        seconds = az_span_slice(seconds, 0, end);
+      }
+
+      uint32_t max_age_sec = 0;
+      if (az_succeeded(az_span_to_uint32(seconds, &max_age_sec)))
+      {
+        return (int64_t)(max_age_sec < _az_HTTP_CACHE_MAX_AGE_MAX_SEC
+                             ? max_age_sec
+                             : _az_HTTP_CACHE_MAX_AGE_MAX_SEC)
+            * _az_TIME_MILLISECONDS_PER_SECOND;
+      }
+    }
+  }
+
+  return cache->_internal.default_ttl_msec;
+}
+
+/******************************  POLICY */
+
+static AZ_NODISCARD bool _az_http_cache_is_not_modified(az_http_response const* response)
+{
+  az_http_response copy = *response;
+  az_http_response_status_line status_line = { 0 };
+  return az_succeeded(az_http_response_get_status_line(&copy, &status_line))
+      && status_line.status_code == AZ_HTTP_STATUS_CODE_NOT_MODIFIED;
+}
+
+// Updates the cache with the response of a GET request, the shard lock being held. A 304 response
+// to the revalidation of the pinned entry is replaced by the cached response, if it can be.
+static AZ_NODISCARD az_result _az_http_cache_update(
+    az_http_cache const* cache,
+    _az_http_cache_shard* shard,
+    uint32_t hash,
+    az_span url,
+    int32_t pinned,
+    int64_t now_msec,
+    az_http_response* ref_response)
+{
+  az_http_response response = *ref_response;
+  az_http_response_status_line status_line = { 0 };
+  AZ_RETURN_IF_FAILED(az_http_response_get_status_line(&response, &status_line));
+
+  int64_t const ttl_msec = _az_http_cache_get_ttl_msec(cache, &response);
+
+  if (status_line.status_code == AZ_HTTP_STATUS_CODE_NOT_MODIFIED && pinned != -1)
+  {
+    // The entry may have been removed or replaced during the revalidation. The request is then
+    // sent again, and counted then.
+    az_http_cache_entry* const entry = &shard->_internal.entries[pinned];
+    if (entry->_internal.hash == hash && entry->_internal.url_length > 0
+        && az_span_is_content_equal(_az_http_cache_entry_url(entry), url))
+    {
+      entry->_internal.expires_at_msec = now_msec + (ttl_msec < 0 ? 0 : ttl_msec);
+      AZ_RETURN_IF_FAILED(_az_http_cache_serve(shard, pinned, ref_response));
+      ++shard->_internal.revalidations;
+      return AZ_OK;
+    }
+    return AZ_ERROR_ITEM_NOT_FOUND;
+  }
+
+  ++shard->_internal.misses;
+
+  if (status_line.status_code != AZ_HTTP_STATUS_CODE_OK)
+  {
+    return AZ_OK;
+  }
+
+  int32_t index = _az_http_cache_find(shard, hash, url);
+  int32_t const url_length = az_span_length(url);
+  int32_t const response_length = az_span_length(ref_response->_internal.http_response);
+
+  if (ttl_msec < 0 || url_length + response_length > cache->_internal.slot_size)
+  {
+    // The cached response, if any, is outdated.
+    if (index != -1)
+    {
+      _az_http_cache_remove(shard, index);
+    }
+    return AZ_OK;
+  }
+
+  if (index == -1)
+  {
+    index = _az_http_cache_take(shard);
+    if (index == -1)
+    {
+      return AZ_OK;
+    }
+  }
+
+  az_http_cache_entry* const entry = &shard->_internal.entries[index];
+  memcpy(entry->_internal.slot, az_span_ptr(url), (size_t)url_length);
+  memcpy(
+      entry->_internal.slot + url_length,
+      az_span_ptr(ref_response->_internal.http_response),
+      (size_t)response_length);
+  entry->_internal.hash = hash;
+  entry->_internal.url_length = url_length;
+  entry->_internal.response_length = response_length;
+  entry->_internal.expires_at_msec = now_msec + ttl_msec;
+
+  _az_http_cache_unlink(shard, index);
+  _az_http_cache_link_first(shard, index);
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_http_pipeline_policy_cache(
+    _az_http_policy* p_policies,
+    void* p_options,
+    _az_http_request* p_request,
+    az_http_response* p_response)
+{
+  az_http_cache* const cache = (az_http_cache*)p_options;
+
+  az_http_method method = AZ_SPAN_NULL;
+  az_span url = AZ_SPAN_NULL;
+  az_span body = AZ_SPAN_NULL;
+  AZ_RETURN_IF_FAILED(az_http_request_get_parts(p_request, &method, &url, &body));
+  (void)body;
+
+  uint32_t const hash = _az_http_cache_hash(url);
+  int32_t const s = (int32_t)(hash % (uint32_t)cache->_internal.shards_length);
+  _az_http_cache_shard* const shard = &cache->_internal.shards[s];
+
+  if (!az_span_is_content_equal(method, az_http_method_get()))
+  {
+    // The request may change the resource.
+    AZ_RETURN_IF_FAILED(_az_http_cache_lock(s));
+    int32_t const index = _az_http_cache_find(shard, hash, url);
+    if (index != -1)
+    {
+      _az_http_cache_remove(shard, index);
+    }
+    AZ_RETURN_IF_FAILED(_az_http_cache_unlock(s));
+
+    return az_http_pipeline_nextpolicy(p_policies, p_request, p_response);
+  }
+
+  int64_t const now_msec = az_platform_clock_msec();
+  uint8_t etag_buffer[_az_HTTP_CACHE_ETAG_MAX_SIZE];
+  az_span etag = AZ_SPAN_NULL;
+  int32_t pinned = -1;
+  bool served = false;
+
+  AZ_RETURN_IF_FAILED(_az_http_cache_lock(s));
+  int32_t const index = _az_http_cache_find(shard, hash, url);
+  if (index != -1)
+  {
+    az_http_cache_entry* const entry = &shard->_internal.entries[index];
+    if (now_msec < entry->_internal.expires_at_msec)
+    {
+      // The response is not served if it doesn't fit in the response buffer.
+      served = az_succeeded(_az_http_cache_serve(shard, index, p_response));
+      shard->_internal.hits += served ? 1 : 0;
+    }
+    else if (az_succeeded(
+                 _az_http_cache_get_etag(entry, AZ_SPAN_FROM_BUFFER(etag_buffer), &etag)))
+    {
+      ++entry->_internal.pins;
+      pinned = index;
+    }
+  }
+  AZ_RETURN_IF_FAILED(_az_http_cache_unlock(s));
+
+  if (served)
+  {
+    return AZ_OK;
+  }
+
+  // The policies after this one remove the headers they add before returning.
+  az_span const headers = p_request->_internal.headers;
+  az_span const response_buffer = p_response->_internal.http_response;
+
+  // Without room for the header, the response is just sent again.
+  bool const revalidating = pinned != -1
+      && az_succeeded(
+          az_http_request_append_header(p_request, _az_HTTP_CACHE_HEADER_IF_NONE_MATCH, etag));
+
+  az_result result = az_http_pipeline_nextpolicy(p_policies, p_request, p_response);
+
+  AZ_RETURN_IF_FAILED(_az_http_cache_lock(s));
+  if (pinned != -1)
+  {
+    --shard->_internal.entries[pinned]._internal.pins;
+  }
+
+  // A response that can't be parsed is not cached.
+  if (az_succeeded(result))
+  {
+    az_result const update_result
+        = _az_http_cache_update(cache, shard, hash, url, pinned, now_msec, p_response);
+    (void)update_result;
+  }
+  AZ_RETURN_IF_FAILED(_az_http_cache_unlock(s));
+
+  if (!revalidating || az_failed(result) || !_az_http_cache_is_not_modified(p_response))
+  {
+    return result;
+  }
+
+  // The cached response was removed during the revalidation, or doesn't fit in the response
+  // buffer: the caller didn't ask for a 304 response, so the request is sent without the ETag.
+  p_request->_internal.headers = headers;
+  AZ_RETURN_IF_FAILED(az_http_response_init(p_response, response_buffer));
+  result = az_http_pipeline_nextpolicy(p_policies, p_request, p_response);
+
+  AZ_RETURN_IF_FAILED(_az_http_cache_lock(s));
+  if (az_succeeded(result))
+  {
+    az_result const update_result
+        = _az_http_cache_update(cache, shard, hash, url, -1, now_msec, p_response);
+    (void)update_result;
+  }
+  AZ_RETURN_IF_FAILED(_az_http_cache_unlock(s));
+
+  return result;
+}
@@ -0,0 +1,319 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_context.h>
+#include <az_http.h>
+#include <az_http_internal.h>
+#include <az_http_metrics.h>
+#include <az_http_transport.h>
+#include <az_platform_internal.h>
+#include <az_precondition_internal.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Histograms are updated with atomic operations, so that one can be shared by requests sent
+// concurrently. The compare and swap and the additions are full barriers too.
+#if defined(__GNUC__) || defined(__clang__)
+#define _az_HTTP_METRICS_MEMORY_BARRIER() __sync_synchronize()
+#define _az_HTTP_METRICS_ADD(ptr, value) ((void)__sync_fetch_and_add(ptr, value))
+#define _az_HTTP_METRICS_ADD64(ptr, value) ((void)__sync_fetch_and_add(ptr, value))
+// Reading through an addition keeps 64 bits loads whole on 32 bits targets.
+#define _az_HTTP_METRICS_LOAD64(ptr) __sync_fetch_and_add((int64_t volatile*)(uintptr_t)(ptr), 0)
+#define _az_HTTP_METRICS_COMPARE_AND_SWAP(ptr, expected, desired) \
+  __sync_bool_compare_and_swap(ptr, expected, desired)
+#define _az_HTTP_METRICS_COMPARE_AND_SWAP64(ptr, expected, desired) \
+  __sync_bool_compare_and_swap(ptr, expected, desired)
+#elif defined(_MSC_VER)
+#include <windows.h>
+#define _az_HTTP_METRICS_MEMORY_BARRIER() MemoryBarrier()
+#define _az_HTTP_METRICS_ADD(ptr, value) \
+  ((void)InterlockedExchangeAdd((LONG volatile*)(ptr), (LONG)(value)))
+#define _az_HTTP_METRICS_ADD64(ptr, value) \
+  ((void)InterlockedExchangeAdd64((LONG64 volatile*)(ptr), (LONG64)(value)))
+#define _az_HTTP_METRICS_LOAD64(ptr) \
+  ((int64_t)InterlockedCompareExchange64((LONG64 volatile*)(uintptr_t)(ptr), 0, 0))
+#define _az_HTTP_METRICS_COMPARE_AND_SWAP(ptr, expected, desired) \
+  (InterlockedCompareExchange((LONG volatile*)(ptr), (LONG)(desired), (LONG)(expected)) \
+   == (LONG)(expected))
+#define _az_HTTP_METRICS_COMPARE_AND_SWAP64(ptr, expected, desired) \
+  (InterlockedCompareExchange64((LONG64 volatile*)(ptr), (LONG64)(desired), (LONG64)(expected)) \
+   == (LONG64)(expected))
+#else
+// Without atomics, metrics can only be recorded by one thread at a time.
+#define _az_HTTP_METRICS_MEMORY_BARRIER()
+#define _az_HTTP_METRICS_ADD(ptr, value) ((void)(*(ptr) += (value)))
+#define _az_HTTP_METRICS_ADD64(ptr, value) ((void)(*(ptr) += (value)))
+#define _az_HTTP_METRICS_LOAD64(ptr) (*(ptr))
+#define _az_HTTP_METRICS_COMPARE_AND_SWAP(ptr, expected, desired) (*(ptr) = (desired), true)
+#define _az_HTTP_METRICS_COMPARE_AND_SWAP64(ptr, expected, desired) (*(ptr) = (desired), true)
+#endif
+
+#include <_az_cfg.h>
+
+// Only the address is used, as the key of the context node that holds the az_http_metrics.
+static uint8_t _az_http_metrics_context_key = 0;
+
+AZ_NODISCARD az_result az_http_metrics_init(az_http_metrics* self)
+{
+  AZ_PRECONDITION_NOT_NULL(self);
+
+  *self = (az_http_metrics){ 0 };
+  return AZ_OK;
+}
+
+// Values below _az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS have a bucket each. Above that, the range of
+// each power of two is split into _az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS buckets.
+static int32_t _az_http_metrics_histogram_bucket_index(int64_t value)
+{
+  if (value < _az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS)
+  {
+    return (int32_t)value;
+  }
+
+  int32_t shift = 0;
+  while ((value >> shift) >= (_az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS * 2))
+  {
+    ++shift;
+  }
+
+  int32_t const index = _az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS
+      + (shift * _az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS) + (int32_t)(value >> shift)
+      - _az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS;
+
+  return index < _az_HTTP_METRICS_HISTOGRAM_BUCKETS ? index
+                                                    : _az_HTTP_METRICS_HISTOGRAM_BUCKETS - 1;
+}
+
+static int64_t _az_http_metrics_histogram_bucket_highest_value(int32_t index)
+{
+  if (index < _az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS)
+  {
+    return index;
+  }
+
+  int32_t const shift
+      = (index - _az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS) / _az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS;
+  int64_t const sub_bucket
+      = (index - _az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS) % _az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS;
+
+  return ((_az_HTTP_METRICS_HISTOGRAM_SUB_BUCKETS + sub_bucket + 1) << shift) - 1;
+}
+
+void az_http_metrics_histogram_record(az_http_metrics_histogram* self, int64_t value_msec)
+{
+  AZ_PRECONDITION_NOT_NULL(self);
+
+  if (value_msec < 0)
+  {
+    return;
+  }
+
+  // The min is stored plus 1, so that 0 tells it is not set yet.
+  while (true)
+  {
+    int64_t const min_plus_one = _az_HTTP_METRICS_LOAD64(&self->_internal.min_plus_one);
+    if ((min_plus_one != 0 && min_plus_one <= value_msec + 1)
+        || _az_HTTP_METRICS_COMPARE_AND_SWAP64(
+            &self->_internal.min_plus_one, min_plus_one, value_msec + 1))
+    {
+      break;
+    }
+  }
+
+  while (true)
+  {
+    int64_t const max = _az_HTTP_METRICS_LOAD64(&self->_internal.max);
+    if (max >= value_msec
+        || _az_HTTP_METRICS_COMPARE_AND_SWAP64(&self->_internal.max, max, value_msec))
+    {
+      break;
+    }
+  }
+
+  int32_t const index = _az_http_metrics_histogram_bucket_index(value_msec);
+  _az_HTTP_METRICS_ADD(&self->_internal.counts[index], 1);
+  _az_HTTP_METRICS_ADD64(&self->_internal.sum, value_msec);
+  _az_HTTP_METRICS_ADD64(&self->_internal.count, 1);
+}
+
+AZ_NODISCARD int64_t
+az_http_metrics_histogram_get_percentile(az_http_metrics_histogram const* self, int32_t percentile)
+{
+  AZ_PRECONDITION_NOT_NULL(self);
+  AZ_PRECONDITION_RANGE(0, percentile, 100);
+
+  int64_t const count = _az_HTTP_METRICS_LOAD64(&self->_internal.count);
+  int64_t const max = _az_HTTP_METRICS_LOAD64(&self->_internal.max);
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  // Rank of the percentile value, rounded up. The smallest rank is the first value.
+  int64_t rank = ((count * percentile) + 99) / 100;
+  if (rank < 1)
+  {
+    rank = 1;
+  }
+
+  int64_t seen = 0;
+  for (int32_t i = 0; i < _az_HTTP_METRICS_HISTOGRAM_BUCKETS; ++i)
+  {
+    seen += self->_internal.counts[i];
+    if (seen >= rank)
+    {
+      // The last bucket also counts every value that is too large for the histogram.
+      int64_t const highest_value = (i == _az_HTTP_METRICS_HISTOGRAM_BUCKETS - 1)
+          ? max
+          : _az_http_metrics_histogram_bucket_highest_value(i);
+
+      return highest_value < max ? highest_value : max;
+    }
+  }
+
+  // Values being recorded may be counted in the total, and not in their bucket yet.
+  return max;
+}
+
+void az_http_metrics_histogram_get_snapshot(
+    az_http_metrics_histogram const* self,
+    az_http_metrics_histogram_snapshot* out_snapshot)
+{
+  AZ_PRECONDITION_NOT_NULL(self);
+  AZ_PRECONDITION_NOT_NULL(out_snapshot);
+
+  int64_t const count = _az_HTTP_METRICS_LOAD64(&self->_internal.count);
+  int64_t const min_plus_one = _az_HTTP_METRICS_LOAD64(&self->_internal.min_plus_one);
+
+  *out_snapshot = (az_http_metrics_histogram_snapshot){
+    .count = count,
+    .min_msec = min_plus_one == 0 ? 0 : min_plus_one - 1,
+    .max_msec = _az_HTTP_METRICS_LOAD64(&self->_internal.max),
+    .mean_msec = count == 0 ? 0 : _az_HTTP_METRICS_LOAD64(&self->_internal.sum) / count,
+    .p50_msec = az_http_metrics_histogram_get_percentile(self, 50),
+    .p90_msec = az_http_metrics_histogram_get_percentile(self, 90),
+    .p99_msec = az_http_metrics_histogram_get_percentile(self, 99),
+  };
+}
+
+void az_http_metrics_record(az_http_metrics* self, az_http_request_metrics const* request_metrics)
+{
+  AZ_PRECONDITION_NOT_NULL(self);
+  AZ_PRECONDITION_NOT_NULL(request_metrics);
+
+  az_http_metrics_histogram_record(&self->_internal.queue, request_metrics->queue_msec);
+  az_http_metrics_histogram_record(&self->_internal.dns, request_metrics->dns_msec);
+  az_http_metrics_histogram_record(&self->_internal.connect, request_metrics->connect_msec);
+  az_http_metrics_histogram_record(&self->_internal.tls, request_metrics->tls_msec);
+  az_http_metrics_histogram_record(&self->_internal.first_byte, request_metrics->first_byte_msec);
+  az_http_metrics_histogram_record(&self->_internal.total, request_metrics->total_msec);
+
+  if (request_metrics->retry_count > 0)
+  {
+    az_http_metrics_histogram_record(
+        &self->_internal.retry_delay, request_metrics->retry_delay_msec);
+  }
+
+  _az_HTTP_METRICS_ADD64(&self->_internal.retry_count, request_metrics->retry_count);
+
+  // The last request is kept under a sequence that is odd while it is written. A request recorded
+  // while another one is written is not kept: the one being written is as recent.
+  uint32_t const sequence = self->_internal.last_request_sequence;
+  if ((sequence & 1) == 0
+      && _az_HTTP_METRICS_COMPARE_AND_SWAP(
+          &self->_internal.last_request_sequence, sequence, sequence + 1))
+  {
+    self->_internal.last_request = *request_metrics;
+    _az_HTTP_METRICS_ADD(&self->_internal.last_request_sequence, 1);
+  }
+}
+
+AZ_NODISCARD az_http_request_metrics az_http_metrics_get_last_request(az_http_metrics const* self)
+{
+  AZ_PRECONDITION_NOT_NULL(self);
+
+  while (true)
+  {
+    uint32_t const sequence = self->_internal.last_request_sequence;
+    _az_HTTP_METRICS_MEMORY_BARRIER();
+    az_http_request_metrics const last_request = self->_internal.last_request;
+    _az_HTTP_METRICS_MEMORY_BARRIER();
+    if ((sequence & 1) == 0 && sequence == self->_internal.last_request_sequence)
+    {
+      return last_request;
+    }
+  }
+}
+
+void az_http_metrics_get_snapshot(
+    az_http_metrics const* self,
+    az_http_metrics_snapshot* out_snapshot)
+{
+  AZ_PRECONDITION_NOT_NULL(self);
+  AZ_PRECONDITION_NOT_NULL(out_snapshot);
+
+  out_snapshot->request_count = _az_HTTP_METRICS_LOAD64(&self->_internal.total._internal.count);
+  out_snapshot->retry_count = _az_HTTP_METRICS_LOAD64(&self->_internal.retry_count);
+  az_http_metrics_histogram_get_snapshot(&self->_internal.queue, &out_snapshot->queue);
+  az_http_metrics_histogram_get_snapshot(&self->_internal.dns, &out_snapshot->dns);
+  az_http_metrics_histogram_get_snapshot(&self->_internal.connect, &out_snapshot->connect);
+  az_http_metrics_histogram_get_snapshot(&self->_internal.tls, &out_snapshot->tls);
+  az_http_metrics_histogram_get_snapshot(&self->_internal.first_byte, &out_snapshot->first_byte);
+  az_http_metrics_histogram_get_snapshot(&self->_internal.total, &out_snapshot->total);
+  az_http_metrics_histogram_get_snapshot(&self->_internal.retry_delay, &out_snapshot->retry_delay);
+}
+
+AZ_NODISCARD az_context
+az_context_with_http_metrics(az_context const* parent, az_http_metrics* metrics)
+{
+  return az_context_with_value(parent, &_az_http_metrics_context_key, metrics);
+}
+
+AZ_NODISCARD az_result az_http_pipeline_policy_metrics(
+    _az_http_policy* p_policies,
+    void* p_options,
+    _az_http_request* p_request,
+    az_http_response* p_response)
+{
+  // Metrics set on the context of the request take precedence over the ones of the client.
+  az_http_metrics* metrics = (az_http_metrics*)p_options;
+  {
+    void* context_metrics = NULL;
+    if (p_request->_internal.context != NULL
+        && az_succeeded(az_context_get_value(
+            p_request->_internal.context, &_az_http_metrics_context_key, &context_metrics)))
+    {
+      metrics = (az_http_metrics*)context_metrics;
+    }
+  }
+
+  if (metrics == NULL)
+  {
+    return az_http_pipeline_nextpolicy(p_policies, p_request, p_response);
+  }
+
+  az_http_request_metrics request_metrics = {
+    .queue_msec = -1,
+    .dns_msec = -1,
+    .connect_msec = -1,
+    .tls_msec = -1,
+    .first_byte_msec = -1,
+    .total_msec = -1,
+    .retry_count = 0,
+    .retry_delay_msec = 0,
+    ._internal = { .start_msec = az_platform_clock_msec() },
+  };
+
+  az_http_request_metrics* const previous_metrics = p_request->_internal.metrics;
+  p_request->_internal.metrics = &request_metrics;
+
+  az_result const result = az_http_pipeline_nextpolicy(p_policies, p_request, p_response);
+
+  request_metrics.total_msec = az_platform_clock_msec() - request_metrics._internal.start_msec;
+  p_request->_internal.metrics = previous_metrics;
+
+  az_http_metrics_record(metrics, &request_metrics);
+
+  return result;
+}
@@ -7,6 +7,105 @@
 
 #include <_az_cfg.h>
 
+static void _az_http_pipeline_add_user_policies(
+    _az_http_pipeline* pipeline,
+    int32_t* ref_count,
+    az_http_user_policy const* user_policies,
+    int32_t user_policies_length,
+    az_http_policy_position position)
+{
+  for (int32_t i = 0; i < user_policies_length; ++i)
+  {
+    if (user_policies[i].position == position)
+    {
+      pipeline->_internal.p_policies[*ref_count] = (_az_http_policy){
+        ._internal = {
+          .process = user_policies[i].process,
+          .p_options = user_policies[i].options,
+        },
+      };
+      *ref_count += 1;
+    }
+  }
+}
+
+AZ_NODISCARD az_result az_http_pipeline_init(
+    _az_http_pipeline* pipeline,
+    _az_http_policy const* policies,
+    int32_t policies_length,
+    az_http_user_policy const* user_policies,
+    int32_t user_policies_length)
+{
+  AZ_PRECONDITION_NOT_NULL(pipeline);
+  AZ_PRECONDITION_NOT_NULL(policies);
+  AZ_PRECONDITION(policies_length > 0);
+  AZ_PRECONDITION(user_policies_length >= 0);
+  AZ_PRECONDITION(user_policies_length == 0 || user_policies != NULL);
+
+  // The last policy is followed by one without process callback.
+  AZ_PRECONDITION(
+      policies_length + AZ_HTTP_PIPELINE_USER_POLICIES_MAX
+      < (int32_t)(sizeof(pipeline->_internal.p_policies) / sizeof(_az_http_policy)));
+
+  if (user_policies_length > AZ_HTTP_PIPELINE_USER_POLICIES_MAX)
+  {
+    return AZ_ERROR_ARG;
+  }
+
+  for (int32_t i = 0; i < user_policies_length; ++i)
+  {
+    if (user_policies[i].process == NULL
+        || (user_policies[i].position != AZ_HTTP_POLICY_POSITION_PER_CALL
+            && user_policies[i].position != AZ_HTTP_POLICY_POSITION_PER_RETRY))
+    {
+      return AZ_ERROR_ARG;
+    }
+  }
+
+  // Per-retry policies go before logging, so that what they change is logged, or else before the
+  // transport. Per-call policies go before retry, or else with the per-retry ones.
+  int32_t per_call_index = -1;
+  int32_t per_retry_index = policies_length - 1;
+  for (int32_t i = 0; i < policies_length; ++i)
+  {
+    if (policies[i]._internal.process == az_http_pipeline_policy_retry)
+    {
+      per_call_index = i;
+    }
+    else if (policies[i]._internal.process == az_http_pipeline_policy_logging)
+    {
+      per_retry_index = i;
+    }
+  }
+
+  if (per_call_index == -1)
+  {
+    per_call_index = per_retry_index;
+  }
+
+  *pipeline = (_az_http_pipeline){ 0 };
+  int32_t count = 0;
+  for (int32_t i = 0; i < policies_length; ++i)
+  {
+    if (i == per_call_index)
+    {
+      _az_http_pipeline_add_user_policies(
+          pipeline, &count, user_policies, user_policies_length, AZ_HTTP_POLICY_POSITION_PER_CALL);
+    }
+
+    if (i == per_retry_index)
+    {
+      _az_http_pipeline_add_user_policies(
+          pipeline, &count, user_policies, user_policies_length, AZ_HTTP_POLICY_POSITION_PER_RETRY);
+    }
+
+    pipeline->_internal.p_policies[count] = policies[i];
+    count += 1;
+  }
+
+  return AZ_OK;
+}
+
 AZ_NODISCARD az_result az_http_pipeline_process(
     _az_http_pipeline* pipeline,
     _az_http_request* p_request,
@@ -1,10 +1,11 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // SPDX-License-Identifier: MIT
 
-#include "az_http_policy_private.h"
 #include <az_credentials.h>
 #include <az_http.h>
 #include <az_http_internal.h>
+#include <az_http_transport.h>
+#include <az_platform_internal.h>
 #include <az_span.h>
 
 #include <_az_cfg.h>
@@ -21,20 +22,10 @@ AZ_NODISCARD az_result az_http_pipeline_policy_apiversion(
 
   _az_http_policy_apiversion_options* options = (_az_http_policy_apiversion_options*)(p_options);
 
-  switch (options->_internal.option_location)
+  // Prepared requests can have the version already.
+  if (!p_request->_internal.api_version_set)
   {
-    case _az_http_policy_apiversion_option_location_header:
-      // Add the version as a header
-      AZ_RETURN_IF_FAILED(az_http_request_append_header(
-          p_request, options->_internal.name, options->_internal.version));
-      break;
-    case _az_http_policy_apiversion_option_location_queryparameter:
-      // Add the version as a query parameter
-      AZ_RETURN_IF_FAILED(az_http_request_set_query_parameter(
-          p_request, options->_internal.name, options->_internal.version));
-      break;
-    default:
-      return AZ_ERROR_ARG;
+    AZ_RETURN_IF_FAILED(az_http_request_set_api_version(p_request, options));
   }
 
   return az_http_pipeline_nextpolicy(p_policies, p_request, p_response);
@@ -104,5 +95,12 @@ AZ_NODISCARD az_result az_http_pipeline_policy_transport(
   (void)p_policies; // this is the last policy in the pipeline, we just void it
   (void)p_options;
 
+  az_http_request_metrics* const metrics = p_request->_internal.metrics;
+  if (metrics != NULL && metrics->queue_msec < 0)
+  {
+    // First attempt, everything until now was spent in the pipeline.
+    metrics->queue_msec = az_platform_clock_msec() - metrics->_internal.start_msec;
+  }
+
   return az_http_client_send_request(p_request, p_response);
 }
@@ -2,7 +2,6 @@
 // SPDX-License-Identifier: MIT
 
 #include "az_http_policy_logging_private.h"
-#include "az_http_policy_private.h"
 #include "az_span_private.h"
 #include <az_http_internal.h>
 #include <az_http_transport.h>
@@ -131,8 +130,88 @@ static az_result _az_http_policy_logging_append_http_response_msg(
   return AZ_OK;
 }
 
+static void _az_http_policy_logging_record_http_request(
+    _az_http_request const* request,
+    az_log_record* ref_record)
+{
+  if (request == NULL)
+  {
+    return;
+  }
+
+  // Only the beginning of a long URL is kept, az_log_flush marks it as truncated.
+  az_span url = request->_internal.url;
+  int32_t const url_length = az_span_length(url);
+  int32_t const url_copy_length
+      = url_length < AZ_LOG_RECORD_URL_BUF_SIZE ? url_length : AZ_LOG_RECORD_URL_BUF_SIZE;
+
+  if (az_succeeded(az_span_copy(
+          AZ_SPAN_FROM_BUFFER(ref_record->_internal.url),
+          az_span_slice(url, 0, url_copy_length),
+          &url)))
+  {
+    ref_record->_internal.url_length = url_length;
+  }
+
+  az_span method = request->_internal.method;
+  if (az_succeeded(
+          az_span_copy(AZ_SPAN_FROM_BUFFER(ref_record->_internal.method), method, &method)))
+  {
+    ref_record->_internal.method_length = (int8_t)az_span_length(method);
+  }
+
+  ref_record->_internal.headers_count = _az_http_request_headers_count(request);
+  ref_record->_internal.body_length = az_http_request_get_body_length(request);
+}
+
+static void _az_http_policy_logging_record_http_response(
+    az_http_response* ref_response,
+    int64_t duration_msec,
+    az_log_record* ref_record)
+{
+  ref_record->_internal.duration_msec = duration_msec;
+
+  az_http_response_status_line status_line = { 0 };
+  if (ref_response == NULL || az_span_length(ref_response->_internal.http_response) == 0
+      || az_failed(az_http_response_get_status_line(ref_response, &status_line)))
+  {
+    return;
+  }
+
+  ref_record->_internal.status_code = (int32_t)status_line.status_code;
+
+  int32_t headers_count = 0;
+  for (az_pair header; az_http_response_get_next_header(ref_response, &header) == AZ_OK;)
+  {
+    ++headers_count;
+  }
+
+  ref_record->_internal.headers_count = headers_count;
+
+  // The body span reaches the end of the response buffer, only count what was received.
+  az_span body = { 0 };
+  if (az_succeeded(az_http_response_get_body(ref_response, &body)))
+  {
+    az_span const received = ref_response->_internal.http_response;
+    ref_record->_internal.body_length = az_span_length(received)
+        - (int32_t)(az_span_ptr(body) - az_span_ptr(received));
+  }
+}
+
 void _az_http_policy_logging_log_http_request(_az_http_request const* request)
 {
+  if (az_log_is_deferred())
+  {
+    az_log_record* const record = az_log_record_acquire(AZ_LOG_HTTP_REQUEST);
+    if (record != NULL)
+    {
+      _az_http_policy_logging_record_http_request(request, record);
+      az_log_record_commit(record);
+    }
+
+    return;
+  }
+
   uint8_t log_msg_buf[AZ_LOG_MSG_BUF_SIZE] = { 0 };
   az_span log_msg = AZ_SPAN_FROM_BUFFER(log_msg_buf);
 
@@ -146,11 +225,24 @@ void _az_http_policy_logging_log_http_response(
     int64_t duration_msec,
     _az_http_request const* request)
 {
+  az_http_response response_copy = *response;
+
+  if (az_log_is_deferred())
+  {
+    az_log_record* const record = az_log_record_acquire(AZ_LOG_HTTP_RESPONSE);
+    if (record != NULL)
+    {
+      _az_http_policy_logging_record_http_request(request, record);
+      _az_http_policy_logging_record_http_response(&response_copy, duration_msec, record);
+      az_log_record_commit(record);
+    }
+
+    return;
+  }
+
   uint8_t log_msg_buf[AZ_LOG_MSG_BUF_SIZE] = { 0 };
   az_span log_msg = AZ_SPAN_FROM_BUFFER(log_msg_buf);
 
-  az_http_response response_copy = *response;
-
   (void)_az_http_policy_logging_append_http_response_msg(
       &response_copy, duration_msec, request, &log_msg);
 
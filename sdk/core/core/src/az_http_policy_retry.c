@@ -1,11 +1,12 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // SPDX-License-Identifier: MIT
 
-#include "az_http_policy_private.h"
 #include "az_http_private.h"
+#include "az_http_tracing_private.h"
 #include <az_config.h>
 #include <az_config_internal.h>
 #include <az_http_internal.h>
+#include <az_http_transport.h>
 #include <az_log_internal.h>
 #include <az_platform_internal.h>
 #include <az_retry_internal.h>
@@ -58,6 +59,19 @@ AZ_INLINE az_result _az_http_policy_retry_append_http_retry_msg(
 
 AZ_INLINE void _az_http_policy_retry_log(int16_t attempt, int32_t delay_msec)
 {
+  if (az_log_is_deferred())
+  {
+    az_log_record* const record = az_log_record_acquire(AZ_LOG_HTTP_RETRY);
+    if (record != NULL)
+    {
+      record->_internal.retry_attempt = attempt;
+      record->_internal.retry_delay_msec = delay_msec;
+      az_log_record_commit(record);
+    }
+
+    return;
+  }
+
   uint8_t log_msg_buf[AZ_LOG_MSG_BUF_SIZE] = { 0 };
   az_span log_msg = AZ_SPAN_FROM_BUFFER(log_msg_buf);
 
@@ -140,15 +154,12 @@ AZ_INLINE AZ_NODISCARD az_result _az_http_policy_retry_get_retry_after(
   return AZ_OK;
 }
 
-AZ_NODISCARD az_result az_http_pipeline_policy_retry(
+static AZ_NODISCARD az_result _az_http_policy_retry_send(
     _az_http_policy* policies,
-    void* options,
+    az_http_policy_retry_options const* retry_options,
     _az_http_request* ref_request,
     az_http_response* ref_response)
 {
-  az_http_policy_retry_options const* const retry_options
-      = (az_http_policy_retry_options const*)options;
-
   int16_t const max_retries = retry_options->max_retries;
   int32_t const retry_delay_msec = retry_options->retry_delay_msec;
   int32_t const max_retry_delay_msec = retry_options->max_retry_delay_msec;
@@ -159,13 +170,23 @@ AZ_NODISCARD az_result az_http_pipeline_policy_retry(
   bool const should_log = az_log_should_write(AZ_LOG_HTTP_RETRY);
   az_result result = AZ_OK;
   int16_t attempt = 1;
+
   while (true)
   {
     AZ_RETURN_IF_FAILED(az_http_response_init(ref_response, ref_response->_internal.http_response));
     AZ_RETURN_IF_FAILED(_az_http_request_remove_retry_headers(ref_request));
 
+    az_http_tracing_span attempt_span = { 0 };
+    bool const is_traced
+        = az_succeeded(_az_http_tracing_attempt_start(ref_request, attempt, &attempt_span));
+
     result = az_http_pipeline_nextpolicy(policies, ref_request, ref_response);
 
+    if (is_traced)
+    {
+      _az_http_tracing_span_end(&attempt_span, result, ref_response);
+    }
+
     // Even HTTP 429, or 502 are expected to be AZ_OK, so the failed result is not retriable.
     if (attempt > max_retries || az_failed(result))
     {
@@ -195,6 +216,13 @@ AZ_NODISCARD az_result az_http_pipeline_policy_retry(
       _az_http_policy_retry_log(attempt, retry_after_msec);
     }
 
+    az_http_request_metrics* const metrics = ref_request->_internal.metrics;
+    if (metrics != NULL)
+    {
+      ++metrics->retry_count;
+      metrics->retry_delay_msec += retry_after_msec;
+    }
+
     az_platform_sleep_msec(retry_after_msec);
 
     if (context != NULL && az_context_has_expired(context, az_platform_clock_msec()))
@@ -205,3 +233,20 @@ AZ_NODISCARD az_result az_http_pipeline_policy_retry(
 
   return result;
 }
+
+AZ_NODISCARD az_result az_http_pipeline_policy_retry(
+    _az_http_policy* policies,
+    void* options,
+    _az_http_request* ref_request,
+    az_http_response* ref_response)
+{
+  // Headers added from here on (credential, tracing, ...) are added again on every attempt.
+  AZ_RETURN_IF_FAILED(_az_http_request_mark_retry_headers_start(ref_request));
+
+  az_result const result = _az_http_policy_retry_send(
+      policies, (az_http_policy_retry_options const*)options, ref_request, ref_response);
+
+  // The traceparent header of the last attempt points into its span, which is gone by now.
+  AZ_RETURN_IF_FAILED(_az_http_request_remove_retry_headers(ref_request));
+  return result;
+}
@@ -6,6 +6,7 @@
 
 #include <az_http.h>
 #include <az_http_internal.h>
+#include <az_http_transport.h>
 #include <az_precondition.h>
 #include <az_precondition_internal.h>
 
@@ -13,11 +14,6 @@
 
 #include <_az_cfg.h>
 
-AZ_NODISCARD az_result _az_is_question_mark(az_span slice)
-{
-  return az_span_ptr(slice)[0] == '?' ? AZ_OK : AZ_CONTINUE;
-}
-
 AZ_NODISCARD az_result az_http_request_init(
     _az_http_request* p_hrb,
     az_context* context,
@@ -31,8 +27,7 @@ AZ_NODISCARD az_result az_http_request_init(
   AZ_PRECONDITION_VALID_SPAN(url, 1, false);
   AZ_PRECONDITION_VALID_SPAN(headers_buffer, 0, false);
 
-  int32_t query_start = 0;
-  az_result url_with_query = _az_scan_until(url, _az_is_question_mark, &query_start);
+  int32_t const query_start = az_span_find_byte(url, '?');
 
   *p_hrb
       = (_az_http_request){ ._internal = {
@@ -42,12 +37,15 @@ AZ_NODISCARD az_result az_http_request_init(
                                 /* query start is set to 0 if there is not a question mark so the
                                    next time query parameter is appended, a question mark will be
                                    added at url length */
-                                .query_start
-                                = url_with_query == AZ_ERROR_ITEM_NOT_FOUND ? 0 : query_start,
+                                .query_start = query_start == -1 ? 0 : query_start,
                                 .headers = headers_buffer,
                                 .max_headers = az_span_capacity(headers_buffer) / sizeof(az_pair),
                                 .retry_headers_start_byte_offset = 0,
                                 .body = body,
+                                .body_parts = NULL,
+                                .body_parts_length = 0,
+                                .metrics = NULL,
+                                .api_version_set = false,
                             } };
 
   return AZ_OK;
@@ -149,6 +147,106 @@ az_http_request_get_header(_az_http_request const* request, int32_t index, az_pa
   return AZ_OK;
 }
 
+AZ_NODISCARD az_result az_http_request_set_api_version(
+    _az_http_request* p_hrb,
+    _az_http_policy_apiversion_options const* options)
+{
+  AZ_PRECONDITION_NOT_NULL(p_hrb);
+  AZ_PRECONDITION_NOT_NULL(options);
+
+  switch (options->_internal.option_location)
+  {
+    case _az_http_policy_apiversion_option_location_header:
+      // Add the version as a header
+      AZ_RETURN_IF_FAILED(az_http_request_append_header(
+          p_hrb, options->_internal.name, options->_internal.version));
+      break;
+    case _az_http_policy_apiversion_option_location_queryparameter:
+      // Add the version as a query parameter
+      AZ_RETURN_IF_FAILED(az_http_request_set_query_parameter(
+          p_hrb, options->_internal.name, options->_internal.version));
+      break;
+    default:
+      return AZ_ERROR_ARG;
+  }
+
+  p_hrb->_internal.api_version_set = true;
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_http_prepared_request_init(
+    _az_http_prepared_request* prepared,
+    az_http_method method,
+    _az_http_request const* request)
+{
+  AZ_PRECONDITION_NOT_NULL(prepared);
+  AZ_PRECONDITION_VALID_SPAN(method, 1, false);
+  AZ_PRECONDITION_NOT_NULL(request);
+
+  *prepared = (_az_http_prepared_request){
+    ._internal = {
+      .method = method,
+      .url = request->_internal.url,
+      .query_start = request->_internal.query_start,
+      .headers = request->_internal.headers,
+      .api_version_set = request->_internal.api_version_set,
+    },
+  };
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_http_request_init_prepared(
+    _az_http_request* p_hrb,
+    az_context* context,
+    _az_http_prepared_request const* prepared,
+    az_span url_buffer,
+    az_span headers_buffer,
+    az_span body)
+{
+  AZ_PRECONDITION_NOT_NULL(p_hrb);
+  AZ_PRECONDITION_NOT_NULL(prepared);
+  AZ_PRECONDITION_VALID_SPAN(url_buffer, 0, false);
+  AZ_PRECONDITION_VALID_SPAN(headers_buffer, 0, false);
+
+  // The constant parts are copied as they are: the URL doesn't need to be scanned for its query.
+  AZ_RETURN_IF_FAILED(az_span_copy(url_buffer, prepared->_internal.url, &url_buffer));
+  AZ_RETURN_IF_FAILED(az_span_copy(headers_buffer, prepared->_internal.headers, &headers_buffer));
+
+  *p_hrb = (_az_http_request){
+    ._internal = {
+      .context = context,
+      .method = prepared->_internal.method,
+      .url = url_buffer,
+      .query_start = prepared->_internal.query_start,
+      .headers = headers_buffer,
+      .max_headers = az_span_capacity(headers_buffer) / sizeof(az_pair),
+      .retry_headers_start_byte_offset = 0,
+      .body = body,
+      .body_parts = NULL,
+      .body_parts_length = 0,
+      .metrics = NULL,
+      .api_version_set = prepared->_internal.api_version_set,
+    },
+  };
+
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_http_request_set_body_parts(
+    _az_http_request* p_hrb,
+    az_span const* parts,
+    int32_t parts_length)
+{
+  AZ_PRECONDITION_NOT_NULL(p_hrb);
+  AZ_PRECONDITION_NOT_NULL(parts);
+  AZ_PRECONDITION(parts_length > 0);
+
+  p_hrb->_internal.body = AZ_SPAN_NULL;
+  p_hrb->_internal.body_parts = parts;
+  p_hrb->_internal.body_parts_length = parts_length;
+  return AZ_OK;
+}
+
 AZ_NODISCARD az_result az_http_request_get_parts(
     _az_http_request const* request,
     az_http_method* out_method,
@@ -158,5 +256,49 @@ AZ_NODISCARD az_result az_http_request_get_parts(
   *out_method = request->_internal.method;
   *out_url = request->_internal.url;
   *out_body = request->_internal.body;
+  if (request->_internal.body_parts != NULL)
+  {
+    *out_body = request->_internal.body_parts_length == 1 ? request->_internal.body_parts[0]
+                                                          : AZ_SPAN_NULL;
+  }
   return AZ_OK;
 }
+
+AZ_NODISCARD az_result az_http_request_get_body_parts(
+    _az_http_request const* request,
+    az_span const** out_parts,
+    int32_t* out_parts_length)
+{
+  AZ_PRECONDITION_NOT_NULL(request);
+  AZ_PRECONDITION_NOT_NULL(out_parts);
+  AZ_PRECONDITION_NOT_NULL(out_parts_length);
+
+  if (request->_internal.body_parts == NULL)
+  {
+    *out_parts = &request->_internal.body;
+    *out_parts_length = 1;
+  }
+  else
+  {
+    *out_parts = request->_internal.body_parts;
+    *out_parts_length = request->_internal.body_parts_length;
+  }
+  return AZ_OK;
+}
+
+AZ_NODISCARD int32_t az_http_request_get_body_length(_az_http_request const* request)
+{
+  AZ_PRECONDITION_NOT_NULL(request);
+
+  if (request->_internal.body_parts == NULL)
+  {
+    return az_span_length(request->_internal.body);
+  }
+
+  int32_t length = 0;
+  for (int32_t i = 0; i < request->_internal.body_parts_length; ++i)
+  {
+    length += az_span_length(request->_internal.body_parts[i]);
+  }
+  return length;
+}
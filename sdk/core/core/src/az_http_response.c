@@ -12,14 +12,6 @@
 
 // HTTP Response utility functions
 
-AZ_NODISCARD AZ_INLINE az_result _az_is_char(az_span slice, uint8_t c)
-{
-  return az_span_ptr(slice)[0] == c ? AZ_OK : AZ_CONTINUE;
-}
-
-AZ_NODISCARD az_result _az_is_a_colon(az_span slice) { return _az_is_char(slice, ':'); }
-AZ_NODISCARD az_result _az_is_new_line(az_span slice) { return _az_is_char(slice, '\n'); }
-
 AZ_NODISCARD bool _az_is_http_whitespace(uint8_t c)
 {
   switch (c)
@@ -93,8 +85,11 @@ AZ_NODISCARD az_result _az_get_http_status_line(az_span* self, az_http_response_
   // reason-phrase = *(HTAB / SP / VCHAR / obs-text)
   // HTAB = "\t"
   // VCHAR or obs-text is %x21-FF,
-  int32_t offset = 0;
-  AZ_RETURN_IF_FAILED(_az_scan_until(*self, _az_is_new_line, &offset));
+  int32_t const offset = az_span_find_byte(*self, '\n');
+  if (offset == -1)
+  {
+    return AZ_ERROR_ITEM_NOT_FOUND;
+  }
 
   // save reason-phrase in status line now that we got the offset. Remove 1 last chars(\r)
   out->reason_phrase = az_span_slice(*self, 0, offset - 1);
@@ -159,14 +154,17 @@ AZ_NODISCARD az_result az_http_response_get_next_header(az_http_response* self,
   // header-field   = field-name ":" OWS field-value OWS
   // field-name     = token
   {
-    int32_t field_name_length = 0;
     // https://tools.ietf.org/html/rfc7230#section-3.2.6
     // token = 1*tchar
     // tchar = "!" / "#" / "$" / "%" / "&" / "'" / "*" / "+" / "-" / "." / "^" /
     //         "_" / "`" / "|" / "~" / DIGIT / ALPHA;
     // any VCHAR,
     //    except delimiters
-    AZ_RETURN_IF_FAILED(_az_scan_until(*reader, _az_is_a_colon, &field_name_length));
+    int32_t const field_name_length = az_span_find_byte(*reader, ':');
+    if (field_name_length == -1)
+    {
+      return AZ_ERROR_ITEM_NOT_FOUND;
+    }
 
     // form a header name. Reader is currently at char ':'
     out->key = az_span_slice(*reader, 0, field_name_length);
@@ -0,0 +1,439 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "az_hex_private.h"
+#include "az_http_tracing_private.h"
+#include <az_config_internal.h>
+#include <az_context.h>
+#include <az_http.h>
+#include <az_http_internal.h>
+#include <az_http_transport.h>
+#include <az_http_tracing.h>
+#include <az_json.h>
+#include <az_platform_internal.h>
+#include <az_precondition_internal.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <_az_cfg.h>
+
+// Only the address is used, as the key of the context node that holds the active span.
+static uint8_t _az_http_tracing_context_key = 0;
+
+#if defined(__GNUC__) || defined(__clang__)
+#define _az_HTTP_TRACING_FETCH_ADD(ptr, value) __sync_fetch_and_add(ptr, value)
+#elif defined(_MSC_VER)
+#include <windows.h>
+#define _az_HTTP_TRACING_FETCH_ADD(ptr, value) \
+  ((uint64_t)InterlockedExchangeAdd64((LONG64 volatile*)(ptr), (LONG64)(value)))
+#else
+// Without atomics, ids can only be generated by one thread.
+#define _az_HTTP_TRACING_FETCH_ADD(ptr, value) ((*(ptr) += (value)) - (value))
+#endif
+
+// Trace ids must be unique across processes too, so the generator of trace and span ids is seeded
+// once from the wall time and from addresses that most loaders randomize. Each id then takes its
+// own step of a splitmix64 sequence, so ids are distinct within the process. They are not
+// unpredictable, and must not be used as secrets.
+static uint64_t volatile _az_http_tracing_id_state = 0;
+static az_platform_once _az_http_tracing_id_once = AZ_PLATFORM_ONCE_INIT;
+
+static uint64_t const _az_HTTP_TRACING_ID_STEP = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t _az_http_tracing_mix(uint64_t value)
+{
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  return value ^ (value >> 31);
+}
+
+static void _az_http_tracing_seed_id(void)
+{
+  uint8_t stack_value = 0;
+  uint64_t const seed = (uint64_t)time(NULL) ^ _az_http_tracing_mix((uintptr_t)&stack_value)
+      ^ _az_http_tracing_mix((uintptr_t)&_az_http_tracing_id_state);
+  _az_http_tracing_id_state = _az_http_tracing_mix(seed);
+}
+
+// Unix time in milliseconds at which the platform clock read 0, taken once, when the first span
+// without a clock epoch in its options is serialized.
+static int64_t _az_http_tracing_clock_epoch_msec = 0;
+static az_platform_once _az_http_tracing_clock_epoch_once = AZ_PLATFORM_ONCE_INIT;
+
+static void _az_http_tracing_take_clock_epoch(void)
+{
+  _az_http_tracing_clock_epoch_msec
+      = (int64_t)time(NULL) * _az_TIME_MILLISECONDS_PER_SECOND - az_platform_clock_msec();
+}
+
+static int64_t _az_http_tracing_get_clock_epoch_msec(az_http_tracing_options const* options)
+{
+  if (options != NULL && options->clock_epoch_msec != 0)
+  {
+    return options->clock_epoch_msec;
+  }
+
+  az_result const taken = az_platform_call_once(
+      &_az_http_tracing_clock_epoch_once, _az_http_tracing_take_clock_epoch);
+  (void)taken;
+  return _az_http_tracing_clock_epoch_msec;
+}
+
+static uint64_t _az_http_tracing_next_id()
+{
+  az_result const seeded
+      = az_platform_call_once(&_az_http_tracing_id_once, _az_http_tracing_seed_id);
+  (void)seeded;
+
+  uint64_t const id = _az_http_tracing_mix(
+      _az_HTTP_TRACING_FETCH_ADD(&_az_http_tracing_id_state, _az_HTTP_TRACING_ID_STEP)
+      + _az_HTTP_TRACING_ID_STEP);
+
+  // All zeros is not a valid id.
+  return id == 0 ? 1 : id;
+}
+
+static void _az_http_tracing_write_id(uint8_t* destination, int32_t size, uint64_t id)
+{
+  for (int32_t i = 0; i < size; ++i)
+  {
+    destination[i] = (uint8_t)(id >> ((size - 1 - i) * 8));
+  }
+}
+
+static void _az_http_tracing_span_start(
+    az_http_tracing_span* span,
+    az_http_tracing_span const* parent,
+    _az_http_request const* request,
+    int16_t attempt,
+    az_http_tracing_options const* options)
+{
+  int64_t const now_msec = az_platform_clock_msec();
+
+  *span = (az_http_tracing_span){
+    .has_parent = parent != NULL,
+    .name = request->_internal.method,
+    .url = request->_internal.url,
+    .attempt = attempt,
+    .start_msec = now_msec,
+    .end_msec = now_msec,
+    .result = AZ_OK,
+    .status_code = AZ_HTTP_STATUS_CODE_NONE,
+    .request_body_length = az_http_request_get_body_length(request),
+    .response_length = 0,
+    ._internal = { .options = options },
+  };
+
+  if (parent != NULL)
+  {
+    for (int32_t i = 0; i < AZ_HTTP_TRACING_TRACE_ID_SIZE; ++i)
+    {
+      span->trace_id[i] = parent->trace_id[i];
+    }
+    for (int32_t i = 0; i < AZ_HTTP_TRACING_SPAN_ID_SIZE; ++i)
+    {
+      span->parent_span_id[i] = parent->span_id[i];
+    }
+  }
+  else
+  {
+    _az_http_tracing_write_id(span->trace_id, 8, _az_http_tracing_next_id());
+    _az_http_tracing_write_id(span->trace_id + 8, 8, _az_http_tracing_next_id());
+  }
+
+  _az_http_tracing_write_id(
+      span->span_id, AZ_HTTP_TRACING_SPAN_ID_SIZE, _az_http_tracing_next_id());
+}
+
+void _az_http_tracing_span_end(
+    az_http_tracing_span* span,
+    az_result result,
+    az_http_response* response)
+{
+  span->end_msec = az_platform_clock_msec();
+  span->result = result;
+
+  if (az_succeeded(result) && response != NULL
+      && az_span_length(response->_internal.http_response) > 0)
+  {
+    span->response_length = az_span_length(response->_internal.http_response);
+
+    // Parse a copy, so that the parsing state of the response is left untouched.
+    az_http_response response_copy = *response;
+    az_http_response_status_line status_line = { 0 };
+    if (az_succeeded(az_http_response_get_status_line(&response_copy, &status_line)))
+    {
+      span->status_code = status_line.status_code;
+    }
+  }
+
+  az_http_tracing_options const* const options = span->_internal.options;
+  if (options != NULL && options->exporter != NULL)
+  {
+    options->exporter(span, options->exporter_context);
+  }
+}
+
+AZ_NODISCARD az_result _az_http_tracing_attempt_start(
+    _az_http_request* request,
+    int16_t attempt,
+    az_http_tracing_span* out_span)
+{
+  // Only the spans started by the tracing policy have options; a span set by the user on the
+  // context is a parent for the operation, not for its attempts.
+  az_http_tracing_span* operation_span = NULL;
+  if (request->_internal.context == NULL
+      || az_failed(az_context_get_http_tracing_span(request->_internal.context, &operation_span))
+      || operation_span->_internal.options == NULL)
+  {
+    return AZ_ERROR_ITEM_NOT_FOUND;
+  }
+
+  _az_http_tracing_span_start(
+      out_span, operation_span, request, attempt, operation_span->_internal.options);
+
+  az_span traceparent = { 0 };
+  AZ_RETURN_IF_FAILED(az_http_tracing_span_get_traceparent(
+      out_span, AZ_SPAN_FROM_BUFFER(out_span->_internal.traceparent), &traceparent));
+
+  return az_http_request_append_header(request, AZ_SPAN_FROM_STR("traceparent"), traceparent);
+}
+
+static AZ_NODISCARD az_result
+_az_http_tracing_append_hex(az_span destination, uint8_t const* id, int32_t size, az_span* out)
+{
+  for (int32_t i = 0; i < size; ++i)
+  {
+    AZ_RETURN_IF_FAILED(
+        az_span_append_uint8(destination, _az_number_to_lower_hex(id[i] >> 4), &destination));
+    AZ_RETURN_IF_FAILED(
+        az_span_append_uint8(destination, _az_number_to_lower_hex(id[i] & 0x0F), &destination));
+  }
+
+  *out = destination;
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_http_tracing_span_get_traceparent(
+    az_http_tracing_span const* span,
+    az_span destination,
+    az_span* out_traceparent)
+{
+  AZ_PRECONDITION_NOT_NULL(span);
+  AZ_PRECONDITION_NOT_NULL(out_traceparent);
+
+  az_span result = az_span_init(az_span_ptr(destination), 0, az_span_capacity(destination));
+
+  AZ_RETURN_IF_FAILED(az_span_append(result, AZ_SPAN_FROM_STR("00-"), &result));
+  AZ_RETURN_IF_FAILED(
+      _az_http_tracing_append_hex(result, span->trace_id, AZ_HTTP_TRACING_TRACE_ID_SIZE, &result));
+  AZ_RETURN_IF_FAILED(az_span_append_uint8(result, '-', &result));
+  AZ_RETURN_IF_FAILED(
+      _az_http_tracing_append_hex(result, span->span_id, AZ_HTTP_TRACING_SPAN_ID_SIZE, &result));
+  AZ_RETURN_IF_FAILED(az_span_append(result, AZ_SPAN_FROM_STR("-01"), &result));
+
+  *out_traceparent = result;
+  return AZ_OK;
+}
+
+// Appends a JSON string member holding an id in hexadecimal.
+static AZ_NODISCARD az_result _az_http_tracing_json_append_id(
+    az_json_builder* builder,
+    az_span name,
+    uint8_t const* id,
+    int32_t size)
+{
+  uint8_t buffer[AZ_HTTP_TRACING_TRACE_ID_SIZE * 2];
+  az_span hex = AZ_SPAN_FROM_BUFFER(buffer);
+  AZ_RETURN_IF_FAILED(_az_http_tracing_append_hex(hex, id, size, &hex));
+  return az_json_builder_append_object(builder, name, az_json_token_string(hex));
+}
+
+// OTLP/JSON encodes 64 bit integers as strings.
+static AZ_NODISCARD az_result
+_az_http_tracing_json_append_int64(az_json_builder* builder, az_span name, int64_t value)
+{
+  uint8_t buffer[24];
+  az_span digits = AZ_SPAN_FROM_BUFFER(buffer);
+  AZ_RETURN_IF_FAILED(az_span_append_i64toa(digits, value, &digits));
+  return az_json_builder_append_object(builder, name, az_json_token_string(digits));
+}
+
+// Appends an item of the attributes array: {"key":"...","value":{"<kind>":<value>}}
+static AZ_NODISCARD az_result _az_http_tracing_json_append_attribute(
+    az_json_builder* builder,
+    az_span key,
+    az_span kind,
+    az_json_token value)
+{
+  AZ_RETURN_IF_FAILED(az_json_builder_append_array_item(builder, az_json_token_object()));
+  AZ_RETURN_IF_FAILED(
+      az_json_builder_append_object(builder, AZ_SPAN_FROM_STR("key"), az_json_token_string(key)));
+  AZ_RETURN_IF_FAILED(
+      az_json_builder_append_object(builder, AZ_SPAN_FROM_STR("value"), az_json_token_object()));
+  AZ_RETURN_IF_FAILED(az_json_builder_append_object(builder, kind, value));
+  AZ_RETURN_IF_FAILED(az_json_builder_append_object_close(builder));
+  return az_json_builder_append_object_close(builder);
+}
+
+static AZ_NODISCARD az_result
+_az_http_tracing_json_append_int_attribute(az_json_builder* builder, az_span key, int64_t value)
+{
+  uint8_t buffer[24];
+  az_span digits = AZ_SPAN_FROM_BUFFER(buffer);
+  AZ_RETURN_IF_FAILED(az_span_append_i64toa(digits, value, &digits));
+  return _az_http_tracing_json_append_attribute(
+      builder, key, AZ_SPAN_FROM_STR("intValue"), az_json_token_string(digits));
+}
+
+AZ_NODISCARD az_result az_http_tracing_span_to_json(
+    az_http_tracing_span const* span,
+    az_span destination,
+    az_span* out_json)
+{
+  AZ_PRECONDITION_NOT_NULL(span);
+  AZ_PRECONDITION_NOT_NULL(out_json);
+
+  enum
+  {
+    // OTLP SpanKind and StatusCode values.
+    _az_OTLP_SPAN_KIND_CLIENT = 3,
+    _az_OTLP_STATUS_CODE_OK = 1,
+    _az_OTLP_STATUS_CODE_ERROR = 2,
+  };
+
+  // The platform clock has millisecond resolution.
+  int64_t const nanoseconds_per_msec = 1000000;
+  int64_t const clock_epoch_msec = _az_http_tracing_get_clock_epoch_msec(span->_internal.options);
+
+  az_json_builder builder = { 0 };
+  AZ_RETURN_IF_FAILED(az_json_builder_init(
+      &builder, az_span_init(az_span_ptr(destination), 0, az_span_capacity(destination))));
+
+  AZ_RETURN_IF_FAILED(az_json_builder_append_token(&builder, az_json_token_object()));
+  AZ_RETURN_IF_FAILED(_az_http_tracing_json_append_id(
+      &builder, AZ_SPAN_FROM_STR("traceId"), span->trace_id, AZ_HTTP_TRACING_TRACE_ID_SIZE));
+  AZ_RETURN_IF_FAILED(_az_http_tracing_json_append_id(
+      &builder, AZ_SPAN_FROM_STR("spanId"), span->span_id, AZ_HTTP_TRACING_SPAN_ID_SIZE));
+  if (span->has_parent)
+  {
+    AZ_RETURN_IF_FAILED(_az_http_tracing_json_append_id(
+        &builder,
+        AZ_SPAN_FROM_STR("parentSpanId"),
+        span->parent_span_id,
+        AZ_HTTP_TRACING_SPAN_ID_SIZE));
+  }
+
+  AZ_RETURN_IF_FAILED(az_json_builder_append_object(
+      &builder, AZ_SPAN_FROM_STR("name"), az_json_token_string(span->name)));
+  AZ_RETURN_IF_FAILED(az_json_builder_append_object(
+      &builder, AZ_SPAN_FROM_STR("kind"), az_json_token_number(_az_OTLP_SPAN_KIND_CLIENT)));
+  AZ_RETURN_IF_FAILED(_az_http_tracing_json_append_int64(
+      &builder,
+      AZ_SPAN_FROM_STR("startTimeUnixNano"),
+      (clock_epoch_msec + span->start_msec) * nanoseconds_per_msec));
+  AZ_RETURN_IF_FAILED(_az_http_tracing_json_append_int64(
+      &builder,
+      AZ_SPAN_FROM_STR("endTimeUnixNano"),
+      (clock_epoch_msec + span->end_msec) * nanoseconds_per_msec));
+
+  AZ_RETURN_IF_FAILED(az_json_builder_append_object(
+      &builder, AZ_SPAN_FROM_STR("attributes"), az_json_token_array()));
+  AZ_RETURN_IF_FAILED(_az_http_tracing_json_append_attribute(
+      &builder,
+      AZ_SPAN_FROM_STR("http.method"),
+      AZ_SPAN_FROM_STR("stringValue"),
+      az_json_token_string(span->name)));
+  AZ_RETURN_IF_FAILED(_az_http_tracing_json_append_attribute(
+      &builder,
+      AZ_SPAN_FROM_STR("http.url"),
+      AZ_SPAN_FROM_STR("stringValue"),
+      az_json_token_string(span->url)));
+  if (span->status_code != AZ_HTTP_STATUS_CODE_NONE)
+  {
+    AZ_RETURN_IF_FAILED(_az_http_tracing_json_append_int_attribute(
+        &builder, AZ_SPAN_FROM_STR("http.status_code"), span->status_code));
+  }
+  AZ_RETURN_IF_FAILED(_az_http_tracing_json_append_int_attribute(
+      &builder, AZ_SPAN_FROM_STR("http.request_content_length"), span->request_body_length));
+  AZ_RETURN_IF_FAILED(_az_http_tracing_json_append_int_attribute(
+      &builder, AZ_SPAN_FROM_STR("http.response_content_length"), span->response_length));
+  if (span->attempt > 0)
+  {
+    AZ_RETURN_IF_FAILED(_az_http_tracing_json_append_int_attribute(
+        &builder, AZ_SPAN_FROM_STR("az.retry_attempt"), span->attempt));
+  }
+  AZ_RETURN_IF_FAILED(az_json_builder_append_array_close(&builder));
+
+  bool const failed = az_failed(span->result)
+      || (span->status_code != AZ_HTTP_STATUS_CODE_NONE && span->status_code >= 400);
+  AZ_RETURN_IF_FAILED(
+      az_json_builder_append_object(&builder, AZ_SPAN_FROM_STR("status"), az_json_token_object()));
+  AZ_RETURN_IF_FAILED(az_json_builder_append_object(
+      &builder,
+      AZ_SPAN_FROM_STR("code"),
+      az_json_token_number(failed ? _az_OTLP_STATUS_CODE_ERROR : _az_OTLP_STATUS_CODE_OK)));
+  AZ_RETURN_IF_FAILED(az_json_builder_append_object_close(&builder));
+
+  AZ_RETURN_IF_FAILED(az_json_builder_append_object_close(&builder));
+
+  *out_json = az_json_builder_span_get(&builder);
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_context
+az_context_with_http_tracing_span(az_context const* parent, az_http_tracing_span* span)
+{
+  return az_context_with_value(parent, &_az_http_tracing_context_key, span);
+}
+
+AZ_NODISCARD az_result
+az_context_get_http_tracing_span(az_context const* context, az_http_tracing_span** out_span)
+{
+  AZ_PRECONDITION_NOT_NULL(context);
+  AZ_PRECONDITION_NOT_NULL(out_span);
+
+  void* value = NULL;
+  AZ_RETURN_IF_FAILED(az_context_get_value(context, &_az_http_tracing_context_key, &value));
+  *out_span = (az_http_tracing_span*)value;
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_http_pipeline_policy_tracing(
+    _az_http_policy* p_policies,
+    void* p_options,
+    _az_http_request* p_request,
+    az_http_response* p_response)
+{
+  az_http_tracing_options const* const options = (az_http_tracing_options const*)p_options;
+  if (options == NULL || options->exporter == NULL)
+  {
+    return az_http_pipeline_nextpolicy(p_policies, p_request, p_response);
+  }
+
+  // A span set by the user on the context becomes the parent of the operation span.
+  az_http_tracing_span* parent = NULL;
+  if (p_request->_internal.context != NULL
+      && az_failed(az_context_get_http_tracing_span(p_request->_internal.context, &parent)))
+  {
+    parent = NULL;
+  }
+
+  az_http_tracing_span span = { 0 };
+  _az_http_tracing_span_start(&span, parent, p_request, 0, options);
+
+  // The policies down the pipeline find the operation span in the context of the request.
+  az_context* const context = p_request->_internal.context;
+  az_context traced_context = az_context_with_http_tracing_span(context, &span);
+  p_request->_internal.context = &traced_context;
+
+  az_result const result = az_http_pipeline_nextpolicy(p_policies, p_request, p_response);
+
+  p_request->_internal.context = context;
+  _az_http_tracing_span_end(&span, result, p_response);
+
+  return result;
+}
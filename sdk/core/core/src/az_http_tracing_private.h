@@ -0,0 +1,37 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#ifndef _az_HTTP_TRACING_PRIVATE_H
+#define _az_HTTP_TRACING_PRIVATE_H
+
+#include <az_http.h>
+#include <az_http_tracing.h>
+#include <az_result.h>
+
+#include <stdint.h>
+
+#include <_az_cfg_prefix.h>
+
+/**
+ * @brief Start a span for an attempt of \p request, as a child of the span carried by the request
+ * context, and add its `traceparent` header to the request.
+ *
+ * @return AZ_OK = span started <br>
+ * AZ_ERROR_ITEM_NOT_FOUND = the request is not traced
+ */
+AZ_NODISCARD az_result _az_http_tracing_attempt_start(
+    _az_http_request* request,
+    int16_t attempt,
+    az_http_tracing_span* out_span);
+
+/**
+ * @brief Record the outcome of a span and give it to the exporter.
+ */
+void _az_http_tracing_span_end(
+    az_http_tracing_span* span,
+    az_result result,
+    az_http_response* response);
+
+#include <_az_cfg_suffix.h>
+
+#endif // _az_HTTP_TRACING_PRIVATE_H
@@ -11,54 +11,323 @@
 #include <az_span.h>
 
 #include <stddef.h>
+#include <stdint.h>
+
+// The compare and swap and the increment are full barriers too.
+#if defined(__GNUC__) || defined(__clang__)
+#define _az_LOG_MEMORY_BARRIER() __sync_synchronize()
+#define _az_LOG_COMPARE_AND_SWAP(ptr, expected, desired) \
+  __sync_bool_compare_and_swap(ptr, expected, desired)
+#define _az_LOG_INCREMENT(ptr) ((void)__sync_add_and_fetch(ptr, 1))
+#elif defined(_MSC_VER)
+#include <windows.h>
+#define _az_LOG_MEMORY_BARRIER() MemoryBarrier()
+#define _az_LOG_COMPARE_AND_SWAP(ptr, expected, desired) \
+  (InterlockedCompareExchange((LONG volatile*)(ptr), (LONG)(desired), (LONG)(expected)) \
+   == (LONG)(expected))
+#define _az_LOG_INCREMENT(ptr) ((void)InterlockedIncrement((LONG volatile*)(ptr)))
+#else
+// Without atomics, records can only be written by one thread.
+#define _az_LOG_MEMORY_BARRIER()
+#define _az_LOG_COMPARE_AND_SWAP(ptr, expected, desired) (*(ptr) = (desired), true)
+#define _az_LOG_INCREMENT(ptr) ((void)++*(ptr))
+#endif
 
 #include <_az_cfg.h>
 
-static az_log_classification const* _az_log_classifications = NULL;
 static az_log_message_fn _az_log_message_callback = NULL;
 
+// Classifications selected by the user, compiled into a bitmask by az_log_set_classifications.
+// The list is kept for the classifications that map to no bit.
+static az_log_classification const* _az_log_classifications = NULL;
+static uint64_t _az_log_classifications_mask = _az_LOG_CLASSIFICATIONS_MASK_ALL;
+
+// Non-zero only when a callback is set. It is the one value az_log_should_write has to load.
+uint64_t _az_log_write_mask = 0;
+
+// Deferred log records ring. Write and read positions are free-running counters: producers reserve
+// records by advancing the write position with a compare and swap, and az_log_flush only advances
+// the read position. The sequence of each record tells whether it is free for the position a
+// producer reserves, and whether it was committed for the position az_log_flush reads.
+static az_log_record* _az_log_records = NULL;
+static uint32_t _az_log_records_length = 0;
+static uint32_t volatile _az_log_records_write_position = 0;
+static uint32_t volatile _az_log_records_read_position = 0;
+static int32_t volatile _az_log_records_dropped_count = 0;
+
+static void _az_log_update_write_mask()
+{
+  _az_log_write_mask = _az_log_message_callback == NULL ? 0 : _az_log_classifications_mask;
+}
+
 void az_log_set_classifications(az_log_classification const classifications[])
 {
   _az_log_classifications = classifications;
+  if (classifications == NULL)
+  {
+    // If the user hasn't registered any classifications, then we log everything.
+    _az_log_classifications_mask = _az_LOG_CLASSIFICATIONS_MASK_ALL;
+  }
+  else
+  {
+    uint64_t mask = 0;
+    for (az_log_classification const* cls = classifications; *cls != AZ_LOG_END_OF_LIST; ++cls)
+    {
+      mask |= _az_log_classification_to_bit(*cls);
+    }
+
+    _az_log_classifications_mask = mask;
+  }
+
+  _az_log_update_write_mask();
 }
 
 void az_log_set_callback(az_log_message_fn az_log_message_callback)
 {
   _az_log_message_callback = az_log_message_callback;
+  _az_log_update_write_mask();
 }
 
-void az_log_write(az_log_classification classification, az_span message)
-{
-  if (_az_log_message_callback != NULL && az_log_should_write(classification))
-  {
-    _az_log_message_callback(classification, message);
-  }
-}
-
-bool az_log_should_write(az_log_classification classification)
+#ifndef AZ_NO_LOGGING
+bool _az_log_should_write_unmapped(az_log_classification classification)
 {
   if (_az_log_message_callback == NULL)
   {
-    // If no one is listening, don't attempt to log.
     return false;
   }
 
   if (_az_log_classifications == NULL)
   {
-    // If the user hasn't registered any classifications, then we log everything.
     return true;
   }
 
   for (az_log_classification const* cls = _az_log_classifications; *cls != AZ_LOG_END_OF_LIST;
        ++cls)
   {
-    // Return true if a classification is in the customer-provided list.
     if (*cls == classification)
     {
       return true;
     }
   }
 
-  // Classification is not in the customer-provided list - return false.
   return false;
 }
+
+void az_log_write(az_log_classification classification, az_span message)
+{
+  az_log_message_fn const callback = _az_log_message_callback;
+  if (callback != NULL && az_log_should_write(classification))
+  {
+    callback(classification, message);
+  }
+}
+#endif // AZ_NO_LOGGING
+
+void az_log_set_deferred(az_log_record* records, int32_t records_length)
+{
+  _az_log_records = NULL;
+
+  // Positions wrap at 2^32: the ring index only stays continuous across that wrap when the length
+  // divides 2^32, so the length is rounded down to a power of two.
+  uint32_t length = (records == NULL || records_length <= 0) ? 0 : (uint32_t)records_length;
+  while ((length & (length - 1)) != 0)
+  {
+    length &= length - 1;
+  }
+  _az_log_records_length = length;
+  _az_log_records_write_position = 0;
+  _az_log_records_read_position = 0;
+  _az_log_records_dropped_count = 0;
+  for (uint32_t i = 0; i < _az_log_records_length; ++i)
+  {
+    records[i]._internal.sequence = i;
+  }
+  _az_LOG_MEMORY_BARRIER();
+  _az_log_records = _az_log_records_length == 0 ? NULL : records;
+}
+
+bool az_log_is_deferred() { return _az_log_records != NULL; }
+
+az_log_record* az_log_record_acquire(az_log_classification classification)
+{
+  if (_az_log_records == NULL)
+  {
+    return NULL;
+  }
+
+  az_log_record* record = NULL;
+  while (true)
+  {
+    uint32_t const write_position = _az_log_records_write_position;
+    record = &_az_log_records[write_position & (_az_log_records_length - 1)];
+    int32_t const lag = (int32_t)(record->_internal.sequence - write_position);
+    _az_LOG_MEMORY_BARRIER();
+
+    if (lag < 0)
+    {
+      // The record still holds one that az_log_flush hasn't written.
+      _az_LOG_INCREMENT(&_az_log_records_dropped_count);
+      return NULL;
+    }
+
+    // Otherwise another producer reserved the position first and the write position moved on.
+    if (lag == 0
+        && _az_LOG_COMPARE_AND_SWAP(
+            &_az_log_records_write_position, write_position, write_position + 1))
+    {
+      break;
+    }
+  }
+
+  uint32_t const sequence = record->_internal.sequence;
+  *record = (az_log_record){ 0 };
+  record->_internal.sequence = sequence;
+  record->_internal.classification = classification;
+  return record;
+}
+
+void az_log_record_commit(az_log_record* record)
+{
+  // Make the record content visible before the consumer can see it is committed.
+  _az_LOG_MEMORY_BARRIER();
+  record->_internal.sequence = record->_internal.sequence + 1;
+}
+
+int32_t az_log_get_dropped_count() { return _az_log_records_dropped_count; }
+
+static az_result _az_log_append_record_url(az_log_record const* record, az_span* ref_log_msg)
+{
+  int32_t const url_length = record->_internal.url_length;
+  int32_t const url_copy_length
+      = url_length < AZ_LOG_RECORD_URL_BUF_SIZE ? url_length : AZ_LOG_RECORD_URL_BUF_SIZE;
+
+  AZ_RETURN_IF_FAILED(az_span_append(
+      *ref_log_msg,
+      az_span_init((uint8_t*)record->_internal.url, url_copy_length, url_copy_length),
+      ref_log_msg));
+
+  if (url_copy_length < url_length)
+  {
+    AZ_RETURN_IF_FAILED(az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR(" ..."), ref_log_msg));
+  }
+
+  return AZ_OK;
+}
+
+static az_result _az_log_append_record_http_request_msg(
+    az_log_record const* record,
+    az_span* ref_log_msg)
+{
+  AZ_RETURN_IF_FAILED(
+      az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR("HTTP Request : "), ref_log_msg));
+
+  int32_t const method_length = record->_internal.method_length;
+  AZ_RETURN_IF_FAILED(az_span_append(
+      *ref_log_msg,
+      az_span_init((uint8_t*)record->_internal.method, method_length, method_length),
+      ref_log_msg));
+
+  AZ_RETURN_IF_FAILED(az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR(" "), ref_log_msg));
+  return _az_log_append_record_url(record, ref_log_msg);
+}
+
+static az_result _az_log_append_record_sizes_msg(
+    az_log_record const* record,
+    az_span* ref_log_msg)
+{
+  AZ_RETURN_IF_FAILED(az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR("\n\t"), ref_log_msg));
+  AZ_RETURN_IF_FAILED(
+      az_span_append_i32toa(*ref_log_msg, record->_internal.headers_count, ref_log_msg));
+  AZ_RETURN_IF_FAILED(az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR(" headers, "), ref_log_msg));
+  AZ_RETURN_IF_FAILED(
+      az_span_append_i32toa(*ref_log_msg, record->_internal.body_length, ref_log_msg));
+  AZ_RETURN_IF_FAILED(
+      az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR(" bytes of body"), ref_log_msg));
+
+  return AZ_OK;
+}
+
+static az_result _az_log_append_record_msg(az_log_record const* record, az_span* ref_log_msg)
+{
+  switch (record->_internal.classification)
+  {
+    case AZ_LOG_HTTP_REQUEST:
+    {
+      AZ_RETURN_IF_FAILED(_az_log_append_record_http_request_msg(record, ref_log_msg));
+      return _az_log_append_record_sizes_msg(record, ref_log_msg);
+    }
+    case AZ_LOG_HTTP_RESPONSE:
+    {
+      AZ_RETURN_IF_FAILED(
+          az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR("HTTP Response ("), ref_log_msg));
+      AZ_RETURN_IF_FAILED(
+          az_span_append_i64toa(*ref_log_msg, record->_internal.duration_msec, ref_log_msg));
+      AZ_RETURN_IF_FAILED(az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR("ms) "), ref_log_msg));
+
+      if (record->_internal.status_code == 0)
+      {
+        return az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR("is empty"), ref_log_msg);
+      }
+
+      AZ_RETURN_IF_FAILED(az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR(": "), ref_log_msg));
+      AZ_RETURN_IF_FAILED(
+          az_span_append_i32toa(*ref_log_msg, record->_internal.status_code, ref_log_msg));
+      AZ_RETURN_IF_FAILED(_az_log_append_record_sizes_msg(record, ref_log_msg));
+      AZ_RETURN_IF_FAILED(az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR("\n\n"), ref_log_msg));
+      AZ_RETURN_IF_FAILED(az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR(" -> "), ref_log_msg));
+      return _az_log_append_record_http_request_msg(record, ref_log_msg);
+    }
+    case AZ_LOG_HTTP_RETRY:
+    {
+      AZ_RETURN_IF_FAILED(
+          az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR("HTTP Retry attempt #"), ref_log_msg));
+      AZ_RETURN_IF_FAILED(
+          az_span_append_i32toa(*ref_log_msg, record->_internal.retry_attempt, ref_log_msg));
+      AZ_RETURN_IF_FAILED(
+          az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR(" will be made in "), ref_log_msg));
+      AZ_RETURN_IF_FAILED(
+          az_span_append_i32toa(*ref_log_msg, record->_internal.retry_delay_msec, ref_log_msg));
+      return az_span_append(*ref_log_msg, AZ_SPAN_FROM_STR("ms."), ref_log_msg);
+    }
+    default:
+      return AZ_OK;
+  }
+}
+
+int32_t az_log_flush()
+{
+  if (_az_log_records == NULL)
+  {
+    return 0;
+  }
+
+  int32_t flushed_count = 0;
+
+  // Records are written in order, up to the first one reserved but not committed yet.
+  for (uint32_t read_position = _az_log_records_read_position;; ++read_position, ++flushed_count)
+  {
+    az_log_record* const record
+        = &_az_log_records[read_position & (_az_log_records_length - 1)];
+    if (record->_internal.sequence != read_position + 1)
+    {
+      break;
+    }
+
+    // Make sure the record is read after the sequence that published it.
+    _az_LOG_MEMORY_BARRIER();
+
+    uint8_t log_msg_buf[AZ_LOG_MSG_BUF_SIZE] = { 0 };
+    az_span log_msg = AZ_SPAN_FROM_BUFFER(log_msg_buf);
+
+    (void)_az_log_append_record_msg(record, &log_msg);
+
+    az_log_write(record->_internal.classification, log_msg);
+
+    // Let a producer reuse the record only once the message has been written.
+    _az_LOG_MEMORY_BARRIER();
+    _az_log_records_read_position = read_position + 1;
+    record->_internal.sequence = read_position + _az_log_records_length;
+  }
+
+  return flushed_count;
+}
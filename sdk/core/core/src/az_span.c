@@ -8,8 +8,13 @@
 #include <az_precondition_internal.h>
 #include <az_span.h>
 
-#include <ctype.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <_az_cfg.h>
 
@@ -50,6 +55,16 @@ AZ_NODISCARD AZ_INLINE uint8_t az_ascii_lower(uint8_t value)
   return 'A' <= value && value <= 'Z' ? value + AZ_ASCII_LOWER_DIF : value;
 }
 
+#if defined(__SSE2__)
+// Lowercases 16 ASCII characters: 'A'..'Z' are shifted to the 26 lowest signed bytes.
+AZ_INLINE __m128i _az_span_ascii_lower_16(__m128i chars)
+{
+  __m128i const shifted = _mm_sub_epi8(chars, _mm_set1_epi8((char)('A' + 128)));
+  __m128i const upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(-128 + 26));
+  return _mm_or_si128(chars, _mm_and_si128(upper, _mm_set1_epi8(AZ_ASCII_LOWER_DIF)));
+}
+#endif // __SSE2__
+
 AZ_NODISCARD bool az_span_is_content_equal_ignoring_case(az_span span1, az_span span2)
 {
   int32_t const size = az_span_length(span1);
@@ -57,9 +72,26 @@ AZ_NODISCARD bool az_span_is_content_equal_ignoring_case(az_span span1, az_span
   {
     return false;
   }
-  for (int32_t i = 0; i < size; ++i)
+
+  uint8_t const* const ptr1 = az_span_ptr(span1);
+  uint8_t const* const ptr2 = az_span_ptr(span2);
+  int32_t i = 0;
+
+#if defined(__SSE2__)
+  for (; i + 16 <= size; i += 16)
   {
-    if (az_ascii_lower(az_span_ptr(span1)[i]) != az_ascii_lower(az_span_ptr(span2)[i]))
+    __m128i const chars1 = _az_span_ascii_lower_16(_mm_loadu_si128((__m128i const*)(ptr1 + i)));
+    __m128i const chars2 = _az_span_ascii_lower_16(_mm_loadu_si128((__m128i const*)(ptr2 + i)));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(chars1, chars2)) != 0xFFFF)
+    {
+      return false;
+    }
+  }
+#endif // __SSE2__
+
+  for (; i < size; ++i)
+  {
+    if (ptr1[i] != ptr2[i] && az_ascii_lower(ptr1[i]) != az_ascii_lower(ptr2[i]))
     {
       return false;
     }
@@ -67,55 +99,189 @@ AZ_NODISCARD bool az_span_is_content_equal_ignoring_case(az_span span1, az_span
   return true;
 }
 
-AZ_NODISCARD az_result az_span_to_uint64(az_span span, uint64_t* out_number)
+AZ_NODISCARD int32_t az_span_find_byte(az_span span, uint8_t byte)
 {
-  AZ_PRECONDITION_VALID_SPAN(span, 1, false);
-  AZ_PRECONDITION_NOT_NULL(out_number);
+  AZ_PRECONDITION_VALID_SPAN(span, 0, true);
 
-  int32_t self_length = az_span_length(span);
-  uint64_t value = 0;
+  // memchr is vectorized by the C libraries.
+  uint8_t const* const ptr = az_span_ptr(span);
+  uint8_t const* const found
+      = az_span_length(span) == 0 ? NULL : memchr(ptr, byte, (size_t)az_span_length(span));
+  return found == NULL ? -1 : (int32_t)(found - ptr);
+}
+
+AZ_NODISCARD int32_t az_span_find_any(az_span span, az_span set)
+{
+  AZ_PRECONDITION_VALID_SPAN(span, 0, true);
+  AZ_PRECONDITION_VALID_SPAN(set, 1, false);
+
+  uint8_t const* const ptr = az_span_ptr(span);
+  uint8_t const* const set_ptr = az_span_ptr(set);
+  int32_t const length = az_span_length(span);
+  int32_t const set_length = az_span_length(set);
+  int32_t i = 0;
 
-  for (int32_t i = 0; i < self_length; ++i)
+#if defined(__SSE2__)
+  // Small sets, such as delimiters, are compared with 16 characters at a time.
+  if (set_length <= 4)
   {
-    uint8_t result = az_span_ptr(span)[i];
-    if (!isdigit(result))
+    __m128i set_chars[4];
+    for (int32_t j = 0; j < 4; ++j)
     {
-      return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
+      set_chars[j] = _mm_set1_epi8((char)set_ptr[j < set_length ? j : 0]);
     }
-    uint64_t const d = (uint64_t)result - '0';
-    if ((UINT64_MAX - d) / 10 < value)
+
+    for (; i + 16 <= length; i += 16)
     {
-      return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
+      __m128i const chars = _mm_loadu_si128((__m128i const*)(ptr + i));
+      __m128i const found = _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(chars, set_chars[0]), _mm_cmpeq_epi8(chars, set_chars[1])),
+          _mm_or_si128(_mm_cmpeq_epi8(chars, set_chars[2]), _mm_cmpeq_epi8(chars, set_chars[3])));
+      int const mask = _mm_movemask_epi8(found);
+      if (mask != 0)
+      {
+        return i + __builtin_ctz((unsigned)mask);
+      }
+    }
+  }
+#endif // __SSE2__
+
+  uint32_t bitmap[256 / 32] = { 0 };
+  for (int32_t j = 0; j < set_length; ++j)
+  {
+    bitmap[set_ptr[j] >> 5] |= 1u << (set_ptr[j] & 31);
+  }
+
+  for (; i < length; ++i)
+  {
+    if ((bitmap[ptr[i] >> 5] >> (ptr[i] & 31)) & 1)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+AZ_NODISCARD int32_t az_span_find(az_span span, az_span target)
+{
+  AZ_PRECONDITION_VALID_SPAN(span, 0, true);
+  AZ_PRECONDITION_VALID_SPAN(target, 1, false);
+
+  uint8_t const* const ptr = az_span_ptr(span);
+  uint8_t const* const target_ptr = az_span_ptr(target);
+  int32_t const length = az_span_length(span);
+  int32_t const target_length = az_span_length(target);
+
+  // Candidates are found by their first byte with memchr, and checked with memcmp.
+  int32_t i = 0;
+  while (length - i >= target_length)
+  {
+    uint8_t const* const candidate
+        = memchr(ptr + i, target_ptr[0], (size_t)(length - i - target_length + 1));
+    if (candidate == NULL)
+    {
+      break;
+    }
+
+    i = (int32_t)(candidate - ptr);
+    if (memcmp(candidate + 1, target_ptr + 1, (size_t)(target_length - 1)) == 0)
+    {
+      return i;
+    }
+    ++i;
+  }
+  return -1;
+}
+
+enum
+{
+  _az_SPAN_UINT32_DIGITS_MAX = 10, // 4294967295
+  _az_SPAN_UINT64_DIGITS_MAX = 20, // 18446744073709551615
+};
+
+// Parses up to 19 digits, which cannot overflow. Returns false if a character isn't a digit.
+static bool _az_span_parse_digits(uint8_t const* ptr, int32_t length, uint64_t* out_value)
+{
+  uint64_t value = 0;
+  int32_t i = 0;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  // 8 digits at a time, as one 64-bit word whose first byte is the most significant digit.
+  for (; i + 8 <= length; i += 8)
+  {
+    uint64_t chunk;
+    memcpy(&chunk, ptr + i, sizeof(chunk));
+
+    // Digits are 0x30..0x39: the high nibble is 3, and adding 6 doesn't carry into it.
+    if ((chunk & 0xF0F0F0F0F0F0F0F0ull) != 0x3030303030303030ull
+        || ((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) != 0x3030303030303030ull)
+    {
+      return false;
     }
 
+    // Combines pairs of digits, then pairs of 2-digit and 4-digit numbers.
+    chunk -= 0x3030303030303030ull;
+    chunk = (chunk * 10) + (chunk >> 8);
+    chunk = (((chunk & 0x000000FF000000FFull) * (100 + (1000000ull << 32)))
+             + (((chunk >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32))))
+        >> 32;
+
+    value = value * 100000000 + chunk;
+  }
+#endif // __BYTE_ORDER__
+
+  for (; i < length; ++i)
+  {
+    uint8_t const d = (uint8_t)(ptr[i] - '0');
+    if (d > 9)
+    {
+      return false;
+    }
     value = value * 10 + d;
   }
 
-  *out_number = value;
-  return AZ_OK;
+  *out_value = value;
+  return true;
 }
 
-AZ_NODISCARD az_result az_span_to_uint32(az_span span, uint32_t* out_number)
+// Gets the significant digits of a number that is too long to parse without overflow checks.
+static void _az_span_skip_zeros(uint8_t const** ptr, int32_t* length)
+{
+  while (*length > 0 && **ptr == '0')
+  {
+    ++*ptr;
+    --*length;
+  }
+}
+
+AZ_NODISCARD az_result az_span_to_uint64(az_span span, uint64_t* out_number)
 {
   AZ_PRECONDITION_VALID_SPAN(span, 1, false);
   AZ_PRECONDITION_NOT_NULL(out_number);
 
-  int32_t self_length = az_span_length(span);
-  uint32_t value = 0;
+  uint8_t const* ptr = az_span_ptr(span);
+  int32_t length = az_span_length(span);
+  if (length >= _az_SPAN_UINT64_DIGITS_MAX)
+  {
+    _az_span_skip_zeros(&ptr, &length);
+  }
 
-  for (int32_t i = 0; i < self_length; ++i)
+  // Only the 20th digit can overflow.
+  uint64_t value = 0;
+  if (length > _az_SPAN_UINT64_DIGITS_MAX
+      || !_az_span_parse_digits(
+          ptr, length < _az_SPAN_UINT64_DIGITS_MAX ? length : length - 1, &value))
   {
-    uint8_t result = az_span_ptr(span)[i];
-    if (!isdigit(result))
-    {
-      return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
-    }
-    uint32_t const d = (uint32_t)result - '0';
-    if ((UINT32_MAX - d) / 10 < value)
+    return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
+  }
+
+  if (length == _az_SPAN_UINT64_DIGITS_MAX)
+  {
+    uint8_t const d = (uint8_t)(ptr[length - 1] - '0');
+    if (d > 9 || (UINT64_MAX - d) / 10 < value)
     {
       return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
     }
-
     value = value * 10 + d;
   }
 
@@ -123,6 +289,29 @@ AZ_NODISCARD az_result az_span_to_uint32(az_span span, uint32_t* out_number)
   return AZ_OK;
 }
 
+AZ_NODISCARD az_result az_span_to_uint32(az_span span, uint32_t* out_number)
+{
+  AZ_PRECONDITION_VALID_SPAN(span, 1, false);
+  AZ_PRECONDITION_NOT_NULL(out_number);
+
+  uint8_t const* ptr = az_span_ptr(span);
+  int32_t length = az_span_length(span);
+  if (length > _az_SPAN_UINT32_DIGITS_MAX)
+  {
+    _az_span_skip_zeros(&ptr, &length);
+  }
+
+  uint64_t value = 0;
+  if (length > _az_SPAN_UINT32_DIGITS_MAX || !_az_span_parse_digits(ptr, length, &value)
+      || value > UINT32_MAX)
+  {
+    return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
+  }
+
+  *out_number = (uint32_t)value;
+  return AZ_OK;
+}
+
 AZ_NODISCARD az_result az_span_copy(az_span destination, az_span source, az_span* out_span)
 {
   AZ_PRECONDITION_VALID_SPAN(destination, 0, true);
@@ -143,18 +332,79 @@ AZ_NODISCARD az_result az_span_copy(az_span destination, az_span source, az_span
   return AZ_OK;
 }
 
-AZ_NODISCARD AZ_INLINE bool should_encode(uint8_t c)
+// Unreserved characters (RFC 3986), which are not url-encoded.
+static const uint8_t url_unreserved[256] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, //  - .
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, // 0-9
+  0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // A-O
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1, // P-Z _
+  0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // a-o
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 0, // p-z ~
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //
+};
+
+// Gets the number of unreserved characters at the start of ptr.
+static int32_t _az_span_url_unreserved_run(uint8_t const* ptr, int32_t length)
 {
-  switch (c)
+  int32_t run = 0;
+
+#if defined(__SSE2__)
+  // 16 characters at a time: letters are lowercased by setting bit 5, and the characters from 0x80
+  // are negative, so they fall out of every range.
+  __m128i const case_bit = _mm_set1_epi8(0x20);
+  for (; run + 16 <= length; run += 16)
+  {
+    __m128i const chars = _mm_loadu_si128((__m128i const*)(ptr + run));
+    __m128i const lower = _mm_or_si128(chars, case_bit);
+    __m128i const letters = _mm_and_si128(
+        _mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+        _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i const digits = _mm_and_si128(
+        _mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+        _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+    __m128i const marks = _mm_or_si128(
+        _mm_or_si128(
+            _mm_cmpeq_epi8(chars, _mm_set1_epi8('-')), _mm_cmpeq_epi8(chars, _mm_set1_epi8('.'))),
+        _mm_or_si128(
+            _mm_cmpeq_epi8(chars, _mm_set1_epi8('_')), _mm_cmpeq_epi8(chars, _mm_set1_epi8('~'))));
+
+    int const mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letters, digits), marks));
+    if (mask != 0xFFFF)
+    {
+      return run + __builtin_ctz((unsigned)~mask);
+    }
+  }
+#endif // __SSE2__
+
+  while (run < length && url_unreserved[ptr[run]])
   {
-    case '-':
-    case '_':
-    case '.':
-    case '~':
-      return false;
-    default:
-      return !(('0' <= c && c <= '9') || ('A' <= c && c <= 'Z') || ('a' <= c && c <= 'z'));
+    ++run;
+  }
+  return run;
+}
+
+AZ_NODISCARD int32_t az_span_url_encode_length(az_span source)
+{
+  AZ_PRECONDITION_VALID_SPAN(source, 0, true);
+
+  uint8_t const* const ptr = az_span_ptr(source);
+  int32_t const length = az_span_length(source);
+
+  int32_t result = length;
+  for (int32_t i = 0; i < length; ++i)
+  {
+    result += url_unreserved[ptr[i]] ? 0 : 2;
   }
+  return result;
 }
 
 AZ_NODISCARD az_result
@@ -164,41 +414,114 @@ az_span_copy_url_encode(az_span destination, az_span source, az_span* out_span)
   AZ_PRECONDITION_VALID_SPAN(destination, 0, true);
   AZ_PRECONDITION_VALID_SPAN(source, 0, true);
 
+  uint8_t const* const p_s = az_span_ptr(source);
+  uint8_t* const p_d = az_span_ptr(destination);
   int32_t const input_size = az_span_length(source);
+  int32_t const capacity = az_span_capacity(destination);
 
-  int32_t result_size = 0;
-  for (int32_t i = 0; i < input_size; ++i)
+  // Single pass: runs of unreserved characters are copied as a whole, and the size is only checked
+  // as the destination fills up.
+  int32_t s = 0;
+  int32_t d = 0;
+  while (s < input_size)
   {
-    result_size += should_encode(az_span_ptr(source)[i]) ? 3 : 1;
+    int32_t const run = _az_span_url_unreserved_run(p_s + s, input_size - s);
+    if (capacity - d < run)
+    {
+      return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+    }
+    if (run > 0)
+    {
+      memcpy(p_d + d, p_s + s, (size_t)run);
+      s += run;
+      d += run;
+    }
+
+    if (s < input_size)
+    {
+      if (capacity - d < 3)
+      {
+        return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+      }
+
+      uint8_t const c = p_s[s];
+      p_d[d] = '%';
+      p_d[d + 1] = _az_number_to_upper_hex(c >> 4);
+      p_d[d + 2] = _az_number_to_upper_hex(c & 0x0F);
+      s += 1;
+      d += 3;
+    }
   }
+  *out_span = az_span_init(p_d, d, capacity);
 
-  if (az_span_capacity(destination) < result_size)
+  return AZ_OK;
+}
+
+// Gets the value of a hexadecimal digit, or -1.
+static int32_t _az_span_hex_digit_value(uint8_t c)
+{
+  if ('0' <= c && c <= '9')
   {
-    return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+    return c - '0';
   }
+  c |= AZ_ASCII_LOWER_DIF;
+  return 'a' <= c && c <= 'f' ? c - _az_HEX_LOWER_OFFSET : -1;
+}
 
-  uint8_t* p_s = az_span_ptr(source);
-  uint8_t* p_d = az_span_ptr(destination);
+AZ_NODISCARD az_result
+az_span_copy_url_decode(az_span destination, az_span source, az_span* out_span)
+{
+  AZ_PRECONDITION_NOT_NULL(out_span);
+  AZ_PRECONDITION_VALID_SPAN(destination, 0, true);
+  AZ_PRECONDITION_VALID_SPAN(source, 0, true);
+
+  uint8_t const* const p_s = az_span_ptr(source);
+  uint8_t* const p_d = az_span_ptr(destination);
+  int32_t const input_size = az_span_length(source);
+  int32_t const capacity = az_span_capacity(destination);
+
+  // The output is never longer than the input, and is written behind it: decoding in place works.
   int32_t s = 0;
-  for (int32_t i = 0; i < input_size; ++i)
+  int32_t d = 0;
+  while (s < input_size)
   {
-    uint8_t c = p_s[i];
-    if (!should_encode(c))
+    uint8_t const* const percent = memchr(p_s + s, '%', (size_t)(input_size - s));
+    int32_t const run = percent == NULL ? input_size - s : (int32_t)(percent - (p_s + s));
+    if (capacity - d < run)
     {
-      *p_d = c;
-      p_d += 1;
-      s += 1;
+      return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+    }
+    if (run > 0)
+    {
+      memmove(p_d + d, p_s + s, (size_t)run);
+      s += run;
+      d += run;
     }
-    else
+
+    if (s < input_size)
     {
-      p_d[0] = '%';
-      p_d[1] = _az_number_to_upper_hex(c >> 4);
-      p_d[2] = _az_number_to_upper_hex(c & 0x0F);
-      p_d += 3;
+      if (input_size - s < 3)
+      {
+        return AZ_ERROR_EOF;
+      }
+
+      int32_t const high = _az_span_hex_digit_value(p_s[s + 1]);
+      int32_t const low = _az_span_hex_digit_value(p_s[s + 2]);
+      if (high < 0 || low < 0)
+      {
+        return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
+      }
+      if (capacity - d < 1)
+      {
+        return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+      }
+
+      p_d[d] = (uint8_t)(high << 4 | low);
       s += 3;
+      d += 1;
     }
   }
-  *out_span = az_span_init(az_span_ptr(destination), s, az_span_capacity(destination));
+  *out_span = az_span_init(p_d, d, capacity);
 
   return AZ_OK;
 }
@@ -363,106 +686,130 @@ AZ_NODISCARD az_result az_span_append_dtoa(az_span destination, double source, a
   }
 }
 
-AZ_INLINE uint8_t _az_decimal_to_ascii(uint8_t d) { return '0' + d; }
+// The 2 digits of 0 to 99.
+static const uint8_t _az_span_digit_pairs[] = "0001020304050607080910111213141516171819"
+                                              "2021222324252627282930313233343536373839"
+                                              "4041424344454647484950515253545556575859"
+                                              "6061626364656667686970717273747576777879"
+                                              "8081828384858687888990919293949596979899";
 
-static AZ_NODISCARD az_result _az_span_builder_append_uint64(az_span* self, uint64_t n)
+// Counts the digits of a number. Small numbers, such as status codes, take the first branches.
+static int32_t _az_span_digit_count(uint64_t n)
 {
-  if (n == 0)
+  if (n < 10)
   {
-    return az_span_append(*self, AZ_SPAN_FROM_STR("0"), self);
+    return 1;
   }
-
-  uint64_t div = 10000000000000000000ull;
-  uint64_t nn = n;
-  while (nn / div == 0)
+  if (n < 100)
   {
-    div /= 10;
+    return 2;
   }
-
-  while (div > 1)
+  if (n < 1000)
   {
-    uint8_t value_to_append = _az_decimal_to_ascii((uint8_t)(nn / div));
-    AZ_RETURN_IF_FAILED(az_span_append(*self, az_span_init(&value_to_append, 1, 1), self));
+    return 3;
+  }
 
-    nn %= div;
-    div /= 10;
+  int32_t count = 4;
+  for (uint64_t power = 10000; n >= power && count < _az_SPAN_UINT64_DIGITS_MAX; power *= 10)
+  {
+    ++count;
   }
-  uint8_t value_to_append = _az_decimal_to_ascii((uint8_t)nn);
-  return az_span_append(*self, az_span_init(&value_to_append, 1, 1), self);
+  return count;
 }
 
-AZ_NODISCARD az_result
-az_span_append_u64toa(az_span destination, uint64_t source, az_span* out_span)
+// Appends a number, with an optional minus sign, writing 2 digits at a time from the end.
+static AZ_NODISCARD az_result
+_az_span_append_uint64(az_span destination, bool negative, uint64_t n, az_span* out_span)
 {
-  AZ_PRECONDITION_NOT_NULL(out_span);
-  *out_span = destination;
+  int32_t const digits = _az_span_digit_count(n);
+  int32_t const length = az_span_length(destination);
+  int32_t const size = digits + (negative ? 1 : 0);
 
-  return _az_span_builder_append_uint64(out_span, source);
-}
+  if (az_span_capacity(destination) - length < size)
+  {
+    return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+  }
 
-AZ_NODISCARD az_result az_span_append_i64toa(az_span destination, int64_t source, az_span* out_span)
-{
-  AZ_PRECONDITION_NOT_NULL(out_span);
+  uint8_t* const start = az_span_ptr(destination) + length;
+  uint8_t* p = start + size;
 
-  if (source < 0)
+  // Numbers past 32 bits are split so that the loop divides 32-bit numbers, which is much cheaper
+  // on 32-bit targets.
+  while (n > UINT32_MAX)
   {
-    AZ_RETURN_IF_FAILED(az_span_append(destination, AZ_SPAN_FROM_STR("-"), out_span));
-    return _az_span_builder_append_uint64(out_span, -source);
+    uint32_t low = (uint32_t)(n % 100000000);
+    n /= 100000000;
+    for (int32_t i = 0; i < 4; ++i)
+    {
+      p -= 2;
+      memcpy(p, &_az_span_digit_pairs[(low % 100) * 2], 2);
+      low /= 100;
+    }
   }
 
-  return _az_span_builder_append_uint64(out_span, source);
-}
+  uint32_t nn = (uint32_t)n;
+  while (nn >= 100)
+  {
+    p -= 2;
+    memcpy(p, &_az_span_digit_pairs[(nn % 100) * 2], 2);
+    nn /= 100;
+  }
 
-static AZ_NODISCARD az_result
-_az_span_builder_append_u32toa(az_span self, uint32_t n, az_span* out_span)
-{
-  if (n == 0)
+  if (nn >= 10)
+  {
+    p -= 2;
+    memcpy(p, &_az_span_digit_pairs[nn * 2], 2);
+  }
+  else
   {
-    return az_span_append_uint8(self, '0', out_span);
+    *--p = (uint8_t)('0' + nn);
   }
 
-  uint32_t div = 1000000000;
-  uint32_t nn = n;
-  while (nn / div == 0)
+  if (negative)
   {
-    div /= 10;
+    *--p = '-';
   }
 
-  *out_span = self;
+  *out_span = az_span_init(az_span_ptr(destination), length + size, az_span_capacity(destination));
+  return AZ_OK;
+}
 
-  while (div > 1)
-  {
-    uint8_t value_to_append = _az_decimal_to_ascii((uint8_t)(nn / div));
-    AZ_RETURN_IF_FAILED(az_span_append_uint8(*out_span, value_to_append, out_span));
+AZ_NODISCARD az_result
+az_span_append_u64toa(az_span destination, uint64_t source, az_span* out_span)
+{
+  AZ_PRECONDITION_VALID_SPAN(destination, 0, false);
+  AZ_PRECONDITION_NOT_NULL(out_span);
 
-    nn %= div;
-    div /= 10;
-  }
+  return _az_span_append_uint64(destination, false, source, out_span);
+}
 
-  uint8_t value_to_append = _az_decimal_to_ascii((uint8_t)nn);
-  return az_span_append_uint8(*out_span, value_to_append, out_span);
+AZ_NODISCARD az_result az_span_append_i64toa(az_span destination, int64_t source, az_span* out_span)
+{
+  AZ_PRECONDITION_VALID_SPAN(destination, 0, false);
+  AZ_PRECONDITION_NOT_NULL(out_span);
+
+  // The magnitude is computed unsigned, which is also correct for INT64_MIN.
+  return source < 0 ? _az_span_append_uint64(destination, true, 0 - (uint64_t)source, out_span)
+                    : _az_span_append_uint64(destination, false, (uint64_t)source, out_span);
 }
 
 AZ_NODISCARD az_result
 az_span_append_u32toa(az_span destination, uint32_t source, az_span* out_span)
 {
+  AZ_PRECONDITION_VALID_SPAN(destination, 0, false);
   AZ_PRECONDITION_NOT_NULL(out_span);
-  return _az_span_builder_append_u32toa(destination, source, out_span);
+
+  return _az_span_append_uint64(destination, false, source, out_span);
 }
 
 AZ_NODISCARD az_result az_span_append_i32toa(az_span destination, int32_t source, az_span* out_span)
 {
+  AZ_PRECONDITION_VALID_SPAN(destination, 0, false);
   AZ_PRECONDITION_NOT_NULL(out_span);
 
-  *out_span = destination;
-
-  if (source < 0)
-  {
-    AZ_RETURN_IF_FAILED(az_span_append_uint8(*out_span, '-', out_span));
-    source = -source;
-  }
-
-  return _az_span_builder_append_u32toa(*out_span, source, out_span);
+  return source < 0
+      ? _az_span_append_uint64(destination, true, 0 - (uint64_t)(int64_t)source, out_span)
+      : _az_span_append_uint64(destination, false, (uint64_t)source, out_span);
 }
 
 // TODO: pass az_span by value
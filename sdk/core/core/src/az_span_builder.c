@@ -0,0 +1,184 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_precondition.h>
+#include <az_precondition_internal.h>
+#include <az_result.h>
+#include <az_span.h>
+#include <az_span_builder.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <_az_cfg.h>
+
+enum
+{
+  _az_SPAN_BUILDER_INT64_SIZE_MAX = 20, // -9223372036854775808
+};
+
+AZ_NODISCARD az_result
+az_span_arena_init(az_span_arena* arena, az_span* blocks, int32_t blocks_length)
+{
+  AZ_PRECONDITION_NOT_NULL(arena);
+  AZ_PRECONDITION_NOT_NULL(blocks);
+  AZ_PRECONDITION(blocks_length > 0);
+
+  *arena = (az_span_arena){ ._internal = {
+                                .blocks = blocks,
+                                .blocks_length = blocks_length,
+                                .block = 0,
+                                .used = 0,
+                            } };
+  return AZ_OK;
+}
+
+// Finds the first block, from the current one, with room for size more bytes, and for the
+// moved_size bytes to move from the current block to a next one. A block left for the next one is
+// not used again until the arena is reset.
+static AZ_NODISCARD az_result _az_span_arena_find_block(
+    az_span_arena const* arena,
+    int32_t size,
+    int32_t moved_size,
+    int32_t* out_block)
+{
+  if (az_span_capacity(arena->_internal.blocks[arena->_internal.block]) - arena->_internal.used
+      >= size)
+  {
+    *out_block = arena->_internal.block;
+    return AZ_OK;
+  }
+
+  for (int32_t block = arena->_internal.block + 1; block < arena->_internal.blocks_length;
+       ++block)
+  {
+    if (az_span_capacity(arena->_internal.blocks[block]) >= moved_size + size)
+    {
+      *out_block = block;
+      return AZ_OK;
+    }
+  }
+
+  return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+}
+
+AZ_NODISCARD az_result
+az_span_arena_allocate(az_span_arena* arena, int32_t capacity, az_span* out_span)
+{
+  AZ_PRECONDITION_NOT_NULL(arena);
+  AZ_PRECONDITION(capacity >= 0);
+  AZ_PRECONDITION_NOT_NULL(out_span);
+
+  int32_t block = 0;
+  AZ_RETURN_IF_FAILED(_az_span_arena_find_block(arena, capacity, 0, &block));
+
+  if (block != arena->_internal.block)
+  {
+    arena->_internal.block = block;
+    arena->_internal.used = 0;
+  }
+
+  *out_span = az_span_init(
+      az_span_ptr(arena->_internal.blocks[block]) + arena->_internal.used, 0, capacity);
+  arena->_internal.used += capacity;
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_span_builder_init(az_span_builder* builder, az_span_arena* arena)
+{
+  AZ_PRECONDITION_NOT_NULL(builder);
+  AZ_PRECONDITION_NOT_NULL(arena);
+
+  uint8_t* const ptr
+      = az_span_ptr(arena->_internal.blocks[arena->_internal.block]) + arena->_internal.used;
+
+  *builder = (az_span_builder){ ._internal = {
+                                    .arena = arena,
+                                    .ptr = ptr,
+                                    .length = 0,
+                                } };
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result
+az_span_builder_reserve(az_span_builder* builder, int32_t size, az_span* out_span)
+{
+  AZ_PRECONDITION_NOT_NULL(builder);
+  AZ_PRECONDITION(size >= 0);
+  AZ_PRECONDITION_NOT_NULL(out_span);
+
+  az_span_arena* const arena = builder->_internal.arena;
+  int32_t const length = builder->_internal.length;
+
+  // The content of the builder must be the last allocation of the arena.
+  AZ_PRECONDITION(
+      az_span_ptr(arena->_internal.blocks[arena->_internal.block]) + arena->_internal.used
+      == builder->_internal.ptr + length);
+
+  int32_t block = 0;
+  AZ_RETURN_IF_FAILED(_az_span_arena_find_block(arena, size, length, &block));
+
+  if (block != arena->_internal.block)
+  {
+    // The content moves with the builder.
+    uint8_t* const ptr = az_span_ptr(arena->_internal.blocks[block]);
+    memmove(ptr, builder->_internal.ptr, (size_t)length);
+
+    builder->_internal.ptr = ptr;
+    arena->_internal.block = block;
+    arena->_internal.used = length;
+  }
+
+  // The rest of the block is handed out, for appending functions that need more room than they
+  // write.
+  *out_span = az_span_init(
+      builder->_internal.ptr + length,
+      0,
+      az_span_capacity(arena->_internal.blocks[block]) - arena->_internal.used);
+  return AZ_OK;
+}
+
+void az_span_builder_commit(az_span_builder* builder, az_span appended)
+{
+  AZ_PRECONDITION_NOT_NULL(builder);
+  AZ_PRECONDITION(az_span_ptr(appended) == builder->_internal.ptr + builder->_internal.length);
+
+  builder->_internal.length += az_span_length(appended);
+  builder->_internal.arena->_internal.used += az_span_length(appended);
+}
+
+AZ_NODISCARD az_result az_span_builder_append(az_span_builder* builder, az_span source)
+{
+  AZ_PRECONDITION_VALID_SPAN(source, 0, true);
+
+  az_span tail = AZ_SPAN_NULL;
+  AZ_RETURN_IF_FAILED(az_span_builder_reserve(builder, az_span_length(source), &tail));
+  AZ_RETURN_IF_FAILED(az_span_append(tail, source, &tail));
+
+  az_span_builder_commit(builder, tail);
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_span_builder_append_i64toa(az_span_builder* builder, int64_t source)
+{
+  az_span tail = AZ_SPAN_NULL;
+  AZ_RETURN_IF_FAILED(az_span_builder_reserve(builder, _az_SPAN_BUILDER_INT64_SIZE_MAX, &tail));
+  AZ_RETURN_IF_FAILED(az_span_append_i64toa(tail, source, &tail));
+
+  az_span_builder_commit(builder, tail);
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result
+az_span_builder_append_url_encode(az_span_builder* builder, az_span source)
+{
+  AZ_PRECONDITION_VALID_SPAN(source, 0, true);
+
+  az_span tail = AZ_SPAN_NULL;
+  AZ_RETURN_IF_FAILED(
+      az_span_builder_reserve(builder, az_span_url_encode_length(source), &tail));
+  AZ_RETURN_IF_FAILED(az_span_copy_url_encode(tail, source, &tail));
+
+  az_span_builder_commit(builder, tail);
+  return AZ_OK;
+}
@@ -34,12 +34,17 @@ void test_json_parser_init(void** state);
 void test_az_span(void** state);
 void test_az_span_replace(void** state);
 void test_az_span_getters(void** state);
+void test_az_span_find(void** state);
 
 /* AZ_context tests */
 void test_az_context(void** state);
+void test_az_context_cached_expiration(void** state);
+void test_az_context_cancel_callbacks(void** state);
 
 /* HTTP Tests */
 void test_http_request(void** state);
+void test_http_request_body_parts(void** state);
+void test_http_request_prepared(void** state);
 void test_http_response(void** state);
 
 /* AZ_Log Tests */
@@ -47,6 +52,9 @@ void test_az_log(void** state);
 
 /* URL encode tests */
 void test_url_encode(void** state);
+void test_url_encode_overflow(void** state);
+void test_url_decode(void** state);
+void test_span_builder(void** state);
 
 /* az pipeline tests */
 void test_az_pipeline(void** state);
@@ -57,13 +65,31 @@ void test_az_aad(void** state);
 /* az http policy tests */
 void test_az_http_policy(void** state);
 
+/* az credential token cache tests */
+void test_az_credential_token_cache(void** state);
+void test_az_credential_token_cache_credential(void** state);
+
+/* az http metrics tests */
+void test_az_http_metrics(void** state);
+
+/* az http cache tests */
+void test_az_http_cache(void** state);
+
+/* az http tracing tests */
+void test_az_http_tracing(void** state);
+
 const struct CMUnitTest tests[] = {
   /* URL encode tests */
   cmocka_unit_test(test_url_encode),
+  cmocka_unit_test(test_url_encode_overflow),
+  cmocka_unit_test(test_url_decode),
+  cmocka_unit_test(test_span_builder),
   /* AZ_Log Tests */
   cmocka_unit_test(test_az_log),
   /* HTTP Tests */
   cmocka_unit_test(test_http_request),
+  cmocka_unit_test(test_http_request_body_parts),
+  cmocka_unit_test(test_http_request_prepared),
   cmocka_unit_test(test_http_response),
   /*JSON tests*/
   cmocka_unit_test(test_json_token_null),
@@ -80,13 +106,25 @@ const struct CMUnitTest tests[] = {
   cmocka_unit_test(test_az_span),
   cmocka_unit_test(test_az_span_replace),
   cmocka_unit_test(test_az_span_getters),
+  cmocka_unit_test(test_az_span_find),
   /* AZ_context tests */
   cmocka_unit_test(test_az_context),
+  cmocka_unit_test(test_az_context_cached_expiration),
+  cmocka_unit_test(test_az_context_cancel_callbacks),
   /* az_pipeline tests */
   cmocka_unit_test(test_az_pipeline),
   /* az_aad tests */
   cmocka_unit_test(test_az_aad),
   /* az_http_policy tests */
   cmocka_unit_test(test_az_http_policy),
+  /* az credential token cache tests */
+  cmocka_unit_test(test_az_credential_token_cache),
+  cmocka_unit_test(test_az_credential_token_cache_credential),
+  /* az http metrics tests */
+  cmocka_unit_test(test_az_http_metrics),
+  /* az http cache tests */
+  cmocka_unit_test(test_az_http_cache),
+  /* az http tracing tests */
+  cmocka_unit_test(test_az_http_tracing),
 
 };
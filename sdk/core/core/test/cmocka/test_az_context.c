@@ -34,8 +34,150 @@ void test_az_context(void** state)
   assert_true(r == AZ_ERROR_ITEM_NOT_FOUND);
   assert_true(value2 == NULL);
 
+  assert_true(expiration == 100);
+
   az_context_cancel(&ctx1);
   expiration = az_context_get_expiration(&ctx3); // Should be 0
 
   assert_true(expiration == 0);
+  assert_true(az_context_get_expiration(&ctx2) == 0);
+
+  // Nodes created after a cancellation cache the canceled expiration of their parents.
+  az_context ctx4 = az_context_with_value(&ctx3, key, value);
+  assert_true(ctx4._internal.effective_expiration == 0);
+  assert_true(az_context_get_expiration(&ctx4) == 0);
+}
+
+void test_az_context_cached_expiration(void** state)
+{
+  (void)state;
+
+  az_context ctx1 = az_context_with_expiration(NULL, 300);
+  az_context ctx2 = az_context_with_expiration(&ctx1, 200);
+  az_context ctx3 = az_context_with_value(&ctx2, "k", "v");
+  az_context ctx4 = az_context_with_expiration(&ctx3, 400);
+  az_context ctx5 = az_context_with_value(&ctx4, "k", "v");
+
+  // The soonest expiration of the parents is cached by every node.
+  assert_true(ctx5._internal.effective_expiration == 200);
+  assert_true(az_context_get_expiration(&ctx5) == 200);
+  assert_true(az_context_has_expired(&ctx5, 201));
+  assert_false(az_context_has_expired(&ctx5, 199));
+
+  // Canceling a parent invalidates the cache of its children.
+  az_context_cancel(&ctx3);
+  assert_true(az_context_get_expiration(&ctx5) == 0);
+  assert_true(az_context_get_expiration(&ctx4) == 0);
+  assert_true(az_context_get_expiration(&ctx2) == 200);
+  assert_true(az_context_has_expired(&ctx5, 1));
+
+  // Reading the expiration doesn't write the cache of the nodes, that other threads may read.
+  assert_true(ctx5._internal.cancel_generation != _az_context_cancel_generation);
+  assert_true(ctx5._internal.effective_expiration == 200);
+
+  // Nodes created after the cancellation cache it.
+  az_context ctx6 = az_context_with_value(&ctx5, "k", "v");
+  assert_true(ctx6._internal.cancel_generation == _az_context_cancel_generation);
+  assert_true(ctx6._internal.effective_expiration == 0);
+  assert_true(az_context_get_expiration(&ctx6) == 0);
+
+  // Siblings of the canceled node are not canceled.
+  az_context sibling = az_context_with_expiration(&ctx2, 250);
+  assert_true(az_context_get_expiration(&sibling) == 200);
+}
+
+static void test_az_context_on_cancel(az_context const* context, void* user_context)
+{
+  (void)context;
+  ++*(int*)user_context;
+}
+
+typedef struct
+{
+  az_context* context;
+  az_context_cancel_callback registration;
+  int calls;
+  az_result result;
+} test_az_context_chained_cancel;
+
+// Registers a callback on another context.
+static void test_az_context_on_cancel_register(az_context const* context, void* user_context)
+{
+  (void)context;
+  test_az_context_chained_cancel* const chained = (test_az_context_chained_cancel*)user_context;
+  chained->result = az_context_register_cancel_callback(
+      chained->context, &chained->registration, test_az_context_on_cancel, &chained->calls);
+}
+
+void test_az_context_cancel_callbacks(void** state)
+{
+  (void)state;
+
+  az_context parent = az_context_with_expiration(NULL, 1000);
+  az_context child = az_context_with_value(&parent, "k", "v");
+  az_context grandchild = az_context_with_expiration(&child, 500);
+  az_context sibling = az_context_with_expiration(&parent, 500);
+
+  int grandchild_calls = 0;
+  int sibling_calls = 0;
+  int unregistered_calls = 0;
+  az_context_cancel_callback grandchild_registration;
+  az_context_cancel_callback sibling_registration;
+  az_context_cancel_callback unregistered_registration;
+
+  assert_return_code(
+      az_context_register_cancel_callback(
+          &grandchild, &grandchild_registration, test_az_context_on_cancel, &grandchild_calls),
+      AZ_OK);
+  assert_return_code(
+      az_context_register_cancel_callback(
+          &sibling, &sibling_registration, test_az_context_on_cancel, &sibling_calls),
+      AZ_OK);
+  assert_return_code(
+      az_context_register_cancel_callback(
+          &grandchild,
+          &unregistered_registration,
+          test_az_context_on_cancel,
+          &unregistered_calls),
+      AZ_OK);
+  az_context_unregister_cancel_callback(&unregistered_registration);
+
+  // Canceling a parent notifies the callbacks registered on its children, once.
+  az_context_cancel(&child);
+  assert_int_equal(grandchild_calls, 1);
+  assert_int_equal(sibling_calls, 0);
+  assert_int_equal(unregistered_calls, 0);
+
+  az_context_cancel(&child);
+  assert_int_equal(grandchild_calls, 1);
+
+  // A canceled context doesn't accept callbacks.
+  assert_true(
+      az_context_register_cancel_callback(
+          &grandchild, &grandchild_registration, test_az_context_on_cancel, &grandchild_calls)
+      == AZ_ERROR_CANCELED);
+
+  az_context_cancel(&parent);
+  assert_int_equal(sibling_calls, 1);
+  assert_int_equal(grandchild_calls, 1);
+
+  // Unregistering a callback that was already invoked does nothing.
+  az_context_unregister_cancel_callback(&sibling_registration);
+
+  // Callbacks are invoked with the list unlocked: they can register callbacks.
+  az_context first = az_context_with_expiration(NULL, 1000);
+  az_context second = az_context_with_expiration(NULL, 1000);
+  test_az_context_chained_cancel chained = { .context = &second, .calls = 0, .result = AZ_OK };
+  az_context_cancel_callback first_registration;
+  assert_return_code(
+      az_context_register_cancel_callback(
+          &first, &first_registration, test_az_context_on_cancel_register, &chained),
+      AZ_OK);
+
+  az_context_cancel(&first);
+  assert_return_code(chained.result, AZ_OK);
+  assert_int_equal(chained.calls, 0);
+
+  az_context_cancel(&second);
+  assert_int_equal(chained.calls, 1);
 }
@@ -0,0 +1,168 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_credential_token_cache_private.h>
+#include <az_credentials.h>
+#include <az_http.h>
+#include <az_http_internal.h>
+#include <az_http_transport.h>
+#include <az_span.h>
+
+#include <setjmp.h>
+#include <stdarg.h>
+
+#include <cmocka.h>
+
+#include <_az_cfg.h>
+
+static _az_token _az_token_create(char const* token, int64_t expires_at_msec)
+{
+  _az_token result = { ._internal = { .token = { 0 }, .token_length = 0, .expires_at_msec = 0 } };
+  az_span token_span = az_span_from_str((char*)token);
+  int32_t const token_length = az_span_length(token_span);
+  for (int32_t i = 0; i < token_length; ++i)
+  {
+    result._internal.token[i] = az_span_ptr(token_span)[i];
+  }
+
+  result._internal.token_length = (int16_t)token_length;
+  result._internal.expires_at_msec = expires_at_msec;
+  return result;
+}
+
+void test_az_credential_token_cache(void** state)
+{
+  (void)state;
+
+  az_span const tenant = AZ_SPAN_FROM_STR("tenant");
+  az_span const client = AZ_SPAN_FROM_STR("client");
+  az_span const vault_scope = AZ_SPAN_FROM_STR("https://vault.azure.net/.default");
+  az_span const storage_scope = AZ_SPAN_FROM_STR("https://storage.azure.com/.default");
+
+  az_credential_token_cache_entry entries[2] = { 0 };
+  _az_token_cache cache = { .entries = entries, .entries_length = 2 };
+  _az_token token = { 0 };
+
+  // empty cache
+  assert_true(
+      _az_token_cache_get(&cache, tenant, client, vault_scope, 0, &token)
+      == AZ_ERROR_ITEM_NOT_FOUND);
+
+  // shared by same key
+  {
+    _az_token const vault_token = _az_token_create("Bearer vault", 1000);
+    assert_return_code(
+        _az_token_cache_set(&cache, tenant, client, vault_scope, 0, &vault_token), AZ_OK);
+    assert_return_code(_az_token_cache_get(&cache, tenant, client, vault_scope, 10, &token), AZ_OK);
+    assert_true(token._internal.token_length == 12);
+    assert_true(token._internal.expires_at_msec == 1000);
+  }
+
+  // different scope or client is a different key
+  {
+    assert_true(
+        _az_token_cache_get(&cache, tenant, client, storage_scope, 10, &token)
+        == AZ_ERROR_ITEM_NOT_FOUND);
+    assert_true(
+        _az_token_cache_get(&cache, tenant, AZ_SPAN_FROM_STR("clien"), vault_scope, 10, &token)
+        == AZ_ERROR_ITEM_NOT_FOUND);
+  }
+
+  // expired tokens are not returned
+  assert_true(
+      _az_token_cache_get(&cache, tenant, client, vault_scope, 1001, &token)
+      == AZ_ERROR_ITEM_NOT_FOUND);
+
+  // updating a key reuses its entry
+  {
+    _az_token const vault_token = _az_token_create("Bearer vault2", 3000);
+    assert_return_code(
+        _az_token_cache_set(&cache, tenant, client, vault_scope, 0, &vault_token), AZ_OK);
+    _az_token const storage_token = _az_token_create("Bearer storage", 2000);
+    assert_return_code(
+        _az_token_cache_set(&cache, tenant, client, storage_scope, 0, &storage_token), AZ_OK);
+
+    assert_return_code(_az_token_cache_get(&cache, tenant, client, vault_scope, 10, &token), AZ_OK);
+    assert_true(token._internal.expires_at_msec == 3000);
+    assert_return_code(
+        _az_token_cache_get(&cache, tenant, client, storage_scope, 10, &token), AZ_OK);
+    assert_true(token._internal.expires_at_msec == 2000);
+  }
+
+  // when full, the token expiring first is evicted
+  {
+    _az_token const other_token = _az_token_create("Bearer other", 4000);
+    assert_return_code(
+        _az_token_cache_set(
+            &cache, AZ_SPAN_FROM_STR("other"), client, vault_scope, 10, &other_token),
+        AZ_OK);
+    assert_true(
+        _az_token_cache_get(&cache, tenant, client, storage_scope, 10, &token)
+        == AZ_ERROR_ITEM_NOT_FOUND);
+    assert_return_code(_az_token_cache_get(&cache, tenant, client, vault_scope, 10, &token), AZ_OK);
+  }
+
+  // clear
+  {
+    _az_token_cache_clear(&cache);
+    assert_true(
+        _az_token_cache_get(&cache, tenant, client, vault_scope, 10, &token)
+        == AZ_ERROR_ITEM_NOT_FOUND);
+  }
+}
+
+void test_az_credential_token_cache_credential(void** state)
+{
+  (void)state;
+
+  az_span const tenant = AZ_SPAN_FROM_STR("tenant");
+  az_span const client = AZ_SPAN_FROM_STR("client");
+  az_span const vault_scope = AZ_SPAN_FROM_STR("https://vault.azure.net/.default");
+
+  az_credential_token_cache_entry entries[2];
+  assert_return_code(az_credential_token_cache_init(entries, 2), AZ_OK);
+
+  // A first credential stored the token it was issued.
+  _az_token const vault_token = _az_token_create("Bearer vault", 1000);
+#ifdef MOCK_ENABLED
+  will_return(__wrap_az_platform_clock_msec, 0);
+#endif // MOCK_ENABLED
+  assert_return_code(
+      _az_credential_token_cache_set(tenant, client, vault_scope, &vault_token), AZ_OK);
+
+  az_credential_client_secret credential;
+  assert_return_code(
+      az_credential_client_secret_init(&credential, tenant, client, AZ_SPAN_FROM_STR("secret")),
+      AZ_OK);
+  assert_return_code(az_credential_client_secret_set_use_token_cache(&credential, true), AZ_OK);
+  assert_return_code(
+      credential._internal.credential._internal.set_scopes(&credential, vault_scope), AZ_OK);
+
+  uint8_t url_buffer[100] = "https://vault";
+  uint8_t headers_buffer[2 * sizeof(az_pair)];
+  _az_http_request request;
+  assert_return_code(
+      az_http_request_init(
+          &request,
+          &az_context_app,
+          az_http_method_get(),
+          az_span_init(url_buffer, 13, sizeof(url_buffer)),
+          AZ_SPAN_FROM_BUFFER(headers_buffer),
+          AZ_SPAN_NULL),
+      AZ_OK);
+
+#ifdef MOCK_ENABLED
+  will_return(__wrap_az_platform_clock_msec, 0);
+#endif // MOCK_ENABLED
+
+  // A second credential with the same key is served from the cache: there is no transport to
+  // request a token.
+  assert_return_code(
+      credential._internal.credential._internal.apply_credential(&credential, &request), AZ_OK);
+
+  az_pair header = { 0 };
+  assert_return_code(az_http_request_get_header(&request, 0, &header), AZ_OK);
+  assert_true(az_span_is_content_equal(header.value, AZ_SPAN_FROM_STR("Bearer vault")));
+
+  assert_return_code(az_credential_token_cache_clear(), AZ_OK);
+}
@@ -0,0 +1,285 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_http.h>
+#include <az_http_cache.h>
+#include <az_http_internal.h>
+#include <az_http_transport.h>
+#include <az_span.h>
+
+#include <setjmp.h>
+#include <stdarg.h>
+
+#include <cmocka.h>
+
+#include <_az_cfg.h>
+
+#define TEST_EXPECT_SUCCESS(exp) assert_true(az_succeeded(exp))
+
+typedef struct
+{
+  int32_t requests;
+  az_span response; // Sent unless the request has an If-None-Match header matching the etag.
+  az_span etag;
+} test_cache_server;
+
+static az_result test_cache_transport(
+    _az_http_policy* p_policies,
+    void* p_options,
+    _az_http_request* p_request,
+    az_http_response* p_response)
+{
+  (void)p_policies;
+  test_cache_server* const server = (test_cache_server*)p_options;
+  ++server->requests;
+
+  az_span response = server->response;
+  for (int32_t i = 0; i < _az_http_request_headers_count(p_request); ++i)
+  {
+    az_pair header = { 0 };
+    TEST_EXPECT_SUCCESS(az_http_request_get_header(p_request, i, &header));
+    if (az_span_is_content_equal(header.key, AZ_SPAN_FROM_STR("If-None-Match"))
+        && az_span_is_content_equal(header.value, server->etag))
+    {
+      response = AZ_SPAN_FROM_STR("HTTP/1.1 304 Not Modified\r\n"
+                                  "Cache-Control: no-cache\r\n"
+                                  "\r\n");
+    }
+  }
+
+  az_span written = p_response->_internal.http_response;
+  AZ_RETURN_IF_FAILED(az_span_copy(written, response, &written));
+  return az_http_response_init(p_response, written);
+}
+
+static void test_cache_send(
+    _az_http_pipeline* pipeline,
+    az_http_method method,
+    az_span url,
+    az_http_response* response,
+    az_span response_buffer)
+{
+  uint8_t url_buffer[100];
+  az_span url_span = AZ_SPAN_FROM_BUFFER(url_buffer);
+  TEST_EXPECT_SUCCESS(az_span_copy(url_span, url, &url_span));
+
+  uint8_t headers_buffer[4 * sizeof(az_pair)];
+  _az_http_request request;
+  TEST_EXPECT_SUCCESS(az_http_request_init(
+      &request,
+      &az_context_app,
+      method,
+      url_span,
+      AZ_SPAN_FROM_BUFFER(headers_buffer),
+      AZ_SPAN_NULL));
+
+#ifdef MOCK_ENABLED
+  if (az_span_is_content_equal(method, az_http_method_get()))
+  {
+    will_return(__wrap_az_platform_clock_msec, 0);
+  }
+#endif // MOCK_ENABLED
+
+  TEST_EXPECT_SUCCESS(az_http_response_init(response, response_buffer));
+  TEST_EXPECT_SUCCESS(az_http_pipeline_process(pipeline, &request, response));
+}
+
+static void test_cache_expect(az_http_response* response, int32_t status_code, az_span body)
+{
+  az_http_response_status_line status_line = { 0 };
+  TEST_EXPECT_SUCCESS(az_http_response_get_status_line(response, &status_line));
+  assert_int_equal(status_line.status_code, status_code);
+
+  az_span response_body = AZ_SPAN_NULL;
+  TEST_EXPECT_SUCCESS(az_http_response_get_body(response, &response_body));
+  // The body runs to the capacity of the response buffer, past the written response.
+  az_span const response_span = response->_internal.http_response;
+  assert_true(
+      az_span_ptr(response_body) + az_span_length(body)
+      == az_span_ptr(response_span) + az_span_length(response_span));
+  assert_true(
+      az_span_is_content_equal(az_span_slice(response_body, 0, az_span_length(body)), body));
+}
+
+static void test_cache_expect_stats(
+    az_http_cache* cache,
+    int64_t hits,
+    int64_t revalidations,
+    int64_t misses)
+{
+  az_http_cache_stats stats = { 0 };
+  TEST_EXPECT_SUCCESS(az_http_cache_get_stats(cache, &stats));
+  assert_int_equal(stats.hits, hits);
+  assert_int_equal(stats.revalidations, revalidations);
+  assert_int_equal(stats.misses, misses);
+}
+
+void test_az_http_cache(void** state)
+{
+  (void)state;
+
+  az_http_cache_entry entries[4];
+  uint8_t buffer[4 * 256];
+  az_http_cache_options options = az_http_cache_options_default();
+  options.shards = 2;
+
+  az_http_cache cache;
+  TEST_EXPECT_SUCCESS(
+      az_http_cache_init(&cache, entries, 4, AZ_SPAN_FROM_BUFFER(buffer), &options));
+
+  test_cache_server server = {
+    .requests = 0,
+    .response = AZ_SPAN_FROM_STR("HTTP/1.1 200 OK\r\n"
+                                 "Cache-Control: max-age=3600\r\n"
+                                 "\r\n"
+                                 "fresh"),
+    .etag = AZ_SPAN_NULL,
+  };
+
+  az_http_user_policy const user_policies[] = { az_http_cache_user_policy(&cache) };
+  _az_http_policy const policies[] = {
+    { ._internal = { .process = test_cache_transport, .p_options = &server } },
+  };
+  _az_http_pipeline pipeline;
+  TEST_EXPECT_SUCCESS(az_http_pipeline_init(&pipeline, policies, 1, user_policies, 1));
+
+  uint8_t response_buffer[256];
+  az_http_response response;
+  az_span const fresh_url = AZ_SPAN_FROM_STR("https://vault/keys/fresh");
+
+  // A fresh response is served without sending the request.
+  test_cache_send(
+      &pipeline, az_http_method_get(), fresh_url, &response, AZ_SPAN_FROM_BUFFER(response_buffer));
+  test_cache_expect(&response, 200, AZ_SPAN_FROM_STR("fresh"));
+  test_cache_send(
+      &pipeline, az_http_method_get(), fresh_url, &response, AZ_SPAN_FROM_BUFFER(response_buffer));
+  test_cache_expect(&response, 200, AZ_SPAN_FROM_STR("fresh"));
+  assert_int_equal(server.requests, 1);
+  test_cache_expect_stats(&cache, 1, 0, 1);
+
+  // A stale response is revalidated with its ETag.
+  az_span const stale_url = AZ_SPAN_FROM_STR("https://vault/keys/stale");
+  server.response = AZ_SPAN_FROM_STR("HTTP/1.1 200 OK\r\n"
+                                     "Cache-Control: no-cache\r\n"
+                                     "ETag: \"1\"\r\n"
+                                     "\r\n"
+                                     "v1");
+  server.etag = AZ_SPAN_FROM_STR("\"1\"");
+  test_cache_send(
+      &pipeline, az_http_method_get(), stale_url, &response, AZ_SPAN_FROM_BUFFER(response_buffer));
+  test_cache_expect(&response, 200, AZ_SPAN_FROM_STR("v1"));
+  test_cache_send(
+      &pipeline, az_http_method_get(), stale_url, &response, AZ_SPAN_FROM_BUFFER(response_buffer));
+  test_cache_expect(&response, 200, AZ_SPAN_FROM_STR("v1"));
+  assert_int_equal(server.requests, 3);
+  test_cache_expect_stats(&cache, 1, 1, 2);
+
+  // A changed resource replaces the cached response.
+  server.response = AZ_SPAN_FROM_STR("HTTP/1.1 200 OK\r\n"
+                                     "Cache-Control: no-cache\r\n"
+                                     "ETag: \"2\"\r\n"
+                                     "\r\n"
+                                     "v2");
+  server.etag = AZ_SPAN_FROM_STR("\"2\"");
+  test_cache_send(
+      &pipeline, az_http_method_get(), stale_url, &response, AZ_SPAN_FROM_BUFFER(response_buffer));
+  test_cache_expect(&response, 200, AZ_SPAN_FROM_STR("v2"));
+  test_cache_send(
+      &pipeline, az_http_method_get(), stale_url, &response, AZ_SPAN_FROM_BUFFER(response_buffer));
+  test_cache_expect(&response, 200, AZ_SPAN_FROM_STR("v2"));
+  assert_int_equal(server.requests, 5);
+  test_cache_expect_stats(&cache, 1, 2, 3);
+
+  // Other methods remove the cached response.
+  test_cache_send(
+      &pipeline,
+      az_http_method_delete(),
+      fresh_url,
+      &response,
+      AZ_SPAN_FROM_BUFFER(response_buffer));
+  server.response = AZ_SPAN_FROM_STR("HTTP/1.1 200 OK\r\n"
+                                     "Cache-Control: no-store\r\n"
+                                     "\r\n"
+                                     "gone");
+  test_cache_send(
+      &pipeline, az_http_method_get(), fresh_url, &response, AZ_SPAN_FROM_BUFFER(response_buffer));
+  test_cache_expect(&response, 200, AZ_SPAN_FROM_STR("gone"));
+  assert_int_equal(server.requests, 7);
+
+  // no-store responses are not cached.
+  test_cache_send(
+      &pipeline, az_http_method_get(), fresh_url, &response, AZ_SPAN_FROM_BUFFER(response_buffer));
+  assert_int_equal(server.requests, 8);
+  test_cache_expect_stats(&cache, 1, 2, 5);
+
+  // The least recently used responses are evicted: each shard holds 2 of them.
+  server.response = AZ_SPAN_FROM_STR("HTTP/1.1 200 OK\r\n"
+                                     "\r\n"
+                                     "default ttl");
+  uint8_t url_buffer[32];
+  for (int32_t i = 0; i < 8; ++i)
+  {
+    az_span url = AZ_SPAN_FROM_BUFFER(url_buffer);
+    TEST_EXPECT_SUCCESS(az_span_copy(url, AZ_SPAN_FROM_STR("https://vault/keys/"), &url));
+    TEST_EXPECT_SUCCESS(az_span_append_i64toa(url, i, &url));
+    test_cache_send(
+        &pipeline, az_http_method_get(), url, &response, AZ_SPAN_FROM_BUFFER(response_buffer));
+    test_cache_expect(&response, 200, AZ_SPAN_FROM_STR("default ttl"));
+  }
+  assert_int_equal(server.requests, 16);
+
+  test_cache_send(
+      &pipeline, az_http_method_get(), fresh_url, &response, AZ_SPAN_FROM_BUFFER(response_buffer));
+  test_cache_send(
+      &pipeline, az_http_method_get(), stale_url, &response, AZ_SPAN_FROM_BUFFER(response_buffer));
+  assert_int_equal(server.requests, 18);
+
+  // Responses bigger than an entry are not cached.
+  uint8_t big_response[300] = "HTTP/1.1 200 OK\r\n\r\n";
+  server.response = az_span_init(big_response, sizeof(big_response), sizeof(big_response));
+  az_span const big_url = AZ_SPAN_FROM_STR("https://vault/keys/big");
+  uint8_t big_response_buffer[512];
+  test_cache_send(
+      &pipeline,
+      az_http_method_get(),
+      big_url,
+      &response,
+      AZ_SPAN_FROM_BUFFER(big_response_buffer));
+  test_cache_send(
+      &pipeline,
+      az_http_method_get(),
+      big_url,
+      &response,
+      AZ_SPAN_FROM_BUFFER(big_response_buffer));
+  assert_int_equal(server.requests, 20);
+
+  // A cached response too big for the response buffer is not revalidated: the caller gets the
+  // response sent without the ETag, not a 304.
+  az_span const long_url = AZ_SPAN_FROM_STR("https://vault/keys/long");
+  server.response = AZ_SPAN_FROM_STR("HTTP/1.1 200 OK\r\n"
+                                     "Cache-Control: no-cache\r\n"
+                                     "ETag: \"3\"\r\n"
+                                     "\r\n"
+                                     "a long version of the key, that the small buffer can't hold");
+  server.etag = AZ_SPAN_FROM_STR("\"3\"");
+  test_cache_send(
+      &pipeline, az_http_method_get(), long_url, &response, AZ_SPAN_FROM_BUFFER(response_buffer));
+  assert_int_equal(server.requests, 21);
+  test_cache_expect_stats(&cache, 1, 2, 18);
+
+  server.response = AZ_SPAN_FROM_STR("HTTP/1.1 200 OK\r\n"
+                                     "Cache-Control: no-cache\r\n"
+                                     "ETag: \"3\"\r\n"
+                                     "\r\n"
+                                     "short");
+  uint8_t small_response_buffer[64];
+  test_cache_send(
+      &pipeline,
+      az_http_method_get(),
+      long_url,
+      &response,
+      AZ_SPAN_FROM_BUFFER(small_response_buffer));
+  test_cache_expect(&response, 200, AZ_SPAN_FROM_STR("short"));
+  assert_int_equal(server.requests, 23);
+  test_cache_expect_stats(&cache, 1, 2, 19);
+}
@@ -0,0 +1,160 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_context.h>
+#include <az_http.h>
+#include <az_http_internal.h>
+#include <az_http_metrics.h>
+#include <az_http_transport.h>
+#include <az_span.h>
+
+#include <setjmp.h>
+#include <stdarg.h>
+
+#include <cmocka.h>
+
+#include <_az_cfg.h>
+
+static az_result test_policy_transport_with_metrics(
+    _az_http_policy* p_policies,
+    void* p_options,
+    _az_http_request* p_request,
+    az_http_response* p_response)
+{
+  (void)p_policies;
+  (void)p_options;
+  (void)p_response;
+
+  // A transport reports connection phases into the metrics of the request
+  assert_non_null(p_request->_internal.metrics);
+  p_request->_internal.metrics->first_byte_msec = 5;
+  return AZ_OK;
+}
+
+static void test_az_http_metrics_histogram()
+{
+  az_http_metrics_histogram histogram = { 0 };
+  az_http_metrics_histogram_snapshot snapshot = { 0 };
+
+  // empty
+  az_http_metrics_histogram_get_snapshot(&histogram, &snapshot);
+  assert_true(snapshot.count == 0);
+  assert_true(snapshot.p99_msec == 0);
+
+  for (int64_t value = 1; value <= 100; ++value)
+  {
+    az_http_metrics_histogram_record(&histogram, value);
+  }
+
+  // not measured
+  az_http_metrics_histogram_record(&histogram, -1);
+
+  az_http_metrics_histogram_get_snapshot(&histogram, &snapshot);
+  assert_true(snapshot.count == 100);
+  assert_true(snapshot.min_msec == 1);
+  assert_true(snapshot.max_msec == 100);
+  assert_true(snapshot.mean_msec == 50);
+  assert_true(snapshot.p50_msec == 55); // 50 is in the [48, 55] bucket
+  assert_true(snapshot.p90_msec == 95); // 90 is in the [80, 95] bucket
+  assert_true(snapshot.p99_msec == 100); // never more than the max
+
+  // small values are exact
+  assert_true(az_http_metrics_histogram_get_percentile(&histogram, 0) == 1);
+  assert_true(az_http_metrics_histogram_get_percentile(&histogram, 3) == 3);
+
+  // values past the last bucket
+  az_http_metrics_histogram_record(&histogram, 10 * 60 * 1000);
+  assert_true(az_http_metrics_histogram_get_percentile(&histogram, 100) == 10 * 60 * 1000);
+
+  // a min of 0 is kept
+  az_http_metrics_histogram_record(&histogram, 0);
+  az_http_metrics_histogram_get_snapshot(&histogram, &snapshot);
+  assert_true(snapshot.min_msec == 0);
+  assert_true(snapshot.count == 102);
+}
+
+static void test_az_http_metrics_policy()
+{
+  uint8_t buf[100];
+  uint8_t header_buf[(2 * sizeof(az_pair))];
+  memset(buf, 0, sizeof(buf));
+  memset(header_buf, 0, sizeof(header_buf));
+
+  az_span url_span = AZ_SPAN_FROM_BUFFER(buf);
+  assert_return_code(az_span_append(url_span, AZ_SPAN_FROM_STR("url"), &url_span), AZ_OK);
+  az_span header_span = AZ_SPAN_FROM_BUFFER(header_buf);
+
+  az_http_metrics client_metrics;
+  az_http_metrics operation_metrics;
+  assert_return_code(az_http_metrics_init(&client_metrics), AZ_OK);
+  assert_return_code(az_http_metrics_init(&operation_metrics), AZ_OK);
+
+  _az_http_policy policies[2] = {
+    { ._internal = { .process = test_policy_transport_with_metrics, .p_options = NULL } },
+    { ._internal = { .process = NULL, .p_options = NULL } },
+  };
+
+  // client metrics
+  {
+    _az_http_request hrb;
+    assert_return_code(
+        az_http_request_init(
+            &hrb, &az_context_app, az_http_method_get(), url_span, header_span, AZ_SPAN_NULL),
+        AZ_OK);
+
+#ifdef MOCK_ENABLED
+    will_return(__wrap_az_platform_clock_msec, 100);
+    will_return(__wrap_az_platform_clock_msec, 142);
+#endif // MOCK_ENABLED
+    assert_return_code(
+        az_http_pipeline_policy_metrics(policies, &client_metrics, &hrb, NULL), AZ_OK);
+    assert_null(hrb._internal.metrics);
+
+    az_http_metrics_snapshot snapshot = { 0 };
+    az_http_metrics_get_snapshot(&client_metrics, &snapshot);
+    assert_true(snapshot.request_count == 1);
+    assert_true(snapshot.retry_count == 0);
+    assert_true(snapshot.first_byte.count == 1);
+    assert_true(snapshot.first_byte.max_msec == 5);
+    assert_true(snapshot.dns.count == 0);
+    assert_true(snapshot.retry_delay.count == 0);
+
+    az_http_request_metrics const last = az_http_metrics_get_last_request(&client_metrics);
+    assert_true(last.first_byte_msec == 5);
+    assert_true(last.dns_msec == -1);
+#ifdef MOCK_ENABLED
+    assert_true(last.total_msec == 42);
+#endif // MOCK_ENABLED
+  }
+
+  // metrics from the context take precedence
+  {
+    az_context context = az_context_with_http_metrics(&az_context_app, &operation_metrics);
+    _az_http_request hrb;
+    assert_return_code(
+        az_http_request_init(
+            &hrb, &context, az_http_method_get(), url_span, header_span, AZ_SPAN_NULL),
+        AZ_OK);
+
+#ifdef MOCK_ENABLED
+    will_return(__wrap_az_platform_clock_msec, 0);
+    will_return(__wrap_az_platform_clock_msec, 0);
+#endif // MOCK_ENABLED
+    assert_return_code(
+        az_http_pipeline_policy_metrics(policies, &client_metrics, &hrb, NULL), AZ_OK);
+
+    az_http_metrics_snapshot snapshot = { 0 };
+    az_http_metrics_get_snapshot(&client_metrics, &snapshot);
+    assert_true(snapshot.request_count == 1);
+    az_http_metrics_get_snapshot(&operation_metrics, &snapshot);
+    assert_true(snapshot.request_count == 1);
+  }
+}
+
+void test_az_http_metrics(void** state)
+{
+  (void)state;
+
+  test_az_http_metrics_histogram();
+  test_az_http_metrics_policy();
+}
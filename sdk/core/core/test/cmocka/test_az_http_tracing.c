@@ -0,0 +1,273 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_context.h>
+#include <az_http.h>
+#include <az_http_internal.h>
+#include <az_http_tracing.h>
+#include <az_http_transport.h>
+#include <az_span.h>
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <cmocka.h>
+
+#include <_az_cfg.h>
+
+typedef struct
+{
+  int32_t count;
+  az_http_tracing_span spans[4];
+  uint8_t json[1024];
+  az_span last_json;
+} test_tracing_exporter;
+
+static void test_tracing_export(az_http_tracing_span const* span, void* exporter_context)
+{
+  test_tracing_exporter* const exporter = (test_tracing_exporter*)exporter_context;
+  assert_true(exporter->count < 4);
+  exporter->spans[exporter->count++] = *span;
+
+  assert_return_code(
+      az_http_tracing_span_to_json(span, AZ_SPAN_FROM_BUFFER(exporter->json), &exporter->last_json),
+      AZ_OK);
+}
+
+static int32_t test_tracing_transport_calls = 0;
+static int32_t test_tracing_traceparent_count = 0; // Expected on each request to the transport.
+
+static az_result test_policy_transport_with_tracing(
+    _az_http_policy* p_policies,
+    void* p_options,
+    _az_http_request* p_request,
+    az_http_response* p_response)
+{
+  (void)p_policies;
+  (void)p_options;
+
+  // Each traced attempt carries its own traceparent header, and only one.
+  int32_t traceparent_count = 0;
+  for (int32_t i = 0; i < _az_http_request_headers_count(p_request); ++i)
+  {
+    az_pair header = { 0 };
+    assert_return_code(az_http_request_get_header(p_request, i, &header), AZ_OK);
+    if (az_span_is_content_equal(header.key, AZ_SPAN_FROM_STR("traceparent")))
+    {
+      assert_int_equal(az_span_length(header.value), AZ_HTTP_TRACING_TRACEPARENT_SIZE);
+      ++traceparent_count;
+    }
+  }
+  assert_int_equal(traceparent_count, test_tracing_traceparent_count);
+
+  ++test_tracing_transport_calls;
+  return az_http_response_init(
+      p_response,
+      test_tracing_transport_calls == 1
+          ? AZ_SPAN_FROM_STR("HTTP/1.1 503 Service Unavailable\r\nretry-after-ms: 0\r\n\r\n")
+          : AZ_SPAN_FROM_STR("HTTP/1.1 200 OK\r\n\r\n{}"));
+}
+
+static void test_az_http_tracing_traceparent()
+{
+  az_http_tracing_span span = { 0 };
+  for (uint8_t i = 0; i < AZ_HTTP_TRACING_TRACE_ID_SIZE; ++i)
+  {
+    span.trace_id[i] = (uint8_t)(0xA0 + i);
+  }
+  for (uint8_t i = 0; i < AZ_HTTP_TRACING_SPAN_ID_SIZE; ++i)
+  {
+    span.span_id[i] = i;
+  }
+
+  uint8_t buffer[AZ_HTTP_TRACING_TRACEPARENT_SIZE];
+  az_span traceparent = { 0 };
+  assert_return_code(
+      az_http_tracing_span_get_traceparent(&span, AZ_SPAN_FROM_BUFFER(buffer), &traceparent),
+      AZ_OK);
+  assert_true(az_span_is_content_equal(
+      traceparent,
+      AZ_SPAN_FROM_STR("00-a0a1a2a3a4a5a6a7a8a9aaabacadaeaf-0001020304050607-01")));
+
+  uint8_t small_buffer[AZ_HTTP_TRACING_TRACEPARENT_SIZE - 1];
+  assert_true(
+      az_http_tracing_span_get_traceparent(&span, AZ_SPAN_FROM_BUFFER(small_buffer), &traceparent)
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+}
+
+static void test_az_http_tracing_json()
+{
+  az_http_tracing_options const options = { .clock_epoch_msec = 1600000000000 };
+  az_http_tracing_span span = {
+    .trace_id = { 0x01, [15] = 0x02 },
+    .span_id = { 0x03, [7] = 0x04 },
+    .parent_span_id = { 0x05, [7] = 0x06 },
+    .has_parent = true,
+    .name = AZ_SPAN_LITERAL_FROM_STR("GET"),
+    .url = AZ_SPAN_LITERAL_FROM_STR("https://a.b/c"),
+    .attempt = 2,
+    .start_msec = 10,
+    .end_msec = 12,
+    .result = AZ_OK,
+    .status_code = AZ_HTTP_STATUS_CODE_OK,
+    .request_body_length = 0,
+    .response_length = 20,
+    ._internal = { .options = &options },
+  };
+
+  uint8_t buffer[1024];
+  az_span json = { 0 };
+  assert_return_code(
+      az_http_tracing_span_to_json(&span, AZ_SPAN_FROM_BUFFER(buffer), &json), AZ_OK);
+  assert_true(az_span_is_content_equal(
+      json,
+      AZ_SPAN_FROM_STR("{\"traceId\":\"01000000000000000000000000000002\","
+                       "\"spanId\":\"0300000000000004\","
+                       "\"parentSpanId\":\"0500000000000006\","
+                       "\"name\":\"GET\",\"kind\":3,"
+                       "\"startTimeUnixNano\":\"1600000000010000000\","
+                       "\"endTimeUnixNano\":\"1600000000012000000\","
+                       "\"attributes\":["
+                       "{\"key\":\"http.method\",\"value\":{\"stringValue\":\"GET\"}},"
+                       "{\"key\":\"http.url\",\"value\":{\"stringValue\":\"https://a.b/c\"}},"
+                       "{\"key\":\"http.status_code\",\"value\":{\"intValue\":\"200\"}},"
+                       "{\"key\":\"http.request_content_length\",\"value\":{\"intValue\":\"0\"}},"
+                       "{\"key\":\"http.response_content_length\",\"value\":{\"intValue\":\"20\"}},"
+                       "{\"key\":\"az.retry_attempt\",\"value\":{\"intValue\":\"2\"}}],"
+                       "\"status\":{\"code\":1}}")));
+
+  uint8_t small_buffer[64];
+  assert_true(
+      az_http_tracing_span_to_json(&span, AZ_SPAN_FROM_BUFFER(small_buffer), &json)
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+
+#ifndef MOCK_ENABLED
+  // Without a clock epoch, times are converted with the wall clock. The platform clock reads 0.
+  span._internal.options = NULL;
+  int64_t const now_msec = (int64_t)time(NULL) * 1000;
+  assert_return_code(
+      az_http_tracing_span_to_json(&span, AZ_SPAN_FROM_BUFFER(buffer), &json), AZ_OK);
+  az_span const start_key = AZ_SPAN_FROM_STR("\"startTimeUnixNano\":\"");
+  int32_t const start_index = az_span_find(json, start_key);
+  assert_true(start_index > 0);
+  int64_t const start_msec
+      = strtoll((char const*)az_span_ptr(json) + start_index + az_span_length(start_key), NULL, 10)
+      / 1000000;
+  assert_true(start_msec >= now_msec - 60 * 1000 && start_msec <= now_msec + 60 * 1000);
+#endif // MOCK_ENABLED
+}
+
+static void test_az_http_tracing_policy()
+{
+  uint8_t url_buf[100];
+  uint8_t header_buf[(4 * sizeof(az_pair))];
+  memset(url_buf, 0, sizeof(url_buf));
+  memset(header_buf, 0, sizeof(header_buf));
+
+  az_span url_span = AZ_SPAN_FROM_BUFFER(url_buf);
+  assert_return_code(az_span_append(url_span, AZ_SPAN_FROM_STR("url"), &url_span), AZ_OK);
+  az_span header_span = AZ_SPAN_FROM_BUFFER(header_buf);
+
+  test_tracing_exporter exporter = { 0 };
+  az_http_tracing_options tracing_options = {
+    .exporter = test_tracing_export,
+    .exporter_context = &exporter,
+    .clock_epoch_msec = 1600000000000,
+  };
+
+  az_http_policy_retry_options retry_options = az_http_policy_retry_options_default();
+  retry_options.max_retries = 1;
+
+  _az_http_policy policies[3] = {
+    { ._internal = { .process = az_http_pipeline_policy_retry, .p_options = &retry_options } },
+    { ._internal = { .process = test_policy_transport_with_tracing, .p_options = NULL } },
+    { ._internal = { .process = NULL, .p_options = NULL } },
+  };
+
+  // The span set by the user on the context is the parent of the operation span.
+  az_http_tracing_span user_span = { .trace_id = { 0x42 }, .span_id = { 0x43 } };
+  az_context context = az_context_with_http_tracing_span(&az_context_app, &user_span);
+
+  _az_http_request hrb;
+  assert_return_code(
+      az_http_request_init(
+          &hrb, &context, az_http_method_get(), url_span, header_span, AZ_SPAN_NULL),
+      AZ_OK);
+  assert_return_code(
+      az_http_request_append_header(&hrb, AZ_SPAN_FROM_STR("key"), AZ_SPAN_FROM_STR("value")),
+      AZ_OK);
+
+  az_http_response response = { 0 };
+  assert_return_code(az_http_response_init(&response, AZ_SPAN_NULL), AZ_OK);
+
+#ifdef MOCK_ENABLED
+  will_return(__wrap_az_platform_clock_msec, 100); // operation start
+  will_return(__wrap_az_platform_clock_msec, 101); // attempt 1 start
+  will_return(__wrap_az_platform_clock_msec, 110); // attempt 1 end
+  will_return(__wrap_az_platform_clock_msec, 111); // context expiration check
+  will_return(__wrap_az_platform_clock_msec, 112); // attempt 2 start
+  will_return(__wrap_az_platform_clock_msec, 120); // attempt 2 end
+  will_return(__wrap_az_platform_clock_msec, 121); // operation end
+#endif // MOCK_ENABLED
+  test_tracing_transport_calls = 0;
+  test_tracing_traceparent_count = 1;
+  assert_return_code(
+      az_http_pipeline_policy_tracing(policies, &tracing_options, &hrb, &response), AZ_OK);
+
+  // The request context is restored, headers added before the retry policy are kept, and the
+  // traceparent header of the last attempt is removed with its span.
+  assert_ptr_equal(hrb._internal.context, &context);
+  assert_int_equal(_az_http_request_headers_count(&hrb), 1);
+  az_pair header = { 0 };
+  assert_return_code(az_http_request_get_header(&hrb, 0, &header), AZ_OK);
+  assert_true(az_span_is_content_equal(header.key, AZ_SPAN_FROM_STR("key")));
+
+  assert_int_equal(exporter.count, 3);
+  az_http_tracing_span const* const attempt1 = &exporter.spans[0];
+  az_http_tracing_span const* const attempt2 = &exporter.spans[1];
+  az_http_tracing_span const* const operation = &exporter.spans[2];
+
+  assert_int_equal(operation->attempt, 0);
+  assert_true(operation->has_parent);
+  assert_memory_equal(operation->trace_id, user_span.trace_id, AZ_HTTP_TRACING_TRACE_ID_SIZE);
+  assert_memory_equal(operation->parent_span_id, user_span.span_id, AZ_HTTP_TRACING_SPAN_ID_SIZE);
+  assert_true(operation->status_code == AZ_HTTP_STATUS_CODE_OK);
+
+  assert_int_equal(attempt1->attempt, 1);
+  assert_true(attempt1->status_code == AZ_HTTP_STATUS_CODE_SERVICE_UNAVAILABLE);
+  assert_int_equal(attempt2->attempt, 2);
+  assert_true(attempt2->status_code == AZ_HTTP_STATUS_CODE_OK);
+
+  assert_memory_equal(attempt1->trace_id, user_span.trace_id, AZ_HTTP_TRACING_TRACE_ID_SIZE);
+  assert_memory_equal(
+      attempt1->parent_span_id, operation->span_id, AZ_HTTP_TRACING_SPAN_ID_SIZE);
+  assert_memory_equal(
+      attempt2->parent_span_id, operation->span_id, AZ_HTTP_TRACING_SPAN_ID_SIZE);
+  assert_true(memcmp(attempt1->span_id, attempt2->span_id, AZ_HTTP_TRACING_SPAN_ID_SIZE) != 0);
+
+#ifdef MOCK_ENABLED
+  assert_true(operation->start_msec == 100 && operation->end_msec == 121);
+  assert_true(attempt1->start_msec == 101 && attempt1->end_msec == 110);
+  assert_true(attempt2->start_msec == 112 && attempt2->end_msec == 120);
+#endif // MOCK_ENABLED
+
+  // Without options the policy does nothing.
+  exporter.count = 0;
+  test_tracing_transport_calls = 1;
+  test_tracing_traceparent_count = 0;
+  assert_return_code(
+      az_http_pipeline_policy_tracing(&policies[1], NULL, &hrb, &response), AZ_OK);
+  assert_int_equal(exporter.count, 0);
+}
+
+void test_az_http_tracing(void** state)
+{
+  (void)state;
+
+  test_az_http_tracing_traceparent();
+  test_az_http_tracing_json();
+  test_az_http_tracing_policy();
+}
@@ -1,7 +1,6 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // SPDX-License-Identifier: MIT
 
-#include "az_http_policy_private.h"
 #include <az_http.h>
 #include <az_http_internal.h>
 #include <az_http_transport.h>
@@ -27,13 +26,21 @@ az_result test_policy_2(
     _az_http_request* p_request,
     az_http_response* p_response);
 
+az_result test_policy_count(
+    _az_http_policy* p_policies,
+    void* p_options,
+    _az_http_request* p_request,
+    az_http_response* p_response);
+
 void test_az_http_pipeline_process();
+void test_az_http_pipeline_init();
 
 void test_az_pipeline(void** state)
 {
   (void)state;
 
   test_az_http_pipeline_process();
+  test_az_http_pipeline_init();
 }
 
 void test_az_http_pipeline_process()
@@ -80,6 +87,93 @@ void test_az_http_pipeline_process()
   assert_return_code(az_http_pipeline_process(&pipeline, &hrb, &response), AZ_OK);
 }
 
+void test_az_http_pipeline_init()
+{
+  _az_http_policy const policies[] = {
+    { ._internal = { .process = test_policy_1, .p_options = NULL } },
+    { ._internal = { .process = az_http_pipeline_policy_retry, .p_options = NULL } },
+    { ._internal = { .process = az_http_pipeline_policy_logging, .p_options = NULL } },
+    { ._internal = { .process = test_policy_2, .p_options = NULL } },
+  };
+
+  int count_a = 0;
+  int count_b = 0;
+  int count_c = 0;
+  az_http_user_policy const user_policies[] = {
+    { test_policy_count, &count_a, AZ_HTTP_POLICY_POSITION_PER_RETRY },
+    { test_policy_count, &count_b, AZ_HTTP_POLICY_POSITION_PER_CALL },
+    { test_policy_count, &count_c, AZ_HTTP_POLICY_POSITION_PER_RETRY },
+  };
+
+  // Per-call policies go before retry, per-retry ones before logging, in order.
+  _az_http_pipeline pipeline;
+  assert_return_code(az_http_pipeline_init(&pipeline, policies, 4, user_policies, 3), AZ_OK);
+
+  _az_http_policy const* const p = pipeline._internal.p_policies;
+  assert_true(p[0]._internal.process == test_policy_1);
+  assert_ptr_equal(p[1]._internal.p_options, &count_b);
+  assert_true(p[2]._internal.process == az_http_pipeline_policy_retry);
+  assert_ptr_equal(p[3]._internal.p_options, &count_a);
+  assert_ptr_equal(p[4]._internal.p_options, &count_c);
+  assert_true(p[5]._internal.process == az_http_pipeline_policy_logging);
+  assert_true(p[6]._internal.process == test_policy_2);
+  assert_true(p[7]._internal.process == NULL);
+
+  // Without retry and logging policies, they all go before the transport.
+  assert_return_code(az_http_pipeline_init(&pipeline, &policies[3], 1, user_policies, 3), AZ_OK);
+  assert_ptr_equal(p[0]._internal.p_options, &count_b);
+  assert_ptr_equal(p[1]._internal.p_options, &count_a);
+  assert_ptr_equal(p[2]._internal.p_options, &count_c);
+  assert_true(p[3]._internal.process == test_policy_2);
+
+  uint8_t buf[100] = "url";
+  uint8_t header_buf[(2 * sizeof(az_pair))];
+  _az_http_request hrb;
+  assert_return_code(
+      az_http_request_init(
+          &hrb,
+          &az_context_app,
+          az_http_method_get(),
+          az_span_init(buf, 3, sizeof(buf)),
+          AZ_SPAN_FROM_BUFFER(header_buf),
+          AZ_SPAN_NULL),
+      AZ_OK);
+
+  uint8_t buffer[10];
+  az_http_response response;
+  assert_return_code(az_http_response_init(&response, AZ_SPAN_FROM_BUFFER(buffer)), AZ_OK);
+
+  assert_return_code(az_http_pipeline_process(&pipeline, &hrb, &response), AZ_OK);
+  assert_int_equal(count_a, 1);
+  assert_int_equal(count_b, 1);
+  assert_int_equal(count_c, 1);
+
+  // Too many policies.
+  az_http_user_policy too_many[AZ_HTTP_PIPELINE_USER_POLICIES_MAX + 1];
+  for (int i = 0; i < AZ_HTTP_PIPELINE_USER_POLICIES_MAX + 1; ++i)
+  {
+    too_many[i] = user_policies[0];
+  }
+
+  assert_true(
+      az_http_pipeline_init(
+          &pipeline, policies, 4, too_many, AZ_HTTP_PIPELINE_USER_POLICIES_MAX + 1)
+      == AZ_ERROR_ARG);
+  assert_return_code(
+      az_http_pipeline_init(&pipeline, policies, 4, too_many, AZ_HTTP_PIPELINE_USER_POLICIES_MAX),
+      AZ_OK);
+}
+
+az_result test_policy_count(
+    _az_http_policy* p_policies,
+    void* p_options,
+    _az_http_request* p_request,
+    az_http_response* p_response)
+{
+  *(int*)p_options += 1;
+  return az_http_pipeline_nextpolicy(p_policies, p_request, p_response);
+}
+
 az_result test_policy_1(
     _az_http_policy* p_policies,
     void* p_options,
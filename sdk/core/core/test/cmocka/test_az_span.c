@@ -23,3 +23,39 @@ void test_az_span_getters(void** state)
   assert_int_equal(az_span_length(span), 8);
   assert_ptr_equal(az_span_ptr(span), &example);
 }
+
+void test_az_span_find(void** state)
+{
+  (void)state;
+
+  // Longer than a vector, with letters on either side of the case bit, and '@' and '`' which
+  // differ only by the case bit.
+  az_span const lower = AZ_SPAN_FROM_STR("content-length: az@[z]-0123456789-retry-after");
+  az_span const upper = AZ_SPAN_FROM_STR("CONTENT-Length: AZ@[Z]-0123456789-Retry-After");
+  assert_true(az_span_is_content_equal_ignoring_case(lower, upper));
+  assert_false(az_span_is_content_equal_ignoring_case(
+      lower, AZ_SPAN_FROM_STR("content-length: az`[z]-0123456789-retry-after")));
+  assert_false(az_span_is_content_equal_ignoring_case(
+      lower, AZ_SPAN_FROM_STR("content-length: az@{z}-0123456789-retry-after")));
+  assert_false(az_span_is_content_equal_ignoring_case(
+      lower, AZ_SPAN_FROM_STR("content-length: az@[z]-0123456789-retry-aftex")));
+  assert_false(az_span_is_content_equal_ignoring_case(lower, AZ_SPAN_FROM_STR("content")));
+
+  assert_int_equal(az_span_find_byte(lower, ':'), 14);
+  assert_int_equal(az_span_find_byte(lower, 'f'), 41);
+  assert_int_equal(az_span_find_byte(lower, '?'), -1);
+  assert_int_equal(az_span_find_byte(AZ_SPAN_NULL, '?'), -1);
+
+  assert_int_equal(az_span_find_any(lower, AZ_SPAN_FROM_STR("]?")), 21);
+  assert_int_equal(az_span_find_any(lower, AZ_SPAN_FROM_STR("?!Xf")), 41);
+  assert_int_equal(az_span_find_any(lower, AZ_SPAN_FROM_STR("#$%^&*()_+=~|<>?!;")), -1);
+  assert_int_equal(az_span_find_any(lower, AZ_SPAN_FROM_STR("#$%^&*()_+=~|<>?!;f")), 41);
+  assert_int_equal(az_span_find_any(AZ_SPAN_NULL, AZ_SPAN_FROM_STR("&")), -1);
+
+  assert_int_equal(az_span_find(lower, AZ_SPAN_FROM_STR("retry")), 34);
+  assert_int_equal(az_span_find(lower, AZ_SPAN_FROM_STR("retry-after")), 34);
+  assert_int_equal(az_span_find(lower, AZ_SPAN_FROM_STR("retry-afterx")), -1);
+  assert_int_equal(az_span_find(lower, AZ_SPAN_FROM_STR("-0")), 22);
+  assert_int_equal(az_span_find(lower, AZ_SPAN_FROM_STR("c")), 0);
+  assert_int_equal(az_span_find(AZ_SPAN_FROM_STR("ab"), AZ_SPAN_FROM_STR("abc")), -1);
+}
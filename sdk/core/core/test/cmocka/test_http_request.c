@@ -121,3 +121,145 @@ void test_http_request(void** state)
     }
   }
 }
+
+void test_http_request_body_parts(void** state)
+{
+  (void)state;
+
+  uint8_t buf[100];
+  uint8_t header_buf[(2 * sizeof(az_pair))];
+  az_span url_span = AZ_SPAN_FROM_BUFFER(buf);
+  TEST_EXPECT_SUCCESS(az_span_append(url_span, hrb_url, &url_span));
+
+  _az_http_request hrb;
+  TEST_EXPECT_SUCCESS(az_http_request_init(
+      &hrb,
+      &az_context_app,
+      az_http_method_put(),
+      url_span,
+      AZ_SPAN_FROM_BUFFER(header_buf),
+      AZ_SPAN_FROM_STR("{}")));
+
+  // A single body is one part.
+  az_span const* parts = NULL;
+  int32_t parts_length = 0;
+  TEST_EXPECT_SUCCESS(az_http_request_get_body_parts(&hrb, &parts, &parts_length));
+  assert_int_equal(parts_length, 1);
+  assert_true(az_span_is_content_equal(parts[0], AZ_SPAN_FROM_STR("{}")));
+  assert_int_equal(az_http_request_get_body_length(&hrb), 2);
+
+  az_span const body_parts[] = {
+    AZ_SPAN_FROM_STR("{\"value\":\""),
+    AZ_SPAN_FROM_STR("AAECAwQF"),
+    AZ_SPAN_FROM_STR("\"}"),
+  };
+  TEST_EXPECT_SUCCESS(az_http_request_set_body_parts(&hrb, body_parts, 3));
+
+  TEST_EXPECT_SUCCESS(az_http_request_get_body_parts(&hrb, &parts, &parts_length));
+  assert_ptr_equal(parts, body_parts);
+  assert_int_equal(parts_length, 3);
+  assert_int_equal(az_http_request_get_body_length(&hrb), 10 + 8 + 2);
+
+  // Transports that only know contiguous bodies get no body rather than a part of it.
+  az_http_method method;
+  az_span url;
+  az_span body;
+  TEST_EXPECT_SUCCESS(az_http_request_get_parts(&hrb, &method, &url, &body));
+  assert_int_equal(az_span_length(body), 0);
+}
+
+static az_result test_http_request_prepared_transport(
+    _az_http_policy* p_policies,
+    void* p_options,
+    _az_http_request* p_request,
+    az_http_response* p_response)
+{
+  (void)p_policies;
+  (void)p_options;
+  (void)p_request;
+  (void)p_response;
+  return AZ_OK;
+}
+
+void test_http_request_prepared(void** state)
+{
+  (void)state;
+
+  _az_http_policy_apiversion_options api_version = _az_http_policy_apiversion_options_default();
+  api_version._internal.option_location
+      = _az_http_policy_apiversion_option_location_queryparameter;
+  api_version._internal.name = hrb_param_api_version_name;
+  api_version._internal.version = hrb_param_api_version_token;
+
+  // The constant parts: {url}?api-version=7.0 and the content type.
+  uint8_t template_url_buf[100];
+  az_pair template_headers[1];
+  az_span template_url = AZ_SPAN_FROM_BUFFER(template_url_buf);
+  TEST_EXPECT_SUCCESS(az_span_append(
+      template_url,
+      AZ_SPAN_FROM_STR("https://antk-keyvault.vault.azure.net/secrets"),
+      &template_url));
+
+  _az_http_request constant_request;
+  TEST_EXPECT_SUCCESS(az_http_request_init(
+      &constant_request,
+      &az_context_app,
+      az_http_method_get(),
+      template_url,
+      az_span_init((uint8_t*)template_headers, 0, sizeof(template_headers)),
+      AZ_SPAN_NULL));
+  TEST_EXPECT_SUCCESS(az_http_request_set_api_version(&constant_request, &api_version));
+  TEST_EXPECT_SUCCESS(az_http_request_append_header(
+      &constant_request, hrb_header_content_type_name, hrb_header_content_type_token));
+
+  _az_http_prepared_request prepared;
+  TEST_EXPECT_SUCCESS(
+      az_http_prepared_request_init(&prepared, az_http_method_put(), &constant_request));
+
+  for (int i = 0; i < 2; ++i)
+  {
+    uint8_t url_buf[100];
+    uint8_t header_buf[(2 * sizeof(az_pair))];
+    _az_http_request hrb;
+    TEST_EXPECT_SUCCESS(az_http_request_init_prepared(
+        &hrb,
+        &az_context_app,
+        &prepared,
+        AZ_SPAN_FROM_BUFFER(url_buf),
+        AZ_SPAN_FROM_BUFFER(header_buf),
+        AZ_SPAN_FROM_STR("{}")));
+
+    // Only the variable parts are added.
+    TEST_EXPECT_SUCCESS(az_http_request_append_path(&hrb, AZ_SPAN_FROM_STR("Password")));
+    TEST_EXPECT_SUCCESS(az_http_request_set_query_parameter(
+        &hrb, hrb_param_test_param_name, hrb_param_test_param_token));
+
+    // The api version policy doesn't add the version again.
+    _az_http_policy policies[1] = {
+      {
+        ._internal = {
+          .process = test_http_request_prepared_transport,
+          .p_options = NULL,
+        },
+      },
+    };
+    TEST_EXPECT_SUCCESS(az_http_pipeline_policy_apiversion(policies, &api_version, &hrb, NULL));
+
+    az_http_method method;
+    az_span url;
+    az_span body;
+    TEST_EXPECT_SUCCESS(az_http_request_get_parts(&hrb, &method, &url, &body));
+    assert_true(az_span_is_content_equal(method, az_http_method_put()));
+    assert_true(az_span_is_content_equal(url, hrb_url3));
+    assert_true(az_span_is_content_equal(body, AZ_SPAN_FROM_STR("{}")));
+
+    assert_int_equal(_az_http_request_headers_count(&hrb), 1);
+    az_pair header = { 0 };
+    TEST_EXPECT_SUCCESS(az_http_request_get_header(&hrb, 0, &header));
+    assert_true(az_span_is_content_equal(header.key, hrb_header_content_type_name));
+    assert_true(az_span_is_content_equal(header.value, hrb_header_content_type_token));
+  }
+
+  // The constant request is unchanged.
+  assert_int_equal(az_span_length(constant_request._internal.url), 61);
+}
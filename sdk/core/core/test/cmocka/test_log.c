@@ -17,6 +17,8 @@
 
 #include <_az_cfg.h>
 
+#ifndef AZ_NO_LOGGING
+
 #define TEST_EXPECT_SUCCESS(exp) assert_true(az_succeeded(exp))
 
 static bool _log_invoked_for_http_request = false;
@@ -80,6 +82,36 @@ static void _log_listener_NULL(az_log_classification classification, az_span mes
   }
 }
 
+static void _log_listener_deferred(az_log_classification classification, az_span message)
+{
+  switch (classification)
+  {
+    case AZ_LOG_HTTP_REQUEST:
+      _log_invoked_for_http_request = true;
+      assert_true(az_span_is_content_equal(
+          message,
+          AZ_SPAN_FROM_STR("HTTP Request : GET https://www.example.com\n"
+                           "\t3 headers, 55 bytes of body")));
+      break;
+    case AZ_LOG_HTTP_RESPONSE:
+      _log_invoked_for_http_response = true;
+      assert_true(az_span_is_content_equal(
+          message,
+          AZ_SPAN_FROM_STR("HTTP Response (3456ms) : 404\n"
+                           "\t4 headers, 55 bytes of body\n"
+                           "\n"
+                           " -> HTTP Request : GET https://www.example.com")));
+      break;
+    case AZ_LOG_HTTP_RETRY:
+      assert_true(az_span_is_content_equal(
+          message, AZ_SPAN_FROM_STR("HTTP Retry attempt #0 will be made in 0ms.")));
+      break;
+    default:
+      assert_true(false);
+      break;
+  }
+}
+
 void test_az_log(void** state)
 {
   (void)state;
@@ -198,5 +230,89 @@ void test_az_log(void** state)
   }
 
   az_log_set_classifications(NULL);
+
+  {
+    // Verify that in deferred mode, log callback only gets invoked on flush, and that records that
+    // don't fit into the ring are dropped.
+    _reset_log_invocation_status();
+    az_log_set_callback(_log_listener_deferred);
+
+    az_log_record records[2] = { 0 };
+    az_log_set_deferred(records, 2);
+
+    _az_http_policy_logging_log_http_request(&hrb);
+    _az_http_policy_logging_log_http_response(&response, 3456, &hrb);
+    _az_http_policy_logging_log_http_request(&hrb);
+
+    assert_true(_log_invoked_for_http_request == false);
+    assert_true(_log_invoked_for_http_response == false);
+    assert_true(az_log_get_dropped_count() == 1);
+
+    assert_true(az_log_flush() == 2);
+    assert_true(_log_invoked_for_http_request == true);
+    assert_true(_log_invoked_for_http_response == true);
+    assert_true(az_log_flush() == 0);
+
+    // A record reserved by another thread holds back the ones committed after it, until it is
+    // committed too, and the ring is reused after the flush.
+    _reset_log_invocation_status();
+    az_log_record* const retry_record = az_log_record_acquire(AZ_LOG_HTTP_RETRY);
+    assert_non_null(retry_record);
+    _az_http_policy_logging_log_http_response(&response, 3456, &hrb);
+    assert_true(az_log_flush() == 0);
+
+    assert_null(az_log_record_acquire(AZ_LOG_HTTP_RETRY));
+    assert_true(az_log_get_dropped_count() == 2);
+
+    az_log_record_commit(retry_record);
+    assert_true(az_log_flush() == 2);
+    assert_true(_log_invoked_for_http_response == true);
+
+    // The ring length is rounded down to a power of two.
+    az_log_record odd_records[3] = { 0 };
+    az_log_set_deferred(odd_records, 3);
+    az_log_record_commit(az_log_record_acquire(AZ_LOG_HTTP_RETRY));
+    az_log_record_commit(az_log_record_acquire(AZ_LOG_HTTP_RETRY));
+    assert_null(az_log_record_acquire(AZ_LOG_HTTP_RETRY));
+    assert_true(az_log_flush() == 2);
+
+    az_log_set_deferred(NULL, 0);
+    assert_true(az_log_flush() == 0);
+  }
+  {
+    // Verify that classifications are kept when the callback is unset and set again. 0x70001
+    // maps to the last byte of the mask, and 0x40008 (code 8) to no bit: it is looked up in the
+    // list instead.
+    az_log_classification const classifications[]
+        = { AZ_LOG_HTTP_RETRY, (az_log_classification)0x40008, AZ_LOG_END_OF_LIST };
+    az_log_set_classifications(classifications);
+    az_log_set_callback(NULL);
+    assert_true(az_log_should_write(AZ_LOG_HTTP_RETRY) == false);
+    assert_true(az_log_should_write((az_log_classification)0x40008) == false);
+
+    az_log_set_callback(_log_listener);
+    assert_true(az_log_should_write(AZ_LOG_HTTP_RETRY) == true);
+    assert_true(az_log_should_write(AZ_LOG_HTTP_REQUEST) == false);
+    assert_true(az_log_should_write((az_log_classification)0x70001) == false);
+    assert_true(az_log_should_write((az_log_classification)0x40008) == true);
+    assert_true(az_log_should_write((az_log_classification)0x80001) == false);
+
+    az_log_set_classifications(NULL);
+    assert_true(az_log_should_write((az_log_classification)0x80001) == true);
+  }
+
+  az_log_set_callback(NULL);
+}
+
+#else // AZ_NO_LOGGING
+
+void test_az_log(void** state)
+{
+  (void)state;
+
+  // Logging is compiled out, nothing gets written even if a callback is set.
   az_log_set_callback(NULL);
+  assert_true(az_log_should_write(AZ_LOG_HTTP_REQUEST) == false);
 }
+
+#endif // AZ_NO_LOGGING
@@ -189,6 +189,70 @@ void az_span_to_uint32_test()
   assert_int_equal(value, 1024);
 }
 
+void az_span_to_uint64_bounds_test()
+{
+  uint64_t value = 0;
+
+  assert_return_code(
+      az_span_to_uint64(AZ_SPAN_FROM_STR("18446744073709551615"), &value), AZ_OK);
+  assert_true(value == UINT64_MAX);
+  assert_return_code(
+      az_span_to_uint64(AZ_SPAN_FROM_STR("0000000000000000000012345678901234567"), &value),
+      AZ_OK);
+  assert_true(value == 12345678901234567ull);
+  assert_return_code(az_span_to_uint64(AZ_SPAN_FROM_STR("0"), &value), AZ_OK);
+  assert_true(value == 0);
+
+  assert_true(
+      az_span_to_uint64(AZ_SPAN_FROM_STR("18446744073709551616"), &value)
+      == AZ_ERROR_PARSER_UNEXPECTED_CHAR);
+  assert_true(
+      az_span_to_uint64(AZ_SPAN_FROM_STR("100000000000000000000"), &value)
+      == AZ_ERROR_PARSER_UNEXPECTED_CHAR);
+  assert_true(
+      az_span_to_uint64(AZ_SPAN_FROM_STR("1234567/"), &value) == AZ_ERROR_PARSER_UNEXPECTED_CHAR);
+  assert_true(
+      az_span_to_uint64(AZ_SPAN_FROM_STR("1234:5678"), &value) == AZ_ERROR_PARSER_UNEXPECTED_CHAR);
+  assert_true(
+      az_span_to_uint64(AZ_SPAN_FROM_STR("1844674407370955161a"), &value)
+      == AZ_ERROR_PARSER_UNEXPECTED_CHAR);
+
+  uint32_t value32 = 0;
+  assert_return_code(az_span_to_uint32(AZ_SPAN_FROM_STR("4294967295"), &value32), AZ_OK);
+  assert_true(value32 == UINT32_MAX);
+  assert_true(
+      az_span_to_uint32(AZ_SPAN_FROM_STR("4294967296"), &value32)
+      == AZ_ERROR_PARSER_UNEXPECTED_CHAR);
+  assert_true(
+      az_span_to_uint32(AZ_SPAN_FROM_STR("-1"), &value32) == AZ_ERROR_PARSER_UNEXPECTED_CHAR);
+}
+
+void az_span_append_i64toa_bounds_test()
+{
+  uint8_t raw_buffer[30];
+  az_span out_span;
+
+  assert_return_code(
+      az_span_append_i64toa(AZ_SPAN_FROM_BUFFER(raw_buffer), INT64_MIN, &out_span), AZ_OK);
+  assert_true(az_span_is_content_equal(out_span, AZ_SPAN_FROM_STR("-9223372036854775808")));
+
+  assert_return_code(
+      az_span_append_u64toa(AZ_SPAN_FROM_BUFFER(raw_buffer), UINT64_MAX, &out_span), AZ_OK);
+  assert_true(az_span_is_content_equal(out_span, AZ_SPAN_FROM_STR("18446744073709551615")));
+
+  // Appended after the existing content, only if it fits.
+  assert_true(
+      az_span_append_i32toa(out_span, INT32_MIN, &out_span)
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+  assert_return_code(az_span_append_i32toa(out_span, -2147483, &out_span), AZ_OK);
+  assert_true(
+      az_span_is_content_equal(out_span, AZ_SPAN_FROM_STR("18446744073709551615-2147483")));
+  assert_return_code(az_span_append_u32toa(out_span, 42, &out_span), AZ_OK);
+  assert_true(
+      az_span_is_content_equal(out_span, AZ_SPAN_FROM_STR("18446744073709551615-214748342")));
+  assert_true(az_span_append_u32toa(out_span, 0, &out_span) == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+}
+
 void az_span_to_str_test()
 {
   az_span sample = AZ_SPAN_FROM_STR("hello World!");
@@ -223,4 +287,6 @@ void test_az_span(void** state)
   az_span_to_uint32_test();
   az_span_to_str_test();
   az_span_to_uint64_return_errors();
+  az_span_to_uint64_bounds_test();
+  az_span_append_i64toa_bounds_test();
 }
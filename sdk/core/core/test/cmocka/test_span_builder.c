@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_span.h>
+#include <az_span_builder.h>
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+#include <cmocka.h>
+
+#include <_az_cfg.h>
+
+#define TEST_EXPECT_SUCCESS(exp) assert_true(az_succeeded(exp))
+
+void test_span_builder(void** state)
+{
+  (void)state;
+
+  uint8_t block0[16];
+  uint8_t block1[8];
+  uint8_t block2[64];
+  az_span blocks[] = {
+    AZ_SPAN_FROM_BUFFER(block0),
+    AZ_SPAN_FROM_BUFFER(block1),
+    AZ_SPAN_FROM_BUFFER(block2),
+  };
+
+  az_span_arena arena;
+  TEST_EXPECT_SUCCESS(az_span_arena_init(&arena, blocks, 3));
+
+  // Allocations before the builder stay where they are.
+  az_span header = AZ_SPAN_NULL;
+  TEST_EXPECT_SUCCESS(az_span_arena_allocate(&arena, 4, &header));
+  assert_ptr_equal(az_span_ptr(header), block0);
+  TEST_EXPECT_SUCCESS(az_span_append(header, AZ_SPAN_FROM_STR("name"), &header));
+
+  az_span_builder builder;
+  TEST_EXPECT_SUCCESS(az_span_builder_init(&builder, &arena));
+  TEST_EXPECT_SUCCESS(az_span_builder_append(&builder, AZ_SPAN_FROM_STR("https://a/")));
+  assert_ptr_equal(az_span_ptr(az_span_builder_span_get(&builder)), block0 + 4);
+
+  // The content doesn't fit in block0 anymore, and block1 can't hold it: it moves to block2.
+  TEST_EXPECT_SUCCESS(az_span_builder_append_url_encode(&builder, AZ_SPAN_FROM_STR("a b")));
+  TEST_EXPECT_SUCCESS(az_span_builder_append(&builder, AZ_SPAN_FROM_STR("?n=")));
+  TEST_EXPECT_SUCCESS(az_span_builder_append_i64toa(&builder, -1234567890123));
+
+  az_span const url = az_span_builder_span_get(&builder);
+  assert_ptr_equal(az_span_ptr(url), block2);
+  assert_true(az_span_is_content_equal(url, AZ_SPAN_FROM_STR("https://a/a%20b?n=-1234567890123")));
+  assert_true(az_span_is_content_equal(header, AZ_SPAN_FROM_STR("name")));
+
+  // Reserved room is only added once committed.
+  az_span tail = AZ_SPAN_NULL;
+  TEST_EXPECT_SUCCESS(az_span_builder_reserve(&builder, 1, &tail));
+  TEST_EXPECT_SUCCESS(az_span_append_uint8(tail, '&', &tail));
+  assert_int_equal(az_span_length(az_span_builder_span_get(&builder)), az_span_length(url));
+  az_span_builder_commit(&builder, tail);
+  assert_int_equal(az_span_length(az_span_builder_span_get(&builder)), az_span_length(url) + 1);
+
+  assert_true(
+      az_span_builder_append(&builder, AZ_SPAN_FROM_STR("0123456789012345678901234567890123"))
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+
+  // After a reset, the blocks are reused from the first one.
+  az_span_arena_reset(&arena);
+  TEST_EXPECT_SUCCESS(az_span_builder_init(&builder, &arena));
+  TEST_EXPECT_SUCCESS(az_span_builder_append(&builder, AZ_SPAN_FROM_STR("0123456789")));
+  assert_ptr_equal(az_span_ptr(az_span_builder_span_get(&builder)), block0);
+
+  az_span body = AZ_SPAN_NULL;
+  TEST_EXPECT_SUCCESS(az_span_arena_allocate(&arena, 8, &body));
+  assert_ptr_equal(az_span_ptr(body), block1);
+  assert_true(az_span_arena_allocate(&arena, 65, &body) == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+}
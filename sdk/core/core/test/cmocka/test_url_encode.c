@@ -62,3 +62,58 @@ void test_url_encode(void** state)
     assert_true(az_span_is_content_equal(builder, uri_encoded));
   }
 }
+
+void test_url_encode_overflow(void** state)
+{
+  (void)state;
+  uint8_t buffer[1000];
+
+  assert_int_equal(az_span_url_encode_length(uri_decoded), az_span_length(uri_encoded));
+  assert_int_equal(az_span_url_encode_length(AZ_SPAN_NULL), 0);
+
+  // Too small by one character, at the end of a run of unreserved characters or of an escape.
+  az_span builder = AZ_SPAN_NULL;
+  assert_true(
+      az_span_copy_url_encode(
+          az_span_init(buffer, 0, az_span_length(uri_encoded) - 1), uri_decoded, &builder)
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+  assert_true(
+      az_span_copy_url_encode(
+          az_span_init(buffer, 0, 18), AZ_SPAN_FROM_STR("0123456789abcdefghij"), &builder)
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+  assert_true(
+      az_span_copy_url_encode(
+          az_span_init(buffer, 0, 20), AZ_SPAN_FROM_STR("0123456789abcdefghi/"), &builder)
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+
+  TEST_EXPECT_SUCCESS(az_span_copy_url_encode(
+      az_span_init(buffer, 0, 22), AZ_SPAN_FROM_STR("0123456789abcdefghi/"), &builder));
+  assert_true(az_span_is_content_equal(builder, AZ_SPAN_FROM_STR("0123456789abcdefghi%2F")));
+}
+
+void test_url_decode(void** state)
+{
+  (void)state;
+  uint8_t buffer[1000];
+
+  az_span builder = AZ_SPAN_FROM_BUFFER(buffer);
+  TEST_EXPECT_SUCCESS(az_span_copy_url_decode(builder, uri_encoded, &builder));
+  assert_true(az_span_is_content_equal(builder, uri_decoded));
+
+  // Lowercase hexadecimal digits, and decoding in place.
+  uint8_t in_place_buffer[] = "a%2fb%2Bc%20d";
+  az_span in_place = AZ_SPAN_FROM_INITIALIZED_BUFFER(in_place_buffer);
+  in_place = az_span_slice(in_place, 0, az_span_length(in_place) - 1);
+  TEST_EXPECT_SUCCESS(az_span_copy_url_decode(in_place, in_place, &in_place));
+  assert_true(az_span_is_content_equal(in_place, AZ_SPAN_FROM_STR("a/b+c d")));
+
+  builder = AZ_SPAN_FROM_BUFFER(buffer);
+  assert_true(
+      az_span_copy_url_decode(builder, AZ_SPAN_FROM_STR("a%2"), &builder) == AZ_ERROR_EOF);
+  assert_true(
+      az_span_copy_url_decode(builder, AZ_SPAN_FROM_STR("a%2G"), &builder)
+      == AZ_ERROR_PARSER_UNEXPECTED_CHAR);
+  assert_true(
+      az_span_copy_url_decode(az_span_init(buffer, 0, 2), AZ_SPAN_FROM_STR("ab%20"), &builder)
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+}
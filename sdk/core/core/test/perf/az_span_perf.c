@@ -0,0 +1,304 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file az_span_perf.c
+ *
+ * @brief Microbenchmark of the integer parsing and formatting of az_span, against copies of the
+ * routines they replaced, which parsed and formatted one digit at a time. Both versions are first
+ * cross-checked on random inputs: the program fails if they give different results.
+ */
+
+#include <az_result.h>
+#include <az_span.h>
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <_az_cfg.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define _az_PERF_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define _az_PERF_NOINLINE __declspec(noinline)
+#else
+#define _az_PERF_NOINLINE
+#endif
+
+enum
+{
+  _az_PERF_NUMBERS = 4096,
+  _az_PERF_ROUNDS = 100,
+  _az_PERF_RUNS = 7, // The fastest run is kept.
+  _az_PERF_CHECKS = 300000,
+};
+
+// The previous az_span_to_uint64.
+static _az_PERF_NOINLINE az_result _az_perf_old_to_uint64(az_span span, uint64_t* out_number)
+{
+  int32_t self_length = az_span_length(span);
+  uint64_t value = 0;
+
+  for (int32_t i = 0; i < self_length; ++i)
+  {
+    uint8_t result = az_span_ptr(span)[i];
+    if (!isdigit(result))
+    {
+      return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
+    }
+    uint64_t const d = (uint64_t)result - '0';
+    if ((UINT64_MAX - d) / 10 < value)
+    {
+      return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
+    }
+
+    value = value * 10 + d;
+  }
+
+  *out_number = value;
+  return AZ_OK;
+}
+
+// The previous az_span_to_uint32.
+static _az_PERF_NOINLINE az_result _az_perf_old_to_uint32(az_span span, uint32_t* out_number)
+{
+  int32_t self_length = az_span_length(span);
+  uint32_t value = 0;
+
+  for (int32_t i = 0; i < self_length; ++i)
+  {
+    uint8_t result = az_span_ptr(span)[i];
+    if (!isdigit(result))
+    {
+      return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
+    }
+    uint32_t const d = (uint32_t)result - '0';
+    if ((UINT32_MAX - d) / 10 < value)
+    {
+      return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
+    }
+
+    value = value * 10 + d;
+  }
+
+  *out_number = value;
+  return AZ_OK;
+}
+
+// The previous az_span_append_u64toa.
+static _az_PERF_NOINLINE az_result
+_az_perf_old_append_u64toa(az_span destination, uint64_t source, az_span* out_span)
+{
+  *out_span = destination;
+  if (source == 0)
+  {
+    return az_span_append(*out_span, AZ_SPAN_FROM_STR("0"), out_span);
+  }
+
+  uint64_t div = 10000000000000000000ull;
+  uint64_t nn = source;
+  while (nn / div == 0)
+  {
+    div /= 10;
+  }
+
+  while (div > 1)
+  {
+    uint8_t value_to_append = (uint8_t)('0' + (uint8_t)(nn / div));
+    AZ_RETURN_IF_FAILED(az_span_append(*out_span, az_span_init(&value_to_append, 1, 1), out_span));
+
+    nn %= div;
+    div /= 10;
+  }
+  uint8_t value_to_append = (uint8_t)('0' + (uint8_t)nn);
+  return az_span_append(*out_span, az_span_init(&value_to_append, 1, 1), out_span);
+}
+
+// A xorshift generator, so that every run measures the same numbers.
+static uint64_t _az_perf_random_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t _az_perf_random()
+{
+  _az_perf_random_state ^= _az_perf_random_state << 13;
+  _az_perf_random_state ^= _az_perf_random_state >> 7;
+  _az_perf_random_state ^= _az_perf_random_state << 17;
+  return _az_perf_random_state;
+}
+
+// A number with digits digits, or with 1 to 19 digits when digits is 0.
+static uint64_t _az_perf_random_number(int32_t digits)
+{
+  if (digits == 0)
+  {
+    digits = 1 + (int32_t)(_az_perf_random() % 19);
+  }
+
+  uint64_t number = 1 + _az_perf_random() % 9;
+  for (int32_t i = 1; i < digits; ++i)
+  {
+    number = number * 10 + _az_perf_random() % 10;
+  }
+  return number;
+}
+
+static uint64_t _az_perf_numbers[_az_PERF_NUMBERS];
+static uint8_t _az_perf_text[_az_PERF_NUMBERS][24];
+static az_span _az_perf_spans[_az_PERF_NUMBERS];
+
+// Keeps the results alive, so that the calls are not optimized away.
+static uint64_t volatile _az_perf_sink = 0;
+
+static int32_t _az_perf_check()
+{
+  int32_t mismatches = 0;
+  for (int32_t i = 0; i < _az_PERF_CHECKS; ++i)
+  {
+    // Digits, with some other bytes, and numbers around UINT64_MAX.
+    uint8_t text[24];
+    int32_t const length = 1 + (int32_t)(_az_perf_random() % 22);
+    for (int32_t j = 0; j < length; ++j)
+    {
+      text[j] = _az_perf_random() % 50 == 0 ? (uint8_t)_az_perf_random()
+                                            : (uint8_t)('0' + _az_perf_random() % 10);
+    }
+    az_span span = az_span_init(text, length, (int32_t)sizeof(text));
+    if (i % 3 == 0)
+    {
+      memcpy(text, "1844674407370955161", 19);
+      text[19] = (uint8_t)('0' + _az_perf_random() % 10);
+      span = az_span_init(text, 20, (int32_t)sizeof(text));
+    }
+
+    uint64_t old_u64 = 1;
+    uint64_t new_u64 = 1;
+    az_result const old_u64_result = _az_perf_old_to_uint64(span, &old_u64);
+    az_result const new_u64_result = az_span_to_uint64(span, &new_u64);
+    if (old_u64_result != new_u64_result || (az_succeeded(old_u64_result) && old_u64 != new_u64))
+    {
+      ++mismatches;
+    }
+
+    uint32_t old_u32 = 1;
+    uint32_t new_u32 = 1;
+    az_result const old_u32_result = _az_perf_old_to_uint32(span, &old_u32);
+    az_result const new_u32_result = az_span_to_uint32(span, &new_u32);
+    if (old_u32_result != new_u32_result || (az_succeeded(old_u32_result) && old_u32 != new_u32))
+    {
+      ++mismatches;
+    }
+
+    uint64_t const number = _az_perf_random() >> (_az_perf_random() % 64);
+    uint8_t old_buffer[24];
+    uint8_t new_buffer[24];
+    az_span old_text = AZ_SPAN_NULL;
+    az_span new_text = AZ_SPAN_NULL;
+    if (az_failed(_az_perf_old_append_u64toa(AZ_SPAN_FROM_BUFFER(old_buffer), number, &old_text))
+        || az_failed(az_span_append_u64toa(AZ_SPAN_FROM_BUFFER(new_buffer), number, &new_text))
+        || !az_span_is_content_equal(old_text, new_text))
+    {
+      ++mismatches;
+    }
+  }
+  return mismatches;
+}
+
+static void _az_perf_prepare(int32_t digits)
+{
+  for (int32_t i = 0; i < _az_PERF_NUMBERS; ++i)
+  {
+    _az_perf_numbers[i] = _az_perf_random_number(digits);
+    az_span text = AZ_SPAN_NULL;
+    az_result const result = az_span_append_u64toa(
+        AZ_SPAN_FROM_BUFFER(_az_perf_text[i]), _az_perf_numbers[i], &text);
+    (void)result;
+    _az_perf_spans[i] = text;
+  }
+}
+
+typedef az_result (*_az_perf_parse_fn)(az_span span, uint64_t* out_number);
+typedef az_result (*_az_perf_format_fn)(az_span destination, uint64_t source, az_span* out_span);
+
+// Returns the fastest time of a call, in nanoseconds.
+static double _az_perf_parse(_az_perf_parse_fn parse)
+{
+  double fastest = 0;
+  for (int32_t run = 0; run < _az_PERF_RUNS; ++run)
+  {
+    clock_t const start = clock();
+    for (int32_t round = 0; round < _az_PERF_ROUNDS; ++round)
+    {
+      for (int32_t i = 0; i < _az_PERF_NUMBERS; ++i)
+      {
+        uint64_t number = 0;
+        if (az_succeeded(parse(_az_perf_spans[i], &number)))
+        {
+          _az_perf_sink += number;
+        }
+      }
+    }
+    double const elapsed = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC
+        / ((double)_az_PERF_ROUNDS * _az_PERF_NUMBERS);
+    fastest = (run == 0 || elapsed < fastest) ? elapsed : fastest;
+  }
+  return fastest;
+}
+
+static double _az_perf_format(_az_perf_format_fn format)
+{
+  double fastest = 0;
+  for (int32_t run = 0; run < _az_PERF_RUNS; ++run)
+  {
+    clock_t const start = clock();
+    for (int32_t round = 0; round < _az_PERF_ROUNDS; ++round)
+    {
+      for (int32_t i = 0; i < _az_PERF_NUMBERS; ++i)
+      {
+        uint8_t buffer[24];
+        az_span text = AZ_SPAN_NULL;
+        if (az_succeeded(format(AZ_SPAN_FROM_BUFFER(buffer), _az_perf_numbers[i], &text)))
+        {
+          _az_perf_sink += (uint64_t)az_span_length(text);
+        }
+      }
+    }
+    double const elapsed = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC
+        / ((double)_az_PERF_ROUNDS * _az_PERF_NUMBERS);
+    fastest = (run == 0 || elapsed < fastest) ? elapsed : fastest;
+  }
+  return fastest;
+}
+
+int main(void)
+{
+  int32_t const mismatches = _az_perf_check();
+  printf("mismatches: %d\n\n", (int)mismatches);
+
+  printf("ns per call, previous -> current\n");
+  printf("digits   parse (to_uint64)   format (append_u64toa)\n");
+
+  int32_t const digit_counts[] = { 1, 3, 8, 10, 19, 0 };
+  for (size_t i = 0; i < sizeof(digit_counts) / sizeof(digit_counts[0]); ++i)
+  {
+    _az_perf_prepare(digit_counts[i]);
+    double const old_parse = _az_perf_parse(_az_perf_old_to_uint64);
+    double const new_parse = _az_perf_parse(az_span_to_uint64);
+    double const old_format = _az_perf_format(_az_perf_old_append_u64toa);
+    double const new_format = _az_perf_format(az_span_append_u64toa);
+
+    if (digit_counts[i] == 0)
+    {
+      printf("1..19  ");
+    }
+    else
+    {
+      printf("%-7d", (int)digit_counts[i]);
+    }
+    printf(
+        "  %6.1f -> %6.1f      %6.1f -> %6.1f\n", old_parse, new_parse, old_format, new_format);
+  }
+
+  return mismatches == 0 ? 0 : 1;
+}
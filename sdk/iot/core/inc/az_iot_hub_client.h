@@ -29,6 +29,13 @@ typedef struct az_iot_hub_client_options
                          usage statistics. */
 } az_iot_hub_client_options;
 
+enum
+{
+  // "devices/" + device id + "/modules/" + module id + "/messages/events/", with IoT Hub device and
+  // module ids of up to 128 characters each.
+  _az_IOT_HUB_CLIENT_TELEMETRY_TOPIC_PREFIX_SIZE = 8 + 128 + 9 + 128 + 17,
+};
+
 /**
  * @brief Azure IoT Hub Client.
  *
@@ -40,6 +47,10 @@ typedef struct az_iot_hub_client
     az_span iot_hub_hostname;
     az_span device_id;
     az_iot_hub_client_options options;
+    // The telemetry topic up to the properties, computed by az_iot_hub_client_init. Empty when the
+    // client was not initialized by az_iot_hub_client_init, or if the ids don't fit.
+    uint8_t telemetry_topic_prefix[_az_IOT_HUB_CLIENT_TELEMETRY_TOPIC_PREFIX_SIZE];
+    int16_t telemetry_topic_prefix_length;
   } _internal;
 } az_iot_hub_client;
 
@@ -151,6 +162,23 @@ AZ_NODISCARD az_result az_iot_hub_client_sas_password_get(
  *   must contain Uri-encoded keys and values.
  */
 
+/**
+ * @brief An entry of a properties index. It locates one property in the properties buffer, and is
+ * also one slot of the hash table used by #az_iot_hub_client_properties_find.
+ *
+ */
+typedef struct az_iot_hub_client_properties_index_entry
+{
+  struct
+  {
+    uint16_t key_offset;
+    uint16_t key_length;
+    uint16_t value_offset;
+    uint16_t value_length;
+    int16_t slot; // Hash table slot: position of an entry, or -1 when empty.
+  } _internal;
+} az_iot_hub_client_properties_index_entry;
+
 /**
  * @brief Telemetry or C2D properties.
  *
@@ -161,6 +189,9 @@ typedef struct az_iot_hub_client_properties
   {
     az_span properties;
     uint8_t* current_property;
+    az_iot_hub_client_properties_index_entry* index; // NULL when the properties are not indexed
+    int16_t index_capacity;
+    int16_t index_count;
   } _internal;
 } az_iot_hub_client_properties;
 
@@ -169,12 +200,31 @@ typedef struct az_iot_hub_client_properties
  *
  * @param[in] properties The #az_iot_hub_client_properties to initialize
  * @param[in] buffer Can either be an empty #az_span or an #az_span containing properly formatted
- *                   properties starting with the '?' character.
+ *                   properties, optionally starting with the '?' character.
  * @return #az_result
  */
 AZ_NODISCARD az_result
 az_iot_hub_client_properties_init(az_iot_hub_client_properties* properties, az_span buffer);
 
+/**
+ * @brief Indexes the properties in one pass, so that #az_iot_hub_client_properties_find runs in
+ *        constant time instead of scanning the properties.
+ * @details Properties appended afterwards are indexed as they are appended. If there are more
+ *          properties than index entries, the index is dropped and finds scan the properties
+ *          again.
+ *
+ * @param[in] properties The #az_iot_hub_client_properties to index.
+ * @param[in] entries The storage of the index. It must stay valid as long as the properties are
+ *                    used.
+ * @param[in] entries_length The number of entries. Up to 1 entry per property.
+ * @return #az_result
+ *         #AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY if the properties don't fit in the index.
+ */
+AZ_NODISCARD az_result az_iot_hub_client_properties_index_init(
+    az_iot_hub_client_properties* properties,
+    az_iot_hub_client_properties_index_entry* entries,
+    int16_t entries_length);
+
 /**
  * @brief Appends a key-value property to the list of properties.
  *
@@ -195,7 +245,8 @@ AZ_NODISCARD az_result az_iot_hub_client_properties_append(
  *
  * @param[in] properties The #az_iot_hub_client_properties to use for this call
  * @param[in] name The name of the property.
- * @param[out] out_value An #az_span containing the value of the property.
+ * @param[out] out_value An #az_span containing the value of the property, or #AZ_SPAN_NULL if
+ *                       the property has no value, with or without an index.
  * @return #az_result.
  */
 AZ_NODISCARD az_result az_iot_hub_client_properties_find(
@@ -235,6 +286,105 @@ AZ_NODISCARD az_result az_iot_hub_client_telemetry_publish_topic_get(
     az_span mqtt_topic,
     az_span* out_mqtt_topic);
 
+/**
+ *
+ * Telemetry batch APIs
+ *
+ *   A telemetry batch packs many readings into a single message, as a JSON array. The message is
+ *   sent with the `application/json` content type, so that IoT Hub routing can query it.
+ */
+
+enum
+{
+  AZ_IOT_HUB_CLIENT_TELEMETRY_MAX_MESSAGE_SIZE
+  = 256 * 1024, ///< Maximum size of a device to cloud message: topic, with properties, and payload.
+};
+
+/**
+ * @brief A batch of telemetry readings.
+ *
+ */
+typedef struct az_iot_hub_client_telemetry_batch
+{
+  struct
+  {
+    az_span payload;
+    az_iot_hub_client_properties* properties;
+    int32_t topic_length; ///< Length of the MQTT topic, without the properties.
+    int32_t max_payload_size;
+    int32_t count;
+  } _internal;
+} az_iot_hub_client_telemetry_batch;
+
+/**
+ * @brief Initializes a telemetry batch.
+ *
+ * @param[in] client The #az_iot_hub_client the batch is sent with.
+ * @param[out] batch The #az_iot_hub_client_telemetry_batch to initialize.
+ * @param[in] payload_buffer An empty #az_span where the payload of the batch is built.
+ * @param[in] properties An optional #az_iot_hub_client_properties object (can be NULL), shared by
+ *                       all the readings of the batch. The content type and encoding system
+ *                       properties are appended to it, unless a previous batch already did.
+ * @return #az_result.
+ *         #AZ_ERROR_ARG if \p properties already have a different content type or encoding.
+ */
+AZ_NODISCARD az_result az_iot_hub_client_telemetry_batch_init(
+    az_iot_hub_client const* client,
+    az_iot_hub_client_telemetry_batch* batch,
+    az_span payload_buffer,
+    az_iot_hub_client_properties* properties);
+
+/**
+ * @brief Appends a reading to a telemetry batch.
+ * @details When the reading doesn't fit, either in the payload buffer or in the message size limit
+ *          of IoT Hub, the batch is left unchanged: send it, reset it and append the reading again.
+ *
+ * @param[in] batch The #az_iot_hub_client_telemetry_batch to use for this call.
+ * @param[in] reading A JSON value (usually an object) of one reading.
+ * @return #az_result.
+ *         #AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY if the reading doesn't fit in the batch.
+ */
+AZ_NODISCARD az_result
+az_iot_hub_client_telemetry_batch_append(az_iot_hub_client_telemetry_batch* batch, az_span reading);
+
+/**
+ * @brief Gets the number of readings in a telemetry batch.
+ *
+ * @param[in] batch The #az_iot_hub_client_telemetry_batch to use for this call.
+ * @return The number of readings.
+ */
+AZ_NODISCARD AZ_INLINE int32_t
+az_iot_hub_client_telemetry_batch_count(az_iot_hub_client_telemetry_batch const* batch)
+{
+  return batch->_internal.count;
+}
+
+/**
+ * @brief Gets the MQTT topic and the payload of the message that sends a telemetry batch.
+ * @note Telemetry MQTT Publish messages must have QoS At Least Once (1).
+ *
+ * @param[in] client The #az_iot_hub_client to use for this call.
+ * @param[in] batch The #az_iot_hub_client_telemetry_batch to send. It must not be empty.
+ * @param[in] mqtt_topic An empty #az_span with sufficient capacity to hold the MQTT topic.
+ * @param[out] out_mqtt_topic The output #az_span containing the MQTT topic.
+ * @param[out] out_payload The output #az_span containing the MQTT payload. It is valid until the
+ *                         batch is reset.
+ * @return #az_result.
+ */
+AZ_NODISCARD az_result az_iot_hub_client_telemetry_batch_publish_get(
+    az_iot_hub_client const* client,
+    az_iot_hub_client_telemetry_batch const* batch,
+    az_span mqtt_topic,
+    az_span* out_mqtt_topic,
+    az_span* out_payload);
+
+/**
+ * @brief Removes all the readings of a telemetry batch, keeping its properties.
+ *
+ * @param[in] batch The #az_iot_hub_client_telemetry_batch to use for this call.
+ */
+void az_iot_hub_client_telemetry_batch_reset(az_iot_hub_client_telemetry_batch* batch);
+
 /**
  *
  * Cloud to device (C2D) APIs
@@ -503,6 +653,57 @@ AZ_NODISCARD az_result az_iot_hub_client_twin_patch_publish_topic_get(
     az_span mqtt_topic,
     az_span* out_mqtt_topic);
 
+/**
+ *
+ * Received topic APIs
+ *
+ */
+
+/**
+ * @brief The kind of a topic received from IoT Hub.
+ *
+ */
+typedef enum
+{
+  AZ_IOT_HUB_CLIENT_TOPIC_TYPE_C2D = 1,
+  AZ_IOT_HUB_CLIENT_TOPIC_TYPE_METHOD = 2,
+  AZ_IOT_HUB_CLIENT_TOPIC_TYPE_TWIN = 3,
+} az_iot_hub_client_topic_type;
+
+/**
+ * @brief A topic received from IoT Hub.
+ *
+ */
+typedef struct az_iot_hub_client_received_topic
+{
+  az_iot_hub_client_topic_type type; /**< Selects the member of parsed that is set. */
+  union
+  {
+    az_iot_hub_client_c2d_request c2d; /**< Set for #AZ_IOT_HUB_CLIENT_TOPIC_TYPE_C2D. */
+    az_iot_hub_client_method_request method; /**< Set for #AZ_IOT_HUB_CLIENT_TOPIC_TYPE_METHOD. */
+    az_iot_hub_client_twin_response twin; /**< Set for #AZ_IOT_HUB_CLIENT_TOPIC_TYPE_TWIN. */
+  } parsed;
+} az_iot_hub_client_received_topic;
+
+/**
+ * @brief Classifies and parses a received message's topic.
+ * @details The topic is matched in a single pass, instead of trying
+ *          #az_iot_hub_client_c2d_received_topic_parse,
+ *          #az_iot_hub_client_methods_received_topic_parse and
+ *          #az_iot_hub_client_twin_received_topic_parse in turn. The parsed spans refer to
+ *          \p received_topic.
+ *
+ * @param[in] client The #az_iot_hub_client to use for this call.
+ * @param[in] received_topic An #az_span containing the received topic.
+ * @param[out] out_topic The type of the topic, and the corresponding parsed request or response.
+ * @return #AZ_ERROR_IOT_TOPIC_NO_MATCH if the topic is not a C2D, method or twin topic of this
+ *         client.
+ */
+AZ_NODISCARD az_result az_iot_hub_client_received_topic_parse(
+    az_iot_hub_client const* client,
+    az_span received_topic,
+    az_iot_hub_client_received_topic* out_topic);
+
 #include <_az_cfg_suffix.h>
 
 #endif //!_az_IOT_HUB_CLIENT_H
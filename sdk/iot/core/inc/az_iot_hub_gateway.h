@@ -0,0 +1,182 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file az_iot_hub_gateway.h
+ *
+ * @brief Azure IoT Hub device identities managed by a gateway.
+ *
+ * @details A gateway acting for many leaf devices keeps a handful of bytes per device, in parallel
+ *          arrays provided by the application, instead of one #az_iot_hub_client per device. The
+ *          topics of any device are built with a single #az_iot_hub_client owned by the gateway,
+ *          and SAS tokens are signed on demand, so that nothing larger than the device id and the
+ *          token expiry is kept per device.
+ */
+
+#ifndef _az_IOT_HUB_GATEWAY_H
+#define _az_IOT_HUB_GATEWAY_H
+
+#include <az_iot_hub_client.h>
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdint.h>
+
+#include <_az_cfg_prefix.h>
+
+/**
+ * @brief The per-device state of a gateway, as parallel arrays of the same capacity. Device `i` is
+ * described by the `i`-th element of each array.
+ *
+ */
+typedef struct az_iot_hub_gateway_devices
+{
+  az_span* device_ids; /**< The device ids. */
+  az_span* keys; /**< The Base64 encoded shared access keys of the devices. Can be NULL when all the
+                    keys are derived from the gateway group key. */
+  int32_t* sas_expiry_times; /**< The expiry of the last token signed for each device, or 0. */
+  int32_t capacity; /**< The number of elements of each array. */
+} az_iot_hub_gateway_devices;
+
+/**
+ * @brief Azure IoT Hub Gateway options.
+ *
+ */
+typedef struct az_iot_hub_gateway_options
+{
+  az_span group_key; /**< The Base64 encoded group enrollment key, used for devices without a key
+                        of their own. The key of a device is then HMAC-SHA256(group key, device
+                        id), as for IoT Hub Device Provisioning Service group enrollments. */
+  int32_t sas_lifetime_secs; /**< How long each SAS token is valid. */
+  int32_t sas_refresh_secs; /**< How long before expiry a SAS token should be signed again. */
+} az_iot_hub_gateway_options;
+
+/**
+ * @brief Azure IoT Hub Gateway.
+ *
+ */
+typedef struct az_iot_hub_gateway
+{
+  struct
+  {
+    az_span iot_hub_hostname;
+    az_iot_hub_gateway_devices devices;
+    int32_t device_count;
+    az_iot_hub_gateway_options options;
+    // Shared by all the devices: pointed at one device at a time by az_iot_hub_gateway_get_client.
+    az_iot_hub_client client;
+    int32_t client_device_index;
+    // Where az_iot_hub_gateway_sas_next_refresh resumes, so that devices are refreshed in turn.
+    int32_t refresh_cursor;
+  } _internal;
+} az_iot_hub_gateway;
+
+/**
+ * @brief Gets the default Azure IoT Hub Gateway options.
+ *
+ * @return #az_iot_hub_gateway_options, with SAS tokens valid for an hour and refreshed 5 minutes
+ *         before expiry.
+ */
+AZ_NODISCARD az_iot_hub_gateway_options az_iot_hub_gateway_options_default();
+
+/**
+ * @brief Initializes an Azure IoT Hub Gateway without devices.
+ *
+ * @param[out] gateway The #az_iot_hub_gateway to initialize.
+ * @param[in] iot_hub_hostname The IoT Hub Hostname.
+ * @param[in] devices The arrays holding the state of the devices.
+ * @param[in] options A reference to an #az_iot_hub_gateway_options structure. Can be NULL.
+ * @return #az_result
+ */
+AZ_NODISCARD az_result az_iot_hub_gateway_init(
+    az_iot_hub_gateway* gateway,
+    az_span iot_hub_hostname,
+    az_iot_hub_gateway_devices devices,
+    az_iot_hub_gateway_options const* options);
+
+/**
+ * @brief Adds a device to the gateway.
+ *
+ * @param[in,out] gateway The #az_iot_hub_gateway to use for this call.
+ * @param[in] device_id The device id. Must remain valid while the gateway is used.
+ * @param[in] key The Base64 encoded shared access key of the device, or #AZ_SPAN_NULL to derive it
+ *                from the group key.
+ * @param[out] out_device_index The index of the device, used by the other gateway APIs.
+ * @return #AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY if the device arrays are full.
+ */
+AZ_NODISCARD az_result az_iot_hub_gateway_add_device(
+    az_iot_hub_gateway* gateway,
+    az_span device_id,
+    az_span key,
+    int32_t* out_device_index);
+
+/**
+ * @brief Gets the number of devices of the gateway.
+ *
+ * @param[in] gateway The #az_iot_hub_gateway to use for this call.
+ * @return The number of devices added.
+ */
+AZ_NODISCARD AZ_INLINE int32_t az_iot_hub_gateway_device_count(az_iot_hub_gateway const* gateway)
+{
+  return gateway->_internal.device_count;
+}
+
+/**
+ * @brief Gets an #az_iot_hub_client for a device, to be used with the #az_iot_hub_client APIs
+ *        (topics, received topic parsing, ...).
+ * @note The client is shared by all the devices of the gateway: it is only valid until the next
+ *       call to this function for another device.
+ *
+ * @param[in,out] gateway The #az_iot_hub_gateway to use for this call.
+ * @param[in] device_index The index of the device.
+ * @return The client of the device.
+ */
+AZ_NODISCARD az_iot_hub_client const*
+az_iot_hub_gateway_get_client(az_iot_hub_gateway* gateway, int32_t device_index);
+
+/**
+ * @brief Signs a new SAS token for a device, valid from \p current_time_secs for the SAS lifetime.
+ *
+ * @param[in,out] gateway The #az_iot_hub_gateway to use for this call.
+ * @param[in] device_index The index of the device.
+ * @param[in] current_time_secs The current time, in seconds since UNIX epoch (1970).
+ * @param[in] sas_token An #az_span with sufficient capacity to hold the SAS token. It can be shared
+ *                      by all the devices, once the token is handed to the MQTT connection.
+ * @param[out] out_sas_token The SAS token.
+ * @return #az_result
+ */
+AZ_NODISCARD az_result az_iot_hub_gateway_sas_token_get(
+    az_iot_hub_gateway* gateway,
+    int32_t device_index,
+    int32_t current_time_secs,
+    az_span sas_token,
+    az_span* out_sas_token);
+
+/**
+ * @brief Finds the next device whose SAS token must be signed again.
+ * @details Devices are visited in turn, starting after the one last returned, so that a device
+ *          that keeps failing to reconnect doesn't starve the others.
+ *
+ * @param[in,out] gateway The #az_iot_hub_gateway to use for this call.
+ * @param[in] current_time_secs The current time, in seconds since UNIX epoch (1970).
+ * @param[out] out_device_index The index of a device without a token, or whose token is within the
+ *                              refresh time of its expiry.
+ * @return #AZ_ERROR_ITEM_NOT_FOUND if no token needs to be signed.
+ */
+AZ_NODISCARD az_result az_iot_hub_gateway_sas_next_refresh(
+    az_iot_hub_gateway* gateway,
+    int32_t current_time_secs,
+    int32_t* out_device_index);
+
+/**
+ * @brief Gets the earliest time at which a SAS token of the gateway must be signed again.
+ *
+ * @param[in] gateway The #az_iot_hub_gateway to use for this call.
+ * @return The time in seconds since UNIX epoch, 0 if a device has no token yet, or INT32_MAX if
+ *         the gateway has no devices.
+ */
+AZ_NODISCARD int32_t az_iot_hub_gateway_sas_next_refresh_time(az_iot_hub_gateway const* gateway);
+
+#include <_az_cfg_suffix.h>
+
+#endif // _az_IOT_HUB_GATEWAY_H
@@ -0,0 +1,135 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file az_iot_hub_telemetry_queue.h
+ *
+ * @brief Store-and-forward queue of telemetry messages.
+ *
+ * @details The queue is a ring of records in a memory region provided by the application, which
+ *          can be a memory-mapped file or flash memory for the queue to survive restarts. Records
+ *          are only appended, and are checksummed along with their position, so that a record torn
+ *          by a crash or left from a previous lap of the ring is detected when the queue is opened
+ *          again. The read position is only persisted by az_iot_hub_telemetry_queue_commit, in one
+ *          of two alternating slots, so a torn commit leaves the previous one in effect.
+ *
+ *          Nothing is flushed by the queue: the application decides when to flush the region (e.g.
+ *          msync after enqueuing a few messages), trading durability for throughput.
+ */
+
+#ifndef _az_IOT_HUB_TELEMETRY_QUEUE_H
+#define _az_IOT_HUB_TELEMETRY_QUEUE_H
+
+#include <az_iot_hub_client.h>
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdint.h>
+
+#include <_az_cfg_prefix.h>
+
+enum
+{
+  // Magic, capacity, generation and two read position slots.
+  _az_IOT_HUB_TELEMETRY_QUEUE_HEADER_SIZE = 4 + 4 + 4 + 4 + 2 * 16,
+  // Record length and checksum.
+  _az_IOT_HUB_TELEMETRY_QUEUE_RECORD_HEADER_SIZE = 4 + 4,
+};
+
+/**
+ * @brief A queue of telemetry messages stored in a memory region.
+ *
+ */
+typedef struct az_iot_hub_telemetry_queue
+{
+  struct
+  {
+    uint8_t* region;
+    uint32_t capacity;
+    uint32_t generation;
+    int32_t slot;
+    uint64_t head;
+    uint64_t read;
+    uint64_t tail;
+    int32_t count;
+    int32_t unread_count;
+  } _internal;
+} az_iot_hub_telemetry_queue;
+
+/**
+ * @brief Opens the queue stored in \p region, or creates an empty one if \p region doesn't hold a
+ *        queue of the same size.
+ * @details Messages enqueued but not committed before the region was last written are recovered:
+ *          the ring is scanned from the committed read position to the last intact record.
+ *
+ * @param[out] queue The #az_iot_hub_telemetry_queue to initialize.
+ * @param[in] region The memory holding the queue. Its length is used, and must be more than the
+ *                   queue header.
+ * @return #az_result
+ */
+AZ_NODISCARD az_result
+az_iot_hub_telemetry_queue_init(az_iot_hub_telemetry_queue* queue, az_span region);
+
+/**
+ * @brief Appends a message to the queue.
+ *
+ * @param[in,out] queue The #az_iot_hub_telemetry_queue to use for this call.
+ * @param[in] properties The properties of the message. Can be NULL.
+ * @param[in] payload The payload of the message.
+ * @return #AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY if the queue doesn't have room for the message
+ *         until messages are committed.
+ */
+AZ_NODISCARD az_result az_iot_hub_telemetry_queue_enqueue(
+    az_iot_hub_telemetry_queue* queue,
+    az_iot_hub_client_properties const* properties,
+    az_span payload);
+
+/**
+ * @brief Reads the next message of the queue, and gets the topic to publish it with.
+ * @details Reading doesn't remove the message: messages are removed by
+ *          az_iot_hub_telemetry_queue_commit, once their delivery is acknowledged.
+ *
+ * @param[in,out] queue The #az_iot_hub_telemetry_queue to use for this call.
+ * @param[in] client The #az_iot_hub_client the message is published with.
+ * @param[in] mqtt_topic An empty #az_span with sufficient capacity to hold the MQTT topic.
+ * @param[out] out_mqtt_topic The output #az_span containing the MQTT topic.
+ * @param[out] out_payload The payload of the message. It refers to the queue region, and is valid
+ *                         until the message is committed.
+ * @return #AZ_ERROR_ITEM_NOT_FOUND if all the messages were read.
+ */
+AZ_NODISCARD az_result az_iot_hub_telemetry_queue_read(
+    az_iot_hub_telemetry_queue* queue,
+    az_iot_hub_client const* client,
+    az_span mqtt_topic,
+    az_span* out_mqtt_topic,
+    az_span* out_payload);
+
+/**
+ * @brief Removes the messages read so far from the queue, and persists the read position.
+ *
+ * @param[in,out] queue The #az_iot_hub_telemetry_queue to use for this call.
+ */
+void az_iot_hub_telemetry_queue_commit(az_iot_hub_telemetry_queue* queue);
+
+/**
+ * @brief Makes the messages read since the last commit readable again, e.g. after a disconnection.
+ *
+ * @param[in,out] queue The #az_iot_hub_telemetry_queue to use for this call.
+ */
+void az_iot_hub_telemetry_queue_rewind(az_iot_hub_telemetry_queue* queue);
+
+/**
+ * @brief Gets the number of messages in the queue, read or not.
+ *
+ * @param[in] queue The #az_iot_hub_telemetry_queue to use for this call.
+ * @return The number of messages not committed.
+ */
+AZ_NODISCARD AZ_INLINE int32_t
+az_iot_hub_telemetry_queue_count(az_iot_hub_telemetry_queue const* queue)
+{
+  return queue->_internal.count;
+}
+
+#include <_az_cfg_suffix.h>
+
+#endif // _az_IOT_HUB_TELEMETRY_QUEUE_H
@@ -0,0 +1,190 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file az_iot_hub_twin.h
+ *
+ * @brief Incremental Azure IoT Hub twin properties.
+ *
+ * @details The desired or reported properties of a twin are kept as a table of leaf properties,
+ *          sorted by name, whose raw JSON values are stored in a buffer provided by the
+ *          application. Nested properties are named by their path, with members separated by '.',
+ *          which twin property names cannot contain: `{"a":{"b":1}}` holds the property `a.b`.
+ *
+ *          Desired property patches are merged into the table as they are received, as JSON merge
+ *          patches (RFC 7386), and the changed properties can then be listed. Reported properties
+ *          are set one by one, and only those whose value changed are sent by the next reported
+ *          properties patch.
+ */
+
+#ifndef _az_IOT_HUB_TWIN_H
+#define _az_IOT_HUB_TWIN_H
+
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <_az_cfg_prefix.h>
+
+enum
+{
+  AZ_IOT_HUB_TWIN_NAME_MAX_SIZE = 256, /**< The maximum length of a property path. */
+};
+
+/**
+ * @brief A leaf property of an #az_iot_hub_twin_properties.
+ *
+ */
+typedef struct az_iot_hub_twin_property
+{
+  struct
+  {
+    az_span name;
+    az_span value; // Raw JSON value, `null` until the removal of the property is cleared.
+    bool changed;
+  } _internal;
+} az_iot_hub_twin_property;
+
+/**
+ * @brief The desired or reported properties of a twin.
+ *
+ */
+typedef struct az_iot_hub_twin_properties
+{
+  struct
+  {
+    az_iot_hub_twin_property* properties; // Sorted by name.
+    int32_t capacity;
+    int32_t count;
+    az_span buffer; // Names and values. Its length is the size in use.
+    int64_t version;
+  } _internal;
+} az_iot_hub_twin_properties;
+
+/**
+ * @brief Initializes empty twin properties.
+ *
+ * @param[out] properties The #az_iot_hub_twin_properties to initialize.
+ * @param[in] entries The storage of the properties table.
+ * @param[in] entries_length The number of entries: up to 1 entry per leaf property.
+ * @param[in] buffer The storage of the property names and values. Space left by changed values is
+ *                   reclaimed when the buffer is full.
+ * @return #az_result
+ */
+AZ_NODISCARD az_result az_iot_hub_twin_properties_init(
+    az_iot_hub_twin_properties* properties,
+    az_iot_hub_twin_property* entries,
+    int32_t entries_length,
+    az_span buffer);
+
+/**
+ * @brief Replaces the properties with a section of a full twin document, as received in response
+ *        to a twin GET request.
+ * @details All the properties are marked as changed.
+ *
+ * @param[in,out] properties The #az_iot_hub_twin_properties to use for this call.
+ * @param[in] twin_document The twin document, e.g. `{"desired":{...},"reported":{...}}`.
+ * @param[in] section The member of the document holding the properties: `desired` or `reported`.
+ * @return #AZ_ERROR_ITEM_NOT_FOUND if the document has no such section.
+ */
+AZ_NODISCARD az_result az_iot_hub_twin_properties_apply_document(
+    az_iot_hub_twin_properties* properties,
+    az_span twin_document,
+    az_span section);
+
+/**
+ * @brief Merges a patch, as received on the desired properties topic, into the properties.
+ * @details Properties set to `null` are removed, objects are merged member by member, and any
+ *          other value replaces the property. The properties whose value changed are marked as
+ *          changed. The `$version` of the patch becomes the version of the properties.
+ *
+ * @param[in,out] properties The #az_iot_hub_twin_properties to use for this call.
+ * @param[in] patch The JSON patch.
+ * @return #AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY if the properties table or buffer is full. The
+ *         properties may then be partially patched.
+ */
+AZ_NODISCARD az_result
+az_iot_hub_twin_properties_apply_patch(az_iot_hub_twin_properties* properties, az_span patch);
+
+/**
+ * @brief Gets the value of a property.
+ *
+ * @param[in] properties The #az_iot_hub_twin_properties to use for this call.
+ * @param[in] name The path of the property, e.g. `config.rate`.
+ * @param[out] out_value The raw JSON value of the property, e.g. `42` or `"on"`.
+ * @return #AZ_ERROR_ITEM_NOT_FOUND if the property doesn't exist.
+ */
+AZ_NODISCARD az_result az_iot_hub_twin_properties_get(
+    az_iot_hub_twin_properties const* properties,
+    az_span name,
+    az_span* out_value);
+
+/**
+ * @brief Sets the value of a property. The property is only marked as changed if its value is
+ *        different.
+ *
+ * @param[in,out] properties The #az_iot_hub_twin_properties to use for this call.
+ * @param[in] name The path of the property, e.g. `config.rate`. Names are not escaped.
+ * @param[in] value The raw JSON value of the property, e.g. `42` or `"on"`, or `null` to remove
+ *                  it.
+ * @return #AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY if the properties table or buffer is full.
+ */
+AZ_NODISCARD az_result az_iot_hub_twin_properties_set(
+    az_iot_hub_twin_properties* properties,
+    az_span name,
+    az_span value);
+
+/**
+ * @brief Iterates over the changed properties.
+ *
+ * @param[in] properties The #az_iot_hub_twin_properties to use for this call.
+ * @param[in,out] iterator Where the iteration resumes. Set it to 0 to start.
+ * @param[out] out_name The path of the changed property.
+ * @param[out] out_value The raw JSON value of the property, `null` if it was removed.
+ * @return #AZ_ERROR_ITEM_NOT_FOUND once all the changed properties were listed.
+ */
+AZ_NODISCARD az_result az_iot_hub_twin_properties_next_change(
+    az_iot_hub_twin_properties const* properties,
+    int32_t* iterator,
+    az_span* out_name,
+    az_span* out_value);
+
+/**
+ * @brief Gets the reported properties patch holding only the changed properties, to be published
+ *        on the topic from #az_iot_hub_client_twin_patch_publish_topic_get.
+ *
+ * @param[in] properties The #az_iot_hub_twin_properties to use for this call.
+ * @param[in] json An empty #az_span with sufficient capacity to hold the JSON patch.
+ * @param[out] out_json The output #az_span containing the JSON patch.
+ * @return #az_result
+ */
+AZ_NODISCARD az_result az_iot_hub_twin_properties_patch_get(
+    az_iot_hub_twin_properties const* properties,
+    az_span json,
+    az_span* out_json);
+
+/**
+ * @brief Marks all the properties as unchanged, e.g. once a patch is acknowledged or the desired
+ *        property changes are handled, and forgets the removed properties.
+ *
+ * @param[in,out] properties The #az_iot_hub_twin_properties to use for this call.
+ */
+void az_iot_hub_twin_properties_changes_clear(az_iot_hub_twin_properties* properties);
+
+/**
+ * @brief Gets the version of the properties, from the last desired properties patch or document.
+ *
+ * @param[in] properties The #az_iot_hub_twin_properties to use for this call.
+ * @return The `$version` of the properties, or 0 if unknown.
+ */
+AZ_NODISCARD AZ_INLINE int64_t
+az_iot_hub_twin_properties_get_version(az_iot_hub_twin_properties const* properties)
+{
+  return properties->_internal.version;
+}
+
+#include <_az_cfg_suffix.h>
+
+#endif // _az_IOT_HUB_TWIN_H
@@ -54,6 +54,100 @@ az_result az_iot_sas_token_get_document(az_span iothub_fqdn, az_span device_id,
  */
 az_result az_iot_sas_token_generate(az_span iothub_fqdn, az_span device_id, az_span signature, int32_t expiry_time_secs, az_span key_name, az_span sas_token, az_span* out_sas_token);
 
+enum
+{
+  AZ_IOT_SAS_TOKEN_KEY_MAX_SIZE = 128,
+  // A Base64 encoded 32 byte HMAC is 44 characters, each of which may be URL encoded as 3.
+  AZ_IOT_SAS_TOKEN_SIGNATURE_MAX_SIZE = 44 * 3,
+};
+
+/**
+ * @brief Signs a SAS token document with HMAC-SHA256, using the built-in implementation.
+ * @details Computes the signature expected by az_iot_sas_token_generate(): the document is signed
+ *          with the Base64 decoded \p key, and the result is Base64 then URL encoded.
+ *
+ * @param[in] key The Base64 encoded shared access key. Decoded keys of up to
+ *                #AZ_IOT_SAS_TOKEN_KEY_MAX_SIZE bytes are supported.
+ * @param[in] document The document obtained from az_iot_sas_token_get_document().
+ * @param[in] signature An #az_span with capacity for #AZ_IOT_SAS_TOKEN_SIGNATURE_MAX_SIZE bytes.
+ * @param[out] out_signature The output #az_span containing the signature.
+ * @return #AZ_ERROR_PARSER_UNEXPECTED_CHAR if \p key is not valid Base64.
+ */
+AZ_NODISCARD az_result
+az_iot_sas_token_sign(az_span key, az_span document, az_span signature, az_span* out_signature);
+
+/**
+ * @brief A SAS token that is only regenerated when it is about to expire.
+ *
+ */
+typedef struct az_iot_sas_token_cache
+{
+  struct
+  {
+    az_span iothub_fqdn;
+    az_span device_id;
+    az_span key;
+    az_span key_name;
+    az_span sas_token;
+    int32_t lifetime_secs;
+    int32_t refresh_secs;
+    int32_t expiry_time_secs;
+  } _internal;
+} az_iot_sas_token_cache;
+
+/**
+ * @brief Initializes a SAS token cache. No token is generated until az_iot_sas_token_cache_get().
+ *
+ * @param[out] cache The #az_iot_sas_token_cache to initialize.
+ * @param[in] iothub_fqdn The FQDN of the Azure IoT Hub.
+ * @param[in] device_id The device id.
+ * @param[in] key The Base64 encoded shared access key, see az_iot_sas_token_sign().
+ * @param[in] key_name The key name, or #AZ_SPAN_NULL.
+ * @param[in] lifetime_secs How long each generated token is valid.
+ * @param[in] refresh_secs How long before expiry a token is regenerated. Must be less than
+ *                         \p lifetime_secs.
+ * @param[in] sas_token_buffer The buffer holding the token. The document to sign is also built in
+ *                             it.
+ * @return #az_result
+ */
+AZ_NODISCARD az_result az_iot_sas_token_cache_init(
+    az_iot_sas_token_cache* cache,
+    az_span iothub_fqdn,
+    az_span device_id,
+    az_span key,
+    az_span key_name,
+    int32_t lifetime_secs,
+    int32_t refresh_secs,
+    az_span sas_token_buffer);
+
+/**
+ * @brief Gets a SAS token valid for at least the refresh time after \p current_time_secs,
+ *        generating a new one only if the cached one is about to expire.
+ *
+ * @param[in,out] cache The #az_iot_sas_token_cache to use for this call.
+ * @param[in] current_time_secs The current time, in seconds since UNIX epoch (1970).
+ * @param[out] out_sas_token The SAS token. It is valid until the next call that regenerates it.
+ * @return #az_result
+ */
+AZ_NODISCARD az_result az_iot_sas_token_cache_get(
+    az_iot_sas_token_cache* cache,
+    int32_t current_time_secs,
+    az_span* out_sas_token);
+
+/**
+ * @brief Gets the time from which az_iot_sas_token_cache_get() regenerates the token.
+ *
+ * @param[in] cache The #az_iot_sas_token_cache to use for this call.
+ * @return The time in seconds since UNIX epoch, or 0 if no token was generated yet.
+ */
+AZ_NODISCARD AZ_INLINE int32_t
+az_iot_sas_token_cache_get_refresh_time(az_iot_sas_token_cache const* cache)
+{
+  return cache->_internal.expiry_time_secs == 0
+      ? 0
+      : cache->_internal.expiry_time_secs - cache->_internal.refresh_secs;
+}
+
 #include <_az_cfg_suffix.h>
 
 #endif // _az_IOT_SAS_TOKEN_H
@@ -2,6 +2,9 @@
 // SPDX-License-Identifier: MIT
 
 #include "az_iot_hub_client.h"
+#include "az_iot_telemetry_private.h"
+#include <az_precondition_internal.h>
+#include <az_result.h>
 #include <az_span.h>
 
 #include <_az_cfg.h>
@@ -10,3 +13,22 @@ AZ_NODISCARD az_iot_hub_client_options az_iot_hub_client_options_default()
 {
   return (az_iot_hub_client_options){ .module_id = AZ_SPAN_NULL, .user_agent = AZ_SPAN_NULL };
 }
+
+AZ_NODISCARD az_result az_iot_hub_client_init(
+    az_iot_hub_client* client,
+    az_span iot_hub_hostname,
+    az_span device_id,
+    az_iot_hub_client_options const* options)
+{
+  AZ_PRECONDITION_NOT_NULL(client);
+  AZ_PRECONDITION_VALID_SPAN(iot_hub_hostname, 1, false);
+  AZ_PRECONDITION_VALID_SPAN(device_id, 1, false);
+
+  client->_internal.iot_hub_hostname = iot_hub_hostname;
+  client->_internal.device_id = device_id;
+  client->_internal.options = options == NULL ? az_iot_hub_client_options_default() : *options;
+
+  _az_iot_hub_client_telemetry_topic_prefix_init(client);
+
+  return AZ_OK;
+}
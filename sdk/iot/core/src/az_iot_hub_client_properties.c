@@ -0,0 +1,293 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "az_iot_hub_client.h"
+#include <az_precondition.h>
+#include <az_precondition_internal.h>
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <_az_cfg.h>
+
+static const uint8_t hub_client_param_delim = '?';
+static const uint8_t hub_client_param_separator = '&';
+static const uint8_t hub_client_param_equals = '=';
+static const az_span hub_client_param_delimiters = AZ_SPAN_LITERAL_FROM_STR("=&");
+
+AZ_NODISCARD az_result
+az_iot_hub_client_properties_init(az_iot_hub_client_properties* properties, az_span buffer)
+{
+  AZ_PRECONDITION_NOT_NULL(properties);
+  AZ_PRECONDITION_VALID_SPAN(buffer, 0, true);
+
+  // The delimiter belongs to the topic, not to the properties.
+  if (az_span_length(buffer) > 0 && az_span_ptr(buffer)[0] == hub_client_param_delim)
+  {
+    buffer = az_span_init(
+        az_span_ptr(buffer) + 1, az_span_length(buffer) - 1, az_span_capacity(buffer) - 1);
+  }
+
+  *properties = (az_iot_hub_client_properties){
+    ._internal = {
+      .properties = buffer,
+      .current_property = az_span_ptr(buffer),
+      .index = NULL,
+      .index_capacity = 0,
+      .index_count = 0,
+    },
+  };
+
+  return AZ_OK;
+}
+
+// FNV-1a
+static uint32_t _az_iot_hub_client_properties_hash(az_span key)
+{
+  uint8_t const* const ptr = az_span_ptr(key);
+  uint32_t hash = 2166136261u;
+  for (int32_t i = 0; i < az_span_length(key); ++i)
+  {
+    hash = (hash ^ ptr[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static az_span _az_iot_hub_client_properties_index_key(
+    az_iot_hub_client_properties const* properties,
+    az_iot_hub_client_properties_index_entry const* entry)
+{
+  int32_t const offset = entry->_internal.key_offset;
+  return az_span_slice(
+      properties->_internal.properties, offset, offset + entry->_internal.key_length);
+}
+
+// Indexes a property of the buffer. Returns false if it cannot be indexed.
+static bool _az_iot_hub_client_properties_index_add(
+    az_iot_hub_client_properties* properties,
+    az_pair const* property)
+{
+  int16_t const capacity = properties->_internal.index_capacity;
+  int16_t const position = properties->_internal.index_count;
+  uint8_t* const base = az_span_ptr(properties->_internal.properties);
+
+  if (position >= capacity || az_span_length(properties->_internal.properties) > UINT16_MAX)
+  {
+    return false;
+  }
+
+  az_iot_hub_client_properties_index_entry* const index = properties->_internal.index;
+  index[position]._internal.key_offset = (uint16_t)(az_span_ptr(property->key) - base);
+  index[position]._internal.key_length = (uint16_t)az_span_length(property->key);
+  index[position]._internal.value_offset = (uint16_t)(az_span_ptr(property->value) - base);
+  index[position]._internal.value_length = (uint16_t)az_span_length(property->value);
+
+  // Linear probing. There is always an empty slot, as there are as many slots as entries. Since
+  // entries are never removed, the first of several properties with the same name is always found
+  // first.
+  int32_t slot = (int32_t)(_az_iot_hub_client_properties_hash(property->key) % (uint32_t)capacity);
+  while (index[slot]._internal.slot >= 0)
+  {
+    slot = (slot + 1) % capacity;
+  }
+  index[slot]._internal.slot = position;
+
+  ++properties->_internal.index_count;
+  return true;
+}
+
+static void _az_iot_hub_client_properties_index_drop(az_iot_hub_client_properties* properties)
+{
+  properties->_internal.index = NULL;
+  properties->_internal.index_capacity = 0;
+  properties->_internal.index_count = 0;
+}
+
+AZ_NODISCARD az_result az_iot_hub_client_properties_append(
+    az_iot_hub_client_properties* properties,
+    az_span name,
+    az_span value)
+{
+  AZ_PRECONDITION_NOT_NULL(properties);
+  AZ_PRECONDITION_VALID_SPAN(name, 1, false);
+  AZ_PRECONDITION_VALID_SPAN(value, 1, false);
+
+  az_span* const buffer = &properties->_internal.properties;
+  int32_t const separator_length = az_span_length(*buffer) > 0 ? 1 : 0;
+
+  // Only append if the whole property fits, so that a failure leaves the properties unchanged.
+  if (az_span_capacity(*buffer) - az_span_length(*buffer)
+      < separator_length + az_span_length(name) + 1 + az_span_length(value))
+  {
+    return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+  }
+
+  if (separator_length > 0)
+  {
+    AZ_RETURN_IF_FAILED(az_span_append_uint8(*buffer, hub_client_param_separator, buffer));
+  }
+
+  int32_t const name_offset = az_span_length(*buffer);
+  AZ_RETURN_IF_FAILED(az_span_append(*buffer, name, buffer));
+  AZ_RETURN_IF_FAILED(az_span_append_uint8(*buffer, hub_client_param_equals, buffer));
+  int32_t const value_offset = az_span_length(*buffer);
+  AZ_RETURN_IF_FAILED(az_span_append(*buffer, value, buffer));
+
+  if (properties->_internal.index != NULL)
+  {
+    az_pair const property = {
+      .key = az_span_slice(*buffer, name_offset, name_offset + az_span_length(name)),
+      .value = az_span_slice(*buffer, value_offset, value_offset + az_span_length(value)),
+    };
+    if (!_az_iot_hub_client_properties_index_add(properties, &property))
+    {
+      _az_iot_hub_client_properties_index_drop(properties);
+    }
+  }
+
+  return AZ_OK;
+}
+
+// Reads the property starting at offset, and returns the offset of the next one.
+static int32_t _az_iot_hub_client_properties_read(az_span properties, int32_t offset, az_pair* out)
+{
+  int32_t const length = az_span_length(properties);
+
+  // The name ends at the first '=' or '&', and the value at the next '&'.
+  int32_t equals
+      = az_span_find_any(az_span_slice(properties, offset, length), hub_client_param_delimiters);
+  equals = equals == -1 ? length : offset + equals;
+
+  int32_t end
+      = az_span_find_byte(az_span_slice(properties, equals, length), hub_client_param_separator);
+  end = end == -1 ? length : equals + end;
+
+  out->key = az_span_slice(properties, offset, equals);
+  out->value = equals < end ? az_span_slice(properties, equals + 1, end) : AZ_SPAN_NULL;
+
+  return end < length ? end + 1 : length;
+}
+
+AZ_NODISCARD az_result az_iot_hub_client_properties_index_init(
+    az_iot_hub_client_properties* properties,
+    az_iot_hub_client_properties_index_entry* entries,
+    int16_t entries_length)
+{
+  AZ_PRECONDITION_NOT_NULL(properties);
+  AZ_PRECONDITION_NOT_NULL(entries);
+  AZ_PRECONDITION(entries_length > 0);
+
+  for (int16_t i = 0; i < entries_length; ++i)
+  {
+    entries[i]._internal.slot = -1;
+  }
+
+  properties->_internal.index = entries;
+  properties->_internal.index_capacity = entries_length;
+  properties->_internal.index_count = 0;
+
+  az_span const buffer = properties->_internal.properties;
+  int32_t const length = az_span_length(buffer);
+
+  for (int32_t offset = 0; offset < length;)
+  {
+    az_pair property = { 0 };
+    offset = _az_iot_hub_client_properties_read(buffer, offset, &property);
+
+    // A property without value is indexed with an empty value right after its name.
+    if (az_span_ptr(property.value) == NULL)
+    {
+      property.value = az_span_init(
+          az_span_ptr(property.key) + az_span_length(property.key), 0, 0);
+    }
+
+    if (!_az_iot_hub_client_properties_index_add(properties, &property))
+    {
+      _az_iot_hub_client_properties_index_drop(properties);
+      return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+    }
+  }
+
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_iot_hub_client_properties_find(
+    az_iot_hub_client_properties* properties,
+    az_span name,
+    az_span* out_value)
+{
+  AZ_PRECONDITION_NOT_NULL(properties);
+  AZ_PRECONDITION_VALID_SPAN(name, 1, false);
+  AZ_PRECONDITION_NOT_NULL(out_value);
+
+  az_iot_hub_client_properties_index_entry const* const index = properties->_internal.index;
+  if (index != NULL)
+  {
+    int32_t const capacity = properties->_internal.index_capacity;
+    int32_t slot = (int32_t)(_az_iot_hub_client_properties_hash(name) % (uint32_t)capacity);
+    for (int32_t probes = 0; probes < capacity && index[slot]._internal.slot >= 0; ++probes)
+    {
+      az_iot_hub_client_properties_index_entry const* const entry
+          = &index[index[slot]._internal.slot];
+      if (az_span_is_content_equal(
+              _az_iot_hub_client_properties_index_key(properties, entry), name))
+      {
+        // A property without value was indexed with its value right after its name, where the
+        // '=' would be otherwise. Like the scan below, it has no value.
+        int32_t const value_offset = entry->_internal.value_offset;
+        *out_value = value_offset == entry->_internal.key_offset + entry->_internal.key_length
+            ? AZ_SPAN_NULL
+            : az_span_slice(
+                properties->_internal.properties,
+                value_offset,
+                value_offset + entry->_internal.value_length);
+        return AZ_OK;
+      }
+      slot = (slot + 1) % capacity;
+    }
+
+    return AZ_ERROR_ITEM_NOT_FOUND;
+  }
+
+  az_span const buffer = properties->_internal.properties;
+  int32_t const length = az_span_length(buffer);
+
+  for (int32_t offset = 0; offset < length;)
+  {
+    az_pair property = { 0 };
+    offset = _az_iot_hub_client_properties_read(buffer, offset, &property);
+    if (az_span_is_content_equal(property.key, name))
+    {
+      *out_value = property.value;
+      return AZ_OK;
+    }
+  }
+
+  return AZ_ERROR_ITEM_NOT_FOUND;
+}
+
+AZ_NODISCARD az_result
+az_iot_hub_client_properties_next(az_iot_hub_client_properties* properties, az_pair* out)
+{
+  AZ_PRECONDITION_NOT_NULL(properties);
+  AZ_PRECONDITION_NOT_NULL(out);
+
+  az_span const buffer = properties->_internal.properties;
+  if (properties->_internal.current_property == NULL)
+  {
+    return AZ_ERROR_EOF;
+  }
+
+  int32_t const offset = (int32_t)(properties->_internal.current_property - az_span_ptr(buffer));
+  if (offset >= az_span_length(buffer))
+  {
+    return AZ_ERROR_EOF;
+  }
+
+  int32_t const next = _az_iot_hub_client_properties_read(buffer, offset, out);
+  properties->_internal.current_property = az_span_ptr(buffer) + next;
+
+  return AZ_OK;
+}
@@ -0,0 +1,271 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "az_iot_hub_client.h"
+#include <az_precondition.h>
+#include <az_precondition_internal.h>
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <_az_cfg.h>
+
+static const az_span hub_topic_prefix = AZ_SPAN_LITERAL_FROM_STR("$iothub/");
+static const az_span methods_topic_mid = AZ_SPAN_LITERAL_FROM_STR("methods/POST/");
+static const az_span twin_response_topic_mid = AZ_SPAN_LITERAL_FROM_STR("twin/res/");
+static const az_span twin_patch_topic_mid
+    = AZ_SPAN_LITERAL_FROM_STR("twin/PATCH/properties/desired");
+static const az_span c2d_topic_prefix = AZ_SPAN_LITERAL_FROM_STR("devices/");
+static const az_span c2d_topic_suffix = AZ_SPAN_LITERAL_FROM_STR("/messages/devicebound/");
+static const az_span topic_query_prefix = AZ_SPAN_LITERAL_FROM_STR("/?");
+static const az_span request_id_name = AZ_SPAN_LITERAL_FROM_STR("$rid");
+static const az_span version_name = AZ_SPAN_LITERAL_FROM_STR("$version");
+
+// Consumes prefix from the start of topic, if topic starts with it.
+static bool _az_iot_topic_consume(az_span* topic, az_span prefix)
+{
+  int32_t const prefix_length = az_span_length(prefix);
+  if (az_span_length(*topic) < prefix_length
+      || !az_span_is_content_equal(az_span_slice(*topic, 0, prefix_length), prefix))
+  {
+    return false;
+  }
+
+  *topic = az_span_slice(*topic, prefix_length, az_span_length(*topic));
+  return true;
+}
+
+// Consumes topic up to the next '/', and returns the consumed segment.
+static az_span _az_iot_topic_consume_segment(az_span* topic)
+{
+  int32_t const length = az_span_length(*topic);
+
+  int32_t end = az_span_find_byte(*topic, '/');
+  end = end == -1 ? length : end;
+
+  az_span const segment = az_span_slice(*topic, 0, end);
+  *topic = az_span_slice(*topic, end, length);
+  return segment;
+}
+
+// Reads the "$rid" and "$version" properties of the "/?..." topic query.
+static AZ_NODISCARD az_result
+_az_iot_topic_query_parse(az_span topic, az_span* out_request_id, az_span* out_version)
+{
+  if (!_az_iot_topic_consume(&topic, topic_query_prefix))
+  {
+    return AZ_ERROR_IOT_TOPIC_NO_MATCH;
+  }
+
+  az_iot_hub_client_properties query;
+  AZ_RETURN_IF_FAILED(az_iot_hub_client_properties_init(&query, topic));
+
+  *out_request_id = AZ_SPAN_NULL;
+  *out_version = AZ_SPAN_NULL;
+
+  az_pair property;
+  while (az_succeeded(az_iot_hub_client_properties_next(&query, &property)))
+  {
+    if (az_span_is_content_equal(property.key, request_id_name))
+    {
+      *out_request_id = property.value;
+    }
+    else if (az_span_is_content_equal(property.key, version_name))
+    {
+      *out_version = property.value;
+    }
+  }
+
+  return AZ_OK;
+}
+
+// "methods/POST/{method name}/?$rid={request id}"
+static AZ_NODISCARD az_result
+_az_iot_hub_client_method_topic_parse(az_span topic, az_iot_hub_client_method_request* out_request)
+{
+  az_span const name = _az_iot_topic_consume_segment(&topic);
+  az_span request_id;
+  az_span version;
+  AZ_RETURN_IF_FAILED(_az_iot_topic_query_parse(topic, &request_id, &version));
+
+  if (az_span_length(name) == 0 || az_span_length(request_id) == 0)
+  {
+    return AZ_ERROR_IOT_TOPIC_NO_MATCH;
+  }
+
+  out_request->name = name;
+  out_request->request_id = request_id;
+  return AZ_OK;
+}
+
+// "twin/res/{status}/?$rid={request id}[&$version={version}]"
+static AZ_NODISCARD az_result _az_iot_hub_client_twin_response_topic_parse(
+    az_span topic,
+    az_iot_hub_client_twin_response* out_response)
+{
+  az_span const status_span = _az_iot_topic_consume_segment(&topic);
+  uint32_t status = 0;
+  if (az_failed(az_span_to_uint32(status_span, &status)))
+  {
+    return AZ_ERROR_IOT_TOPIC_NO_MATCH;
+  }
+
+  az_span request_id;
+  az_span version;
+  AZ_RETURN_IF_FAILED(_az_iot_topic_query_parse(topic, &request_id, &version));
+
+  out_response->response_type = status == AZ_IOT_HUB_CLIENT_STATUS_NO_CONTENT
+      ? AZ_IOT_CLIENT_TWIN_RESPONSE_TYPE_REPORTED_PROPERTIES
+      : AZ_IOT_CLIENT_TWIN_RESPONSE_TYPE_GET;
+  out_response->status = (az_iot_hub_client_status)status;
+  out_response->request_id = request_id;
+  out_response->version = version;
+  return AZ_OK;
+}
+
+// "twin/PATCH/properties/desired/?$version={version}"
+static AZ_NODISCARD az_result _az_iot_hub_client_twin_patch_topic_parse(
+    az_span topic,
+    az_iot_hub_client_twin_response* out_response)
+{
+  az_span request_id;
+  az_span version;
+  AZ_RETURN_IF_FAILED(_az_iot_topic_query_parse(topic, &request_id, &version));
+
+  out_response->response_type = AZ_IOT_CLIENT_TWIN_RESPONSE_TYPE_DESIRED_PROPERTIES;
+  out_response->status = AZ_IOT_HUB_CLIENT_STATUS_OK;
+  out_response->request_id = request_id;
+  out_response->version = version;
+  return AZ_OK;
+}
+
+// "devices/{device id}/messages/devicebound/{properties}"
+static AZ_NODISCARD az_result _az_iot_hub_client_c2d_topic_parse(
+    az_iot_hub_client const* client,
+    az_span topic,
+    az_iot_hub_client_c2d_request* out_request)
+{
+  if (!_az_iot_topic_consume(&topic, client->_internal.device_id)
+      || !_az_iot_topic_consume(&topic, c2d_topic_suffix))
+  {
+    return AZ_ERROR_IOT_TOPIC_NO_MATCH;
+  }
+
+  return az_iot_hub_client_properties_init(&out_request->properties, topic);
+}
+
+AZ_NODISCARD az_result az_iot_hub_client_received_topic_parse(
+    az_iot_hub_client const* client,
+    az_span received_topic,
+    az_iot_hub_client_received_topic* out_topic)
+{
+  AZ_PRECONDITION_NOT_NULL(client);
+  AZ_PRECONDITION_VALID_SPAN(received_topic, 1, false);
+  AZ_PRECONDITION_NOT_NULL(out_topic);
+
+  az_span topic = received_topic;
+
+  // Every prefix is compared at most once: the topic kinds are told apart by a single character
+  // after the common prefixes.
+  if (_az_iot_topic_consume(&topic, hub_topic_prefix))
+  {
+    switch (az_span_length(topic) > 5 ? az_span_ptr(topic)[5] : 0)
+    {
+      case 'd': // methods/
+        if (_az_iot_topic_consume(&topic, methods_topic_mid))
+        {
+          out_topic->type = AZ_IOT_HUB_CLIENT_TOPIC_TYPE_METHOD;
+          return _az_iot_hub_client_method_topic_parse(topic, &out_topic->parsed.method);
+        }
+        break;
+
+      case 'r': // twin/res/
+        if (_az_iot_topic_consume(&topic, twin_response_topic_mid))
+        {
+          out_topic->type = AZ_IOT_HUB_CLIENT_TOPIC_TYPE_TWIN;
+          return _az_iot_hub_client_twin_response_topic_parse(topic, &out_topic->parsed.twin);
+        }
+        break;
+
+      case 'P': // twin/PATCH/
+        if (_az_iot_topic_consume(&topic, twin_patch_topic_mid))
+        {
+          out_topic->type = AZ_IOT_HUB_CLIENT_TOPIC_TYPE_TWIN;
+          return _az_iot_hub_client_twin_patch_topic_parse(topic, &out_topic->parsed.twin);
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+  else if (_az_iot_topic_consume(&topic, c2d_topic_prefix))
+  {
+    out_topic->type = AZ_IOT_HUB_CLIENT_TOPIC_TYPE_C2D;
+    return _az_iot_hub_client_c2d_topic_parse(client, topic, &out_topic->parsed.c2d);
+  }
+
+  return AZ_ERROR_IOT_TOPIC_NO_MATCH;
+}
+
+AZ_NODISCARD az_result az_iot_hub_client_c2d_received_topic_parse(
+    az_iot_hub_client const* client,
+    az_span received_topic,
+    az_iot_hub_client_c2d_request* out_request)
+{
+  AZ_PRECONDITION_NOT_NULL(client);
+  AZ_PRECONDITION_VALID_SPAN(received_topic, 1, false);
+  AZ_PRECONDITION_NOT_NULL(out_request);
+
+  az_iot_hub_client_received_topic topic;
+  AZ_RETURN_IF_FAILED(az_iot_hub_client_received_topic_parse(client, received_topic, &topic));
+  if (topic.type != AZ_IOT_HUB_CLIENT_TOPIC_TYPE_C2D)
+  {
+    return AZ_ERROR_IOT_TOPIC_NO_MATCH;
+  }
+
+  *out_request = topic.parsed.c2d;
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_iot_hub_client_methods_received_topic_parse(
+    az_iot_hub_client const* client,
+    az_span received_topic,
+    az_iot_hub_client_method_request* out_request)
+{
+  AZ_PRECONDITION_NOT_NULL(client);
+  AZ_PRECONDITION_VALID_SPAN(received_topic, 1, false);
+  AZ_PRECONDITION_NOT_NULL(out_request);
+
+  az_iot_hub_client_received_topic topic;
+  AZ_RETURN_IF_FAILED(az_iot_hub_client_received_topic_parse(client, received_topic, &topic));
+  if (topic.type != AZ_IOT_HUB_CLIENT_TOPIC_TYPE_METHOD)
+  {
+    return AZ_ERROR_IOT_TOPIC_NO_MATCH;
+  }
+
+  *out_request = topic.parsed.method;
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_iot_hub_client_twin_received_topic_parse(
+    az_iot_hub_client const* client,
+    az_span received_topic,
+    az_iot_hub_client_twin_response* out_twin_response)
+{
+  AZ_PRECONDITION_NOT_NULL(client);
+  AZ_PRECONDITION_VALID_SPAN(received_topic, 1, false);
+  AZ_PRECONDITION_NOT_NULL(out_twin_response);
+
+  az_iot_hub_client_received_topic topic;
+  AZ_RETURN_IF_FAILED(az_iot_hub_client_received_topic_parse(client, received_topic, &topic));
+  if (topic.type != AZ_IOT_HUB_CLIENT_TOPIC_TYPE_TWIN)
+  {
+    return AZ_ERROR_IOT_TOPIC_NO_MATCH;
+  }
+
+  *out_twin_response = topic.parsed.twin;
+  return AZ_OK;
+}
@@ -0,0 +1,236 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "az_iot_hub_gateway.h"
+#include "az_iot_sas_token_private.h"
+#include "az_iot_sha256_private.h"
+#include <az_iot_hub_client.h>
+#include <az_iot_sas_token.h>
+#include <az_precondition.h>
+#include <az_precondition_internal.h>
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <_az_cfg.h>
+
+enum
+{
+  _az_IOT_HUB_GATEWAY_BASE64_KEY_SIZE = (_az_IOT_SHA256_HASH_SIZE + 2) / 3 * 4,
+};
+
+AZ_NODISCARD az_iot_hub_gateway_options az_iot_hub_gateway_options_default()
+{
+  return (az_iot_hub_gateway_options){
+    .group_key = AZ_SPAN_NULL,
+    .sas_lifetime_secs = 60 * 60,
+    .sas_refresh_secs = 5 * 60,
+  };
+}
+
+AZ_NODISCARD az_result az_iot_hub_gateway_init(
+    az_iot_hub_gateway* gateway,
+    az_span iot_hub_hostname,
+    az_iot_hub_gateway_devices devices,
+    az_iot_hub_gateway_options const* options)
+{
+  AZ_PRECONDITION_NOT_NULL(gateway);
+  AZ_PRECONDITION_VALID_SPAN(iot_hub_hostname, 1, false);
+  AZ_PRECONDITION_NOT_NULL(devices.device_ids);
+  AZ_PRECONDITION_NOT_NULL(devices.sas_expiry_times);
+  AZ_PRECONDITION(devices.capacity > 0);
+
+  gateway->_internal.iot_hub_hostname = iot_hub_hostname;
+  gateway->_internal.devices = devices;
+  gateway->_internal.device_count = 0;
+  gateway->_internal.options = options == NULL ? az_iot_hub_gateway_options_default() : *options;
+  gateway->_internal.client_device_index = -1;
+  gateway->_internal.refresh_cursor = 0;
+
+  AZ_PRECONDITION(gateway->_internal.options.sas_lifetime_secs > 0);
+  AZ_PRECONDITION(
+      gateway->_internal.options.sas_refresh_secs >= 0
+      && gateway->_internal.options.sas_refresh_secs
+          < gateway->_internal.options.sas_lifetime_secs);
+
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_iot_hub_gateway_add_device(
+    az_iot_hub_gateway* gateway,
+    az_span device_id,
+    az_span key,
+    int32_t* out_device_index)
+{
+  AZ_PRECONDITION_NOT_NULL(gateway);
+  AZ_PRECONDITION_VALID_SPAN(device_id, 1, false);
+  AZ_PRECONDITION_VALID_SPAN(key, 0, true);
+  AZ_PRECONDITION_NOT_NULL(out_device_index);
+
+  az_iot_hub_gateway_devices const* const devices = &gateway->_internal.devices;
+  int32_t const index = gateway->_internal.device_count;
+
+  if (index >= devices->capacity)
+  {
+    return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+  }
+
+  // Devices without a key of their own sign with a key derived from the group key.
+  bool const has_key = az_span_length(key) > 0;
+  if ((has_key && devices->keys == NULL)
+      || (!has_key && az_span_length(gateway->_internal.options.group_key) == 0))
+  {
+    return AZ_ERROR_ARG;
+  }
+
+  devices->device_ids[index] = device_id;
+  if (devices->keys != NULL)
+  {
+    devices->keys[index] = key;
+  }
+  devices->sas_expiry_times[index] = 0;
+
+  ++gateway->_internal.device_count;
+  *out_device_index = index;
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_iot_hub_client const*
+az_iot_hub_gateway_get_client(az_iot_hub_gateway* gateway, int32_t device_index)
+{
+  AZ_PRECONDITION_NOT_NULL(gateway);
+  AZ_PRECONDITION_RANGE(0, device_index, gateway->_internal.device_count - 1);
+
+  if (gateway->_internal.client_device_index != device_index)
+  {
+    // Cannot fail: the hostname and device id were validated by init and add_device.
+    az_result const result = az_iot_hub_client_init(
+        &gateway->_internal.client,
+        gateway->_internal.iot_hub_hostname,
+        gateway->_internal.devices.device_ids[device_index],
+        NULL);
+    (void)result;
+
+    gateway->_internal.client_device_index = device_index;
+  }
+
+  return &gateway->_internal.client;
+}
+
+// Derives the key of a device from the group key, as the Device Provisioning Service does:
+// Base64(HMAC-SHA256(Base64Decode(group key), device id)).
+static AZ_NODISCARD az_result _az_iot_hub_gateway_derive_key(
+    az_span group_key,
+    az_span device_id,
+    az_span key,
+    az_span* out_key)
+{
+  uint8_t decoded_group_key_buffer[AZ_IOT_SAS_TOKEN_KEY_MAX_SIZE];
+  az_span decoded_group_key = AZ_SPAN_NULL;
+  AZ_RETURN_IF_FAILED(_az_iot_base64_decode(
+      AZ_SPAN_FROM_BUFFER(decoded_group_key_buffer), group_key, &decoded_group_key));
+
+  uint8_t hmac[_az_IOT_SHA256_HASH_SIZE];
+  _az_iot_hmac_sha256(decoded_group_key, device_id, hmac);
+
+  return _az_iot_base64_encode(key, AZ_SPAN_FROM_INITIALIZED_BUFFER(hmac), out_key);
+}
+
+AZ_NODISCARD az_result az_iot_hub_gateway_sas_token_get(
+    az_iot_hub_gateway* gateway,
+    int32_t device_index,
+    int32_t current_time_secs,
+    az_span sas_token,
+    az_span* out_sas_token)
+{
+  AZ_PRECONDITION_NOT_NULL(gateway);
+  AZ_PRECONDITION_RANGE(0, device_index, gateway->_internal.device_count - 1);
+  AZ_PRECONDITION(current_time_secs > 0);
+  AZ_PRECONDITION_VALID_SPAN(sas_token, 0, false);
+  AZ_PRECONDITION_NOT_NULL(out_sas_token);
+
+  az_iot_hub_gateway_devices const* const devices = &gateway->_internal.devices;
+  az_span const device_id = devices->device_ids[device_index];
+
+  uint8_t derived_key_buffer[_az_IOT_HUB_GATEWAY_BASE64_KEY_SIZE];
+  az_span key = devices->keys == NULL ? AZ_SPAN_NULL : devices->keys[device_index];
+  if (az_span_length(key) == 0)
+  {
+    AZ_RETURN_IF_FAILED(_az_iot_hub_gateway_derive_key(
+        gateway->_internal.options.group_key,
+        device_id,
+        AZ_SPAN_FROM_BUFFER(derived_key_buffer),
+        &key));
+  }
+
+  int32_t const expiry_time_secs = current_time_secs + gateway->_internal.options.sas_lifetime_secs;
+  AZ_RETURN_IF_FAILED(_az_iot_sas_token_generate_signed(
+      gateway->_internal.iot_hub_hostname,
+      device_id,
+      key,
+      AZ_SPAN_NULL,
+      expiry_time_secs,
+      sas_token,
+      out_sas_token));
+
+  devices->sas_expiry_times[device_index] = expiry_time_secs;
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_iot_hub_gateway_sas_next_refresh(
+    az_iot_hub_gateway* gateway,
+    int32_t current_time_secs,
+    int32_t* out_device_index)
+{
+  AZ_PRECONDITION_NOT_NULL(gateway);
+  AZ_PRECONDITION_NOT_NULL(out_device_index);
+
+  int32_t const* const expiry_times = gateway->_internal.devices.sas_expiry_times;
+  int32_t const device_count = gateway->_internal.device_count;
+  int32_t const refresh_secs = gateway->_internal.options.sas_refresh_secs;
+
+  int32_t index = gateway->_internal.refresh_cursor;
+  for (int32_t visited = 0; visited < device_count; ++visited)
+  {
+    if (index >= device_count)
+    {
+      index = 0;
+    }
+
+    if (expiry_times[index] == 0 || current_time_secs >= expiry_times[index] - refresh_secs)
+    {
+      gateway->_internal.refresh_cursor = index + 1;
+      *out_device_index = index;
+      return AZ_OK;
+    }
+
+    ++index;
+  }
+
+  return AZ_ERROR_ITEM_NOT_FOUND;
+}
+
+AZ_NODISCARD int32_t az_iot_hub_gateway_sas_next_refresh_time(az_iot_hub_gateway const* gateway)
+{
+  AZ_PRECONDITION_NOT_NULL(gateway);
+
+  int32_t const* const expiry_times = gateway->_internal.devices.sas_expiry_times;
+  int32_t const device_count = gateway->_internal.device_count;
+
+  int32_t earliest = INT32_MAX;
+  for (int32_t i = 0; i < device_count; ++i)
+  {
+    if (expiry_times[i] == 0)
+    {
+      return 0;
+    }
+    if (expiry_times[i] < earliest)
+    {
+      earliest = expiry_times[i];
+    }
+  }
+
+  return earliest == INT32_MAX ? earliest : earliest - gateway->_internal.options.sas_refresh_secs;
+}
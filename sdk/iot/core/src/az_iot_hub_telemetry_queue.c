@@ -0,0 +1,422 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "az_iot_hub_telemetry_queue.h"
+#include <az_iot_hub_client.h>
+#include <az_precondition.h>
+#include <az_precondition_internal.h>
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <_az_cfg.h>
+
+// Region layout, little-endian:
+//   magic (4) | capacity (4) | generation (4) | unused (4)
+//   | 2 x { read position (8) | checksum (4) | unused (4) } | ring
+// Record layout, aligned to 4 bytes in the ring:
+//   length (4) | checksum (4) | properties length (2) | properties | payload
+// Positions increase forever: the offset of a record in the ring is its position modulo the
+// capacity. The generation changes each time the region is formatted, so that the records of a
+// previous format aren't taken for new ones. A record never wraps: the end of the ring is skipped,
+// and marked with a padding record when it has room for a record header.
+
+static const uint32_t telemetry_queue_magic = 0x51544941; // "AITQ"
+static const uint32_t telemetry_queue_padding_length = UINT32_MAX;
+static const uint16_t telemetry_queue_no_properties = UINT16_MAX;
+
+enum
+{
+  _az_IOT_HUB_TELEMETRY_QUEUE_SLOT_OFFSET = 16,
+  _az_IOT_HUB_TELEMETRY_QUEUE_SLOT_SIZE = 16,
+  _az_IOT_HUB_TELEMETRY_QUEUE_PROPERTIES_LENGTH_SIZE = 2,
+};
+
+static uint32_t _az_iot_hub_telemetry_queue_load32(uint8_t const* ptr)
+{
+  return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) | ((uint32_t)ptr[2] << 16)
+      | ((uint32_t)ptr[3] << 24);
+}
+
+static void _az_iot_hub_telemetry_queue_store32(uint8_t* ptr, uint32_t value)
+{
+  ptr[0] = (uint8_t)value;
+  ptr[1] = (uint8_t)(value >> 8);
+  ptr[2] = (uint8_t)(value >> 16);
+  ptr[3] = (uint8_t)(value >> 24);
+}
+
+static uint64_t _az_iot_hub_telemetry_queue_load64(uint8_t const* ptr)
+{
+  return (uint64_t)_az_iot_hub_telemetry_queue_load32(ptr)
+      | ((uint64_t)_az_iot_hub_telemetry_queue_load32(ptr + 4) << 32);
+}
+
+static void _az_iot_hub_telemetry_queue_store64(uint8_t* ptr, uint64_t value)
+{
+  _az_iot_hub_telemetry_queue_store32(ptr, (uint32_t)value);
+  _az_iot_hub_telemetry_queue_store32(ptr + 4, (uint32_t)(value >> 32));
+}
+
+// FNV-1a of the generation, the position, the length and the content. Including the position
+// tells apart the records of the current lap of the ring from those left by the previous ones.
+static uint32_t _az_iot_hub_telemetry_queue_checksum(
+    az_iot_hub_telemetry_queue const* queue,
+    uint64_t position,
+    uint32_t length,
+    uint8_t const* content,
+    uint32_t content_length)
+{
+  uint32_t const generation = queue->_internal.generation;
+  uint32_t hash = 2166136261u;
+  for (int32_t i = 0; i < 4; ++i)
+  {
+    hash = (hash ^ (uint8_t)(generation >> (8 * i))) * 16777619u;
+  }
+  for (int32_t i = 0; i < 8; ++i)
+  {
+    hash = (hash ^ (uint8_t)(position >> (8 * i))) * 16777619u;
+  }
+  for (int32_t i = 0; i < 4; ++i)
+  {
+    hash = (hash ^ (uint8_t)(length >> (8 * i))) * 16777619u;
+  }
+  for (uint32_t i = 0; i < content_length; ++i)
+  {
+    hash = (hash ^ content[i]) * 16777619u;
+  }
+  return hash;
+}
+
+AZ_INLINE uint8_t* _az_iot_hub_telemetry_queue_ring(az_iot_hub_telemetry_queue const* queue)
+{
+  return queue->_internal.region + _az_IOT_HUB_TELEMETRY_QUEUE_HEADER_SIZE;
+}
+
+AZ_INLINE uint8_t* _az_iot_hub_telemetry_queue_slot(
+    az_iot_hub_telemetry_queue const* queue,
+    int32_t slot)
+{
+  return queue->_internal.region + _az_IOT_HUB_TELEMETRY_QUEUE_SLOT_OFFSET
+      + slot * _az_IOT_HUB_TELEMETRY_QUEUE_SLOT_SIZE;
+}
+
+AZ_INLINE uint64_t _az_iot_hub_telemetry_queue_record_size(uint64_t content_length)
+{
+  return _az_IOT_HUB_TELEMETRY_QUEUE_RECORD_HEADER_SIZE + ((content_length + 3) & ~(uint64_t)3);
+}
+
+static bool _az_iot_hub_telemetry_queue_slot_load(
+    az_iot_hub_telemetry_queue const* queue,
+    int32_t slot,
+    uint64_t* out_position)
+{
+  uint8_t const* const ptr = _az_iot_hub_telemetry_queue_slot(queue, slot);
+  *out_position = _az_iot_hub_telemetry_queue_load64(ptr);
+  return _az_iot_hub_telemetry_queue_load32(ptr + 8)
+      == _az_iot_hub_telemetry_queue_checksum(
+          queue, *out_position, telemetry_queue_magic, NULL, 0);
+}
+
+static void _az_iot_hub_telemetry_queue_slot_store(
+    az_iot_hub_telemetry_queue const* queue,
+    int32_t slot,
+    uint64_t position)
+{
+  uint8_t* const ptr = _az_iot_hub_telemetry_queue_slot(queue, slot);
+  _az_iot_hub_telemetry_queue_store64(ptr, position);
+  _az_iot_hub_telemetry_queue_store32(
+      ptr + 8,
+      _az_iot_hub_telemetry_queue_checksum(queue, position, telemetry_queue_magic, NULL, 0));
+  _az_iot_hub_telemetry_queue_store32(ptr + 12, 0);
+}
+
+// Gets the position where the record at or after position starts: the end of the ring is skipped
+// when it is too short for a record header, or when it holds a padding record (only trusted if
+// its checksum matches when verify is set).
+static uint64_t _az_iot_hub_telemetry_queue_record_start(
+    az_iot_hub_telemetry_queue const* queue,
+    uint64_t position,
+    bool verify)
+{
+  uint32_t const capacity = queue->_internal.capacity;
+  uint32_t const offset = (uint32_t)(position % capacity);
+  uint32_t const remaining = capacity - offset;
+
+  if (remaining < _az_IOT_HUB_TELEMETRY_QUEUE_RECORD_HEADER_SIZE)
+  {
+    return position + remaining;
+  }
+
+  uint8_t const* const header = _az_iot_hub_telemetry_queue_ring(queue) + offset;
+  if (_az_iot_hub_telemetry_queue_load32(header) == telemetry_queue_padding_length
+      && (!verify
+          || _az_iot_hub_telemetry_queue_load32(header + 4)
+              == _az_iot_hub_telemetry_queue_checksum(
+                  queue,
+                  position, telemetry_queue_padding_length, NULL, 0)))
+  {
+    return position + remaining;
+  }
+
+  return position;
+}
+
+// Finds the records enqueued after the committed read position: they end at the first record that
+// is torn, stale or past a full ring.
+static void _az_iot_hub_telemetry_queue_recover(az_iot_hub_telemetry_queue* queue)
+{
+  uint32_t const capacity = queue->_internal.capacity;
+  uint8_t const* const ring = _az_iot_hub_telemetry_queue_ring(queue);
+  uint64_t const head = queue->_internal.head;
+  uint64_t tail = head;
+  int32_t count = 0;
+
+  while (true)
+  {
+    uint64_t const position = _az_iot_hub_telemetry_queue_record_start(queue, tail, true);
+    uint32_t const offset = (uint32_t)(position % capacity);
+    uint32_t const remaining = capacity - offset;
+    if (position - head >= capacity || remaining < _az_IOT_HUB_TELEMETRY_QUEUE_RECORD_HEADER_SIZE)
+    {
+      break;
+    }
+
+    uint8_t const* const header = ring + offset;
+    uint32_t const length = _az_iot_hub_telemetry_queue_load32(header);
+    if (length == telemetry_queue_padding_length
+        || length < _az_IOT_HUB_TELEMETRY_QUEUE_PROPERTIES_LENGTH_SIZE
+        || _az_iot_hub_telemetry_queue_record_size(length) > remaining
+        || position + _az_iot_hub_telemetry_queue_record_size(length) - head > capacity
+        || _az_iot_hub_telemetry_queue_load32(header + 4)
+            != _az_iot_hub_telemetry_queue_checksum(
+                queue,
+                position,
+                length,
+                header + _az_IOT_HUB_TELEMETRY_QUEUE_RECORD_HEADER_SIZE,
+                length))
+    {
+      break;
+    }
+
+    tail = position + _az_iot_hub_telemetry_queue_record_size(length);
+    ++count;
+  }
+
+  queue->_internal.read = head;
+  queue->_internal.tail = tail;
+  queue->_internal.count = count;
+  queue->_internal.unread_count = count;
+}
+
+AZ_NODISCARD az_result
+az_iot_hub_telemetry_queue_init(az_iot_hub_telemetry_queue* queue, az_span region)
+{
+  AZ_PRECONDITION_NOT_NULL(queue);
+  AZ_PRECONDITION_VALID_SPAN(
+      region,
+      _az_IOT_HUB_TELEMETRY_QUEUE_HEADER_SIZE + _az_IOT_HUB_TELEMETRY_QUEUE_RECORD_HEADER_SIZE + 4,
+      false);
+
+  uint8_t* const ptr = az_span_ptr(region);
+  uint32_t const capacity
+      = (uint32_t)(az_span_length(region) - _az_IOT_HUB_TELEMETRY_QUEUE_HEADER_SIZE) & ~3u;
+
+  *queue = (az_iot_hub_telemetry_queue){
+    ._internal = {
+      .region = ptr,
+      .capacity = capacity,
+      .generation = _az_iot_hub_telemetry_queue_load32(ptr + 8),
+      .slot = 0,
+      .head = 0,
+      .read = 0,
+      .tail = 0,
+      .count = 0,
+      .unread_count = 0,
+    },
+  };
+
+  uint64_t positions[2] = { 0, 0 };
+  bool const valid[2] = {
+    _az_iot_hub_telemetry_queue_slot_load(queue, 0, &positions[0]),
+    _az_iot_hub_telemetry_queue_slot_load(queue, 1, &positions[1]),
+  };
+
+  if (_az_iot_hub_telemetry_queue_load32(ptr) == telemetry_queue_magic
+      && _az_iot_hub_telemetry_queue_load32(ptr + 4) == capacity && (valid[0] || valid[1]))
+  {
+    // The newest slot wins: the other one may have been torn by a crash during a commit.
+    queue->_internal.slot = valid[0] && (!valid[1] || positions[0] >= positions[1]) ? 0 : 1;
+    queue->_internal.head = positions[queue->_internal.slot];
+  }
+  else
+  {
+    // The magic is written last, so that a region torn while being formatted is formatted again.
+    ++queue->_internal.generation;
+    _az_iot_hub_telemetry_queue_store32(ptr + 8, queue->_internal.generation);
+    _az_iot_hub_telemetry_queue_slot_store(queue, 0, 0);
+    _az_iot_hub_telemetry_queue_slot_store(queue, 1, 0);
+    _az_iot_hub_telemetry_queue_store32(ptr + 4, capacity);
+    _az_iot_hub_telemetry_queue_store32(ptr, telemetry_queue_magic);
+  }
+
+  _az_iot_hub_telemetry_queue_recover(queue);
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_iot_hub_telemetry_queue_enqueue(
+    az_iot_hub_telemetry_queue* queue,
+    az_iot_hub_client_properties const* properties,
+    az_span payload)
+{
+  AZ_PRECONDITION_NOT_NULL(queue);
+  AZ_PRECONDITION_VALID_SPAN(payload, 0, true);
+
+  az_span const properties_span
+      = properties == NULL ? AZ_SPAN_NULL : properties->_internal.properties;
+  AZ_PRECONDITION(az_span_length(properties_span) < telemetry_queue_no_properties);
+
+  uint32_t const capacity = queue->_internal.capacity;
+  uint64_t const content_length = _az_IOT_HUB_TELEMETRY_QUEUE_PROPERTIES_LENGTH_SIZE
+      + (uint64_t)az_span_length(properties_span) + (uint64_t)az_span_length(payload);
+  uint64_t const size = _az_iot_hub_telemetry_queue_record_size(content_length);
+
+  // Records don't wrap: the end of the ring is skipped if the record doesn't fit there.
+  uint64_t position = queue->_internal.tail;
+  uint32_t const remaining = capacity - (uint32_t)(position % capacity);
+  uint32_t const skipped = size > remaining ? remaining : 0;
+
+  if (size > capacity || position + skipped + size - queue->_internal.head > capacity)
+  {
+    return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+  }
+
+  uint8_t* const ring = _az_iot_hub_telemetry_queue_ring(queue);
+  if (skipped >= _az_IOT_HUB_TELEMETRY_QUEUE_RECORD_HEADER_SIZE)
+  {
+    uint8_t* const padding = ring + (uint32_t)(position % capacity);
+    _az_iot_hub_telemetry_queue_store32(
+        padding + 4,
+        _az_iot_hub_telemetry_queue_checksum(
+            queue, position, telemetry_queue_padding_length, NULL, 0));
+    _az_iot_hub_telemetry_queue_store32(padding, telemetry_queue_padding_length);
+  }
+  position += skipped;
+
+  uint8_t* const header = ring + (uint32_t)(position % capacity);
+  uint8_t* const content = header + _az_IOT_HUB_TELEMETRY_QUEUE_RECORD_HEADER_SIZE;
+  uint16_t const properties_length = properties == NULL
+      ? telemetry_queue_no_properties
+      : (uint16_t)az_span_length(properties_span);
+  content[0] = (uint8_t)properties_length;
+  content[1] = (uint8_t)(properties_length >> 8);
+
+  az_span record = az_span_init(
+      content + _az_IOT_HUB_TELEMETRY_QUEUE_PROPERTIES_LENGTH_SIZE,
+      0,
+      (int32_t)content_length - _az_IOT_HUB_TELEMETRY_QUEUE_PROPERTIES_LENGTH_SIZE);
+  // Empty spans may be AZ_SPAN_NULL, which az_span_copy must not be given to memmove.
+  if (az_span_length(properties_span) > 0)
+  {
+    AZ_RETURN_IF_FAILED(az_span_append(record, properties_span, &record));
+  }
+  if (az_span_length(payload) > 0)
+  {
+    AZ_RETURN_IF_FAILED(az_span_append(record, payload, &record));
+  }
+
+  _az_iot_hub_telemetry_queue_store32(
+      header + 4,
+      _az_iot_hub_telemetry_queue_checksum(
+          queue,
+          position, (uint32_t)content_length, content, (uint32_t)content_length));
+  _az_iot_hub_telemetry_queue_store32(header, (uint32_t)content_length);
+
+  queue->_internal.tail = position + size;
+  ++queue->_internal.count;
+  ++queue->_internal.unread_count;
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_iot_hub_telemetry_queue_read(
+    az_iot_hub_telemetry_queue* queue,
+    az_iot_hub_client const* client,
+    az_span mqtt_topic,
+    az_span* out_mqtt_topic,
+    az_span* out_payload)
+{
+  AZ_PRECONDITION_NOT_NULL(queue);
+  AZ_PRECONDITION_NOT_NULL(client);
+  AZ_PRECONDITION_VALID_SPAN(mqtt_topic, 0, false);
+  AZ_PRECONDITION_NOT_NULL(out_mqtt_topic);
+  AZ_PRECONDITION_NOT_NULL(out_payload);
+
+  if (queue->_internal.unread_count == 0)
+  {
+    return AZ_ERROR_ITEM_NOT_FOUND;
+  }
+
+  // The records up to the tail were checked when written or recovered.
+  uint64_t const position
+      = _az_iot_hub_telemetry_queue_record_start(queue, queue->_internal.read, false);
+  uint8_t const* const header
+      = _az_iot_hub_telemetry_queue_ring(queue) + (uint32_t)(position % queue->_internal.capacity);
+  uint32_t const length = _az_iot_hub_telemetry_queue_load32(header);
+  uint8_t* const content = (uint8_t*)header + _az_IOT_HUB_TELEMETRY_QUEUE_RECORD_HEADER_SIZE;
+  uint16_t const properties_length = (uint16_t)(content[0] | (content[1] << 8));
+
+  int32_t const properties_size
+      = properties_length == telemetry_queue_no_properties ? 0 : properties_length;
+  uint8_t* const properties_ptr = content + _az_IOT_HUB_TELEMETRY_QUEUE_PROPERTIES_LENGTH_SIZE;
+  int32_t const payload_length
+      = (int32_t)length - _az_IOT_HUB_TELEMETRY_QUEUE_PROPERTIES_LENGTH_SIZE - properties_size;
+
+  if (properties_length == telemetry_queue_no_properties)
+  {
+    AZ_RETURN_IF_FAILED(
+        az_iot_hub_client_telemetry_publish_topic_get(client, NULL, mqtt_topic, out_mqtt_topic));
+  }
+  else
+  {
+    az_iot_hub_client_properties properties;
+    AZ_RETURN_IF_FAILED(az_iot_hub_client_properties_init(
+        &properties, az_span_init(properties_ptr, properties_size, properties_size)));
+    AZ_RETURN_IF_FAILED(az_iot_hub_client_telemetry_publish_topic_get(
+        client, &properties, mqtt_topic, out_mqtt_topic));
+  }
+
+  *out_payload = az_span_init(properties_ptr + properties_size, payload_length, payload_length);
+
+  queue->_internal.read = position + _az_iot_hub_telemetry_queue_record_size(length);
+  --queue->_internal.unread_count;
+  return AZ_OK;
+}
+
+void az_iot_hub_telemetry_queue_commit(az_iot_hub_telemetry_queue* queue)
+{
+  AZ_PRECONDITION_NOT_NULL(queue);
+
+  if (queue->_internal.read == queue->_internal.head)
+  {
+    return;
+  }
+
+  // The slot not holding the current read position is written, so that a torn write leaves the
+  // current position in effect.
+  int32_t const slot = 1 - queue->_internal.slot;
+  _az_iot_hub_telemetry_queue_slot_store(queue, slot, queue->_internal.read);
+
+  queue->_internal.slot = slot;
+  queue->_internal.head = queue->_internal.read;
+  queue->_internal.count = queue->_internal.unread_count;
+}
+
+void az_iot_hub_telemetry_queue_rewind(az_iot_hub_telemetry_queue* queue)
+{
+  AZ_PRECONDITION_NOT_NULL(queue);
+
+  queue->_internal.read = queue->_internal.head;
+  queue->_internal.unread_count = queue->_internal.count;
+}
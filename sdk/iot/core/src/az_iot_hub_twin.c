@@ -0,0 +1,649 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "az_iot_hub_twin.h"
+#include <az_json.h>
+#include <az_precondition.h>
+#include <az_precondition_internal.h>
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <_az_cfg.h>
+
+static const uint8_t twin_name_separator = '.';
+static const uint8_t twin_metadata_prefix = '$';
+static const az_span twin_version_name = AZ_SPAN_LITERAL_FROM_STR("$version");
+static const az_span twin_null = AZ_SPAN_LITERAL_FROM_STR("null");
+
+AZ_NODISCARD az_result az_iot_hub_twin_properties_init(
+    az_iot_hub_twin_properties* properties,
+    az_iot_hub_twin_property* entries,
+    int32_t entries_length,
+    az_span buffer)
+{
+  AZ_PRECONDITION_NOT_NULL(properties);
+  AZ_PRECONDITION_NOT_NULL(entries);
+  AZ_PRECONDITION(entries_length > 0);
+  AZ_PRECONDITION_VALID_SPAN(buffer, 0, false);
+
+  *properties = (az_iot_hub_twin_properties){
+    ._internal = {
+      .properties = entries,
+      .capacity = entries_length,
+      .count = 0,
+      .buffer = az_span_init(az_span_ptr(buffer), 0, az_span_capacity(buffer)),
+      .version = 0,
+    },
+  };
+
+  return AZ_OK;
+}
+
+// Compares name with key, followed by a separator when descendants is set: names are sorted
+// byte by byte, so that the descendants of a property follow one another.
+static int32_t _az_iot_hub_twin_compare(az_span name, az_span key, bool descendants)
+{
+  uint8_t const* const name_ptr = az_span_ptr(name);
+  uint8_t const* const key_ptr = az_span_ptr(key);
+  int32_t const name_length = az_span_length(name);
+  int32_t const key_length = az_span_length(key) + (descendants ? 1 : 0);
+
+  for (int32_t i = 0; i < name_length && i < key_length; ++i)
+  {
+    uint8_t const key_char = i < az_span_length(key) ? key_ptr[i] : twin_name_separator;
+    if (name_ptr[i] != key_char)
+    {
+      return name_ptr[i] < key_char ? -1 : 1;
+    }
+  }
+
+  return name_length - key_length;
+}
+
+// Gets the index of the first property not sorted before key.
+static int32_t _az_iot_hub_twin_properties_lower_bound(
+    az_iot_hub_twin_properties const* properties,
+    az_span key,
+    bool descendants)
+{
+  int32_t low = 0;
+  int32_t high = properties->_internal.count;
+  while (low < high)
+  {
+    int32_t const middle = low + (high - low) / 2;
+    if (_az_iot_hub_twin_compare(
+            properties->_internal.properties[middle]._internal.name, key, descendants)
+        < 0)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+static int32_t _az_iot_hub_twin_properties_find(
+    az_iot_hub_twin_properties const* properties,
+    az_span name)
+{
+  int32_t const index = _az_iot_hub_twin_properties_lower_bound(properties, name, false);
+  return index < properties->_internal.count
+          && az_span_is_content_equal(properties->_internal.properties[index]._internal.name, name)
+      ? index
+      : -1;
+}
+
+static void _az_iot_hub_twin_properties_remove(
+    az_iot_hub_twin_properties* properties,
+    int32_t begin,
+    int32_t end)
+{
+  az_iot_hub_twin_property* const entries = properties->_internal.properties;
+  int32_t const count = properties->_internal.count;
+  for (int32_t i = end; i < count; ++i)
+  {
+    entries[begin + i - end] = entries[i];
+  }
+  properties->_internal.count -= end - begin;
+}
+
+// Removes the properties which a property of this name replaces: the properties it is nested in,
+// and those nested in it.
+static void _az_iot_hub_twin_properties_remove_related(
+    az_iot_hub_twin_properties* properties,
+    az_span name)
+{
+  uint8_t const* const name_ptr = az_span_ptr(name);
+  for (int32_t i = 0; i < az_span_length(name); ++i)
+  {
+    if (name_ptr[i] == twin_name_separator)
+    {
+      int32_t const index
+          = _az_iot_hub_twin_properties_find(properties, az_span_slice(name, 0, i));
+      if (index >= 0)
+      {
+        _az_iot_hub_twin_properties_remove(properties, index, index + 1);
+      }
+    }
+  }
+
+  int32_t const begin = _az_iot_hub_twin_properties_lower_bound(properties, name, true);
+  int32_t end = begin;
+  while (end < properties->_internal.count
+         && az_span_length(properties->_internal.properties[end]._internal.name)
+             > az_span_length(name)
+         && _az_iot_hub_twin_compare(
+                az_span_slice(
+                    properties->_internal.properties[end]._internal.name,
+                    0,
+                    az_span_length(name) + 1),
+                name,
+                true)
+             == 0)
+  {
+    ++end;
+  }
+  _az_iot_hub_twin_properties_remove(properties, begin, end);
+}
+
+// Moves the names and values in use to the start of the buffer, in the order they are stored, to
+// reclaim the space of the values that were replaced.
+static void _az_iot_hub_twin_properties_compact(az_iot_hub_twin_properties* properties)
+{
+  az_iot_hub_twin_property* const entries = properties->_internal.properties;
+  int32_t const count = properties->_internal.count;
+  uint8_t* const buffer = az_span_ptr(properties->_internal.buffer);
+  int32_t used = 0;
+
+  while (true)
+  {
+    // The lowest span not moved yet: the moved ones all end before the used size.
+    az_span* next = NULL;
+    for (int32_t i = 0; i < count; ++i)
+    {
+      az_span* const spans[2] = { &entries[i]._internal.name, &entries[i]._internal.value };
+      for (int32_t j = 0; j < 2; ++j)
+      {
+        if (az_span_length(*spans[j]) > 0 && az_span_ptr(*spans[j]) >= buffer + used
+            && (next == NULL || az_span_ptr(*spans[j]) < az_span_ptr(*next)))
+        {
+          next = spans[j];
+        }
+      }
+    }
+
+    if (next == NULL)
+    {
+      break;
+    }
+
+    int32_t const length = az_span_length(*next);
+    az_span const moved = az_span_init(buffer + used, 0, length);
+    az_span out = AZ_SPAN_NULL;
+    // Cannot fail: the destination is as long as the source.
+    az_result const result = az_span_copy(moved, *next, &out);
+    (void)result;
+
+    *next = az_span_init(buffer + used, length, length);
+    used += length;
+  }
+
+  properties->_internal.buffer
+      = az_span_init(buffer, used, az_span_capacity(properties->_internal.buffer));
+}
+
+// Copies first and second next to each other in the buffer.
+static AZ_NODISCARD az_result _az_iot_hub_twin_properties_store(
+    az_iot_hub_twin_properties* properties,
+    az_span first,
+    az_span second,
+    az_span* out_first,
+    az_span* out_second)
+{
+  int32_t const length = az_span_length(first) + az_span_length(second);
+  if (az_span_capacity(properties->_internal.buffer) - az_span_length(properties->_internal.buffer)
+      < length)
+  {
+    _az_iot_hub_twin_properties_compact(properties);
+  }
+
+  az_span buffer = properties->_internal.buffer;
+  uint8_t* const ptr = az_span_ptr(buffer) + az_span_length(buffer);
+  // A value may be AZ_SPAN_NULL, which az_span_copy must not be given to memmove.
+  if (az_span_length(first) > 0)
+  {
+    AZ_RETURN_IF_FAILED(az_span_append(buffer, first, &buffer));
+  }
+  if (az_span_length(second) > 0)
+  {
+    AZ_RETURN_IF_FAILED(az_span_append(buffer, second, &buffer));
+  }
+
+  *out_first = az_span_init(ptr, az_span_length(first), az_span_length(first));
+  *out_second = az_span_init(
+      ptr + az_span_length(first), az_span_length(second), az_span_length(second));
+  properties->_internal.buffer = buffer;
+  return AZ_OK;
+}
+
+static AZ_NODISCARD az_result _az_iot_hub_twin_properties_update(
+    az_iot_hub_twin_properties* properties,
+    az_span name,
+    az_span value)
+{
+  _az_iot_hub_twin_properties_remove_related(properties, name);
+
+  az_iot_hub_twin_property* const entries = properties->_internal.properties;
+  int32_t const index = _az_iot_hub_twin_properties_lower_bound(properties, name, false);
+
+  if (index < properties->_internal.count
+      && az_span_is_content_equal(entries[index]._internal.name, name))
+  {
+    az_iot_hub_twin_property* const entry = &entries[index];
+    if (az_span_is_content_equal(entry->_internal.value, value))
+    {
+      return AZ_OK;
+    }
+
+    if (az_span_length(value) <= az_span_length(entry->_internal.value))
+    {
+      az_span const old_value = entry->_internal.value;
+      AZ_RETURN_IF_FAILED(az_span_copy(
+          az_span_init(az_span_ptr(old_value), 0, az_span_length(old_value)),
+          value,
+          &entry->_internal.value));
+    }
+    else
+    {
+      az_span unused_name = AZ_SPAN_NULL;
+      AZ_RETURN_IF_FAILED(_az_iot_hub_twin_properties_store(
+          properties, AZ_SPAN_NULL, value, &unused_name, &entry->_internal.value));
+    }
+
+    entry->_internal.changed = true;
+    return AZ_OK;
+  }
+
+  if (properties->_internal.count == properties->_internal.capacity)
+  {
+    return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+  }
+
+  az_iot_hub_twin_property entry = { ._internal = { .changed = true } };
+  AZ_RETURN_IF_FAILED(_az_iot_hub_twin_properties_store(
+      properties, name, value, &entry._internal.name, &entry._internal.value));
+
+  for (int32_t i = properties->_internal.count; i > index; --i)
+  {
+    entries[i] = entries[i - 1];
+  }
+  entries[index] = entry;
+  ++properties->_internal.count;
+  return AZ_OK;
+}
+
+// Gets the raw JSON text of a member value, once the parser is past it.
+static az_span _az_iot_hub_twin_member_value(az_json_token_member const* member, az_span reader)
+{
+  // The value follows the closing quote of the name, the colon and white spaces.
+  uint8_t* start = az_span_ptr(member->name) + az_span_length(member->name) + 1;
+  while (*start != ':')
+  {
+    ++start;
+  }
+  ++start;
+  while (*start == ' ' || *start == '\t' || *start == '\n' || *start == '\r')
+  {
+    ++start;
+  }
+
+  // The parser is past the white spaces and the comma following the value, if any.
+  uint8_t* end = az_span_ptr(reader);
+  while (end > start
+         && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r'
+             || end[-1] == ','))
+  {
+    --end;
+  }
+
+  int32_t const length = (int32_t)(end - start);
+  return az_span_init(start, length, length);
+}
+
+// Merges the members of the object the parser is in, up to its end.
+static AZ_NODISCARD az_result
+_az_iot_hub_twin_properties_merge(az_iot_hub_twin_properties* properties, az_json_parser* parser)
+{
+  uint8_t path_buffer[AZ_IOT_HUB_TWIN_NAME_MAX_SIZE];
+  int32_t path_length = 0;
+  int32_t depth = 0;
+
+  while (true)
+  {
+    az_json_token_member member;
+    az_result const result = az_json_parser_parse_token_member(parser, &member);
+    if (result == AZ_ERROR_ITEM_NOT_FOUND)
+    {
+      if (depth == 0)
+      {
+        return AZ_OK;
+      }
+
+      // Back to the parent object.
+      --depth;
+      while (path_length > 0 && path_buffer[path_length - 1] != twin_name_separator)
+      {
+        --path_length;
+      }
+      path_length = path_length > 0 ? path_length - 1 : 0;
+      continue;
+    }
+    AZ_RETURN_IF_FAILED(result);
+
+    if (depth == 0 && az_span_length(member.name) > 0
+        && az_span_ptr(member.name)[0] == twin_metadata_prefix)
+    {
+      double version = 0;
+      if (az_span_is_content_equal(member.name, twin_version_name)
+          && az_succeeded(az_json_token_get_number(member.token, &version)))
+      {
+        properties->_internal.version = (int64_t)version;
+      }
+      AZ_RETURN_IF_FAILED(az_json_parser_skip_children(parser, member.token));
+      continue;
+    }
+
+    int32_t const parent_length = path_length;
+    az_span path = az_span_init(path_buffer, path_length, (int32_t)sizeof(path_buffer));
+    if (parent_length > 0)
+    {
+      AZ_RETURN_IF_FAILED(az_span_append_uint8(path, twin_name_separator, &path));
+    }
+    AZ_RETURN_IF_FAILED(az_span_append(path, member.name, &path));
+    path_length = az_span_length(path);
+
+    if (member.token.kind == AZ_JSON_TOKEN_OBJECT)
+    {
+      // The object replaces a property of the same name, and its members are merged one by one.
+      int32_t const index = _az_iot_hub_twin_properties_find(properties, path);
+      if (index >= 0)
+      {
+        _az_iot_hub_twin_properties_remove(properties, index, index + 1);
+      }
+      ++depth;
+      continue;
+    }
+
+    AZ_RETURN_IF_FAILED(az_json_parser_skip_children(parser, member.token));
+    AZ_RETURN_IF_FAILED(_az_iot_hub_twin_properties_update(
+        properties, path, _az_iot_hub_twin_member_value(&member, parser->_internal.reader)));
+    path_length = parent_length;
+  }
+}
+
+AZ_NODISCARD az_result az_iot_hub_twin_properties_apply_document(
+    az_iot_hub_twin_properties* properties,
+    az_span twin_document,
+    az_span section)
+{
+  AZ_PRECONDITION_NOT_NULL(properties);
+  AZ_PRECONDITION_VALID_SPAN(twin_document, 1, false);
+  AZ_PRECONDITION_VALID_SPAN(section, 1, false);
+
+  az_json_parser parser;
+  AZ_RETURN_IF_FAILED(az_json_parser_init(&parser, twin_document));
+
+  az_json_token token;
+  AZ_RETURN_IF_FAILED(az_json_parser_parse_token(&parser, &token));
+  if (token.kind != AZ_JSON_TOKEN_OBJECT)
+  {
+    return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
+  }
+
+  while (true)
+  {
+    az_json_token_member member;
+    az_result const result = az_json_parser_parse_token_member(&parser, &member);
+    if (result == AZ_ERROR_ITEM_NOT_FOUND)
+    {
+      return AZ_ERROR_ITEM_NOT_FOUND;
+    }
+    AZ_RETURN_IF_FAILED(result);
+
+    if (member.token.kind == AZ_JSON_TOKEN_OBJECT
+        && az_span_is_content_equal(member.name, section))
+    {
+      properties->_internal.count = 0;
+      properties->_internal.buffer = az_span_init(
+          az_span_ptr(properties->_internal.buffer),
+          0,
+          az_span_capacity(properties->_internal.buffer));
+      properties->_internal.version = 0;
+      return _az_iot_hub_twin_properties_merge(properties, &parser);
+    }
+
+    AZ_RETURN_IF_FAILED(az_json_parser_skip_children(&parser, member.token));
+  }
+}
+
+AZ_NODISCARD az_result
+az_iot_hub_twin_properties_apply_patch(az_iot_hub_twin_properties* properties, az_span patch)
+{
+  AZ_PRECONDITION_NOT_NULL(properties);
+  AZ_PRECONDITION_VALID_SPAN(patch, 1, false);
+
+  az_json_parser parser;
+  AZ_RETURN_IF_FAILED(az_json_parser_init(&parser, patch));
+
+  az_json_token token;
+  AZ_RETURN_IF_FAILED(az_json_parser_parse_token(&parser, &token));
+  if (token.kind != AZ_JSON_TOKEN_OBJECT)
+  {
+    return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
+  }
+
+  AZ_RETURN_IF_FAILED(_az_iot_hub_twin_properties_merge(properties, &parser));
+  return az_json_parser_done(&parser);
+}
+
+AZ_NODISCARD az_result az_iot_hub_twin_properties_get(
+    az_iot_hub_twin_properties const* properties,
+    az_span name,
+    az_span* out_value)
+{
+  AZ_PRECONDITION_NOT_NULL(properties);
+  AZ_PRECONDITION_VALID_SPAN(name, 1, false);
+  AZ_PRECONDITION_NOT_NULL(out_value);
+
+  int32_t const index = _az_iot_hub_twin_properties_find(properties, name);
+  if (index < 0
+      || az_span_is_content_equal(
+          properties->_internal.properties[index]._internal.value, twin_null))
+  {
+    return AZ_ERROR_ITEM_NOT_FOUND;
+  }
+
+  *out_value = properties->_internal.properties[index]._internal.value;
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_iot_hub_twin_properties_set(
+    az_iot_hub_twin_properties* properties,
+    az_span name,
+    az_span value)
+{
+  AZ_PRECONDITION_NOT_NULL(properties);
+  AZ_PRECONDITION_VALID_SPAN(name, 1, false);
+  AZ_PRECONDITION_VALID_SPAN(value, 1, false);
+
+  return _az_iot_hub_twin_properties_update(properties, name, value);
+}
+
+AZ_NODISCARD az_result az_iot_hub_twin_properties_next_change(
+    az_iot_hub_twin_properties const* properties,
+    int32_t* iterator,
+    az_span* out_name,
+    az_span* out_value)
+{
+  AZ_PRECONDITION_NOT_NULL(properties);
+  AZ_PRECONDITION_NOT_NULL(iterator);
+  AZ_PRECONDITION_NOT_NULL(out_name);
+  AZ_PRECONDITION_NOT_NULL(out_value);
+
+  for (int32_t i = *iterator; i < properties->_internal.count; ++i)
+  {
+    az_iot_hub_twin_property const* const entry = &properties->_internal.properties[i];
+    if (entry->_internal.changed)
+    {
+      *out_name = entry->_internal.name;
+      *out_value = entry->_internal.value;
+      *iterator = i + 1;
+      return AZ_OK;
+    }
+  }
+
+  *iterator = properties->_internal.count;
+  return AZ_ERROR_ITEM_NOT_FOUND;
+}
+
+// Gets the number of leading members two paths have in common.
+static int32_t _az_iot_hub_twin_common_depth(az_span a, az_span b)
+{
+  uint8_t const* const a_ptr = az_span_ptr(a);
+  uint8_t const* const b_ptr = az_span_ptr(b);
+  int32_t const a_length = az_span_length(a);
+  int32_t const b_length = az_span_length(b);
+
+  int32_t depth = 0;
+  int32_t i = 0;
+  for (; i < a_length && i < b_length && a_ptr[i] == b_ptr[i]; ++i)
+  {
+    if (a_ptr[i] == twin_name_separator)
+    {
+      ++depth;
+    }
+  }
+
+  // The last member is shared if both paths end, or go on with another member, there.
+  bool const a_end = i == a_length || a_ptr[i] == twin_name_separator;
+  bool const b_end = i == b_length || b_ptr[i] == twin_name_separator;
+  return i > 0 && a_end && b_end ? depth + 1 : depth;
+}
+
+static AZ_NODISCARD az_result _az_iot_hub_twin_name_append(az_span json, az_span name, az_span* out)
+{
+  AZ_RETURN_IF_FAILED(az_span_append_uint8(json, '"', &json));
+  AZ_RETURN_IF_FAILED(az_span_append(json, name, &json));
+  AZ_RETURN_IF_FAILED(az_span_append(json, AZ_SPAN_FROM_STR("\":"), &json));
+  *out = json;
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_iot_hub_twin_properties_patch_get(
+    az_iot_hub_twin_properties const* properties,
+    az_span json,
+    az_span* out_json)
+{
+  AZ_PRECONDITION_NOT_NULL(properties);
+  AZ_PRECONDITION_VALID_SPAN(json, 0, false);
+  AZ_PRECONDITION_NOT_NULL(out_json);
+
+  // The properties are sorted by name, so the members of an object follow one another: objects are
+  // opened and closed as the path of the properties goes deeper or back up.
+  az_span open_path = AZ_SPAN_NULL;
+  int32_t depth = 0;
+  bool need_comma = false;
+
+  AZ_RETURN_IF_FAILED(az_span_append_uint8(json, '{', &json));
+
+  for (int32_t i = 0; i < properties->_internal.count; ++i)
+  {
+    az_iot_hub_twin_property const* const entry = &properties->_internal.properties[i];
+    if (!entry->_internal.changed)
+    {
+      continue;
+    }
+
+    az_span const name = entry->_internal.name;
+    uint8_t const* const name_ptr = az_span_ptr(name);
+    int32_t leaf_start = az_span_length(name);
+    while (leaf_start > 0 && name_ptr[leaf_start - 1] != twin_name_separator)
+    {
+      --leaf_start;
+    }
+    az_span const path = az_span_slice(name, 0, leaf_start > 0 ? leaf_start - 1 : 0);
+
+    int32_t const common_depth = _az_iot_hub_twin_common_depth(open_path, path);
+    for (; depth > common_depth; --depth)
+    {
+      AZ_RETURN_IF_FAILED(az_span_append_uint8(json, '}', &json));
+    }
+    if (need_comma)
+    {
+      AZ_RETURN_IF_FAILED(az_span_append_uint8(json, ',', &json));
+    }
+
+    // Skip the members already open, and open the others.
+    int32_t member_start = 0;
+    for (int32_t member = 0; member < common_depth; ++member)
+    {
+      while (name_ptr[member_start] != twin_name_separator)
+      {
+        ++member_start;
+      }
+      ++member_start;
+    }
+    while (member_start < leaf_start)
+    {
+      int32_t member_end = member_start;
+      while (name_ptr[member_end] != twin_name_separator)
+      {
+        ++member_end;
+      }
+      AZ_RETURN_IF_FAILED(
+          _az_iot_hub_twin_name_append(json, az_span_slice(name, member_start, member_end), &json));
+      AZ_RETURN_IF_FAILED(az_span_append_uint8(json, '{', &json));
+      ++depth;
+      member_start = member_end + 1;
+    }
+
+    AZ_RETURN_IF_FAILED(
+        _az_iot_hub_twin_name_append(json, az_span_slice(name, leaf_start, -1), &json));
+    AZ_RETURN_IF_FAILED(az_span_append(json, entry->_internal.value, &json));
+
+    open_path = path;
+    need_comma = true;
+  }
+
+  for (; depth >= 0; --depth)
+  {
+    AZ_RETURN_IF_FAILED(az_span_append_uint8(json, '}', &json));
+  }
+
+  *out_json = json;
+  return AZ_OK;
+}
+
+void az_iot_hub_twin_properties_changes_clear(az_iot_hub_twin_properties* properties)
+{
+  AZ_PRECONDITION_NOT_NULL(properties);
+
+  az_iot_hub_twin_property* const entries = properties->_internal.properties;
+  int32_t count = 0;
+  for (int32_t i = 0; i < properties->_internal.count; ++i)
+  {
+    if (!az_span_is_content_equal(entries[i]._internal.value, twin_null))
+    {
+      entries[count] = entries[i];
+      entries[count]._internal.changed = false;
+      ++count;
+    }
+  }
+  properties->_internal.count = count;
+}
@@ -0,0 +1,143 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "az_iot_sas_token_private.h"
+#include "az_iot_sha256_private.h"
+#include <az_iot_sas_token.h>
+#include <az_precondition.h>
+#include <az_precondition_internal.h>
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdint.h>
+
+#include <_az_cfg.h>
+
+enum
+{
+  _az_IOT_SAS_TOKEN_BASE64_HMAC_SIZE = (_az_IOT_SHA256_HASH_SIZE + 2) / 3 * 4,
+};
+
+AZ_NODISCARD az_result
+az_iot_sas_token_sign(az_span key, az_span document, az_span signature, az_span* out_signature)
+{
+  AZ_PRECONDITION_VALID_SPAN(key, 1, false);
+  AZ_PRECONDITION_VALID_SPAN(document, 1, false);
+  AZ_PRECONDITION_VALID_SPAN(signature, 0, false);
+  AZ_PRECONDITION_NOT_NULL(out_signature);
+
+  uint8_t decoded_key_buffer[AZ_IOT_SAS_TOKEN_KEY_MAX_SIZE];
+  az_span decoded_key = AZ_SPAN_NULL;
+  AZ_RETURN_IF_FAILED(
+      _az_iot_base64_decode(AZ_SPAN_FROM_BUFFER(decoded_key_buffer), key, &decoded_key));
+
+  uint8_t hmac[_az_IOT_SHA256_HASH_SIZE];
+  _az_iot_hmac_sha256(decoded_key, document, hmac);
+
+  uint8_t base64_hmac_buffer[_az_IOT_SAS_TOKEN_BASE64_HMAC_SIZE];
+  az_span base64_hmac = AZ_SPAN_NULL;
+  AZ_RETURN_IF_FAILED(_az_iot_base64_encode(
+      AZ_SPAN_FROM_BUFFER(base64_hmac_buffer),
+      AZ_SPAN_FROM_INITIALIZED_BUFFER(hmac),
+      &base64_hmac));
+
+  return az_span_copy_url_encode(signature, base64_hmac, out_signature);
+}
+
+AZ_NODISCARD az_result _az_iot_sas_token_generate_signed(
+    az_span iothub_fqdn,
+    az_span device_id,
+    az_span key,
+    az_span key_name,
+    int32_t expiry_time_secs,
+    az_span sas_token,
+    az_span* out_sas_token)
+{
+  az_span const buffer = az_span_init(az_span_ptr(sas_token), 0, az_span_capacity(sas_token));
+
+  // The document is only needed until it is signed, so it is built in the token buffer.
+  az_span document = AZ_SPAN_NULL;
+  AZ_RETURN_IF_FAILED(
+      az_iot_sas_token_get_document(iothub_fqdn, device_id, expiry_time_secs, buffer, &document));
+
+  uint8_t signature_buffer[AZ_IOT_SAS_TOKEN_SIGNATURE_MAX_SIZE];
+  az_span signature = AZ_SPAN_NULL;
+  AZ_RETURN_IF_FAILED(
+      az_iot_sas_token_sign(key, document, AZ_SPAN_FROM_BUFFER(signature_buffer), &signature));
+
+  return az_iot_sas_token_generate(
+      iothub_fqdn, device_id, signature, expiry_time_secs, key_name, buffer, out_sas_token);
+}
+
+AZ_NODISCARD az_result az_iot_sas_token_cache_init(
+    az_iot_sas_token_cache* cache,
+    az_span iothub_fqdn,
+    az_span device_id,
+    az_span key,
+    az_span key_name,
+    int32_t lifetime_secs,
+    int32_t refresh_secs,
+    az_span sas_token_buffer)
+{
+  AZ_PRECONDITION_NOT_NULL(cache);
+  AZ_PRECONDITION_VALID_SPAN(iothub_fqdn, 1, false);
+  AZ_PRECONDITION_VALID_SPAN(device_id, 1, false);
+  AZ_PRECONDITION_VALID_SPAN(key, 1, false);
+  AZ_PRECONDITION(lifetime_secs > 0);
+  AZ_PRECONDITION(refresh_secs >= 0 && refresh_secs < lifetime_secs);
+  AZ_PRECONDITION_VALID_SPAN(sas_token_buffer, 0, false);
+
+  *cache = (az_iot_sas_token_cache){
+    ._internal = {
+      .iothub_fqdn = iothub_fqdn,
+      .device_id = device_id,
+      .key = key,
+      .key_name = key_name,
+      .sas_token
+      = az_span_init(az_span_ptr(sas_token_buffer), 0, az_span_capacity(sas_token_buffer)),
+      .lifetime_secs = lifetime_secs,
+      .refresh_secs = refresh_secs,
+      .expiry_time_secs = 0,
+    },
+  };
+
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_iot_sas_token_cache_get(
+    az_iot_sas_token_cache* cache,
+    int32_t current_time_secs,
+    az_span* out_sas_token)
+{
+  AZ_PRECONDITION_NOT_NULL(cache);
+  AZ_PRECONDITION(current_time_secs > 0);
+  AZ_PRECONDITION_NOT_NULL(out_sas_token);
+
+  if (cache->_internal.expiry_time_secs == 0
+      || current_time_secs >= az_iot_sas_token_cache_get_refresh_time(cache))
+  {
+    int32_t const expiry_time_secs = current_time_secs + cache->_internal.lifetime_secs;
+
+    az_result const result = _az_iot_sas_token_generate_signed(
+        cache->_internal.iothub_fqdn,
+        cache->_internal.device_id,
+        cache->_internal.key,
+        cache->_internal.key_name,
+        expiry_time_secs,
+        cache->_internal.sas_token,
+        &cache->_internal.sas_token);
+    if (az_failed(result))
+    {
+      // The buffer may hold a partial token: the next call generates it again.
+      cache->_internal.sas_token = az_span_init(
+          az_span_ptr(cache->_internal.sas_token), 0, az_span_capacity(cache->_internal.sas_token));
+      cache->_internal.expiry_time_secs = 0;
+      return result;
+    }
+
+    cache->_internal.expiry_time_secs = expiry_time_secs;
+  }
+
+  *out_sas_token = cache->_internal.sas_token;
+  return AZ_OK;
+}
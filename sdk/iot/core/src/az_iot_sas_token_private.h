@@ -0,0 +1,29 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#ifndef _az_IOT_SAS_TOKEN_PRIVATE_H
+#define _az_IOT_SAS_TOKEN_PRIVATE_H
+
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdint.h>
+
+#include <_az_cfg_prefix.h>
+
+/**
+ * @brief Generates a SAS token signed with the Base64 encoded \p key into \p sas_token. The
+ * document to sign is built in \p sas_token first.
+ */
+AZ_NODISCARD az_result _az_iot_sas_token_generate_signed(
+    az_span iothub_fqdn,
+    az_span device_id,
+    az_span key,
+    az_span key_name,
+    int32_t expiry_time_secs,
+    az_span sas_token,
+    az_span* out_sas_token);
+
+#include <_az_cfg_suffix.h>
+
+#endif // _az_IOT_SAS_TOKEN_PRIVATE_H
@@ -0,0 +1,378 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "az_iot_sha256_private.h"
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The SHA extensions are used when the target enables them (e.g. -msha -msse4.1). There is no
+// runtime detection: builds for generic targets get the portable implementation.
+#if defined(__SHA__) && defined(__SSE4_1__)
+#define _az_IOT_SHA256_X86_SHA_NI
+#include <immintrin.h>
+#endif
+
+#include <_az_cfg.h>
+
+static const uint32_t sha256_k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#ifdef _az_IOT_SHA256_X86_SHA_NI
+
+static void _az_iot_sha256_compress(uint32_t state[8], uint8_t const* block)
+{
+  __m128i const byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  // The SHA instructions work on the ABEF and CDGH halves of the state.
+  __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const*)&state[0]), 0xB1); // CDAB
+  __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const*)&state[4]), 0x1B); // EFGH
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0); // CDGH
+
+  __m128i const abef = state0;
+  __m128i const cdgh = state1;
+
+  // Four rounds per iteration, keeping the last 16 message words in w.
+  __m128i w[4];
+  for (int32_t i = 0; i < 16; ++i)
+  {
+    __m128i words;
+    if (i < 4)
+    {
+      words = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const*)(block + 16 * i)), byte_swap);
+    }
+    else
+    {
+      words = _mm_sha256msg2_epu32(
+          _mm_add_epi32(
+              _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]),
+              _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4)),
+          w[(i + 3) & 3]);
+    }
+    w[i & 3] = words;
+
+    __m128i const message = _mm_add_epi32(words, _mm_loadu_si128((__m128i const*)&sha256_k[4 * i]));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(message, 0x0E));
+  }
+
+  state0 = _mm_add_epi32(state0, abef);
+  state1 = _mm_add_epi32(state1, cdgh);
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B); // FEBA
+  state1 = _mm_shuffle_epi32(state1, 0xB1); // DCHG
+  _mm_storeu_si128((__m128i*)&state[0], _mm_blend_epi16(tmp, state1, 0xF0)); // DCBA
+  _mm_storeu_si128((__m128i*)&state[4], _mm_alignr_epi8(state1, tmp, 8)); // HGFE
+}
+
+#else // _az_IOT_SHA256_X86_SHA_NI
+
+AZ_INLINE uint32_t _az_iot_sha256_rotr(uint32_t x, int32_t n) { return (x >> n) | (x << (32 - n)); }
+
+static void _az_iot_sha256_compress(uint32_t state[8], uint8_t const* block)
+{
+  uint32_t w[64];
+  for (int32_t i = 0; i < 16; ++i)
+  {
+    w[i] = ((uint32_t)block[4 * i] << 24) | ((uint32_t)block[4 * i + 1] << 16)
+        | ((uint32_t)block[4 * i + 2] << 8) | (uint32_t)block[4 * i + 3];
+  }
+  for (int32_t i = 16; i < 64; ++i)
+  {
+    uint32_t const s0
+        = _az_iot_sha256_rotr(w[i - 15], 7) ^ _az_iot_sha256_rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t const s1
+        = _az_iot_sha256_rotr(w[i - 2], 17) ^ _az_iot_sha256_rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  uint32_t a = state[0];
+  uint32_t b = state[1];
+  uint32_t c = state[2];
+  uint32_t d = state[3];
+  uint32_t e = state[4];
+  uint32_t f = state[5];
+  uint32_t g = state[6];
+  uint32_t h = state[7];
+
+  for (int32_t i = 0; i < 64; ++i)
+  {
+    uint32_t const s1
+        = _az_iot_sha256_rotr(e, 6) ^ _az_iot_sha256_rotr(e, 11) ^ _az_iot_sha256_rotr(e, 25);
+    uint32_t const ch = (e & f) ^ (~e & g);
+    uint32_t const t1 = h + s1 + ch + sha256_k[i] + w[i];
+    uint32_t const s0
+        = _az_iot_sha256_rotr(a, 2) ^ _az_iot_sha256_rotr(a, 13) ^ _az_iot_sha256_rotr(a, 22);
+    uint32_t const maj = (a & b) ^ (a & c) ^ (b & c);
+    uint32_t const t2 = s0 + maj;
+
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+#endif // _az_IOT_SHA256_X86_SHA_NI
+
+void _az_iot_sha256_init(_az_iot_sha256* sha)
+{
+  *sha = (_az_iot_sha256){
+    .state = { 0x6a09e667,
+               0xbb67ae85,
+               0x3c6ef372,
+               0xa54ff53a,
+               0x510e527f,
+               0x9b05688c,
+               0x1f83d9ab,
+               0x5be0cd19 },
+    .block_length = 0,
+    .total_length = 0,
+  };
+}
+
+void _az_iot_sha256_update(_az_iot_sha256* sha, az_span data)
+{
+  uint8_t const* ptr = az_span_ptr(data);
+  int32_t length = az_span_length(data);
+
+  sha->total_length += (uint64_t)length;
+
+  // Complete a partial block first, then hash whole blocks straight from the input.
+  if (sha->block_length > 0)
+  {
+    while (length > 0 && sha->block_length < _az_IOT_SHA256_BLOCK_SIZE)
+    {
+      sha->block[sha->block_length++] = *ptr++;
+      --length;
+    }
+
+    if (sha->block_length < _az_IOT_SHA256_BLOCK_SIZE)
+    {
+      return;
+    }
+
+    _az_iot_sha256_compress(sha->state, sha->block);
+    sha->block_length = 0;
+  }
+
+  for (; length >= _az_IOT_SHA256_BLOCK_SIZE; length -= _az_IOT_SHA256_BLOCK_SIZE)
+  {
+    _az_iot_sha256_compress(sha->state, ptr);
+    ptr += _az_IOT_SHA256_BLOCK_SIZE;
+  }
+
+  for (int32_t i = 0; i < length; ++i)
+  {
+    sha->block[sha->block_length++] = ptr[i];
+  }
+}
+
+void _az_iot_sha256_final(_az_iot_sha256* sha, uint8_t hash[_az_IOT_SHA256_HASH_SIZE])
+{
+  uint64_t const bit_length = sha->total_length * 8;
+
+  sha->block[sha->block_length++] = 0x80;
+  if (sha->block_length > _az_IOT_SHA256_BLOCK_SIZE - 8)
+  {
+    while (sha->block_length < _az_IOT_SHA256_BLOCK_SIZE)
+    {
+      sha->block[sha->block_length++] = 0;
+    }
+    _az_iot_sha256_compress(sha->state, sha->block);
+    sha->block_length = 0;
+  }
+
+  while (sha->block_length < _az_IOT_SHA256_BLOCK_SIZE - 8)
+  {
+    sha->block[sha->block_length++] = 0;
+  }
+  for (int32_t i = 0; i < 8; ++i)
+  {
+    sha->block[_az_IOT_SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(bit_length >> (8 * i));
+  }
+  _az_iot_sha256_compress(sha->state, sha->block);
+
+  for (int32_t i = 0; i < 8; ++i)
+  {
+    hash[4 * i] = (uint8_t)(sha->state[i] >> 24);
+    hash[4 * i + 1] = (uint8_t)(sha->state[i] >> 16);
+    hash[4 * i + 2] = (uint8_t)(sha->state[i] >> 8);
+    hash[4 * i + 3] = (uint8_t)sha->state[i];
+  }
+}
+
+void _az_iot_hmac_sha256(az_span key, az_span data, uint8_t hmac[_az_IOT_SHA256_HASH_SIZE])
+{
+  uint8_t key_block[_az_IOT_SHA256_BLOCK_SIZE] = { 0 };
+  _az_iot_sha256 sha;
+
+  // Keys longer than a block are hashed first.
+  if (az_span_length(key) > _az_IOT_SHA256_BLOCK_SIZE)
+  {
+    _az_iot_sha256_init(&sha);
+    _az_iot_sha256_update(&sha, key);
+    _az_iot_sha256_final(&sha, key_block);
+  }
+  else
+  {
+    for (int32_t i = 0; i < az_span_length(key); ++i)
+    {
+      key_block[i] = az_span_ptr(key)[i];
+    }
+  }
+
+  uint8_t pad[_az_IOT_SHA256_BLOCK_SIZE];
+  for (int32_t i = 0; i < _az_IOT_SHA256_BLOCK_SIZE; ++i)
+  {
+    pad[i] = key_block[i] ^ 0x36;
+  }
+
+  uint8_t inner[_az_IOT_SHA256_HASH_SIZE];
+  _az_iot_sha256_init(&sha);
+  _az_iot_sha256_update(&sha, AZ_SPAN_FROM_INITIALIZED_BUFFER(pad));
+  _az_iot_sha256_update(&sha, data);
+  _az_iot_sha256_final(&sha, inner);
+
+  for (int32_t i = 0; i < _az_IOT_SHA256_BLOCK_SIZE; ++i)
+  {
+    pad[i] = key_block[i] ^ 0x5c;
+  }
+
+  _az_iot_sha256_init(&sha);
+  _az_iot_sha256_update(&sha, AZ_SPAN_FROM_INITIALIZED_BUFFER(pad));
+  _az_iot_sha256_update(&sha, AZ_SPAN_FROM_INITIALIZED_BUFFER(inner));
+  _az_iot_sha256_final(&sha, hmac);
+}
+
+static const uint8_t base64_alphabet[]
+    = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const uint8_t base64_padding = '=';
+
+AZ_NODISCARD az_result
+_az_iot_base64_encode(az_span destination, az_span source, az_span* out_span)
+{
+  uint8_t const* const src = az_span_ptr(source);
+  int32_t const length = az_span_length(source);
+  int32_t const encoded_length = (length + 2) / 3 * 4;
+
+  if (az_span_capacity(destination) < encoded_length)
+  {
+    return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+  }
+
+  uint8_t* dst = az_span_ptr(destination);
+  for (int32_t i = 0; i < length; i += 3)
+  {
+    int32_t const remaining = length - i;
+    uint32_t const triple = ((uint32_t)src[i] << 16)
+        | (remaining > 1 ? (uint32_t)src[i + 1] << 8 : 0) | (remaining > 2 ? src[i + 2] : 0);
+
+    *dst++ = base64_alphabet[(triple >> 18) & 0x3F];
+    *dst++ = base64_alphabet[(triple >> 12) & 0x3F];
+    *dst++ = remaining > 1 ? base64_alphabet[(triple >> 6) & 0x3F] : base64_padding;
+    *dst++ = remaining > 2 ? base64_alphabet[triple & 0x3F] : base64_padding;
+  }
+
+  *out_span = az_span_init(az_span_ptr(destination), encoded_length, az_span_capacity(destination));
+  return AZ_OK;
+}
+
+// Returns the 6-bit value of a base64 character, or -1.
+static int32_t _az_iot_base64_value(uint8_t c)
+{
+  if (c >= 'A' && c <= 'Z')
+  {
+    return c - 'A';
+  }
+  if (c >= 'a' && c <= 'z')
+  {
+    return c - 'a' + 26;
+  }
+  if (c >= '0' && c <= '9')
+  {
+    return c - '0' + 52;
+  }
+  return c == '+' ? 62 : c == '/' ? 63 : -1;
+}
+
+AZ_NODISCARD az_result
+_az_iot_base64_decode(az_span destination, az_span source, az_span* out_span)
+{
+  uint8_t const* const src = az_span_ptr(source);
+  int32_t const length = az_span_length(source);
+
+  if (length % 4 != 0)
+  {
+    return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
+  }
+
+  int32_t const padding = length == 0 ? 0
+      : src[length - 1] != base64_padding ? 0
+      : src[length - 2] != base64_padding ? 1
+                                          : 2;
+  int32_t const decoded_length = length / 4 * 3 - padding;
+
+  if (az_span_capacity(destination) < decoded_length)
+  {
+    return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+  }
+
+  uint8_t* const dst = az_span_ptr(destination);
+  int32_t written = 0;
+  for (int32_t i = 0; i < length; i += 4)
+  {
+    bool const last = i + 4 == length;
+    uint32_t quad = 0;
+    for (int32_t j = 0; j < 4; ++j)
+    {
+      int32_t value = 0;
+      if (!(last && j >= 4 - padding))
+      {
+        value = _az_iot_base64_value(src[i + j]);
+        if (value < 0)
+        {
+          return AZ_ERROR_PARSER_UNEXPECTED_CHAR;
+        }
+      }
+      quad = (quad << 6) | (uint32_t)value;
+    }
+
+    dst[written++] = (uint8_t)(quad >> 16);
+    if (written < decoded_length)
+    {
+      dst[written++] = (uint8_t)(quad >> 8);
+    }
+    if (written < decoded_length)
+    {
+      dst[written++] = (uint8_t)quad;
+    }
+  }
+
+  *out_span = az_span_init(dst, decoded_length, az_span_capacity(destination));
+  return AZ_OK;
+}
@@ -0,0 +1,57 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#ifndef _az_IOT_SHA256_PRIVATE_H
+#define _az_IOT_SHA256_PRIVATE_H
+
+#include <az_result.h>
+#include <az_span.h>
+
+#include <stdint.h>
+
+#include <_az_cfg_prefix.h>
+
+enum
+{
+  _az_IOT_SHA256_HASH_SIZE = 32,
+  _az_IOT_SHA256_BLOCK_SIZE = 64,
+};
+
+/**
+ * @brief SHA-256 hashing state.
+ */
+typedef struct
+{
+  uint32_t state[8];
+  uint8_t block[_az_IOT_SHA256_BLOCK_SIZE];
+  int32_t block_length;
+  uint64_t total_length;
+} _az_iot_sha256;
+
+void _az_iot_sha256_init(_az_iot_sha256* sha);
+
+void _az_iot_sha256_update(_az_iot_sha256* sha, az_span data);
+
+void _az_iot_sha256_final(_az_iot_sha256* sha, uint8_t hash[_az_IOT_SHA256_HASH_SIZE]);
+
+/**
+ * @brief Computes the HMAC-SHA256 of \p data with \p key.
+ */
+void _az_iot_hmac_sha256(az_span key, az_span data, uint8_t hmac[_az_IOT_SHA256_HASH_SIZE]);
+
+/**
+ * @brief Base64 encodes \p source into \p destination, with padding.
+ */
+AZ_NODISCARD az_result
+_az_iot_base64_encode(az_span destination, az_span source, az_span* out_span);
+
+/**
+ * @brief Base64 decodes \p source into \p destination. The length of \p source must be a multiple
+ * of 4, with padding.
+ */
+AZ_NODISCARD az_result
+_az_iot_base64_decode(az_span destination, az_span source, az_span* out_span);
+
+#include <_az_cfg_suffix.h>
+
+#endif // _az_IOT_SHA256_PRIVATE_H
@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include "az_iot_hub_client.h"
+#include "az_iot_telemetry_private.h"
 #include <az_precondition.h>
 #include <az_precondition_internal.h>
 #include <az_result.h>
@@ -18,42 +19,87 @@ static const az_span telemetry_topic_prefix = AZ_SPAN_LITERAL_FROM_STR("devices/
 static const az_span telemetry_topic_modules_mid = AZ_SPAN_LITERAL_FROM_STR("/modules/");
 static const az_span telemetry_topic_suffix = AZ_SPAN_LITERAL_FROM_STR("/messages/events/");
 
-AZ_NODISCARD az_result az_iot_hub_client_telemetry_publish_topic_get(
-    az_iot_hub_client const* client,
-    az_iot_hub_client_properties const* properties,
-    az_span mqtt_topic,
-    az_span* out_mqtt_topic)
+// Appends "devices/<device id>[/modules/<module id>]/messages/events/".
+static AZ_NODISCARD az_result
+_az_iot_hub_client_telemetry_topic_prefix_append(az_iot_hub_client const* client, az_span* topic)
 {
-  AZ_PRECONDITION_NOT_NULL(client);
-  AZ_PRECONDITION_VALID_SPAN(mqtt_topic, 0, false);
-  AZ_PRECONDITION_NOT_NULL(out_mqtt_topic);
-
-  const az_span* user_agent = &(client->_internal.options.user_agent);
-  const az_span* module_id = &(client->_internal.options.module_id);
+  az_span const module_id = client->_internal.options.module_id;
 
-  // Required topic parts
-  int32_t required_size = az_span_length(telemetry_topic_prefix)
-      + az_span_length(client->_internal.device_id) + az_span_length(telemetry_topic_suffix)
-      + sizeof(telemetry_null_terminator);
+  AZ_RETURN_IF_FAILED(az_span_append(*topic, telemetry_topic_prefix, topic));
+  AZ_RETURN_IF_FAILED(az_span_append(*topic, client->_internal.device_id, topic));
 
-  // Optional parts
-  if (az_span_ptr(*module_id) != NULL)
+  if (az_span_length(module_id) != 0)
   {
-    required_size += az_span_length(telemetry_topic_modules_mid);
-    required_size += az_span_length(*module_id);
+    AZ_RETURN_IF_FAILED(az_span_append(*topic, telemetry_topic_modules_mid, topic));
+    AZ_RETURN_IF_FAILED(az_span_append(*topic, module_id, topic));
   }
 
+  return az_span_append(*topic, telemetry_topic_suffix, topic);
+}
+
+static int32_t _az_iot_hub_client_telemetry_topic_prefix_length(az_iot_hub_client const* client)
+{
+  int32_t const module_id_length = az_span_length(client->_internal.options.module_id);
+
+  return az_span_length(telemetry_topic_prefix) + az_span_length(client->_internal.device_id)
+      + (module_id_length != 0 ? az_span_length(telemetry_topic_modules_mid) + module_id_length
+                               : 0)
+      + az_span_length(telemetry_topic_suffix);
+}
+
+void _az_iot_hub_client_telemetry_topic_prefix_init(az_iot_hub_client* client)
+{
+  az_span prefix = AZ_SPAN_FROM_BUFFER(client->_internal.telemetry_topic_prefix);
+
+  // Ids longer than IoT Hub allows leave the prefix empty: topics are then built piece by piece.
+  client->_internal.telemetry_topic_prefix_length
+      = az_succeeded(_az_iot_hub_client_telemetry_topic_prefix_append(client, &prefix))
+      ? (int16_t)az_span_length(prefix)
+      : 0;
+}
+
+// Length of the telemetry topic, without its null terminator.
+static int32_t _az_iot_hub_client_telemetry_topic_length(
+    az_iot_hub_client const* client,
+    az_iot_hub_client_properties const* properties)
+{
+  az_span const user_agent = client->_internal.options.user_agent;
+  int32_t const prefix_length = client->_internal.telemetry_topic_prefix_length;
+
+  // Required topic parts
+  int32_t length = prefix_length > 0 ? prefix_length
+                                     : _az_iot_hub_client_telemetry_topic_prefix_length(client);
+
+  // Optional parts
   if (properties != NULL)
   {
-    required_size
-        += az_span_length(properties->_internal.properties) + sizeof(telemetry_prop_delim);
+    length += az_span_length(properties->_internal.properties)
+        + (int32_t)sizeof(telemetry_prop_delim);
   }
 
-  if (az_span_ptr(*user_agent) != NULL)
+  if (az_span_length(user_agent) != 0)
   {
-    required_size += az_span_length(*user_agent) + sizeof(telemetry_prop_delim);
+    length += az_span_length(user_agent) + (int32_t)sizeof(telemetry_prop_delim);
   }
 
+  return length;
+}
+
+AZ_NODISCARD az_result az_iot_hub_client_telemetry_publish_topic_get(
+    az_iot_hub_client const* client,
+    az_iot_hub_client_properties const* properties,
+    az_span mqtt_topic,
+    az_span* out_mqtt_topic)
+{
+  AZ_PRECONDITION_NOT_NULL(client);
+  AZ_PRECONDITION_VALID_SPAN(mqtt_topic, 0, false);
+  AZ_PRECONDITION_NOT_NULL(out_mqtt_topic);
+
+  az_span const user_agent = client->_internal.options.user_agent;
+  int32_t const prefix_length = client->_internal.telemetry_topic_prefix_length;
+  int32_t const required_size = _az_iot_hub_client_telemetry_topic_length(client, properties)
+      + (int32_t)sizeof(telemetry_null_terminator);
+
   // Only build topic if the span has the capacity
   if (az_span_capacity(mqtt_topic) < required_size)
   {
@@ -61,17 +107,17 @@ AZ_NODISCARD az_result az_iot_hub_client_telemetry_publish_topic_get(
   }
 
   // Build topic string
-  AZ_RETURN_IF_FAILED(az_span_append(mqtt_topic, telemetry_topic_prefix, out_mqtt_topic));
-  AZ_RETURN_IF_FAILED(az_span_append(*out_mqtt_topic, client->_internal.device_id, out_mqtt_topic));
-
-  if (az_span_length(*module_id) != 0)
+  *out_mqtt_topic = mqtt_topic;
+  if (prefix_length > 0)
   {
-    AZ_RETURN_IF_FAILED(
-        az_span_append(*out_mqtt_topic, telemetry_topic_modules_mid, out_mqtt_topic));
-    AZ_RETURN_IF_FAILED(az_span_append(*out_mqtt_topic, *module_id, out_mqtt_topic));
+    uint8_t* const prefix = (uint8_t*)client->_internal.telemetry_topic_prefix;
+    AZ_RETURN_IF_FAILED(az_span_append(
+        *out_mqtt_topic, az_span_init(prefix, prefix_length, prefix_length), out_mqtt_topic));
+  }
+  else
+  {
+    AZ_RETURN_IF_FAILED(_az_iot_hub_client_telemetry_topic_prefix_append(client, out_mqtt_topic));
   }
-
-  AZ_RETURN_IF_FAILED(az_span_append(*out_mqtt_topic, telemetry_topic_suffix, out_mqtt_topic));
 
   if (properties != NULL)
   {
@@ -81,13 +127,13 @@ AZ_NODISCARD az_result az_iot_hub_client_telemetry_publish_topic_get(
         az_span_append(*out_mqtt_topic, properties->_internal.properties, out_mqtt_topic));
   }
 
-  if (az_span_length(*user_agent) != 0)
+  if (az_span_length(user_agent) != 0)
   {
     AZ_RETURN_IF_FAILED(
         properties == NULL
             ? az_span_append_uint8(*out_mqtt_topic, telemetry_prop_delim, out_mqtt_topic)
             : az_span_append_uint8(*out_mqtt_topic, telemetry_prop_separator, out_mqtt_topic));
-    AZ_RETURN_IF_FAILED(az_span_append(*out_mqtt_topic, *user_agent, out_mqtt_topic));
+    AZ_RETURN_IF_FAILED(az_span_append(*out_mqtt_topic, user_agent, out_mqtt_topic));
   }
 
   AZ_RETURN_IF_FAILED(
@@ -95,3 +141,133 @@ AZ_NODISCARD az_result az_iot_hub_client_telemetry_publish_topic_get(
 
   return AZ_OK;
 }
+
+static const az_span telemetry_batch_content_type_name = AZ_SPAN_LITERAL_FROM_STR("$.ct");
+static const az_span telemetry_batch_content_type = AZ_SPAN_LITERAL_FROM_STR("application%2Fjson");
+static const az_span telemetry_batch_content_encoding_name = AZ_SPAN_LITERAL_FROM_STR("$.ce");
+static const az_span telemetry_batch_content_encoding = AZ_SPAN_LITERAL_FROM_STR("utf-8");
+static const uint8_t telemetry_batch_begin = '[';
+static const uint8_t telemetry_batch_separator = ',';
+static const uint8_t telemetry_batch_end = ']';
+
+// Appends a system property of the batch, unless the properties were already used by a batch.
+static AZ_NODISCARD az_result _az_iot_hub_client_telemetry_batch_property_set(
+    az_iot_hub_client_properties* properties,
+    az_span name,
+    az_span value)
+{
+  az_span existing = AZ_SPAN_NULL;
+  if (az_succeeded(az_iot_hub_client_properties_find(properties, name, &existing)))
+  {
+    return az_span_is_content_equal(existing, value) ? AZ_OK : AZ_ERROR_ARG;
+  }
+
+  return az_iot_hub_client_properties_append(properties, name, value);
+}
+
+AZ_NODISCARD az_result az_iot_hub_client_telemetry_batch_init(
+    az_iot_hub_client const* client,
+    az_iot_hub_client_telemetry_batch* batch,
+    az_span payload_buffer,
+    az_iot_hub_client_properties* properties)
+{
+  AZ_PRECONDITION_NOT_NULL(client);
+  AZ_PRECONDITION_NOT_NULL(batch);
+  AZ_PRECONDITION_VALID_SPAN(payload_buffer, 0, false);
+
+  // The payload needs room for at least "[]".
+  if (az_span_capacity(payload_buffer) < 2)
+  {
+    return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+  }
+
+  if (properties != NULL)
+  {
+    AZ_RETURN_IF_FAILED(_az_iot_hub_client_telemetry_batch_property_set(
+        properties, telemetry_batch_content_type_name, telemetry_batch_content_type));
+    AZ_RETURN_IF_FAILED(_az_iot_hub_client_telemetry_batch_property_set(
+        properties, telemetry_batch_content_encoding_name, telemetry_batch_content_encoding));
+  }
+
+  int32_t const capacity = az_span_capacity(payload_buffer);
+  *batch = (az_iot_hub_client_telemetry_batch){
+    ._internal = {
+      .payload = az_span_init(az_span_ptr(payload_buffer), 0, capacity),
+      .properties = properties,
+      .topic_length = _az_iot_hub_client_telemetry_topic_length(client, NULL)
+          + (properties != NULL ? (int32_t)sizeof(telemetry_prop_delim) : 0),
+      .max_payload_size = capacity < AZ_IOT_HUB_CLIENT_TELEMETRY_MAX_MESSAGE_SIZE
+          ? capacity
+          : AZ_IOT_HUB_CLIENT_TELEMETRY_MAX_MESSAGE_SIZE,
+      .count = 0,
+    },
+  };
+
+  return az_span_append_uint8(
+      batch->_internal.payload, telemetry_batch_begin, &batch->_internal.payload);
+}
+
+AZ_NODISCARD az_result
+az_iot_hub_client_telemetry_batch_append(az_iot_hub_client_telemetry_batch* batch, az_span reading)
+{
+  AZ_PRECONDITION_NOT_NULL(batch);
+  AZ_PRECONDITION_VALID_SPAN(reading, 1, false);
+
+  az_span* const payload = &batch->_internal.payload;
+  int32_t const separator_length = batch->_internal.count > 0 ? 1 : 0;
+  int32_t const properties_length = batch->_internal.properties == NULL
+      ? 0
+      : az_span_length(batch->_internal.properties->_internal.properties);
+
+  // The closing bracket is written by az_iot_hub_client_telemetry_batch_publish_get, but its room
+  // is reserved now.
+  int32_t const required_size = az_span_length(*payload) + separator_length
+      + az_span_length(reading) + (int32_t)sizeof(telemetry_batch_end);
+  if (required_size > batch->_internal.max_payload_size
+      || required_size + batch->_internal.topic_length + properties_length
+          > AZ_IOT_HUB_CLIENT_TELEMETRY_MAX_MESSAGE_SIZE)
+  {
+    return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+  }
+
+  if (separator_length > 0)
+  {
+    AZ_RETURN_IF_FAILED(az_span_append_uint8(*payload, telemetry_batch_separator, payload));
+  }
+  AZ_RETURN_IF_FAILED(az_span_append(*payload, reading, payload));
+
+  ++batch->_internal.count;
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_iot_hub_client_telemetry_batch_publish_get(
+    az_iot_hub_client const* client,
+    az_iot_hub_client_telemetry_batch const* batch,
+    az_span mqtt_topic,
+    az_span* out_mqtt_topic,
+    az_span* out_payload)
+{
+  AZ_PRECONDITION_NOT_NULL(client);
+  AZ_PRECONDITION_NOT_NULL(batch);
+  AZ_PRECONDITION(batch->_internal.count > 0);
+  AZ_PRECONDITION_NOT_NULL(out_mqtt_topic);
+  AZ_PRECONDITION_NOT_NULL(out_payload);
+
+  AZ_RETURN_IF_FAILED(az_iot_hub_client_telemetry_publish_topic_get(
+      client, batch->_internal.properties, mqtt_topic, out_mqtt_topic));
+
+  // The room of the closing bracket was reserved by az_iot_hub_client_telemetry_batch_append. It
+  // is not counted in the batch, so more readings can still be appended.
+  az_span const payload = batch->_internal.payload;
+  return az_span_append_uint8(payload, telemetry_batch_end, out_payload);
+}
+
+void az_iot_hub_client_telemetry_batch_reset(az_iot_hub_client_telemetry_batch* batch)
+{
+  AZ_PRECONDITION_NOT_NULL(batch);
+
+  // Keep the opening bracket.
+  batch->_internal.payload = az_span_init(
+      az_span_ptr(batch->_internal.payload), 1, az_span_capacity(batch->_internal.payload));
+  batch->_internal.count = 0;
+}
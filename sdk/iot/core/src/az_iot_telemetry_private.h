@@ -0,0 +1,20 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#ifndef _az_IOT_TELEMETRY_PRIVATE_H
+#define _az_IOT_TELEMETRY_PRIVATE_H
+
+#include "az_iot_hub_client.h"
+#include <az_result.h>
+
+#include <_az_cfg_prefix.h>
+
+/**
+ * @brief Computes the constant part of the telemetry topic of \p client, so that
+ * az_iot_hub_client_telemetry_publish_topic_get only has to copy it.
+ */
+void _az_iot_hub_client_telemetry_topic_prefix_init(az_iot_hub_client* client);
+
+#include <_az_cfg_suffix.h>
+
+#endif // _az_IOT_TELEMETRY_PRIVATE_H
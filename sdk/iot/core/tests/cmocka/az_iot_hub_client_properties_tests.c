@@ -0,0 +1,169 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_iot_hub_client.h>
+#include <az_span.h>
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmocka.h>
+
+#define TEST_PARAMS "key=value&key_two=value2"
+
+void test_az_iot_hub_client_properties_append_succeed(void** state)
+{
+  (void)state;
+
+  uint8_t buffer[sizeof(TEST_PARAMS) - 1];
+  az_iot_hub_client_properties props;
+  assert_true(az_iot_hub_client_properties_init(&props, AZ_SPAN_FROM_BUFFER(buffer)) == AZ_OK);
+
+  assert_true(
+      az_iot_hub_client_properties_append(
+          &props, AZ_SPAN_FROM_STR("key"), AZ_SPAN_FROM_STR("value"))
+      == AZ_OK);
+  assert_true(
+      az_iot_hub_client_properties_append(
+          &props, AZ_SPAN_FROM_STR("key_two"), AZ_SPAN_FROM_STR("value2"))
+      == AZ_OK);
+  assert_true(
+      az_span_is_content_equal(props._internal.properties, AZ_SPAN_FROM_STR(TEST_PARAMS)));
+
+  // A property that doesn't fit leaves the properties unchanged.
+  assert_true(
+      az_iot_hub_client_properties_append(&props, AZ_SPAN_FROM_STR("k"), AZ_SPAN_FROM_STR("v"))
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+  assert_true(
+      az_span_is_content_equal(props._internal.properties, AZ_SPAN_FROM_STR(TEST_PARAMS)));
+}
+
+void test_az_iot_hub_client_properties_find_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_client_properties props;
+  assert_true(
+      az_iot_hub_client_properties_init(&props, AZ_SPAN_FROM_STR(TEST_PARAMS "&key=other"))
+      == AZ_OK);
+
+  az_span value;
+  assert_true(az_iot_hub_client_properties_find(&props, AZ_SPAN_FROM_STR("key"), &value) == AZ_OK);
+  assert_true(az_span_is_content_equal(value, AZ_SPAN_FROM_STR("value")));
+
+  assert_true(
+      az_iot_hub_client_properties_find(&props, AZ_SPAN_FROM_STR("key_two"), &value) == AZ_OK);
+  assert_true(az_span_is_content_equal(value, AZ_SPAN_FROM_STR("value2")));
+
+  assert_true(
+      az_iot_hub_client_properties_find(&props, AZ_SPAN_FROM_STR("ke"), &value)
+      == AZ_ERROR_ITEM_NOT_FOUND);
+}
+
+void test_az_iot_hub_client_properties_next_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_client_properties props;
+  assert_true(az_iot_hub_client_properties_init(&props, AZ_SPAN_FROM_STR(TEST_PARAMS)) == AZ_OK);
+
+  az_pair pair;
+  assert_true(az_iot_hub_client_properties_next(&props, &pair) == AZ_OK);
+  assert_true(az_span_is_content_equal(pair.key, AZ_SPAN_FROM_STR("key")));
+  assert_true(az_span_is_content_equal(pair.value, AZ_SPAN_FROM_STR("value")));
+
+  assert_true(az_iot_hub_client_properties_next(&props, &pair) == AZ_OK);
+  assert_true(az_span_is_content_equal(pair.key, AZ_SPAN_FROM_STR("key_two")));
+  assert_true(az_span_is_content_equal(pair.value, AZ_SPAN_FROM_STR("value2")));
+
+  assert_true(az_iot_hub_client_properties_next(&props, &pair) == AZ_ERROR_EOF);
+}
+
+void test_az_iot_hub_client_properties_index_find_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_client_properties props;
+  assert_true(
+      az_iot_hub_client_properties_init(
+          &props, AZ_SPAN_FROM_STR("?" TEST_PARAMS "&key=other&flag&empty="))
+      == AZ_OK);
+  assert_true(az_span_is_content_equal(
+      props._internal.properties, AZ_SPAN_FROM_STR(TEST_PARAMS "&key=other&flag&empty=")));
+
+  az_iot_hub_client_properties_index_entry entries[5];
+  assert_true(
+      az_iot_hub_client_properties_index_init(&props, entries, _az_COUNTOF(entries)) == AZ_OK);
+
+  // The first of several properties with the same name is found.
+  az_span value;
+  assert_true(az_iot_hub_client_properties_find(&props, AZ_SPAN_FROM_STR("key"), &value) == AZ_OK);
+  assert_true(az_span_is_content_equal(value, AZ_SPAN_FROM_STR("value")));
+
+  assert_true(
+      az_iot_hub_client_properties_find(&props, AZ_SPAN_FROM_STR("key_two"), &value) == AZ_OK);
+  assert_true(az_span_is_content_equal(value, AZ_SPAN_FROM_STR("value2")));
+
+  // A property without value has no value, and one with an empty value has an empty value.
+  assert_true(az_iot_hub_client_properties_find(&props, AZ_SPAN_FROM_STR("flag"), &value) == AZ_OK);
+  assert_true(az_span_ptr(value) == NULL && az_span_length(value) == 0);
+  assert_true(
+      az_iot_hub_client_properties_find(&props, AZ_SPAN_FROM_STR("empty"), &value) == AZ_OK);
+  assert_true(az_span_ptr(value) != NULL && az_span_length(value) == 0);
+
+  assert_true(
+      az_iot_hub_client_properties_find(&props, AZ_SPAN_FROM_STR("ke"), &value)
+      == AZ_ERROR_ITEM_NOT_FOUND);
+
+  // More properties than entries. The scan finds the same values.
+  az_iot_hub_client_properties_index_entry small_entries[4];
+  assert_true(
+      az_iot_hub_client_properties_index_init(&props, small_entries, _az_COUNTOF(small_entries))
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+  assert_true(props._internal.index == NULL);
+  assert_true(az_iot_hub_client_properties_find(&props, AZ_SPAN_FROM_STR("flag"), &value) == AZ_OK);
+  assert_true(az_span_ptr(value) == NULL && az_span_length(value) == 0);
+  assert_true(
+      az_iot_hub_client_properties_find(&props, AZ_SPAN_FROM_STR("empty"), &value) == AZ_OK);
+  assert_true(az_span_ptr(value) != NULL && az_span_length(value) == 0);
+}
+
+void test_az_iot_hub_client_properties_index_append_succeed(void** state)
+{
+  (void)state;
+
+  uint8_t buffer[64];
+  az_iot_hub_client_properties props;
+  assert_true(az_iot_hub_client_properties_init(&props, AZ_SPAN_FROM_BUFFER(buffer)) == AZ_OK);
+
+  az_iot_hub_client_properties_index_entry entries[2];
+  assert_true(
+      az_iot_hub_client_properties_index_init(&props, entries, _az_COUNTOF(entries)) == AZ_OK);
+
+  assert_true(
+      az_iot_hub_client_properties_append(
+          &props, AZ_SPAN_FROM_STR("key"), AZ_SPAN_FROM_STR("value"))
+      == AZ_OK);
+  assert_true(
+      az_iot_hub_client_properties_append(
+          &props, AZ_SPAN_FROM_STR("key_two"), AZ_SPAN_FROM_STR("value2"))
+      == AZ_OK);
+  assert_true(props._internal.index_count == 2);
+
+  az_span value;
+  assert_true(
+      az_iot_hub_client_properties_find(&props, AZ_SPAN_FROM_STR("key_two"), &value) == AZ_OK);
+  assert_true(az_span_is_content_equal(value, AZ_SPAN_FROM_STR("value2")));
+
+  // Once the entries are exhausted, the index is dropped and lookups scan the properties.
+  assert_true(
+      az_iot_hub_client_properties_append(&props, AZ_SPAN_FROM_STR("k3"), AZ_SPAN_FROM_STR("v3"))
+      == AZ_OK);
+  assert_true(props._internal.index == NULL);
+  assert_true(az_iot_hub_client_properties_find(&props, AZ_SPAN_FROM_STR("k3"), &value) == AZ_OK);
+  assert_true(az_span_is_content_equal(value, AZ_SPAN_FROM_STR("v3")));
+  assert_true(az_iot_hub_client_properties_find(&props, AZ_SPAN_FROM_STR("key"), &value) == AZ_OK);
+  assert_true(az_span_is_content_equal(value, AZ_SPAN_FROM_STR("value")));
+}
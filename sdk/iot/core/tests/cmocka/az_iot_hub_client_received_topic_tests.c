@@ -0,0 +1,132 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_iot_hub_client.h>
+#include <az_span.h>
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmocka.h>
+
+#define TEST_DEVICE_ID "my_device"
+#define TEST_HUB_HOSTNAME "myiothub.azure-devices.net"
+
+static az_iot_hub_client test_received_topic_client(void)
+{
+  az_iot_hub_client client;
+  assert_true(
+      az_iot_hub_client_init(
+          &client, AZ_SPAN_FROM_STR(TEST_HUB_HOSTNAME), AZ_SPAN_FROM_STR(TEST_DEVICE_ID), NULL)
+      == AZ_OK);
+  return client;
+}
+
+void test_az_iot_hub_client_received_topic_parse_c2d_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_client client = test_received_topic_client();
+  az_span const received_topic = AZ_SPAN_FROM_STR(
+      "devices/" TEST_DEVICE_ID "/messages/devicebound/%24.to=%2Fdevices%2Fmy_device&abc=123");
+
+  az_iot_hub_client_received_topic topic;
+  assert_true(az_iot_hub_client_received_topic_parse(&client, received_topic, &topic) == AZ_OK);
+  assert_true(topic.type == AZ_IOT_HUB_CLIENT_TOPIC_TYPE_C2D);
+
+  az_span value;
+  assert_true(
+      az_iot_hub_client_properties_find(
+          &topic.parsed.c2d.properties, AZ_SPAN_FROM_STR("abc"), &value)
+      == AZ_OK);
+  assert_true(az_span_is_content_equal(value, AZ_SPAN_FROM_STR("123")));
+
+  az_iot_hub_client_c2d_request request;
+  assert_true(
+      az_iot_hub_client_c2d_received_topic_parse(&client, received_topic, &request) == AZ_OK);
+
+  // Another device's topic.
+  assert_true(
+      az_iot_hub_client_received_topic_parse(
+          &client, AZ_SPAN_FROM_STR("devices/other/messages/devicebound/a=b"), &topic)
+      == AZ_ERROR_IOT_TOPIC_NO_MATCH);
+}
+
+void test_az_iot_hub_client_received_topic_parse_method_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_client client = test_received_topic_client();
+  az_span const received_topic = AZ_SPAN_FROM_STR("$iothub/methods/POST/reboot/?$rid=1");
+
+  az_iot_hub_client_received_topic topic;
+  assert_true(az_iot_hub_client_received_topic_parse(&client, received_topic, &topic) == AZ_OK);
+  assert_true(topic.type == AZ_IOT_HUB_CLIENT_TOPIC_TYPE_METHOD);
+  assert_true(az_span_is_content_equal(topic.parsed.method.name, AZ_SPAN_FROM_STR("reboot")));
+  assert_true(az_span_is_content_equal(topic.parsed.method.request_id, AZ_SPAN_FROM_STR("1")));
+
+  az_iot_hub_client_method_request request;
+  assert_true(
+      az_iot_hub_client_methods_received_topic_parse(&client, received_topic, &request) == AZ_OK);
+  assert_true(az_span_is_content_equal(request.name, AZ_SPAN_FROM_STR("reboot")));
+
+  // A method topic is not a twin topic.
+  az_iot_hub_client_twin_response response;
+  assert_true(
+      az_iot_hub_client_twin_received_topic_parse(&client, received_topic, &response)
+      == AZ_ERROR_IOT_TOPIC_NO_MATCH);
+
+  assert_true(
+      az_iot_hub_client_received_topic_parse(
+          &client, AZ_SPAN_FROM_STR("$iothub/methods/POST/reboot"), &topic)
+      == AZ_ERROR_IOT_TOPIC_NO_MATCH);
+}
+
+void test_az_iot_hub_client_received_topic_parse_twin_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_client client = test_received_topic_client();
+  az_iot_hub_client_received_topic topic;
+
+  assert_true(
+      az_iot_hub_client_received_topic_parse(
+          &client, AZ_SPAN_FROM_STR("$iothub/twin/res/200/?$rid=2"), &topic)
+      == AZ_OK);
+  assert_true(topic.type == AZ_IOT_HUB_CLIENT_TOPIC_TYPE_TWIN);
+  assert_true(topic.parsed.twin.response_type == AZ_IOT_CLIENT_TWIN_RESPONSE_TYPE_GET);
+  assert_true(topic.parsed.twin.status == AZ_IOT_HUB_CLIENT_STATUS_OK);
+  assert_true(az_span_is_content_equal(topic.parsed.twin.request_id, AZ_SPAN_FROM_STR("2")));
+  assert_true(az_span_length(topic.parsed.twin.version) == 0);
+
+  assert_true(
+      az_iot_hub_client_received_topic_parse(
+          &client, AZ_SPAN_FROM_STR("$iothub/twin/res/204/?$rid=3&$version=7"), &topic)
+      == AZ_OK);
+  assert_true(
+      topic.parsed.twin.response_type == AZ_IOT_CLIENT_TWIN_RESPONSE_TYPE_REPORTED_PROPERTIES);
+  assert_true(topic.parsed.twin.status == AZ_IOT_HUB_CLIENT_STATUS_NO_CONTENT);
+  assert_true(az_span_is_content_equal(topic.parsed.twin.request_id, AZ_SPAN_FROM_STR("3")));
+  assert_true(az_span_is_content_equal(topic.parsed.twin.version, AZ_SPAN_FROM_STR("7")));
+
+  az_iot_hub_client_twin_response response;
+  assert_true(
+      az_iot_hub_client_twin_received_topic_parse(
+          &client, AZ_SPAN_FROM_STR("$iothub/twin/PATCH/properties/desired/?$version=8"), &response)
+      == AZ_OK);
+  assert_true(response.response_type == AZ_IOT_CLIENT_TWIN_RESPONSE_TYPE_DESIRED_PROPERTIES);
+  assert_true(az_span_is_content_equal(response.version, AZ_SPAN_FROM_STR("8")));
+
+  assert_true(
+      az_iot_hub_client_received_topic_parse(
+          &client, AZ_SPAN_FROM_STR("$iothub/twin/res/abc/?$rid=2"), &topic)
+      == AZ_ERROR_IOT_TOPIC_NO_MATCH);
+  assert_true(
+      az_iot_hub_client_received_topic_parse(&client, AZ_SPAN_FROM_STR("$iothub/twin"), &topic)
+      == AZ_ERROR_IOT_TOPIC_NO_MATCH);
+  assert_true(
+      az_iot_hub_client_received_topic_parse(&client, AZ_SPAN_FROM_STR("other/topic"), &topic)
+      == AZ_ERROR_IOT_TOPIC_NO_MATCH);
+}
@@ -21,3 +21,56 @@ void test_az_iot_hub_client_get_default_options_succeed(void** state)
   assert_true(az_span_is_content_equal(options.module_id, AZ_SPAN_NULL));
   assert_true(az_span_is_content_equal(options.user_agent, AZ_SPAN_NULL));
 }
+
+void test_az_iot_hub_client_init_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_client_options options = az_iot_hub_client_options_default();
+  options.module_id = AZ_SPAN_FROM_STR("my_module_id");
+
+  az_iot_hub_client client;
+  assert_true(
+      az_iot_hub_client_init(
+          &client,
+          AZ_SPAN_FROM_STR("myiothub.azure-devices.net"),
+          AZ_SPAN_FROM_STR("my_device"),
+          &options)
+      == AZ_OK);
+
+  assert_true(az_span_is_content_equal(
+      client._internal.iot_hub_hostname, AZ_SPAN_FROM_STR("myiothub.azure-devices.net")));
+  assert_true(az_span_is_content_equal(client._internal.device_id, AZ_SPAN_FROM_STR("my_device")));
+  assert_true(
+      az_span_is_content_equal(client._internal.options.module_id, options.module_id));
+
+  // The constant part of the telemetry topic is computed once.
+  az_span const expected_prefix
+      = AZ_SPAN_FROM_STR("devices/my_device/modules/my_module_id/messages/events/");
+  assert_int_equal(
+      client._internal.telemetry_topic_prefix_length, az_span_length(expected_prefix));
+  assert_memory_equal(
+      client._internal.telemetry_topic_prefix,
+      az_span_ptr(expected_prefix),
+      (size_t)az_span_length(expected_prefix));
+}
+
+void test_az_iot_hub_client_init_NULL_options_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_client client;
+  assert_true(
+      az_iot_hub_client_init(
+          &client,
+          AZ_SPAN_FROM_STR("myiothub.azure-devices.net"),
+          AZ_SPAN_FROM_STR("my_device"),
+          NULL)
+      == AZ_OK);
+
+  assert_true(az_span_is_content_equal(client._internal.options.module_id, AZ_SPAN_NULL));
+  assert_true(az_span_is_content_equal(client._internal.options.user_agent, AZ_SPAN_NULL));
+  assert_int_equal(
+      client._internal.telemetry_topic_prefix_length,
+      sizeof("devices/my_device/messages/events/") - 1);
+}
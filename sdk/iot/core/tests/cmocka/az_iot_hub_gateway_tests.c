@@ -0,0 +1,163 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_iot_hub_client.h>
+#include <az_iot_hub_gateway.h>
+#include <az_span.h>
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmocka.h>
+
+#define TEST_HUB_HOSTNAME "myiothub.azure-devices.net"
+#define TEST_GROUP_KEY "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8="
+#define TEST_DEVICE_KEY "BwcHBwcHBwcHBwcHBwcHBwcHBwcHBwcHBwcHBwcHBwc="
+#define TEST_TIME 1578941692
+
+void test_az_iot_hub_gateway_get_client_succeed(void** state)
+{
+  (void)state;
+
+  az_span device_ids[2];
+  int32_t sas_expiry_times[2];
+  az_iot_hub_gateway_devices const devices = {
+    .device_ids = device_ids,
+    .keys = NULL,
+    .sas_expiry_times = sas_expiry_times,
+    .capacity = _az_COUNTOF(device_ids),
+  };
+
+  az_iot_hub_gateway_options options = az_iot_hub_gateway_options_default();
+  options.group_key = AZ_SPAN_FROM_STR(TEST_GROUP_KEY);
+
+  az_iot_hub_gateway gateway;
+  assert_true(
+      az_iot_hub_gateway_init(&gateway, AZ_SPAN_FROM_STR(TEST_HUB_HOSTNAME), devices, &options)
+      == AZ_OK);
+
+  int32_t leaf1 = -1;
+  int32_t leaf2 = -1;
+  assert_true(
+      az_iot_hub_gateway_add_device(&gateway, AZ_SPAN_FROM_STR("leaf1"), AZ_SPAN_NULL, &leaf1)
+      == AZ_OK);
+  assert_true(
+      az_iot_hub_gateway_add_device(&gateway, AZ_SPAN_FROM_STR("leaf2"), AZ_SPAN_NULL, &leaf2)
+      == AZ_OK);
+  assert_true(leaf1 == 0 && leaf2 == 1);
+  assert_true(az_iot_hub_gateway_device_count(&gateway) == 2);
+
+  int32_t index;
+  assert_true(
+      az_iot_hub_gateway_add_device(&gateway, AZ_SPAN_FROM_STR("leaf3"), AZ_SPAN_NULL, &index)
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+
+  // Without a keys array, devices cannot have keys of their own.
+  gateway._internal.device_count = 1;
+  assert_true(
+      az_iot_hub_gateway_add_device(
+          &gateway, AZ_SPAN_FROM_STR("leaf3"), AZ_SPAN_FROM_STR(TEST_DEVICE_KEY), &index)
+      == AZ_ERROR_ARG);
+  gateway._internal.device_count = 2;
+
+  uint8_t topic_buffer[128];
+  az_span topic;
+  assert_true(
+      az_iot_hub_client_telemetry_publish_topic_get(
+          az_iot_hub_gateway_get_client(&gateway, leaf2),
+          NULL,
+          AZ_SPAN_FROM_BUFFER(topic_buffer),
+          &topic)
+      == AZ_OK);
+  // The topic is null terminated.
+  assert_true(az_span_is_content_equal(
+      topic, az_span_init((uint8_t*)"devices/leaf2/messages/events/", 31, 31)));
+
+  az_iot_hub_client_received_topic received;
+  assert_true(
+      az_iot_hub_client_received_topic_parse(
+          az_iot_hub_gateway_get_client(&gateway, leaf1),
+          AZ_SPAN_FROM_STR("devices/leaf1/messages/devicebound/a=b"),
+          &received)
+      == AZ_OK);
+  assert_true(
+      az_iot_hub_client_received_topic_parse(
+          az_iot_hub_gateway_get_client(&gateway, leaf2),
+          AZ_SPAN_FROM_STR("devices/leaf1/messages/devicebound/a=b"),
+          &received)
+      == AZ_ERROR_IOT_TOPIC_NO_MATCH);
+}
+
+void test_az_iot_hub_gateway_sas_refresh_succeed(void** state)
+{
+  (void)state;
+
+  az_span device_ids[2];
+  az_span keys[2];
+  int32_t sas_expiry_times[2];
+  az_iot_hub_gateway_devices const devices = {
+    .device_ids = device_ids,
+    .keys = keys,
+    .sas_expiry_times = sas_expiry_times,
+    .capacity = _az_COUNTOF(device_ids),
+  };
+
+  az_iot_hub_gateway_options options = az_iot_hub_gateway_options_default();
+  options.group_key = AZ_SPAN_FROM_STR(TEST_GROUP_KEY);
+
+  az_iot_hub_gateway gateway;
+  assert_true(
+      az_iot_hub_gateway_init(&gateway, AZ_SPAN_FROM_STR(TEST_HUB_HOSTNAME), devices, &options)
+      == AZ_OK);
+  assert_true(az_iot_hub_gateway_sas_next_refresh_time(&gateway) == INT32_MAX);
+
+  int32_t leaf1 = -1;
+  int32_t leaf2 = -1;
+  assert_true(
+      az_iot_hub_gateway_add_device(&gateway, AZ_SPAN_FROM_STR("leaf1"), AZ_SPAN_NULL, &leaf1)
+      == AZ_OK);
+  assert_true(
+      az_iot_hub_gateway_add_device(
+          &gateway, AZ_SPAN_FROM_STR("leaf2"), AZ_SPAN_FROM_STR(TEST_DEVICE_KEY), &leaf2)
+      == AZ_OK);
+  assert_true(az_iot_hub_gateway_sas_next_refresh_time(&gateway) == 0);
+
+  // Both devices need a token, and are returned in turn.
+  int32_t index = -1;
+  assert_true(az_iot_hub_gateway_sas_next_refresh(&gateway, TEST_TIME, &index) == AZ_OK);
+  assert_true(index == leaf1);
+
+  uint8_t sas_token_buffer[256];
+  az_span sas_token;
+  assert_true(
+      az_iot_hub_gateway_sas_token_get(
+          &gateway, leaf1, TEST_TIME, AZ_SPAN_FROM_BUFFER(sas_token_buffer), &sas_token)
+      == AZ_OK);
+  // Signed with the key derived from the group key.
+  assert_true(az_span_is_content_equal(
+      sas_token,
+      AZ_SPAN_FROM_STR("SharedAccessSignature sr=" TEST_HUB_HOSTNAME "/devices/leaf1"
+                       "&sig=lRiBz6tqLI56R9fsZyreRqql2lDBoMi8eAyUg68ZlXM%3D&se=1578945292")));
+
+  assert_true(az_iot_hub_gateway_sas_next_refresh(&gateway, TEST_TIME, &index) == AZ_OK);
+  assert_true(index == leaf2);
+  assert_true(
+      az_iot_hub_gateway_sas_token_get(
+          &gateway, leaf2, TEST_TIME + 100, AZ_SPAN_FROM_BUFFER(sas_token_buffer), &sas_token)
+      == AZ_OK);
+  // Signed with the device's own key.
+  assert_true(az_span_is_content_equal(
+      sas_token,
+      AZ_SPAN_FROM_STR("SharedAccessSignature sr=" TEST_HUB_HOSTNAME "/devices/leaf2"
+                       "&sig=atmicvPZUd0qfO3iqRf6AVNjm6XbEnZ74SlFxak3MU8%3D&se=1578945392")));
+
+  assert_true(
+      az_iot_hub_gateway_sas_next_refresh(&gateway, TEST_TIME + 100, &index)
+      == AZ_ERROR_ITEM_NOT_FOUND);
+  assert_true(az_iot_hub_gateway_sas_next_refresh_time(&gateway) == 1578945292 - 300);
+
+  assert_true(az_iot_hub_gateway_sas_next_refresh(&gateway, 1578945292 - 300, &index) == AZ_OK);
+  assert_true(index == leaf1);
+}
@@ -0,0 +1,160 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_iot_hub_client.h>
+#include <az_iot_hub_telemetry_queue.h>
+#include <az_span.h>
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmocka.h>
+
+#define TEST_HUB_HOSTNAME "myiothub.azure-devices.net"
+#define TEST_DEVICE_ID "my_device"
+#define TEST_TOPIC "devices/my_device/messages/events/"
+
+static void _read_message(
+    az_iot_hub_telemetry_queue* queue,
+    az_iot_hub_client const* client,
+    char const* expected_topic,
+    char const* expected_payload)
+{
+  uint8_t topic_buffer[64];
+  az_span topic = AZ_SPAN_NULL;
+  az_span payload = AZ_SPAN_NULL;
+  assert_true(
+      az_iot_hub_telemetry_queue_read(
+          queue, client, AZ_SPAN_FROM_BUFFER(topic_buffer), &topic, &payload)
+      == AZ_OK);
+
+  // The topic is null terminated.
+  assert_string_equal((char const*)az_span_ptr(topic), expected_topic);
+  assert_true(az_span_is_content_equal(payload, az_span_from_str((char*)expected_payload)));
+}
+
+void test_az_iot_hub_telemetry_queue_read_commit_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_client client;
+  assert_true(
+      az_iot_hub_client_init(
+          &client, AZ_SPAN_FROM_STR(TEST_HUB_HOSTNAME), AZ_SPAN_FROM_STR(TEST_DEVICE_ID), NULL)
+      == AZ_OK);
+
+  uint8_t region_buffer[_az_IOT_HUB_TELEMETRY_QUEUE_HEADER_SIZE + 64] = { 0 };
+  az_span const region = AZ_SPAN_FROM_INITIALIZED_BUFFER(region_buffer);
+
+  az_iot_hub_telemetry_queue queue;
+  assert_true(az_iot_hub_telemetry_queue_init(&queue, region) == AZ_OK);
+  assert_true(az_iot_hub_telemetry_queue_count(&queue) == 0);
+
+  char properties_buffer[] = "key=value";
+  az_iot_hub_client_properties properties;
+  assert_true(
+      az_iot_hub_client_properties_init(&properties, az_span_from_str(properties_buffer))
+      == AZ_OK);
+
+  // Records of 8 + 2 + 9 + 5 and 8 + 2 + 6 bytes leave 24 bytes, too few for 8 + 2 + 16 (28).
+  assert_true(
+      az_iot_hub_telemetry_queue_enqueue(&queue, &properties, AZ_SPAN_FROM_STR("hello")) == AZ_OK);
+  assert_true(
+      az_iot_hub_telemetry_queue_enqueue(&queue, NULL, AZ_SPAN_FROM_STR("world!")) == AZ_OK);
+  assert_true(
+      az_iot_hub_telemetry_queue_enqueue(&queue, NULL, AZ_SPAN_FROM_STR("too long payload"))
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+  assert_true(az_iot_hub_telemetry_queue_count(&queue) == 2);
+
+  _read_message(&queue, &client, TEST_TOPIC "?key=value", "hello");
+
+  // Messages not committed are read again after a rewind.
+  az_iot_hub_telemetry_queue_rewind(&queue);
+  _read_message(&queue, &client, TEST_TOPIC "?key=value", "hello");
+  _read_message(&queue, &client, TEST_TOPIC, "world!");
+
+  uint8_t topic_buffer[64];
+  az_span topic;
+  az_span payload;
+  assert_true(
+      az_iot_hub_telemetry_queue_read(
+          &queue, &client, AZ_SPAN_FROM_BUFFER(topic_buffer), &topic, &payload)
+      == AZ_ERROR_ITEM_NOT_FOUND);
+
+  // Committing frees the ring: the next message skips its end and wraps around.
+  az_iot_hub_telemetry_queue_commit(&queue);
+  assert_true(az_iot_hub_telemetry_queue_count(&queue) == 0);
+  assert_true(
+      az_iot_hub_telemetry_queue_enqueue(&queue, NULL, AZ_SPAN_FROM_STR("too long payload"))
+      == AZ_OK);
+  assert_true(az_iot_hub_telemetry_queue_enqueue(&queue, NULL, AZ_SPAN_FROM_STR("x")) == AZ_OK);
+  assert_true(
+      az_iot_hub_telemetry_queue_enqueue(&queue, NULL, AZ_SPAN_NULL)
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+
+  // The queue is found again in the region.
+  az_iot_hub_telemetry_queue reopened;
+  assert_true(az_iot_hub_telemetry_queue_init(&reopened, region) == AZ_OK);
+  assert_true(az_iot_hub_telemetry_queue_count(&reopened) == 2);
+  _read_message(&reopened, &client, TEST_TOPIC, "too long payload");
+  _read_message(&reopened, &client, TEST_TOPIC, "x");
+}
+
+void test_az_iot_hub_telemetry_queue_recover_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_client client;
+  assert_true(
+      az_iot_hub_client_init(
+          &client, AZ_SPAN_FROM_STR(TEST_HUB_HOSTNAME), AZ_SPAN_FROM_STR(TEST_DEVICE_ID), NULL)
+      == AZ_OK);
+
+  uint8_t region_buffer[_az_IOT_HUB_TELEMETRY_QUEUE_HEADER_SIZE + 128];
+  for (int32_t i = 0; i < (int32_t)sizeof(region_buffer); ++i)
+  {
+    region_buffer[i] = 0xA5;
+  }
+  az_span const region = AZ_SPAN_FROM_INITIALIZED_BUFFER(region_buffer);
+
+  az_iot_hub_telemetry_queue queue;
+  assert_true(az_iot_hub_telemetry_queue_init(&queue, region) == AZ_OK);
+  assert_true(az_iot_hub_telemetry_queue_count(&queue) == 0);
+
+  assert_true(az_iot_hub_telemetry_queue_enqueue(&queue, NULL, AZ_SPAN_FROM_STR("one")) == AZ_OK);
+  assert_true(az_iot_hub_telemetry_queue_enqueue(&queue, NULL, AZ_SPAN_FROM_STR("two")) == AZ_OK);
+  assert_true(
+      az_iot_hub_telemetry_queue_enqueue(&queue, NULL, AZ_SPAN_FROM_STR("three")) == AZ_OK);
+
+  uint8_t topic_buffer[64];
+  az_span topic;
+  az_span payload;
+  assert_true(
+      az_iot_hub_telemetry_queue_read(
+          &queue, &client, AZ_SPAN_FROM_BUFFER(topic_buffer), &topic, &payload)
+      == AZ_OK);
+  az_iot_hub_telemetry_queue_commit(&queue);
+
+  // A crash tears the last message: it is dropped when the queue is opened again.
+  region_buffer[_az_IOT_HUB_TELEMETRY_QUEUE_HEADER_SIZE + 16 + 16 + 10] = 'T';
+
+  assert_true(az_iot_hub_telemetry_queue_init(&queue, region) == AZ_OK);
+  assert_true(az_iot_hub_telemetry_queue_count(&queue) == 1);
+  _read_message(&queue, &client, TEST_TOPIC, "two");
+
+  // A crash tears the commit: the previous read position is used.
+  az_iot_hub_telemetry_queue_commit(&queue);
+  region_buffer[_az_IOT_HUB_TELEMETRY_QUEUE_HEADER_SIZE - 2 * 16] ^= 1;
+
+  assert_true(az_iot_hub_telemetry_queue_init(&queue, region) == AZ_OK);
+  assert_true(az_iot_hub_telemetry_queue_count(&queue) == 1);
+  _read_message(&queue, &client, TEST_TOPIC, "two");
+
+  // A region not holding a queue of the same size is formatted.
+  assert_true(
+      az_iot_hub_telemetry_queue_init(&queue, az_span_slice(region, 0, az_span_length(region) - 4))
+      == AZ_OK);
+  assert_true(az_iot_hub_telemetry_queue_count(&queue) == 0);
+}
@@ -0,0 +1,182 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_iot_hub_twin.h>
+#include <az_span.h>
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmocka.h>
+
+static void _assert_value(
+    az_iot_hub_twin_properties const* properties,
+    char* name,
+    char* expected_value)
+{
+  az_span value = AZ_SPAN_NULL;
+  assert_true(
+      az_iot_hub_twin_properties_get(properties, az_span_from_str(name), &value) == AZ_OK);
+  assert_true(az_span_is_content_equal(value, az_span_from_str(expected_value)));
+}
+
+static void _assert_next_change(
+    az_iot_hub_twin_properties const* properties,
+    int32_t* iterator,
+    char* expected_name,
+    char* expected_value)
+{
+  az_span name = AZ_SPAN_NULL;
+  az_span value = AZ_SPAN_NULL;
+  assert_true(
+      az_iot_hub_twin_properties_next_change(properties, iterator, &name, &value) == AZ_OK);
+  assert_true(az_span_is_content_equal(name, az_span_from_str(expected_name)));
+  assert_true(az_span_is_content_equal(value, az_span_from_str(expected_value)));
+}
+
+void test_az_iot_hub_twin_properties_apply_patch_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_twin_property entries[8];
+  uint8_t buffer[128];
+  az_iot_hub_twin_properties desired;
+  assert_true(
+      az_iot_hub_twin_properties_init(
+          &desired, entries, _az_COUNTOF(entries), AZ_SPAN_FROM_BUFFER(buffer))
+      == AZ_OK);
+
+  assert_true(
+      az_iot_hub_twin_properties_apply_document(
+          &desired,
+          AZ_SPAN_FROM_STR("{ \"desired\": { \"rate\": 5, \"config\": { \"mode\": \"eco\", "
+                           "\"levels\": [1, 2] }, \"$version\": 3 }, \"reported\": { \"x\": 1 } }"),
+          AZ_SPAN_FROM_STR("desired"))
+      == AZ_OK);
+  assert_true(az_iot_hub_twin_properties_get_version(&desired) == 3);
+  _assert_value(&desired, "rate", "5");
+  _assert_value(&desired, "config.mode", "\"eco\"");
+  _assert_value(&desired, "config.levels", "[1, 2]");
+
+  az_span value;
+  assert_true(
+      az_iot_hub_twin_properties_get(&desired, AZ_SPAN_FROM_STR("x"), &value)
+      == AZ_ERROR_ITEM_NOT_FOUND);
+  assert_true(
+      az_iot_hub_twin_properties_apply_document(
+          &desired, AZ_SPAN_FROM_STR("{\"reported\":{}}"), AZ_SPAN_FROM_STR("desired"))
+      == AZ_ERROR_ITEM_NOT_FOUND);
+
+  // Only the properties whose value changed are listed after a patch.
+  az_iot_hub_twin_properties_changes_clear(&desired);
+  assert_true(
+      az_iot_hub_twin_properties_apply_patch(
+          &desired,
+          AZ_SPAN_FROM_STR("{\"rate\":5,\"config\":{\"mode\":null,\"fan\":{\"speed\":2}},"
+                           "\"$version\":4}"))
+      == AZ_OK);
+  assert_true(az_iot_hub_twin_properties_get_version(&desired) == 4);
+
+  int32_t iterator = 0;
+  _assert_next_change(&desired, &iterator, "config.fan.speed", "2");
+  _assert_next_change(&desired, &iterator, "config.mode", "null");
+  az_span name;
+  assert_true(
+      az_iot_hub_twin_properties_next_change(&desired, &iterator, &name, &value)
+      == AZ_ERROR_ITEM_NOT_FOUND);
+
+  assert_true(
+      az_iot_hub_twin_properties_get(&desired, AZ_SPAN_FROM_STR("config.mode"), &value)
+      == AZ_ERROR_ITEM_NOT_FOUND);
+  _assert_value(&desired, "config.levels", "[1, 2]");
+
+  // A value replaces an object, and an object replaces a value.
+  assert_true(
+      az_iot_hub_twin_properties_apply_patch(
+          &desired, AZ_SPAN_FROM_STR("{\"config\":\"off\",\"rate\":{\"min\":1}}"))
+      == AZ_OK);
+  _assert_value(&desired, "config", "\"off\"");
+  _assert_value(&desired, "rate.min", "1");
+  assert_true(
+      az_iot_hub_twin_properties_get(&desired, AZ_SPAN_FROM_STR("config.levels"), &value)
+      == AZ_ERROR_ITEM_NOT_FOUND);
+  assert_true(
+      az_iot_hub_twin_properties_get(&desired, AZ_SPAN_FROM_STR("rate"), &value)
+      == AZ_ERROR_ITEM_NOT_FOUND);
+
+  assert_true(
+      az_iot_hub_twin_properties_apply_patch(&desired, AZ_SPAN_FROM_STR("{\"rate\":"))
+      != AZ_OK);
+}
+
+void test_az_iot_hub_twin_properties_patch_get_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_twin_property entries[6];
+  uint8_t buffer[48];
+  az_iot_hub_twin_properties reported;
+  assert_true(
+      az_iot_hub_twin_properties_init(
+          &reported, entries, _az_COUNTOF(entries), AZ_SPAN_FROM_BUFFER(buffer))
+      == AZ_OK);
+
+  assert_true(
+      az_iot_hub_twin_properties_set(&reported, AZ_SPAN_FROM_STR("a.b"), AZ_SPAN_FROM_STR("1"))
+      == AZ_OK);
+  assert_true(
+      az_iot_hub_twin_properties_set(&reported, AZ_SPAN_FROM_STR("a.c.d"), AZ_SPAN_FROM_STR("2"))
+      == AZ_OK);
+  assert_true(
+      az_iot_hub_twin_properties_set(&reported, AZ_SPAN_FROM_STR("ab"), AZ_SPAN_FROM_STR("true"))
+      == AZ_OK);
+  assert_true(
+      az_iot_hub_twin_properties_set(&reported, AZ_SPAN_FROM_STR("e"), AZ_SPAN_FROM_STR("\"x\""))
+      == AZ_OK);
+
+  uint8_t json_buffer[64];
+  az_span json = AZ_SPAN_NULL;
+  assert_true(
+      az_iot_hub_twin_properties_patch_get(&reported, AZ_SPAN_FROM_BUFFER(json_buffer), &json)
+      == AZ_OK);
+  assert_true(az_span_is_content_equal(
+      json, AZ_SPAN_FROM_STR("{\"a\":{\"b\":1,\"c\":{\"d\":2}},\"ab\":true,\"e\":\"x\"}")));
+
+  // Once acknowledged, only the values set differently are sent again.
+  az_iot_hub_twin_properties_changes_clear(&reported);
+  assert_true(
+      az_iot_hub_twin_properties_set(&reported, AZ_SPAN_FROM_STR("a.b"), AZ_SPAN_FROM_STR("1"))
+      == AZ_OK);
+  assert_true(
+      az_iot_hub_twin_properties_set(&reported, AZ_SPAN_FROM_STR("a.c.d"), AZ_SPAN_FROM_STR("30"))
+      == AZ_OK);
+  assert_true(
+      az_iot_hub_twin_properties_set(&reported, AZ_SPAN_FROM_STR("e"), AZ_SPAN_FROM_STR("null"))
+      == AZ_OK);
+  assert_true(
+      az_iot_hub_twin_properties_patch_get(&reported, AZ_SPAN_FROM_BUFFER(json_buffer), &json)
+      == AZ_OK);
+  assert_true(az_span_is_content_equal(
+      json, AZ_SPAN_FROM_STR("{\"a\":{\"c\":{\"d\":30}},\"e\":null}")));
+
+  az_iot_hub_twin_properties_changes_clear(&reported);
+  assert_true(
+      az_iot_hub_twin_properties_patch_get(&reported, AZ_SPAN_FROM_BUFFER(json_buffer), &json)
+      == AZ_OK);
+  assert_true(az_span_is_content_equal(json, AZ_SPAN_FROM_STR("{}")));
+
+  // Values replaced in turn fill the buffer: the space they leave is reclaimed.
+  for (int32_t i = 0; i < 10; ++i)
+  {
+    assert_true(
+        az_iot_hub_twin_properties_set(
+            &reported, AZ_SPAN_FROM_STR("ab"), i % 2 == 0 ? AZ_SPAN_FROM_STR("\"long value\"")
+                                                          : AZ_SPAN_FROM_STR("\"longer value\""))
+        == AZ_OK);
+  }
+  _assert_value(&reported, "ab", "\"longer value\"");
+  _assert_value(&reported, "a.b", "1");
+  _assert_value(&reported, "a.c.d", "30");
+}
@@ -256,3 +256,92 @@ void az_iot_sas_token_generate_with_keyname_succeeds(void** state)
       iothub_fqdn, device_id, signature, expiry_time_secs, key_name, sas_token, &sas_token)));
   assert_true(strncmp(expected_sas_token, (char*)raw_sas_token, az_span_length(sas_token)) == 0);
 }
+
+void az_iot_sas_token_sign_succeeds(void** state)
+{
+  (void)state;
+
+  uint8_t raw_signature[AZ_IOT_SAS_TOKEN_SIGNATURE_MAX_SIZE];
+  az_span signature = AZ_SPAN_NULL;
+
+  // RFC 4231 test case 2
+  assert_true(az_succeeded(az_iot_sas_token_sign(
+      AZ_SPAN_FROM_STR("SmVmZQ=="),
+      AZ_SPAN_FROM_STR("what do ya want for nothing?"),
+      AZ_SPAN_FROM_BUFFER(raw_signature),
+      &signature)));
+  assert_true(az_span_is_content_equal(
+      signature, AZ_SPAN_FROM_STR("W9zBRr9gdU5qBCQmCJV1x1oAPwidJzmDnexYuWTsOEM%3D")));
+
+  // A key longer than a SHA-256 block, and a document spanning several blocks.
+  assert_true(az_succeeded(az_iot_sas_token_sign(
+      AZ_SPAN_FROM_STR("qqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqq"
+                       "qqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqg=="),
+      AZ_SPAN_FROM_STR("Test Using Larger Than Block-Size Key and Larger Than One Block-Size Data, "
+                       "with a document spanning several SHA-256 blocks."),
+      AZ_SPAN_FROM_BUFFER(raw_signature),
+      &signature)));
+  assert_true(az_span_is_content_equal(
+      signature, AZ_SPAN_FROM_STR("TeGF%2BSmOoNrudg80uR%2F6ZMUy1HYvDymNnXD%2BpCIiELs%3D")));
+
+  assert_true(
+      az_iot_sas_token_sign(
+          AZ_SPAN_FROM_STR("not base64"),
+          AZ_SPAN_FROM_STR("document"),
+          AZ_SPAN_FROM_BUFFER(raw_signature),
+          &signature)
+      == AZ_ERROR_PARSER_UNEXPECTED_CHAR);
+}
+
+void az_iot_sas_token_cache_get_succeeds(void** state)
+{
+  (void)state;
+
+  uint8_t raw_sas_token[256];
+  az_iot_sas_token_cache cache;
+  assert_true(az_succeeded(az_iot_sas_token_cache_init(
+      &cache,
+      AZ_SPAN_FROM_STR(TEST_FQDN),
+      AZ_SPAN_FROM_STR(TEST_DEVICEID),
+      AZ_SPAN_FROM_STR("AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8="),
+      AZ_SPAN_NULL,
+      3600,
+      300,
+      AZ_SPAN_FROM_BUFFER(raw_sas_token))));
+  assert_true(az_iot_sas_token_cache_get_refresh_time(&cache) == 0);
+
+  az_span sas_token = AZ_SPAN_NULL;
+  assert_true(az_succeeded(az_iot_sas_token_cache_get(&cache, TEST_EXPIRATION, &sas_token)));
+  assert_true(az_span_is_content_equal(
+      sas_token,
+      AZ_SPAN_FROM_STR("SharedAccessSignature sr=" TEST_FQDN "/devices/" TEST_DEVICEID
+                       "&sig=Re%2BrbCY4NmTATWB8MsmKhL0E%2FIPKssQvresLTCQBOVE%3D&se=1578945292")));
+  assert_true(az_iot_sas_token_cache_get_refresh_time(&cache) == 1578945292 - 300);
+
+  // Not regenerated until the refresh time.
+  raw_sas_token[0] = 'X';
+  assert_true(az_succeeded(az_iot_sas_token_cache_get(&cache, 1578944991, &sas_token)));
+  assert_true(raw_sas_token[0] == 'X');
+
+  assert_true(az_succeeded(az_iot_sas_token_cache_get(&cache, 1578945000, &sas_token)));
+  assert_true(az_span_is_content_equal(
+      sas_token,
+      AZ_SPAN_FROM_STR("SharedAccessSignature sr=" TEST_FQDN "/devices/" TEST_DEVICEID
+                       "&sig=YsWNMUnKkLkedIRKbmSLBaNgqllawinknH7TkT4Kzh8%3D&se=1578948600")));
+
+  // A token that doesn't fit is generated again on the next call.
+  uint8_t small_sas_token[64];
+  assert_true(az_succeeded(az_iot_sas_token_cache_init(
+      &cache,
+      AZ_SPAN_FROM_STR(TEST_FQDN),
+      AZ_SPAN_FROM_STR(TEST_DEVICEID),
+      AZ_SPAN_FROM_STR("AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8="),
+      AZ_SPAN_NULL,
+      3600,
+      300,
+      AZ_SPAN_FROM_BUFFER(small_sas_token))));
+  assert_true(
+      az_iot_sas_token_cache_get(&cache, TEST_EXPIRATION, &sas_token)
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+  assert_true(az_iot_sas_token_cache_get_refresh_time(&cache) == 0);
+}
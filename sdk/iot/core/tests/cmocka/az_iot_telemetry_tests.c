@@ -10,6 +10,7 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <cmocka.h>
 
@@ -284,3 +285,182 @@ void test_az_iot_hub_client_telemetry_publish_topic_get_with_options_user_agent_
           &g_test_valid_client_with_options_user_agent, &g_test_params, mqtt_topic, &mqtt_topic)
       == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
 }
+
+void test_az_iot_hub_client_telemetry_publish_topic_get_initialized_client_with_params_succeed(
+    void** state)
+{
+  (void)state;
+
+  az_iot_hub_client_options options = TEST_VALID_OPTIONS_BOTH;
+  az_iot_hub_client client;
+  assert_true(
+      az_iot_hub_client_init(
+          &client, AZ_SPAN_FROM_STR(TEST_FQDN), AZ_SPAN_FROM_STR(TEST_DEVICE_ID), &options)
+      == AZ_OK);
+
+  uint8_t mqtt_topic_buf[sizeof(g_test_correct_topic_with_options_with_params)];
+
+  // The client can be reused for many messages.
+  for (int i = 0; i < 2; ++i)
+  {
+    az_span mqtt_topic = az_span_init(mqtt_topic_buf, 0, _az_COUNTOF(mqtt_topic_buf));
+
+    assert_true(
+        az_iot_hub_client_telemetry_publish_topic_get(
+            &client, &g_test_params, mqtt_topic, &mqtt_topic)
+        == AZ_OK);
+    assert_string_equal(
+        g_test_correct_topic_with_options_with_params, (char*)az_span_ptr(mqtt_topic));
+  }
+}
+
+void test_az_iot_hub_client_telemetry_publish_topic_get_initialized_client_small_buffer_fails(
+    void** state)
+{
+  (void)state;
+
+  az_iot_hub_client client;
+  assert_true(
+      az_iot_hub_client_init(
+          &client, AZ_SPAN_FROM_STR(TEST_FQDN), AZ_SPAN_FROM_STR(TEST_DEVICE_ID), NULL)
+      == AZ_OK);
+
+  uint8_t mqtt_topic_buf[sizeof(g_test_correct_topic_no_options_with_params) - 1];
+  az_span mqtt_topic = az_span_init(mqtt_topic_buf, 0, _az_COUNTOF(mqtt_topic_buf));
+
+  assert_true(
+      az_iot_hub_client_telemetry_publish_topic_get(
+          &client, &g_test_params, mqtt_topic, &mqtt_topic)
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+}
+
+void test_az_iot_hub_client_telemetry_batch_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_client client;
+  assert_true(
+      az_iot_hub_client_init(
+          &client, AZ_SPAN_FROM_STR(TEST_FQDN), AZ_SPAN_FROM_STR(TEST_DEVICE_ID), NULL)
+      == AZ_OK);
+
+  uint8_t props_buf[64];
+  az_iot_hub_client_properties props;
+  assert_true(az_iot_hub_client_properties_init(&props, AZ_SPAN_FROM_BUFFER(props_buf)) == AZ_OK);
+  assert_true(
+      az_iot_hub_client_properties_append(&props, AZ_SPAN_FROM_STR("site"), AZ_SPAN_FROM_STR("7"))
+      == AZ_OK);
+
+  // Room for two readings and the brackets.
+  uint8_t payload_buf[sizeof("[{\"t\":21},{\"t\":22}]") - 1];
+  az_iot_hub_client_telemetry_batch batch;
+  assert_true(
+      az_iot_hub_client_telemetry_batch_init(
+          &client, &batch, AZ_SPAN_FROM_BUFFER(payload_buf), &props)
+      == AZ_OK);
+
+  assert_true(
+      az_iot_hub_client_telemetry_batch_append(&batch, AZ_SPAN_FROM_STR("{\"t\":21}")) == AZ_OK);
+  assert_true(
+      az_iot_hub_client_telemetry_batch_append(&batch, AZ_SPAN_FROM_STR("{\"t\":22}")) == AZ_OK);
+  assert_true(
+      az_iot_hub_client_telemetry_batch_append(&batch, AZ_SPAN_FROM_STR("1"))
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+  assert_int_equal(az_iot_hub_client_telemetry_batch_count(&batch), 2);
+
+  uint8_t mqtt_topic_buf[TEST_MQTT_SPAN_BUFFER_SIZE];
+  az_span mqtt_topic = az_span_init(mqtt_topic_buf, 0, _az_COUNTOF(mqtt_topic_buf));
+  az_span payload;
+  assert_true(
+      az_iot_hub_client_telemetry_batch_publish_get(
+          &client, &batch, mqtt_topic, &mqtt_topic, &payload)
+      == AZ_OK);
+  assert_string_equal(
+      "devices/my_device/messages/events/?site=7&$.ct=application%2Fjson&$.ce=utf-8",
+      (char*)az_span_ptr(mqtt_topic));
+  assert_true(az_span_is_content_equal(payload, AZ_SPAN_FROM_STR("[{\"t\":21},{\"t\":22}]")));
+
+  // After a reset, the properties are kept and new readings can be appended.
+  az_iot_hub_client_telemetry_batch_reset(&batch);
+  assert_int_equal(az_iot_hub_client_telemetry_batch_count(&batch), 0);
+  assert_true(az_iot_hub_client_telemetry_batch_append(&batch, AZ_SPAN_FROM_STR("1")) == AZ_OK);
+
+  mqtt_topic = az_span_init(mqtt_topic_buf, 0, _az_COUNTOF(mqtt_topic_buf));
+  assert_true(
+      az_iot_hub_client_telemetry_batch_publish_get(
+          &client, &batch, mqtt_topic, &mqtt_topic, &payload)
+      == AZ_OK);
+  assert_true(az_span_is_content_equal(payload, AZ_SPAN_FROM_STR("[1]")));
+
+  // A batch initialized again with the same properties doesn't add the system properties again.
+  assert_true(
+      az_iot_hub_client_telemetry_batch_init(
+          &client, &batch, AZ_SPAN_FROM_BUFFER(payload_buf), &props)
+      == AZ_OK);
+  assert_true(az_iot_hub_client_telemetry_batch_append(&batch, AZ_SPAN_FROM_STR("1")) == AZ_OK);
+  mqtt_topic = az_span_init(mqtt_topic_buf, 0, _az_COUNTOF(mqtt_topic_buf));
+  assert_true(
+      az_iot_hub_client_telemetry_batch_publish_get(
+          &client, &batch, mqtt_topic, &mqtt_topic, &payload)
+      == AZ_OK);
+  assert_string_equal(
+      "devices/my_device/messages/events/?site=7&$.ct=application%2Fjson&$.ce=utf-8",
+      (char*)az_span_ptr(mqtt_topic));
+
+  // Properties with another content type are rejected.
+  assert_true(az_iot_hub_client_properties_init(&props, AZ_SPAN_FROM_BUFFER(props_buf)) == AZ_OK);
+  assert_true(
+      az_iot_hub_client_properties_append(
+          &props, AZ_SPAN_FROM_STR("$.ct"), AZ_SPAN_FROM_STR("text%2Fplain"))
+      == AZ_OK);
+  assert_true(
+      az_iot_hub_client_telemetry_batch_init(
+          &client, &batch, AZ_SPAN_FROM_BUFFER(payload_buf), &props)
+      == AZ_ERROR_ARG);
+}
+
+static uint8_t test_telemetry_batch_payload_buf[AZ_IOT_HUB_CLIENT_TELEMETRY_MAX_MESSAGE_SIZE];
+static uint8_t test_telemetry_batch_reading_buf[AZ_IOT_HUB_CLIENT_TELEMETRY_MAX_MESSAGE_SIZE];
+
+void test_az_iot_hub_client_telemetry_batch_topic_in_size_limit_succeed(void** state)
+{
+  (void)state;
+
+  az_iot_hub_client_options options = az_iot_hub_client_options_default();
+  options.user_agent = AZ_SPAN_FROM_STR(TEST_USER_AGENT);
+  az_iot_hub_client client;
+  assert_true(
+      az_iot_hub_client_init(
+          &client, AZ_SPAN_FROM_STR(TEST_FQDN), AZ_SPAN_FROM_STR(TEST_DEVICE_ID), &options)
+      == AZ_OK);
+
+  uint8_t props_buf[64];
+  az_iot_hub_client_properties props;
+  assert_true(az_iot_hub_client_properties_init(&props, AZ_SPAN_FROM_BUFFER(props_buf)) == AZ_OK);
+
+  az_iot_hub_client_telemetry_batch batch;
+  assert_true(
+      az_iot_hub_client_telemetry_batch_init(
+          &client, &batch, AZ_SPAN_FROM_BUFFER(test_telemetry_batch_payload_buf), &props)
+      == AZ_OK);
+
+  uint8_t mqtt_topic_buf[TEST_MQTT_SPAN_BUFFER_SIZE * 2];
+  az_span mqtt_topic = az_span_init(mqtt_topic_buf, 0, _az_COUNTOF(mqtt_topic_buf));
+  assert_true(
+      az_iot_hub_client_telemetry_publish_topic_get(&client, &props, mqtt_topic, &mqtt_topic)
+      == AZ_OK);
+  int32_t const topic_length = az_span_length(mqtt_topic) - 1; // Without the null terminator.
+
+  // The payload buffer could hold a bigger reading, but the topic takes part of the message.
+  memset(test_telemetry_batch_reading_buf, '1', sizeof(test_telemetry_batch_reading_buf));
+  int32_t const reading_length
+      = AZ_IOT_HUB_CLIENT_TELEMETRY_MAX_MESSAGE_SIZE - topic_length - (int32_t)sizeof("[]") + 1;
+  az_span const reading = az_span_init(
+      test_telemetry_batch_reading_buf, reading_length + 1, reading_length + 1);
+  assert_true(
+      az_iot_hub_client_telemetry_batch_append(&batch, reading)
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+  assert_true(
+      az_iot_hub_client_telemetry_batch_append(&batch, az_span_slice(reading, 0, reading_length))
+      == AZ_OK);
+}
@@ -26,6 +26,8 @@ void az_iot_sas_token_generate_NULL_sas_token_span_fails(void** state);
 void az_iot_sas_token_generate_sas_token_overflow_fails(void** state); */
 void az_iot_sas_token_generate_succeeds(void** state);
 void az_iot_sas_token_generate_with_keyname_succeeds(void** state);
+void az_iot_sas_token_sign_succeeds(void** state);
+void az_iot_sas_token_cache_get_succeeds(void** state);
 
 /*
  * Telemetry Unit Tests
@@ -52,11 +54,53 @@ void test_az_iot_hub_client_telemetry_publish_topic_get_with_options_user_agent_
     void** state);
 void test_az_iot_hub_client_telemetry_publish_topic_get_with_options_user_agent_with_params_small_buffer_fails(
     void** state);
+void test_az_iot_hub_client_telemetry_publish_topic_get_initialized_client_with_params_succeed(
+    void** state);
+void test_az_iot_hub_client_telemetry_publish_topic_get_initialized_client_small_buffer_fails(
+    void** state);
+void test_az_iot_hub_client_telemetry_batch_succeed(void** state);
+void test_az_iot_hub_client_telemetry_batch_topic_in_size_limit_succeed(void** state);
+
+/*
+ * Properties Unit Tests
+ */
+void test_az_iot_hub_client_properties_append_succeed(void** state);
+void test_az_iot_hub_client_properties_find_succeed(void** state);
+void test_az_iot_hub_client_properties_next_succeed(void** state);
+void test_az_iot_hub_client_properties_index_find_succeed(void** state);
+void test_az_iot_hub_client_properties_index_append_succeed(void** state);
+
+/*
+ * Received Topic Unit Tests
+ */
+void test_az_iot_hub_client_received_topic_parse_c2d_succeed(void** state);
+void test_az_iot_hub_client_received_topic_parse_method_succeed(void** state);
+void test_az_iot_hub_client_received_topic_parse_twin_succeed(void** state);
+
+/*
+ * Gateway Unit Tests
+ */
+void test_az_iot_hub_gateway_get_client_succeed(void** state);
+void test_az_iot_hub_gateway_sas_refresh_succeed(void** state);
+
+/*
+ * Telemetry Queue Unit Tests
+ */
+void test_az_iot_hub_telemetry_queue_read_commit_succeed(void** state);
+void test_az_iot_hub_telemetry_queue_recover_succeed(void** state);
+
+/*
+ * Twin Properties Unit Tests
+ */
+void test_az_iot_hub_twin_properties_apply_patch_succeed(void** state);
+void test_az_iot_hub_twin_properties_patch_get_succeed(void** state);
 
 /*
  * IoT Hub Client Unit Tests
  */
 void test_az_iot_hub_client_get_default_options_succeed(void** state);
+void test_az_iot_hub_client_init_succeed(void** state);
+void test_az_iot_hub_client_init_NULL_options_succeed(void** state);
 
 int main()
 {
@@ -76,6 +120,8 @@ int main()
     cmocka_unit_test(az_iot_sas_token_generate_sas_token_overflow_fails),*/
     cmocka_unit_test(az_iot_sas_token_generate_succeeds),
     cmocka_unit_test(az_iot_sas_token_generate_with_keyname_succeeds),
+    cmocka_unit_test(az_iot_sas_token_sign_succeeds),
+    cmocka_unit_test(az_iot_sas_token_cache_get_succeeds),
 
     // Telemetry
     // cmocka_unit_test(test_az_iot_hub_client_telemetry_publish_topic_get_NULL_client_fails),
@@ -101,9 +147,33 @@ int main()
         test_az_iot_hub_client_telemetry_publish_topic_get_with_options_user_agent_with_params_succeed),
     cmocka_unit_test(
         test_az_iot_hub_client_telemetry_publish_topic_get_with_options_user_agent_with_params_small_buffer_fails),
+    cmocka_unit_test(
+        test_az_iot_hub_client_telemetry_publish_topic_get_initialized_client_with_params_succeed),
+    cmocka_unit_test(
+        test_az_iot_hub_client_telemetry_publish_topic_get_initialized_client_small_buffer_fails),
+    cmocka_unit_test(test_az_iot_hub_client_telemetry_batch_succeed),
+    cmocka_unit_test(test_az_iot_hub_client_telemetry_batch_topic_in_size_limit_succeed),
+
+    // Properties
+    cmocka_unit_test(test_az_iot_hub_client_properties_append_succeed),
+    cmocka_unit_test(test_az_iot_hub_client_properties_find_succeed),
+    cmocka_unit_test(test_az_iot_hub_client_properties_next_succeed),
+    cmocka_unit_test(test_az_iot_hub_client_properties_index_find_succeed),
+    cmocka_unit_test(test_az_iot_hub_client_properties_index_append_succeed),
+    cmocka_unit_test(test_az_iot_hub_client_received_topic_parse_c2d_succeed),
+    cmocka_unit_test(test_az_iot_hub_client_received_topic_parse_method_succeed),
+    cmocka_unit_test(test_az_iot_hub_client_received_topic_parse_twin_succeed),
+    cmocka_unit_test(test_az_iot_hub_gateway_get_client_succeed),
+    cmocka_unit_test(test_az_iot_hub_gateway_sas_refresh_succeed),
+    cmocka_unit_test(test_az_iot_hub_telemetry_queue_read_commit_succeed),
+    cmocka_unit_test(test_az_iot_hub_telemetry_queue_recover_succeed),
+    cmocka_unit_test(test_az_iot_hub_twin_properties_apply_patch_succeed),
+    cmocka_unit_test(test_az_iot_hub_twin_properties_patch_get_succeed),
 
     // IoT Hub Client
     cmocka_unit_test(test_az_iot_hub_client_get_default_options_succeed),
+    cmocka_unit_test(test_az_iot_hub_client_init_succeed),
+    cmocka_unit_test(test_az_iot_hub_client_init_NULL_options_succeed),
   };
 
   return cmocka_run_group_tests_name("az_iot", tests, NULL, NULL);
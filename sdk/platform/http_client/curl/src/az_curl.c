@@ -1,11 +1,14 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // SPDX-License-Identifier: MIT
 
+#include <az_config_internal.h>
+#include <az_context.h>
 #include <az_http.h>
 #include <az_http_internal.h>
 #include <az_http_transport.h>
 #include <az_span.h>
 
+#include <stdio.h>
 #include <stdlib.h>
 
 #include <curl/curl.h>
@@ -64,6 +67,9 @@ AZ_NODISCARD az_result _az_http_client_curl_code_to_result(CURLcode code)
     case CURLE_COULDNT_RESOLVE_HOST:
       return AZ_ERROR_HTTP_RESPONSE_COULDNT_RESOLVE_HOST;
 
+    case CURLE_ABORTED_BY_CALLBACK:
+      return AZ_ERROR_CANCELED;
+
     default:
       // let any other error code be an HTTP PAL ERROR
       return AZ_ERROR_HTTP_PLATFORM;
@@ -265,84 +271,143 @@ _az_http_client_curl_send_delete_request(CURL* p_curl, _az_http_request const* p
 }
 
 /**
- * handles POST request. It handles seting up a body for request
+ * @brief The body of a request being sent: its parts, and the position of the next byte to send.
  */
-static AZ_NODISCARD az_result
-_az_http_client_curl_send_post_request(CURL* p_curl, _az_http_request const* p_request)
+typedef struct
 {
-  AZ_PRECONDITION_NOT_NULL(p_curl);
-  AZ_PRECONDITION_NOT_NULL(p_request);
-
-  // Method
-  az_span body = { 0 };
-  int32_t const required_length
-      = az_span_length(p_request->_internal.body) + az_span_length(AZ_SPAN_FROM_STR("\0"));
-
-  AZ_RETURN_IF_FAILED(_az_span_malloc(required_length, &body));
-
-  char* b = (char*)az_span_ptr(body);
-  az_result res_code = az_span_to_str(b, required_length, p_request->_internal.body);
-
-  if (az_succeeded(res_code))
-  {
-    res_code = _az_http_client_curl_code_to_result(curl_easy_setopt(p_curl, CURLOPT_POSTFIELDS, b));
-    if (az_succeeded(res_code))
-    {
-      res_code = _az_http_client_curl_code_to_result(curl_easy_perform(p_curl));
-    }
-  }
-
-  _az_span_free(&body);
-  AZ_RETURN_IF_FAILED(res_code);
-
-  return AZ_OK;
-}
+  az_span const* parts;
+  int32_t parts_length;
+  int32_t part;
+  int32_t offset;
+} _az_http_client_curl_body_reader;
 
 /**
- * @brief UPLOAD requests are done via callbacks.  The callback is passed in a buffer address which
- * is filled with the userdata content. The callback will occur until the callback returns 0 (no
- * more data). The callback will return CURL_READFUNC_ABORT should an error occur.  This in turn
- * terminates the POST request.
+ * @brief Request bodies are sent via callbacks, so that the parts of a body are not concatenated.
+ * The callback is passed in a buffer address which is filled with the next bytes of the body. The
+ * callback will occur until the callback returns 0 (no more data). The callback will return
+ * CURL_READFUNC_ABORT should an error occur. This in turn terminates the request.
  *
  * @param dst Destination address buffer
  * @param size Size of an item
  * @param nmemb Number of items to copy
  * @param userdata Source data to upload
- *                 Passed as the pointer to an az_span
+ *                 Passed as the pointer to an _az_http_client_curl_body_reader
  * @return int
  */
-static int32_t _az_http_client_curl_upload_read_callback(
+static size_t _az_http_client_curl_upload_read_callback(
     void* dst,
     size_t size,
     size_t nmemb,
     void* userdata)
 {
-
-  az_span* upload_content = (az_span*)userdata;
+  _az_http_client_curl_body_reader* const reader = (_az_http_client_curl_body_reader*)userdata;
 
   // Calculate the size of the *dst buffer
-  int32_t dst_buffer_size = (int32_t)(nmemb * size);
+  size_t const dst_buffer_size = nmemb * size;
 
   // Terminate the upload if the destination buffer is too small
   if (dst_buffer_size < 1)
+  {
     return CURL_READFUNC_ABORT;
+  }
+
+  // Gather as many parts as fit in the destination buffer.
+  size_t copied = 0;
+  while (copied < dst_buffer_size && reader->part < reader->parts_length)
+  {
+    az_span const part = reader->parts[reader->part];
+    size_t const remaining = (size_t)(az_span_length(part) - reader->offset);
+    size_t const size_of_copy
+        = remaining < dst_buffer_size - copied ? remaining : dst_buffer_size - copied;
+
+    memcpy((uint8_t*)dst + copied, az_span_ptr(part) + reader->offset, size_of_copy);
+    copied += size_of_copy;
+    reader->offset += (int32_t)size_of_copy;
+
+    if (reader->offset == az_span_length(part))
+    {
+      ++reader->part;
+      reader->offset = 0;
+    }
+  }
+
+  return copied;
+}
 
-  int32_t userdata_length = az_span_length(*upload_content);
+/**
+ * @brief Rewinds the body of a request, for curl to send it again, as after a redirect or when
+ * the connection is reused and turns out to be closed. Only going back to the start is supported.
+ *
+ * @param userdata The _az_http_client_curl_body_reader of the body
+ * @param offset Offset to move to, from origin
+ * @param origin SEEK_SET, SEEK_CUR or SEEK_END
+ * @return CURL_SEEKFUNC_OK, or CURL_SEEKFUNC_CANTSEEK for curl to find another way
+ */
+static int _az_http_client_curl_upload_seek_callback(void* userdata, curl_off_t offset, int origin)
+{
+  _az_http_client_curl_body_reader* const reader = (_az_http_client_curl_body_reader*)userdata;
+
+  if (origin != SEEK_SET || offset != 0)
+  {
+    return CURL_SEEKFUNC_CANTSEEK;
+  }
+
+  reader->part = 0;
+  reader->offset = 0;
+  return CURL_SEEKFUNC_OK;
+}
+
+/**
+ * @brief Sets up the read and seek callbacks to send the body of a request.
+ */
+static AZ_NODISCARD az_result _az_http_client_curl_setup_body(
+    CURL* p_curl,
+    _az_http_request const* p_request,
+    _az_http_client_curl_body_reader* reader,
+    CURLoption size_option)
+{
+  *reader = (_az_http_client_curl_body_reader){ 0 };
+  AZ_RETURN_IF_FAILED(
+      az_http_request_get_body_parts(p_request, &reader->parts, &reader->parts_length));
 
-  // Return if nothing to copy
-  if (userdata_length < 1)
-    return CURLE_OK; // Success, all bytes copied
+  AZ_RETURN_IF_CURL_FAILED(
+      curl_easy_setopt(p_curl, CURLOPT_READFUNCTION, _az_http_client_curl_upload_read_callback));
 
-  int32_t size_of_copy = (userdata_length < dst_buffer_size) ? userdata_length : dst_buffer_size;
+  // Setup the request to pass body into the read callback
+  // The read callback receives the address of the reader
+  AZ_RETURN_IF_CURL_FAILED(curl_easy_setopt(p_curl, CURLOPT_READDATA, reader));
 
-  memcpy(dst, az_span_ptr(*upload_content), size_of_copy);
+  // Without a seek callback, curl fails requests whose body has to be sent again.
+  AZ_RETURN_IF_CURL_FAILED(
+      curl_easy_setopt(p_curl, CURLOPT_SEEKFUNCTION, _az_http_client_curl_upload_seek_callback));
+  AZ_RETURN_IF_CURL_FAILED(curl_easy_setopt(p_curl, CURLOPT_SEEKDATA, reader));
 
-  // Update the userdata span
-  //  ptr will point to remaining data to be copied
-  //  length and capacity are set to the size of the remaining content
-  *upload_content = az_span_slice(*upload_content, dst_buffer_size, -1);
+  // Set the size of the body, which curl sends as the Content-Length.
+  AZ_RETURN_IF_CURL_FAILED(curl_easy_setopt(
+      p_curl, size_option, (curl_off_t)az_http_request_get_body_length(p_request)));
 
-  return size_of_copy;
+  return AZ_OK;
+}
+
+/**
+ * handles POST request. It handles seting up a body for request
+ */
+static AZ_NODISCARD az_result
+_az_http_client_curl_send_post_request(CURL* p_curl, _az_http_request const* p_request)
+{
+  AZ_PRECONDITION_NOT_NULL(p_curl);
+  AZ_PRECONDITION_NOT_NULL(p_request);
+
+  _az_http_client_curl_body_reader reader;
+
+  AZ_RETURN_IF_CURL_FAILED(curl_easy_setopt(p_curl, CURLOPT_POST, 1L));
+  AZ_RETURN_IF_FAILED(
+      _az_http_client_curl_setup_body(p_curl, p_request, &reader, CURLOPT_POSTFIELDSIZE_LARGE));
+
+  // curl_easy_perform does not return until the CURLOPT_READFUNCTION callbacks complete.
+  AZ_RETURN_IF_CURL_FAILED(curl_easy_perform(p_curl));
+
+  return AZ_OK;
 }
 
 /**
@@ -355,19 +420,11 @@ _az_http_client_curl_send_upload_request(CURL* p_curl, _az_http_request const* p
   AZ_PRECONDITION_NOT_NULL(p_curl);
   AZ_PRECONDITION_NOT_NULL(p_request);
 
-  az_span body = p_request->_internal.body;
+  _az_http_client_curl_body_reader reader;
 
   AZ_RETURN_IF_CURL_FAILED(curl_easy_setopt(p_curl, CURLOPT_UPLOAD, 1L));
-  AZ_RETURN_IF_CURL_FAILED(
-      curl_easy_setopt(p_curl, CURLOPT_READFUNCTION, _az_http_client_curl_upload_read_callback));
-
-  // Setup the request to pass body into the read callback
-  // The read callback receives the address of body
-  AZ_RETURN_IF_CURL_FAILED(curl_easy_setopt(p_curl, CURLOPT_READDATA, &body));
-
-  // Set the size of the upload
-  AZ_RETURN_IF_CURL_FAILED(
-      curl_easy_setopt(p_curl, CURLOPT_INFILESIZE, (curl_off_t)az_span_length(body)));
+  AZ_RETURN_IF_FAILED(
+      _az_http_client_curl_setup_body(p_curl, p_request, &reader, CURLOPT_INFILESIZE_LARGE));
 
   // Do the curl work
   // curl_easy_perform does not return until the CURLOPT_READFUNCTION callbacks complete.
@@ -468,6 +525,56 @@ _az_http_client_curl_setup_response_redirect(CURL* p_curl, az_span* response_bui
   return AZ_OK;
 }
 
+/**
+ * @brief curl calls this function periodically during a transfer (at least once per second). A
+ * non-zero return value aborts the transfer with CURLE_ABORTED_BY_CALLBACK.
+ */
+static int _az_http_client_curl_progress_callback(
+    void* clientp,
+    curl_off_t dltotal,
+    curl_off_t dlnow,
+    curl_off_t ultotal,
+    curl_off_t ulnow)
+{
+  (void)dltotal;
+  (void)dlnow;
+  (void)ultotal;
+  (void)ulnow;
+
+  // az_context_cancel sets the expiration of the canceled node to the beginning of time.
+  az_context const* const context = (az_context const*)clientp;
+  return az_context_get_expiration(context) == 0 ? 1 : 0;
+}
+
+/**
+ * @brief aborts the transfer as soon as the context of the request is canceled, so that the socket
+ * and the calling thread are released without waiting for the server.
+ *
+ * @param p_curl specif curl structure used to send http request
+ * @param p_request an http request builder holding all http request data
+ * @return az_result
+ */
+static AZ_NODISCARD az_result
+_az_http_client_curl_setup_cancellation(CURL* p_curl, _az_http_request const* p_request)
+{
+  AZ_PRECONDITION_NOT_NULL(p_curl);
+
+  if (p_request->_internal.context == NULL)
+  {
+    return AZ_OK;
+  }
+
+  AZ_RETURN_IF_CURL_FAILED(
+      curl_easy_setopt(p_curl, CURLOPT_XFERINFOFUNCTION, _az_http_client_curl_progress_callback));
+
+  AZ_RETURN_IF_CURL_FAILED(
+      curl_easy_setopt(p_curl, CURLOPT_XFERINFODATA, (void*)p_request->_internal.context));
+
+  AZ_RETURN_IF_CURL_FAILED(curl_easy_setopt(p_curl, CURLOPT_NOPROGRESS, 0L));
+
+  return AZ_OK;
+}
+
 /**
  * @brief use this method to group all the actions that we do with CURL so we can clean it after it
  * no matter is there is an error at any step.
@@ -495,6 +602,8 @@ static AZ_NODISCARD az_result _az_http_client_curl_send_request_impl_process(
   AZ_RETURN_IF_FAILED(
       _az_http_client_curl_setup_response_redirect(p_curl, &response->_internal.http_response));
 
+  AZ_RETURN_IF_FAILED(_az_http_client_curl_setup_cancellation(p_curl, p_request));
+
   if (az_span_is_content_equal(p_request->_internal.method, az_http_method_get()))
   {
     result = _az_http_client_curl_send_get_request(p_curl);
@@ -529,6 +638,42 @@ static AZ_NODISCARD az_result _az_http_client_curl_send_request_impl_process(
   return result;
 }
 
+/**
+ * @brief reads the connection phases of the last transfer. Curl reports them as seconds elapsed
+ * since the start of the transfer, so each phase is the difference with the previous one.
+ *
+ * @param p_curl curl specific structure used to send the http request
+ * @param metrics request metrics where to write phases durations
+ */
+static void _az_http_client_curl_get_metrics(CURL* p_curl, az_http_request_metrics* metrics)
+{
+  double namelookup_sec = 0;
+  double connect_sec = 0;
+  double appconnect_sec = 0;
+  double starttransfer_sec = 0;
+
+  if (curl_easy_getinfo(p_curl, CURLINFO_NAMELOOKUP_TIME, &namelookup_sec) != CURLE_OK
+      || curl_easy_getinfo(p_curl, CURLINFO_CONNECT_TIME, &connect_sec) != CURLE_OK
+      || curl_easy_getinfo(p_curl, CURLINFO_APPCONNECT_TIME, &appconnect_sec) != CURLE_OK
+      || curl_easy_getinfo(p_curl, CURLINFO_STARTTRANSFER_TIME, &starttransfer_sec) != CURLE_OK)
+  {
+    return;
+  }
+
+  metrics->dns_msec = (int64_t)(namelookup_sec * _az_TIME_MILLISECONDS_PER_SECOND);
+  metrics->connect_msec
+      = (int64_t)((connect_sec - namelookup_sec) * _az_TIME_MILLISECONDS_PER_SECOND);
+
+  // appconnect is 0 when there was no TLS handshake
+  if (appconnect_sec > 0)
+  {
+    metrics->tls_msec
+        = (int64_t)((appconnect_sec - connect_sec) * _az_TIME_MILLISECONDS_PER_SECOND);
+  }
+
+  metrics->first_byte_msec = (int64_t)(starttransfer_sec * _az_TIME_MILLISECONDS_PER_SECOND);
+}
+
 /**
  * @brief uses AZ_HTTP_BUILDER to set up CURL request and perform it.
  *
@@ -551,6 +696,11 @@ az_http_client_send_request(_az_http_request* p_request, az_http_response* p_res
   az_result process_result
       = _az_http_client_curl_send_request_impl_process(p_curl, p_request, p_response);
 
+  if (p_request->_internal.metrics != NULL)
+  {
+    _az_http_client_curl_get_metrics(p_curl, p_request->_internal.metrics);
+  }
+
   // no matter if error or not, call curl done before returning to let curl clean everything
   AZ_RETURN_IF_FAILED(_az_http_client_curl_done(&p_curl));
 
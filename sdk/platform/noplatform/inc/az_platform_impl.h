@@ -4,6 +4,8 @@
 #ifndef _az_PLATFORM_IMPL_H
 #define _az_PLATFORM_IMPL_H
 
+#include <stdbool.h>
+
 #include <_az_cfg_prefix.h>
 
 struct az_platform_mtx
@@ -16,6 +18,46 @@ struct az_platform_mtx
   } _internal;
 };
 
+struct az_platform_cond
+{
+  struct
+  {
+    char unused;
+  } _internal;
+};
+
+// Without threads, every caller is the current thread.
+struct az_platform_thread_id
+{
+  struct
+  {
+    char unused;
+  } _internal;
+};
+
+// Threads can't be started.
+struct az_platform_thread
+{
+  struct
+  {
+    char unused;
+  } _internal;
+};
+
+// Without threads, a flag is enough.
+struct az_platform_once
+{
+  struct
+  {
+    bool done;
+  } _internal;
+};
+
+#define AZ_PLATFORM_ONCE_INIT \
+  { \
+    ._internal = {.done = false } \
+  }
+
 #include <_az_cfg_suffix.h>
 
 #endif // _az_PLATFORM_IMPL_H
@@ -28,3 +28,57 @@ AZ_NODISCARD az_result az_platform_mtx_unlock(az_platform_mtx* mtx)
   (void)mtx;
   return AZ_ERROR_NOT_IMPLEMENTED;
 }
+
+void az_platform_cond_destroy(az_platform_cond* cond) { *cond = (az_platform_cond){ 0 }; }
+
+AZ_NODISCARD az_result az_platform_cond_init(az_platform_cond* cond)
+{
+  (void)cond;
+  return AZ_ERROR_NOT_IMPLEMENTED;
+}
+
+AZ_NODISCARD az_result az_platform_cond_wait(az_platform_cond* cond, az_platform_mtx* mtx)
+{
+  (void)cond;
+  (void)mtx;
+  return AZ_ERROR_NOT_IMPLEMENTED;
+}
+
+AZ_NODISCARD az_result az_platform_cond_broadcast(az_platform_cond* cond)
+{
+  (void)cond;
+  return AZ_ERROR_NOT_IMPLEMENTED;
+}
+
+void az_platform_thread_get_id(az_platform_thread_id* out_id) { (void)out_id; }
+
+AZ_NODISCARD bool az_platform_thread_is_current(az_platform_thread_id const* id)
+{
+  (void)id;
+  return true;
+}
+
+AZ_NODISCARD az_result
+az_platform_thread_create(az_platform_thread* thread, az_platform_thread_fn fn, void* arg)
+{
+  (void)thread;
+  (void)fn;
+  (void)arg;
+  return AZ_ERROR_NOT_IMPLEMENTED;
+}
+
+AZ_NODISCARD az_result az_platform_thread_join(az_platform_thread* thread)
+{
+  (void)thread;
+  return AZ_ERROR_NOT_IMPLEMENTED;
+}
+
+AZ_NODISCARD az_result az_platform_call_once(az_platform_once* once, az_platform_once_fn fn)
+{
+  if (!once->_internal.done)
+  {
+    once->_internal.done = true;
+    fn();
+  }
+  return AZ_OK;
+}
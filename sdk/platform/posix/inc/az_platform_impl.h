@@ -16,6 +16,45 @@ struct az_platform_mtx
   } _internal;
 };
 
+struct az_platform_cond
+{
+  struct
+  {
+    pthread_cond_t cond;
+  } _internal;
+};
+
+struct az_platform_thread_id
+{
+  struct
+  {
+    pthread_t thread;
+  } _internal;
+};
+
+struct az_platform_thread
+{
+  struct
+  {
+    pthread_t thread;
+    void (*fn)(void* arg);
+    void* arg;
+  } _internal;
+};
+
+struct az_platform_once
+{
+  struct
+  {
+    pthread_once_t once;
+  } _internal;
+};
+
+#define AZ_PLATFORM_ONCE_INIT \
+  { \
+    ._internal = {.once = PTHREAD_ONCE_INIT } \
+  }
+
 #include <_az_cfg_suffix.h>
 
 #endif // _az_PLATFORM_IMPL_H
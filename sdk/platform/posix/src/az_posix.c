@@ -46,3 +46,64 @@ AZ_NODISCARD az_result az_platform_mtx_unlock(az_platform_mtx* mtx)
 {
   return pthread_mutex_unlock(&mtx->_internal.mutex) == 0 ? AZ_OK : AZ_ERROR_MUTEX;
 }
+
+void az_platform_cond_destroy(az_platform_cond* cond)
+{
+  if (pthread_cond_destroy(&cond->_internal.cond) == 0)
+  {
+    *cond = (az_platform_cond){ 0 };
+  }
+}
+
+AZ_NODISCARD az_result az_platform_cond_init(az_platform_cond* cond)
+{
+  return pthread_cond_init(&cond->_internal.cond, NULL) == 0 ? AZ_OK : AZ_ERROR_MUTEX;
+}
+
+AZ_NODISCARD az_result az_platform_cond_wait(az_platform_cond* cond, az_platform_mtx* mtx)
+{
+  return pthread_cond_wait(&cond->_internal.cond, &mtx->_internal.mutex) == 0 ? AZ_OK
+                                                                              : AZ_ERROR_MUTEX;
+}
+
+AZ_NODISCARD az_result az_platform_cond_broadcast(az_platform_cond* cond)
+{
+  return pthread_cond_broadcast(&cond->_internal.cond) == 0 ? AZ_OK : AZ_ERROR_MUTEX;
+}
+
+void az_platform_thread_get_id(az_platform_thread_id* out_id)
+{
+  out_id->_internal.thread = pthread_self();
+}
+
+AZ_NODISCARD bool az_platform_thread_is_current(az_platform_thread_id const* id)
+{
+  return pthread_equal(id->_internal.thread, pthread_self()) != 0;
+}
+
+static void* _az_posix_thread_start(void* thread)
+{
+  az_platform_thread* const started = (az_platform_thread*)thread;
+  started->_internal.fn(started->_internal.arg);
+  return NULL;
+}
+
+AZ_NODISCARD az_result
+az_platform_thread_create(az_platform_thread* thread, az_platform_thread_fn fn, void* arg)
+{
+  thread->_internal.fn = fn;
+  thread->_internal.arg = arg;
+  return pthread_create(&thread->_internal.thread, NULL, _az_posix_thread_start, thread) == 0
+      ? AZ_OK
+      : AZ_ERROR_MUTEX;
+}
+
+AZ_NODISCARD az_result az_platform_thread_join(az_platform_thread* thread)
+{
+  return pthread_join(thread->_internal.thread, NULL) == 0 ? AZ_OK : AZ_ERROR_MUTEX;
+}
+
+AZ_NODISCARD az_result az_platform_call_once(az_platform_once* once, az_platform_once_fn fn)
+{
+  return pthread_once(&once->_internal.once, fn) == 0 ? AZ_OK : AZ_ERROR_MUTEX;
+}
@@ -36,6 +36,45 @@ struct az_platform_mtx
   } _internal;
 };
 
+struct az_platform_cond
+{
+  struct
+  {
+    CONDITION_VARIABLE cv;
+  } _internal;
+};
+
+struct az_platform_thread_id
+{
+  struct
+  {
+    DWORD thread;
+  } _internal;
+};
+
+struct az_platform_thread
+{
+  struct
+  {
+    HANDLE thread;
+    void (*fn)(void* arg);
+    void* arg;
+  } _internal;
+};
+
+struct az_platform_once
+{
+  struct
+  {
+    INIT_ONCE once;
+  } _internal;
+};
+
+#define AZ_PLATFORM_ONCE_INIT \
+  { \
+    ._internal = {.once = INIT_ONCE_STATIC_INIT } \
+  }
+
 #include <_az_cfg_suffix.h>
 
 #endif // _az_PLATFORM_IMPL_H
@@ -32,3 +32,72 @@ AZ_NODISCARD az_result az_platform_mtx_unlock(az_platform_mtx* mtx)
   LeaveCriticalSection(&mtx->_internal.cs);
   return AZ_OK;
 }
+
+void az_platform_cond_destroy(az_platform_cond* cond) { *cond = (az_platform_cond){ 0 }; }
+
+AZ_NODISCARD az_result az_platform_cond_init(az_platform_cond* cond)
+{
+  InitializeConditionVariable(&cond->_internal.cv);
+  return AZ_OK;
+}
+
+AZ_NODISCARD az_result az_platform_cond_wait(az_platform_cond* cond, az_platform_mtx* mtx)
+{
+  return SleepConditionVariableCS(&cond->_internal.cv, &mtx->_internal.cs, INFINITE)
+      ? AZ_OK
+      : AZ_ERROR_MUTEX;
+}
+
+AZ_NODISCARD az_result az_platform_cond_broadcast(az_platform_cond* cond)
+{
+  WakeAllConditionVariable(&cond->_internal.cv);
+  return AZ_OK;
+}
+
+void az_platform_thread_get_id(az_platform_thread_id* out_id)
+{
+  out_id->_internal.thread = GetCurrentThreadId();
+}
+
+AZ_NODISCARD bool az_platform_thread_is_current(az_platform_thread_id const* id)
+{
+  return id->_internal.thread == GetCurrentThreadId();
+}
+
+static DWORD WINAPI _az_win32_thread_start(LPVOID thread)
+{
+  az_platform_thread* const started = (az_platform_thread*)thread;
+  started->_internal.fn(started->_internal.arg);
+  return 0;
+}
+
+AZ_NODISCARD az_result
+az_platform_thread_create(az_platform_thread* thread, az_platform_thread_fn fn, void* arg)
+{
+  thread->_internal.fn = fn;
+  thread->_internal.arg = arg;
+  thread->_internal.thread = CreateThread(NULL, 0, _az_win32_thread_start, thread, 0, NULL);
+  return thread->_internal.thread != NULL ? AZ_OK : AZ_ERROR_MUTEX;
+}
+
+AZ_NODISCARD az_result az_platform_thread_join(az_platform_thread* thread)
+{
+  DWORD const waited = WaitForSingleObject(thread->_internal.thread, INFINITE);
+  (void)CloseHandle(thread->_internal.thread);
+  return waited == WAIT_OBJECT_0 ? AZ_OK : AZ_ERROR_MUTEX;
+}
+
+static BOOL CALLBACK _az_win32_call_once(PINIT_ONCE once, PVOID parameter, PVOID* context)
+{
+  (void)once;
+  (void)context;
+  (*(az_platform_once_fn*)parameter)();
+  return TRUE;
+}
+
+AZ_NODISCARD az_result az_platform_call_once(az_platform_once* once, az_platform_once_fn fn)
+{
+  return InitOnceExecuteOnce(&once->_internal.once, _az_win32_call_once, &fn, NULL)
+      ? AZ_OK
+      : AZ_ERROR_MUTEX;
+}
@@ -6,9 +6,12 @@
 
 #include <az_credentials.h>
 #include <az_http.h>
+#include <az_http_metrics.h>
+#include <az_http_tracing.h>
 #include <az_result.h>
 #include <az_span.h>
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <_az_cfg_prefix.h>
@@ -21,6 +24,10 @@ static az_span const AZ_KEYVAULT_API_VERSION = AZ_SPAN_LITERAL_FROM_STR("7.0");
 typedef struct
 {
   az_http_policy_retry_options retry;
+  az_http_metrics* metrics; ///< Where to record requests latency, NULL to not record it.
+  az_http_tracing_options* tracing; ///< Where to export requests spans, NULL to not trace them.
+  az_http_user_policy const* policies; ///< Policies added to the pipeline, NULL for none.
+  int32_t policies_length; ///< Up to #AZ_HTTP_PIPELINE_USER_POLICIES_MAX.
   struct
   {
     _az_http_policy_apiversion_options api_version;
@@ -49,6 +56,11 @@ typedef struct
     _az_http_pipeline pipeline;
     az_keyvault_keys_client_options options;
     _az_credential* credential;
+    // The constant parts of the key requests, built in url_buffer and key_create_headers.
+    _az_http_prepared_request key_create;
+    _az_http_prepared_request key_get;
+    _az_http_prepared_request key_delete;
+    az_pair key_create_headers[1];
   } _internal;
 } az_keyvault_keys_client;
 
@@ -184,6 +196,308 @@ AZ_NODISCARD az_result az_keyvault_keys_key_delete(
     az_span key_name,
     az_http_response* response);
 
+/**
+ * @brief The outcome of the request for one key of az_keyvault_keys_key_create_each, _get_each or
+ * _delete_each.
+ *
+ */
+typedef struct
+{
+  az_result result; ///< Result of the call, AZ_ERROR_CANCELED if the key was not sent.
+  az_http_status_code status_code; ///< Status code of the response, or none if there was none.
+} az_keyvault_keys_key_result;
+
+enum
+{
+  AZ_KEYVAULT_KEYS_EACH_CLIENTS_MAX = 16, ///< Most requests in flight of an _each call.
+};
+
+/**
+ * @brief Receives the response for a key, before the request for another key is sent in the same
+ * response buffer.
+ *
+ * @details With several clients, it is called concurrently from their threads, each time with
+ * the response of a different client.
+ *
+ * @param user_context the user context given with the keys
+ * @param index index of the key in the key names
+ * @param response the response for the key
+ * @return AZ_OK to go on sending the keys, or an error to stop and return that error
+ */
+typedef AZ_NODISCARD az_result (*az_keyvault_keys_key_response_fn)(
+    void* user_context,
+    int32_t index,
+    az_http_response* response);
+
+/**
+ * @brief Creates keys of the same type and options, like az_keyvault_keys_key_create, with up to
+ * \p clients_length requests in flight. The request body is built once for all the keys.
+ *
+ * @details This is not a batch operation of the service. Each client sends requests in a thread
+ * of the platform, the first one in the calling thread, and writes their responses in its own
+ * buffer of \p responses: the call takes about as long as the round trips divided by the number
+ * of clients. Clients must not share a credential, unless it uses the token cache. Without
+ * threads, e.g. with no platform, the first client sends all the requests.
+ *
+ * The keys are sent in order of \p key_names. A key that fails doesn't stop the others. Once \p
+ * context is canceled or \p on_response returns an error, the requests in flight end but no other
+ * key is sent. \p out_results is filled in every case, in the order of \p key_names.
+ *
+ * @param clients keyvault clients sending the requests, initialized with the same options
+ * @param clients_length number of clients, from 1 to AZ_KEYVAULT_KEYS_EACH_CLIENTS_MAX
+ * @param context context of the requests, checked for cancellation before each key
+ * @param key_names names of the keys to create
+ * @param key_names_length number of keys in \p key_names
+ * @param json_web_key_type type of the keys to create
+ * @param options create options for the keys, or NULL
+ * @param responses pre allocated buffers where to write the http responses, one for each client
+ * @param on_response called with each response, or NULL to only keep the status codes
+ * @param user_context passed to \p on_response
+ * @param out_results receives the result of each key, in the order of \p key_names
+ * @return AZ_OK = Every key was sent <br>
+ * AZ_ERROR_CANCELED = \p context was canceled <br>
+ * Other value = The error returned by \p on_response, or the body could not be built
+ */
+AZ_NODISCARD az_result az_keyvault_keys_key_create_each(
+    az_keyvault_keys_client* clients,
+    int32_t clients_length,
+    az_context* context,
+    az_span const* key_names,
+    int32_t key_names_length,
+    json_web_key_type json_web_key_type,
+    az_keyvault_create_key_options* options,
+    az_http_response* responses,
+    az_keyvault_keys_key_response_fn on_response,
+    void* user_context,
+    az_keyvault_keys_key_result* out_results);
+
+/**
+ * @brief Gets the latest version of keys, like az_keyvault_keys_key_get, with up to \p
+ * clients_length requests in flight.
+ *
+ * @details See az_keyvault_keys_key_create_each.
+ *
+ * @param clients keyvault clients sending the requests, initialized with the same options
+ * @param clients_length number of clients, from 1 to AZ_KEYVAULT_KEYS_EACH_CLIENTS_MAX
+ * @param context context of the requests, checked for cancellation before each key
+ * @param key_names names of the keys to get
+ * @param key_names_length number of keys in \p key_names
+ * @param responses pre allocated buffers where to write the http responses, one for each client
+ * @param on_response called with each response, or NULL to only keep the status codes
+ * @param user_context passed to \p on_response
+ * @param out_results receives the result of each key, in the order of \p key_names
+ * @return AZ_OK = Every key was sent <br>
+ * AZ_ERROR_CANCELED = \p context was canceled <br>
+ * Other value = The error returned by \p on_response
+ */
+AZ_NODISCARD az_result az_keyvault_keys_key_get_each(
+    az_keyvault_keys_client* clients,
+    int32_t clients_length,
+    az_context* context,
+    az_span const* key_names,
+    int32_t key_names_length,
+    az_http_response* responses,
+    az_keyvault_keys_key_response_fn on_response,
+    void* user_context,
+    az_keyvault_keys_key_result* out_results);
+
+/**
+ * @brief Deletes keys, like az_keyvault_keys_key_delete, with up to \p clients_length requests
+ * in flight.
+ *
+ * @details See az_keyvault_keys_key_create_each.
+ *
+ * @param clients keyvault clients sending the requests, initialized with the same options
+ * @param clients_length number of clients, from 1 to AZ_KEYVAULT_KEYS_EACH_CLIENTS_MAX
+ * @param context context of the requests, checked for cancellation before each key
+ * @param key_names names of the keys to delete
+ * @param key_names_length number of keys in \p key_names
+ * @param responses pre allocated buffers where to write the http responses, one for each client
+ * @param on_response called with each response, or NULL to only keep the status codes
+ * @param user_context passed to \p on_response
+ * @param out_results receives the result of each key, in the order of \p key_names
+ * @return AZ_OK = Every key was sent <br>
+ * AZ_ERROR_CANCELED = \p context was canceled <br>
+ * Other value = The error returned by \p on_response
+ */
+AZ_NODISCARD az_result az_keyvault_keys_key_delete_each(
+    az_keyvault_keys_client* clients,
+    int32_t clients_length,
+    az_context* context,
+    az_span const* key_names,
+    int32_t key_names_length,
+    az_http_response* responses,
+    az_keyvault_keys_key_response_fn on_response,
+    void* user_context,
+    az_keyvault_keys_key_result* out_results);
+
+/**
+ * @brief The public part of a key, as parsed from the response of az_keyvault_keys_key_get. The
+ * fields are the JSON web key members, as sent by the service (numbers are Base64url encoded),
+ * or AZ_SPAN_NULL when the response doesn't have them.
+ *
+ */
+typedef struct
+{
+  az_span kid; ///< Identifier of the key, including its version.
+  json_web_key_type kty;
+  az_span n; ///< RSA modulus.
+  az_span e; ///< RSA public exponent.
+  az_span crv; ///< Elliptic curve name.
+  az_span x; ///< X coordinate of an elliptic curve point.
+  az_span y; ///< Y coordinate of an elliptic curve point.
+} az_keyvault_key;
+
+/**
+ * @brief Parses the key of the body of a key bundle response in a single pass.
+ *
+ * @param json the response body
+ * @param out_key receives the key. Its fields point into \p json.
+ * @return AZ_OK = Key parsed <br>
+ * AZ_ERROR_ITEM_NOT_FOUND = The body has no key <br>
+ * Other value = The body is not valid JSON
+ */
+AZ_NODISCARD az_result az_keyvault_key_parse(az_span json, az_keyvault_key* out_key);
+
+/**
+ * @brief An entry of an az_keyvault_key_cache. User should not access _internal field.
+ *
+ */
+typedef struct
+{
+  struct
+  {
+    uint8_t* slot; // The key name, followed by the fields of the key.
+    int32_t name_length; // 0 when the entry is empty.
+    az_keyvault_key key; // Points into slot.
+    int64_t refresh_at_msec;
+    int64_t expires_at_msec;
+    uint32_t last_use;
+    bool in_flight; // A request is sent for the key.
+    uint32_t fetches; // Number of requests that ended.
+    az_result fetch_result; // Of the last request that ended.
+  } _internal;
+} az_keyvault_key_cache_entry;
+
+/**
+ * @brief Options of an az_keyvault_key_cache.
+ *
+ */
+typedef struct
+{
+  int32_t ttl_msec; ///< How long a key is used after it was got.
+  int32_t refresh_msec; ///< How long before it expires a key is got again.
+} az_keyvault_key_cache_options;
+
+/**
+ * @brief A cache of parsed keys over a keyvault client. User should not access _internal field.
+ *
+ * @details A get only sends a request for a key that expired or is not cached yet: a cached key
+ * is returned until it expires, without waiting. Concurrent gets of the same missing key wait for
+ * a single request, and get its key or its error. Keys are got again before they expire by
+ * az_keyvault_key_cache_refresh(), which the application calls from a timer of its own, as the
+ * SDK doesn't start threads.
+ *
+ * A cache can be used by several threads: it is locked by a mutex of the platform, held only
+ * while the cache is read or changed, never during a request.
+ */
+typedef struct
+{
+  struct
+  {
+    az_keyvault_keys_client* client;
+    az_keyvault_key_cache_entry* entries;
+    int32_t entries_length;
+    int32_t slot_size;
+    az_keyvault_key_cache_options options;
+    uint32_t uses;
+  } _internal;
+} az_keyvault_key_cache;
+
+/**
+ * @brief Get the default options of an az_keyvault_key_cache: keys are used for 10 minutes, and
+ * got again from 1 minute before they expire.
+ *
+ */
+AZ_NODISCARD az_keyvault_key_cache_options az_keyvault_key_cache_options_default();
+
+/**
+ * @brief Initialize an empty az_keyvault_key_cache.
+ *
+ * @param cache az_keyvault_key_cache to initialize
+ * @param client the client getting the keys. It must outlive the cache.
+ * @param entries Storage for the entries. When all are used, the least recently used key is
+ * replaced. It must outlive the cache.
+ * @param entries_length Number of elements in \p entries
+ * @param buffer Storage for the key names and fields, split evenly between the entries. A key
+ * that doesn't fit in its part is not cached. It must outlive the cache.
+ * @param options Options of the cache, NULL for the default ones.
+ * @return AZ_OK = Successfull initialization <br>
+ * AZ_ERROR_ARG = \p refresh_msec is not less than \p ttl_msec
+ */
+AZ_NODISCARD az_result az_keyvault_key_cache_init(
+    az_keyvault_key_cache* cache,
+    az_keyvault_keys_client* client,
+    az_keyvault_key_cache_entry* entries,
+    int32_t entries_length,
+    az_span buffer,
+    az_keyvault_key_cache_options const* options);
+
+/**
+ * @brief Get the latest version of a key, from the cache when it is fresh.
+ *
+ * @param cache az_keyvault_key_cache to use
+ * @param context context of the request, if one is sent
+ * @param key_name name of the key
+ * @param now_msec the current time, in milliseconds, from any fixed origin
+ * @param response a pre allocated buffer where to write the http response, if a request is sent
+ * @param out_key receives the key. Its fields point into the buffer of \p response, where a
+ * cached key is copied, so they stay valid while the cache is changed by other threads.
+ * @return AZ_OK = Key got <br>
+ * AZ_ERROR_ITEM_NOT_FOUND = The service answered that the key doesn't exist <br>
+ * AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY = The cached key doesn't fit in \p response <br>
+ * AZ_ERROR_HTTP_UNEXPECTED_STATUS_CODE = The service answered with another error: the response
+ * tells why <br>
+ * Other value = The request failed
+ */
+AZ_NODISCARD az_result az_keyvault_key_cache_get(
+    az_keyvault_key_cache* cache,
+    az_context* context,
+    az_span key_name,
+    int64_t now_msec,
+    az_http_response* response,
+    az_keyvault_key* out_key);
+
+/**
+ * @brief Get again the keys of an az_keyvault_key_cache that expire in less than \p refresh_msec,
+ * one after the other. Gets keep returning a key while it is refreshed.
+ *
+ * @details When a refresh fails, the cached key is kept and it is refreshed again a quarter of
+ * \p refresh_msec later, if it hasn't expired by then. Call it at least that often, e.g. from a
+ * timer thread of the application.
+ *
+ * @param cache az_keyvault_key_cache to refresh
+ * @param context context of the requests
+ * @param now_msec the current time, in milliseconds, from the same origin as the gets
+ * @param response a pre allocated buffer where to write the http responses. It must hold the key
+ * names as well.
+ * @return AZ_OK = The keys due were refreshed, if any <br>
+ * Other value = The result of the last refresh that failed
+ */
+AZ_NODISCARD az_result az_keyvault_key_cache_refresh(
+    az_keyvault_key_cache* cache,
+    az_context* context,
+    int64_t now_msec,
+    az_http_response* response);
+
+/**
+ * @brief Remove a key from an az_keyvault_key_cache, e.g. after it was deleted or rotated.
+ *
+ * @param cache az_keyvault_key_cache to change
+ * @param key_name name of the key
+ */
+void az_keyvault_key_cache_remove(az_keyvault_key_cache* cache, az_span key_name);
+
 #include <_az_cfg_suffix.h>
 
 #endif // _az_KEYVAULT_H
@@ -9,10 +9,12 @@
 #include <az_http_transport.h>
 #include <az_json.h>
 #include <az_keyvault.h>
+#include <az_platform_internal.h>
 #include <az_precondition.h>
 #include <az_precondition_internal.h>
 #include <az_span.h>
 
+#include <stdbool.h>
 #include <stddef.h>
 
 #include <_az_cfg.h>
@@ -55,8 +57,15 @@ AZ_NODISCARD AZ_INLINE az_span az_keyvault_client_constant_for_application_json(
 AZ_NODISCARD az_keyvault_keys_client_options az_keyvault_keys_client_options_default()
 {
   az_keyvault_keys_client_options options = (az_keyvault_keys_client_options){
-    ._internal = { .api_version = _az_http_policy_apiversion_options_default(), },
+    ._internal = {
+      .api_version = _az_http_policy_apiversion_options_default(),
+      ._telemetry_options = _az_http_policy_telemetry_options_default(),
+    },
     .retry = az_http_policy_retry_options_default(),
+    .metrics = NULL,
+    .tracing = NULL,
+    .policies = NULL,
+    .policies_length = 0,
   };
 
   options._internal.api_version._internal.option_location
@@ -87,60 +96,107 @@ AZ_NODISCARD az_result az_keyvault_keys_client_init(
       .uri = AZ_SPAN_FROM_BUFFER(self->_internal.url_buffer),
       .options = *options,
       .credential = cred,
-      .pipeline = (_az_http_pipeline){
-        ._internal = {
-          .p_policies = {
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_apiversion,
-                .p_options= &self->_internal.options._internal.api_version,
-              },
-            },
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_uniquerequestid,
-                .p_options = NULL,
-              },
-            },
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_telemetry,
-                .p_options = &self->_internal.options._internal._telemetry_options,
-              },
-            },
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_retry,
-                .p_options = &self->_internal.options.retry,
-              },
-            },
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_credential,
-                .p_options = cred,
-              },
-            },
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_logging,
-                .p_options = NULL,
-              },
-            },
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_transport,
-                .p_options= NULL,
-              },
-            },
-          },
-        }
-      }
     }
   };
 
+  // The policies of the application are inserted among these by az_http_pipeline_init.
+  _az_http_policy const policies[] = {
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_metrics,
+        .p_options = options->metrics,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_apiversion,
+        .p_options = &self->_internal.options._internal.api_version,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_uniquerequestid,
+        .p_options = NULL,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_tracing,
+        .p_options = options->tracing,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_telemetry,
+        .p_options = &self->_internal.options._internal._telemetry_options,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_retry,
+        .p_options = &self->_internal.options.retry,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_credential,
+        .p_options = cred,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_logging,
+        .p_options = NULL,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_transport,
+        .p_options = NULL,
+      },
+    },
+  };
+  AZ_RETURN_IF_FAILED(az_http_pipeline_init(
+      &self->_internal.pipeline,
+      policies,
+      (int32_t)(sizeof(policies) / sizeof(policies[0])),
+      options->policies,
+      options->policies_length));
+
   // Copy url to client buffer so customer can re-use buffer on his/her side
   AZ_RETURN_IF_FAILED(az_span_copy(self->_internal.uri, uri, &self->_internal.uri));
 
+  // Build the constant parts of the key requests once, after the url in the client buffer:
+  // {uri}/keys?api-version={version}, plus the content type of key_create.
+  _az_http_request request;
+  AZ_RETURN_IF_FAILED(az_http_request_init(
+      &request,
+      &az_context_app,
+      az_http_method_get(),
+      self->_internal.uri,
+      az_span_init(
+          (uint8_t*)self->_internal.key_create_headers,
+          0,
+          sizeof(self->_internal.key_create_headers)),
+      AZ_SPAN_NULL));
+
+  AZ_RETURN_IF_FAILED(
+      az_http_request_append_path(&request, az_keyvault_client_constant_for_keys()));
+  AZ_RETURN_IF_FAILED(
+      az_http_request_set_api_version(&request, &self->_internal.options._internal.api_version));
+
+  AZ_RETURN_IF_FAILED(
+      az_http_prepared_request_init(&self->_internal.key_get, az_http_method_get(), &request));
+  AZ_RETURN_IF_FAILED(az_http_prepared_request_init(
+      &self->_internal.key_delete, az_http_method_delete(), &request));
+
+  AZ_RETURN_IF_FAILED(az_http_request_append_header(
+      &request,
+      az_keyvault_client_constant_for_content_type(),
+      az_keyvault_client_constant_for_application_json()));
+  AZ_RETURN_IF_FAILED(
+      az_http_prepared_request_init(&self->_internal.key_create, az_http_method_post(), &request));
+
   AZ_RETURN_IF_FAILED(
       _az_credential_set_scopes(cred, AZ_SPAN_FROM_STR("https://vault.azure.net/.default")));
 
@@ -222,54 +278,53 @@ AZ_NODISCARD az_result _az_keyvault_keys_key_create_build_json_body(
   return AZ_OK;
 }
 
-AZ_NODISCARD az_result az_keyvault_keys_key_create(
+// Sends the request creating a key, with its JSON body already built.
+static AZ_NODISCARD az_result _az_keyvault_keys_key_create_send(
     az_keyvault_keys_client* client,
     az_context* context,
     az_span key_name,
-    json_web_key_type json_web_key_type,
-    az_keyvault_create_key_options* options,
+    az_span created_body,
     az_http_response* response)
 {
-
-  // Url buffer
   uint8_t url_buffer[AZ_HTTP_REQUEST_URL_BUF_SIZE];
-  az_span request_url_span = AZ_SPAN_FROM_BUFFER(url_buffer);
-  // copy url from client
-  AZ_RETURN_IF_FAILED(az_span_copy(request_url_span, client->_internal.uri, &request_url_span));
-
-  // Headers buffer
   uint8_t headers_buffer[_az_KEYVAULT_HTTP_REQUEST_HEADER_BUF_SIZE];
-  az_span request_headers_span = AZ_SPAN_FROM_BUFFER(headers_buffer);
 
-  // Allocate buffer in stack to hold body request
-  uint8_t body_buffer[AZ_HTTP_REQUEST_BODY_BUF_SIZE];
-  az_span json_builder = AZ_SPAN_FROM_BUFFER(body_buffer);
-  AZ_RETURN_IF_FAILED(
-      _az_keyvault_keys_key_create_build_json_body(json_web_key_type, options, &json_builder));
-  az_span const created_body = json_builder;
-
-  // create request
+  // create request from {uri}/keys?api-version={version}, with the content-type json header
   _az_http_request hrb;
-  AZ_RETURN_IF_FAILED(az_http_request_init(
-      &hrb, context, az_http_method_post(), request_url_span, request_headers_span, created_body));
+  AZ_RETURN_IF_FAILED(az_http_request_init_prepared(
+      &hrb,
+      context,
+      &client->_internal.key_create,
+      AZ_SPAN_FROM_BUFFER(url_buffer),
+      AZ_SPAN_FROM_BUFFER(headers_buffer),
+      created_body));
 
   // add path to request
-  AZ_RETURN_IF_FAILED(az_http_request_append_path(&hrb, az_keyvault_client_constant_for_keys()));
-
   AZ_RETURN_IF_FAILED(az_http_request_append_path(&hrb, key_name));
 
   AZ_RETURN_IF_FAILED(az_http_request_append_path(&hrb, az_keyvault_client_constant_for_create()));
 
-  // Adding header content-type json
-  AZ_RETURN_IF_FAILED(az_http_request_append_header(
-      &hrb,
-      az_keyvault_client_constant_for_content_type(),
-      az_keyvault_client_constant_for_application_json()));
-
   // start pipeline
   return az_http_pipeline_process(&client->_internal.pipeline, &hrb, response);
 }
 
+AZ_NODISCARD az_result az_keyvault_keys_key_create(
+    az_keyvault_keys_client* client,
+    az_context* context,
+    az_span key_name,
+    json_web_key_type json_web_key_type,
+    az_keyvault_create_key_options* options,
+    az_http_response* response)
+{
+  // Allocate buffer in stack to hold body request
+  uint8_t body_buffer[AZ_HTTP_REQUEST_BODY_BUF_SIZE];
+  az_span json_builder = AZ_SPAN_FROM_BUFFER(body_buffer);
+  AZ_RETURN_IF_FAILED(
+      _az_keyvault_keys_key_create_build_json_body(json_web_key_type, options, &json_builder));
+
+  return _az_keyvault_keys_key_create_send(client, context, key_name, json_builder, response);
+}
+
 /**
  * @brief Currently returning last key version. Need to update to get version key
  *
@@ -286,23 +341,18 @@ AZ_NODISCARD az_result az_keyvault_keys_key_get(
     az_span key_version,
     az_http_response* response)
 {
-  // create request buffer TODO: define size for a getKey Request
-
-  uint8_t headers_buffer[_az_KEYVAULT_HTTP_REQUEST_HEADER_BUF_SIZE];
-  az_span request_headers_span = AZ_SPAN_FROM_BUFFER(headers_buffer);
-  // Url buffer
   uint8_t url_buffer[AZ_HTTP_REQUEST_URL_BUF_SIZE];
-  az_span request_url_span = AZ_SPAN_FROM_BUFFER(url_buffer);
-  // copy url from client
-  AZ_RETURN_IF_FAILED(az_span_copy(request_url_span, client->_internal.uri, &request_url_span));
+  uint8_t headers_buffer[_az_KEYVAULT_HTTP_REQUEST_HEADER_BUF_SIZE];
 
-  // create request
+  // create request from {uri}/keys?api-version={version}
   _az_http_request hrb;
-  AZ_RETURN_IF_FAILED(az_http_request_init(
-      &hrb, context, az_http_method_get(), request_url_span, request_headers_span, AZ_SPAN_NULL));
-
-  // Add path to request
-  AZ_RETURN_IF_FAILED(az_http_request_append_path(&hrb, az_keyvault_client_constant_for_keys()));
+  AZ_RETURN_IF_FAILED(az_http_request_init_prepared(
+      &hrb,
+      context,
+      &client->_internal.key_get,
+      AZ_SPAN_FROM_BUFFER(url_buffer),
+      AZ_SPAN_FROM_BUFFER(headers_buffer),
+      AZ_SPAN_NULL));
 
   // Add path to request after adding query parameter
   AZ_RETURN_IF_FAILED(az_http_request_append_path(&hrb, key_name));
@@ -323,30 +373,354 @@ AZ_NODISCARD az_result az_keyvault_keys_key_delete(
     az_span key_name,
     az_http_response* response)
 {
-
-  // Url buffer
   uint8_t url_buffer[AZ_HTTP_REQUEST_URL_BUF_SIZE];
-  az_span request_url_span = AZ_SPAN_FROM_BUFFER(url_buffer);
-  // copy url from client
-  AZ_RETURN_IF_FAILED(az_span_copy(request_url_span, client->_internal.uri, &request_url_span));
   uint8_t headers_buffer[_az_KEYVAULT_HTTP_REQUEST_HEADER_BUF_SIZE];
-  az_span request_headers_span = AZ_SPAN_FROM_BUFFER(headers_buffer);
 
-  // create request
-  // TODO: define max URL size
+  // create request from {uri}/keys?api-version={version}
   _az_http_request hrb;
-  AZ_RETURN_IF_FAILED(az_http_request_init(
+  AZ_RETURN_IF_FAILED(az_http_request_init_prepared(
       &hrb,
       context,
-      az_http_method_delete(),
-      request_url_span,
-      request_headers_span,
+      &client->_internal.key_delete,
+      AZ_SPAN_FROM_BUFFER(url_buffer),
+      AZ_SPAN_FROM_BUFFER(headers_buffer),
       AZ_SPAN_NULL));
 
   // Add path to request
-  AZ_RETURN_IF_FAILED(az_http_request_append_path(&hrb, az_keyvault_client_constant_for_keys()));
   AZ_RETURN_IF_FAILED(az_http_request_append_path(&hrb, key_name));
 
   // start pipeline
   return az_http_pipeline_process(&client->_internal.pipeline, &hrb, response);
 }
+
+// Sends the request for one key: the body is only used to create keys.
+typedef AZ_NODISCARD az_result (*_az_keyvault_keys_each_send_fn)(
+    az_keyvault_keys_client* client,
+    az_context* context,
+    az_span key_name,
+    az_span created_body,
+    az_http_response* response);
+
+static AZ_NODISCARD az_result _az_keyvault_keys_each_get_send(
+    az_keyvault_keys_client* client,
+    az_context* context,
+    az_span key_name,
+    az_span created_body,
+    az_http_response* response)
+{
+  (void)created_body;
+  return az_keyvault_keys_key_get(client, context, key_name, AZ_SPAN_NULL, response);
+}
+
+static AZ_NODISCARD az_result _az_keyvault_keys_each_delete_send(
+    az_keyvault_keys_client* client,
+    az_context* context,
+    az_span key_name,
+    az_span created_body,
+    az_http_response* response)
+{
+  (void)created_body;
+  return az_keyvault_keys_key_delete(client, context, key_name, response);
+}
+
+// The state of an _each call, shared by the threads sending its requests.
+typedef struct
+{
+  az_context* context;
+  _az_keyvault_keys_each_send_fn send;
+  az_span const* key_names;
+  int32_t key_names_length;
+  az_span created_body;
+  az_keyvault_keys_key_response_fn on_response;
+  void* user_context;
+  az_keyvault_keys_key_result* out_results;
+  az_platform_mtx mtx; // Guards next and result, when there are threads.
+  bool locked;
+  int32_t next; // Index of the next key to send.
+  az_result result;
+} _az_keyvault_keys_each;
+
+// Sends requests with a client and its response buffer, in its own thread.
+typedef struct
+{
+  _az_keyvault_keys_each* each;
+  az_keyvault_keys_client* client;
+  az_http_response* response;
+  az_platform_thread thread;
+} _az_keyvault_keys_each_worker;
+
+// Marks every key as not sent, before anything can fail.
+static void _az_keyvault_keys_each_results_init(
+    int32_t key_names_length,
+    az_keyvault_keys_key_result* out_results)
+{
+  for (int32_t i = 0; i < key_names_length; ++i)
+  {
+    out_results[i] = (az_keyvault_keys_key_result){
+      .result = AZ_ERROR_CANCELED,
+      .status_code = AZ_HTTP_STATUS_CODE_NONE,
+    };
+  }
+}
+
+static void _az_keyvault_keys_each_lock(_az_keyvault_keys_each* each)
+{
+  if (each->locked)
+  {
+    az_result const result = az_platform_mtx_lock(&each->mtx);
+    (void)result;
+  }
+}
+
+static void _az_keyvault_keys_each_unlock(_az_keyvault_keys_each* each)
+{
+  if (each->locked)
+  {
+    az_result const result = az_platform_mtx_unlock(&each->mtx);
+    (void)result;
+  }
+}
+
+// Keeps the first error, which stops the keys left.
+static void _az_keyvault_keys_each_stop(_az_keyvault_keys_each* each, az_result result)
+{
+  _az_keyvault_keys_each_lock(each);
+  if (az_succeeded(each->result))
+  {
+    each->result = result;
+  }
+  _az_keyvault_keys_each_unlock(each);
+}
+
+// Gets the index of the next key to send, or -1 once all are sent or the call is stopped.
+static AZ_NODISCARD int32_t _az_keyvault_keys_each_next(_az_keyvault_keys_each* each)
+{
+  int32_t index = -1;
+  _az_keyvault_keys_each_lock(each);
+
+  // Once canceled, or stopped by the application, the keys left are not sent.
+  if (az_succeeded(each->result) && az_context_get_expiration(each->context) == 0)
+  {
+    each->result = AZ_ERROR_CANCELED;
+  }
+  if (az_succeeded(each->result) && each->next < each->key_names_length)
+  {
+    index = each->next++;
+  }
+
+  _az_keyvault_keys_each_unlock(each);
+  return index;
+}
+
+static void _az_keyvault_keys_each_work(void* arg)
+{
+  _az_keyvault_keys_each_worker* const worker = (_az_keyvault_keys_each_worker*)arg;
+  _az_keyvault_keys_each* const each = worker->each;
+  az_http_response* const response = worker->response;
+
+  // Every response is written from the start of the buffer of the worker.
+  az_span const response_buffer = response->_internal.http_response;
+
+  for (int32_t i = _az_keyvault_keys_each_next(each); i != -1;
+       i = _az_keyvault_keys_each_next(each))
+  {
+    az_result send_result = az_http_response_init(
+        response,
+        az_span_init(az_span_ptr(response_buffer), 0, az_span_capacity(response_buffer)));
+    if (az_succeeded(send_result))
+    {
+      send_result = each->send(
+          worker->client, each->context, each->key_names[i], each->created_body, response);
+    }
+
+    // Each key has its own result: they are written without the lock.
+    each->out_results[i].result = send_result;
+    if (az_failed(send_result))
+    {
+      continue;
+    }
+
+    az_http_response_status_line status_line = { 0 };
+    if (az_succeeded(az_http_response_get_status_line(response, &status_line)))
+    {
+      each->out_results[i].status_code = status_line.status_code;
+    }
+
+    if (each->on_response != NULL)
+    {
+      az_result const on_response_result = each->on_response(each->user_context, i, response);
+      if (az_failed(on_response_result))
+      {
+        _az_keyvault_keys_each_stop(each, on_response_result);
+      }
+    }
+  }
+}
+
+static AZ_NODISCARD az_result _az_keyvault_keys_each_process(
+    az_keyvault_keys_client* clients,
+    int32_t clients_length,
+    az_context* context,
+    _az_keyvault_keys_each_send_fn send,
+    az_span const* key_names,
+    int32_t key_names_length,
+    az_span created_body,
+    az_http_response* responses,
+    az_keyvault_keys_key_response_fn on_response,
+    void* user_context,
+    az_keyvault_keys_key_result* out_results)
+{
+  AZ_PRECONDITION_NOT_NULL(clients);
+  AZ_PRECONDITION_RANGE(1, clients_length, AZ_KEYVAULT_KEYS_EACH_CLIENTS_MAX);
+  AZ_PRECONDITION_NOT_NULL(context);
+  AZ_PRECONDITION_NOT_NULL(key_names);
+  AZ_PRECONDITION(key_names_length >= 0);
+  AZ_PRECONDITION_NOT_NULL(responses);
+  AZ_PRECONDITION_NOT_NULL(out_results);
+
+  _az_keyvault_keys_each_results_init(key_names_length, out_results);
+
+  _az_keyvault_keys_each each = {
+    .context = context,
+    .send = send,
+    .key_names = key_names,
+    .key_names_length = key_names_length,
+    .created_body = created_body,
+    .on_response = on_response,
+    .user_context = user_context,
+    .out_results = out_results,
+    .locked = false,
+    .next = 0,
+    .result = AZ_OK,
+  };
+
+  // Without threads, the calling thread sends all the requests with the first client.
+  az_result const mtx_result = az_platform_mtx_init(&each.mtx);
+  if (mtx_result != AZ_ERROR_NOT_IMPLEMENTED)
+  {
+    AZ_RETURN_IF_FAILED(mtx_result);
+    each.locked = true;
+  }
+
+  _az_keyvault_keys_each_worker workers[AZ_KEYVAULT_KEYS_EACH_CLIENTS_MAX];
+  int32_t workers_length = 0;
+  for (int32_t i = 0; i < clients_length && (i == 0 || each.locked); ++i)
+  {
+    workers[workers_length] = (_az_keyvault_keys_each_worker){
+      .each = &each,
+      .client = &clients[i],
+      .response = &responses[i],
+    };
+
+    // The calling thread is the first worker. A thread that can't start leaves its client unused.
+    if (i == 0
+        || az_succeeded(az_platform_thread_create(
+            &workers[workers_length].thread,
+            _az_keyvault_keys_each_work,
+            &workers[workers_length])))
+    {
+      ++workers_length;
+    }
+  }
+
+  _az_keyvault_keys_each_work(&workers[0]);
+  for (int32_t i = 1; i < workers_length; ++i)
+  {
+    az_result const join_result = az_platform_thread_join(&workers[i].thread);
+    (void)join_result;
+  }
+
+  if (each.locked)
+  {
+    az_platform_mtx_destroy(&each.mtx);
+  }
+
+  return each.result;
+}
+
+AZ_NODISCARD az_result az_keyvault_keys_key_create_each(
+    az_keyvault_keys_client* clients,
+    int32_t clients_length,
+    az_context* context,
+    az_span const* key_names,
+    int32_t key_names_length,
+    json_web_key_type json_web_key_type,
+    az_keyvault_create_key_options* options,
+    az_http_response* responses,
+    az_keyvault_keys_key_response_fn on_response,
+    void* user_context,
+    az_keyvault_keys_key_result* out_results)
+{
+  AZ_PRECONDITION(key_names_length >= 0);
+  AZ_PRECONDITION_NOT_NULL(out_results);
+  _az_keyvault_keys_each_results_init(key_names_length, out_results);
+
+  // The body is the same for all the keys, so it is built once.
+  uint8_t body_buffer[AZ_HTTP_REQUEST_BODY_BUF_SIZE];
+  az_span json_builder = AZ_SPAN_FROM_BUFFER(body_buffer);
+  AZ_RETURN_IF_FAILED(
+      _az_keyvault_keys_key_create_build_json_body(json_web_key_type, options, &json_builder));
+
+  return _az_keyvault_keys_each_process(
+      clients,
+      clients_length,
+      context,
+      _az_keyvault_keys_key_create_send,
+      key_names,
+      key_names_length,
+      json_builder,
+      responses,
+      on_response,
+      user_context,
+      out_results);
+}
+
+AZ_NODISCARD az_result az_keyvault_keys_key_get_each(
+    az_keyvault_keys_client* clients,
+    int32_t clients_length,
+    az_context* context,
+    az_span const* key_names,
+    int32_t key_names_length,
+    az_http_response* responses,
+    az_keyvault_keys_key_response_fn on_response,
+    void* user_context,
+    az_keyvault_keys_key_result* out_results)
+{
+  return _az_keyvault_keys_each_process(
+      clients,
+      clients_length,
+      context,
+      _az_keyvault_keys_each_get_send,
+      key_names,
+      key_names_length,
+      AZ_SPAN_NULL,
+      responses,
+      on_response,
+      user_context,
+      out_results);
+}
+
+AZ_NODISCARD az_result az_keyvault_keys_key_delete_each(
+    az_keyvault_keys_client* clients,
+    int32_t clients_length,
+    az_context* context,
+    az_span const* key_names,
+    int32_t key_names_length,
+    az_http_response* responses,
+    az_keyvault_keys_key_response_fn on_response,
+    void* user_context,
+    az_keyvault_keys_key_result* out_results)
+{
+  return _az_keyvault_keys_each_process(
+      clients,
+      clients_length,
+      context,
+      _az_keyvault_keys_each_delete_send,
+      key_names,
+      key_names_length,
+      AZ_SPAN_NULL,
+      responses,
+      on_response,
+      user_context,
+      out_results);
+}
@@ -0,0 +1,624 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <az_config_internal.h>
+#include <az_http.h>
+#include <az_json.h>
+#include <az_keyvault.h>
+#include <az_platform_internal.h>
+#include <az_precondition.h>
+#include <az_precondition_internal.h>
+#include <az_span.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <_az_cfg.h>
+
+enum
+{
+  _az_KEYVAULT_KEY_FIELDS_LENGTH = 7,
+  _az_KEYVAULT_KEY_CACHE_REFRESH_ATTEMPTS = 4, // Requests sent, at most, in the refresh time.
+  _az_KEYVAULT_KEY_CACHE_STRIPES = 8,
+};
+
+// The fields of an az_keyvault_key, in the order they are stored in a cache entry.
+AZ_INLINE void _az_keyvault_key_get_fields(
+    az_keyvault_key* key,
+    az_span* fields[_az_KEYVAULT_KEY_FIELDS_LENGTH])
+{
+  fields[0] = &key->kid;
+  fields[1] = &key->kty;
+  fields[2] = &key->n;
+  fields[3] = &key->e;
+  fields[4] = &key->crv;
+  fields[5] = &key->x;
+  fields[6] = &key->y;
+}
+
+static az_span const _az_KEYVAULT_KEY_FIELD_NAMES[_az_KEYVAULT_KEY_FIELDS_LENGTH] = {
+  AZ_SPAN_LITERAL_FROM_STR("kid"), AZ_SPAN_LITERAL_FROM_STR("kty"),
+  AZ_SPAN_LITERAL_FROM_STR("n"),   AZ_SPAN_LITERAL_FROM_STR("e"),
+  AZ_SPAN_LITERAL_FROM_STR("crv"), AZ_SPAN_LITERAL_FROM_STR("x"),
+  AZ_SPAN_LITERAL_FROM_STR("y"),
+};
+
+AZ_NODISCARD az_result az_keyvault_key_parse(az_span json, az_keyvault_key* out_key)
+{
+  AZ_PRECONDITION_VALID_SPAN(json, 0, false);
+  AZ_PRECONDITION_NOT_NULL(out_key);
+
+  *out_key = (az_keyvault_key){ 0 };
+  az_span* fields[_az_KEYVAULT_KEY_FIELDS_LENGTH];
+  _az_keyvault_key_get_fields(out_key, fields);
+
+  az_json_parser parser = { 0 };
+  AZ_RETURN_IF_FAILED(az_json_parser_init(&parser, json));
+
+  az_json_token token = { 0 };
+  AZ_RETURN_IF_FAILED(az_json_parser_parse_token(&parser, &token));
+  if (token.kind != AZ_JSON_TOKEN_OBJECT)
+  {
+    return AZ_ERROR_ITEM_NOT_FOUND;
+  }
+
+  // Only the members of the bundle up to its key are read.
+  while (true)
+  {
+    az_json_token_member member = { 0 };
+    AZ_RETURN_IF_FAILED(az_json_parser_parse_token_member(&parser, &member));
+    if (az_span_is_content_equal(member.name, AZ_SPAN_FROM_STR("key"))
+        && member.token.kind == AZ_JSON_TOKEN_OBJECT)
+    {
+      break;
+    }
+    AZ_RETURN_IF_FAILED(az_json_parser_skip_children(&parser, member.token));
+  }
+
+  while (true)
+  {
+    az_json_token_member member = { 0 };
+    az_result const result = az_json_parser_parse_token_member(&parser, &member);
+    if (result == AZ_ERROR_ITEM_NOT_FOUND)
+    {
+      return AZ_OK;
+    }
+    AZ_RETURN_IF_FAILED(result);
+
+    if (member.token.kind == AZ_JSON_TOKEN_STRING)
+    {
+      for (int32_t i = 0; i < _az_KEYVAULT_KEY_FIELDS_LENGTH; ++i)
+      {
+        if (az_span_is_content_equal(member.name, _az_KEYVAULT_KEY_FIELD_NAMES[i]))
+        {
+          *fields[i] = member.token.value.string;
+          break;
+        }
+      }
+    }
+    AZ_RETURN_IF_FAILED(az_json_parser_skip_children(&parser, member.token));
+  }
+}
+
+/******************************  LOCKS */
+
+// Each cache is locked by one of these mutexes, picked from its address, so that caches don't
+// need to hold platform types. The condition of the stripe is signaled when a fetch ends.
+static az_platform_mtx _az_keyvault_key_cache_mtx[_az_KEYVAULT_KEY_CACHE_STRIPES];
+static az_platform_cond _az_keyvault_key_cache_cond[_az_KEYVAULT_KEY_CACHE_STRIPES];
+static az_platform_once _az_keyvault_key_cache_mtx_once = AZ_PLATFORM_ONCE_INIT;
+static az_result _az_keyvault_key_cache_mtx_result = AZ_OK;
+
+static void _az_keyvault_key_cache_mtx_init(void)
+{
+  for (int32_t s = 0; s < _az_KEYVAULT_KEY_CACHE_STRIPES; ++s)
+  {
+    _az_keyvault_key_cache_mtx_result = az_platform_mtx_init(&_az_keyvault_key_cache_mtx[s]);
+    if (az_succeeded(_az_keyvault_key_cache_mtx_result))
+    {
+      _az_keyvault_key_cache_mtx_result = az_platform_cond_init(&_az_keyvault_key_cache_cond[s]);
+    }
+
+    if (az_failed(_az_keyvault_key_cache_mtx_result))
+    {
+      return;
+    }
+  }
+}
+
+static int32_t _az_keyvault_key_cache_stripe(az_keyvault_key_cache const* cache)
+{
+  return (int32_t)(((uintptr_t)cache / sizeof(az_keyvault_key_cache))
+                   % _az_KEYVAULT_KEY_CACHE_STRIPES);
+}
+
+// Platforms without threads don't implement mutexes: the cache doesn't need to be locked there.
+static AZ_NODISCARD az_result _az_keyvault_key_cache_lock(az_keyvault_key_cache const* cache)
+{
+  return _az_keyvault_key_cache_mtx_result == AZ_ERROR_NOT_IMPLEMENTED
+      ? AZ_OK
+      : az_platform_mtx_lock(&_az_keyvault_key_cache_mtx[_az_keyvault_key_cache_stripe(cache)]);
+}
+
+static void _az_keyvault_key_cache_unlock(az_keyvault_key_cache const* cache)
+{
+  if (_az_keyvault_key_cache_mtx_result != AZ_ERROR_NOT_IMPLEMENTED)
+  {
+    az_result const result
+        = az_platform_mtx_unlock(&_az_keyvault_key_cache_mtx[_az_keyvault_key_cache_stripe(cache)]);
+    (void)result;
+  }
+}
+
+// Waits for a fetch to end. Returns whether it waited: without threads, no other fetch can end.
+static AZ_NODISCARD bool _az_keyvault_key_cache_wait(az_keyvault_key_cache const* cache)
+{
+  int32_t const stripe = _az_keyvault_key_cache_stripe(cache);
+  return _az_keyvault_key_cache_mtx_result != AZ_ERROR_NOT_IMPLEMENTED
+      && az_succeeded(az_platform_cond_wait(
+          &_az_keyvault_key_cache_cond[stripe], &_az_keyvault_key_cache_mtx[stripe]));
+}
+
+static void _az_keyvault_key_cache_notify(az_keyvault_key_cache const* cache)
+{
+  if (_az_keyvault_key_cache_mtx_result != AZ_ERROR_NOT_IMPLEMENTED)
+  {
+    az_result const result = az_platform_cond_broadcast(
+        &_az_keyvault_key_cache_cond[_az_keyvault_key_cache_stripe(cache)]);
+    (void)result;
+  }
+}
+
+/******************************  CACHE */
+
+AZ_NODISCARD az_keyvault_key_cache_options az_keyvault_key_cache_options_default()
+{
+  return (az_keyvault_key_cache_options){
+    .ttl_msec = 10 * _az_TIME_SECONDS_PER_MINUTE * _az_TIME_MILLISECONDS_PER_SECOND,
+    .refresh_msec = 1 * _az_TIME_SECONDS_PER_MINUTE * _az_TIME_MILLISECONDS_PER_SECOND,
+  };
+}
+
+AZ_NODISCARD az_result az_keyvault_key_cache_init(
+    az_keyvault_key_cache* cache,
+    az_keyvault_keys_client* client,
+    az_keyvault_key_cache_entry* entries,
+    int32_t entries_length,
+    az_span buffer,
+    az_keyvault_key_cache_options const* options)
+{
+  AZ_PRECONDITION_NOT_NULL(cache);
+  AZ_PRECONDITION_NOT_NULL(client);
+  AZ_PRECONDITION_NOT_NULL(entries);
+  AZ_PRECONDITION(entries_length > 0);
+  AZ_PRECONDITION_VALID_SPAN(buffer, 0, false);
+
+  az_keyvault_key_cache_options const default_options = az_keyvault_key_cache_options_default();
+  if (options == NULL)
+  {
+    options = &default_options;
+  }
+
+  if (options->refresh_msec < 0 || options->refresh_msec >= options->ttl_msec)
+  {
+    return AZ_ERROR_ARG;
+  }
+
+  AZ_RETURN_IF_FAILED(
+      az_platform_call_once(&_az_keyvault_key_cache_mtx_once, _az_keyvault_key_cache_mtx_init));
+  if (_az_keyvault_key_cache_mtx_result != AZ_ERROR_NOT_IMPLEMENTED)
+  {
+    AZ_RETURN_IF_FAILED(_az_keyvault_key_cache_mtx_result);
+  }
+
+  int32_t const slot_size = az_span_capacity(buffer) / entries_length;
+
+  *cache = (az_keyvault_key_cache){
+    ._internal = {
+      .client = client,
+      .entries = entries,
+      .entries_length = entries_length,
+      .slot_size = slot_size,
+      .options = *options,
+      .uses = 0,
+    },
+  };
+
+  for (int32_t i = 0; i < entries_length; ++i)
+  {
+    entries[i] = (az_keyvault_key_cache_entry){
+      ._internal = {
+        .slot = az_span_ptr(buffer) + i * slot_size,
+        .name_length = 0,
+        .key = { 0 },
+        .refresh_at_msec = 0,
+        .expires_at_msec = 0,
+        .last_use = 0,
+        .in_flight = false,
+        .fetches = 0,
+        .fetch_result = AZ_OK,
+      },
+    };
+  }
+
+  return AZ_OK;
+}
+
+static AZ_NODISCARD az_keyvault_key_cache_entry*
+_az_keyvault_key_cache_find(az_keyvault_key_cache const* cache, az_span key_name)
+{
+  for (int32_t i = 0; i < cache->_internal.entries_length; ++i)
+  {
+    az_keyvault_key_cache_entry* const entry = &cache->_internal.entries[i];
+    int32_t const name_length = entry->_internal.name_length;
+    if (name_length > 0
+        && az_span_is_content_equal(
+            az_span_init(entry->_internal.slot, name_length, name_length), key_name))
+    {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+// Gets an empty entry, or else the least recently used one that isn't being fetched. Returns NULL
+// when all the entries are being fetched.
+static AZ_NODISCARD az_keyvault_key_cache_entry*
+_az_keyvault_key_cache_take(az_keyvault_key_cache const* cache)
+{
+  az_keyvault_key_cache_entry* taken = NULL;
+  for (int32_t i = 0; i < cache->_internal.entries_length; ++i)
+  {
+    az_keyvault_key_cache_entry* const entry = &cache->_internal.entries[i];
+    if (entry->_internal.in_flight)
+    {
+      continue;
+    }
+
+    if (entry->_internal.name_length == 0)
+    {
+      return entry;
+    }
+
+    if (taken == NULL || entry->_internal.last_use < taken->_internal.last_use)
+    {
+      taken = entry;
+    }
+  }
+
+  return taken;
+}
+
+// Copies the name to the slot of an entry, without a key, so that gets of the same name find it
+// while it is fetched.
+static AZ_NODISCARD az_result _az_keyvault_key_cache_reserve(
+    az_keyvault_key_cache const* cache,
+    az_keyvault_key_cache_entry* entry,
+    az_span key_name)
+{
+  if (az_span_length(key_name) > cache->_internal.slot_size)
+  {
+    return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+  }
+
+  memcpy(entry->_internal.slot, az_span_ptr(key_name), (size_t)az_span_length(key_name));
+  entry->_internal.name_length = az_span_length(key_name);
+  entry->_internal.key = (az_keyvault_key){ 0 };
+  entry->_internal.refresh_at_msec = 0;
+  entry->_internal.expires_at_msec = 0;
+  return AZ_OK;
+}
+
+// Copies the key to the slot of an entry, after its name, if it fits.
+static AZ_NODISCARD az_result _az_keyvault_key_cache_store(
+    az_keyvault_key_cache const* cache,
+    az_keyvault_key_cache_entry* entry,
+    az_keyvault_key const* key)
+{
+  az_keyvault_key stored = *key;
+  az_span* fields[_az_KEYVAULT_KEY_FIELDS_LENGTH];
+  _az_keyvault_key_get_fields(&stored, fields);
+
+  int32_t size = entry->_internal.name_length;
+  for (int32_t i = 0; i < _az_KEYVAULT_KEY_FIELDS_LENGTH; ++i)
+  {
+    size += az_span_length(*fields[i]);
+  }
+
+  if (size > cache->_internal.slot_size)
+  {
+    return AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+  }
+
+  uint8_t* ptr = entry->_internal.slot + entry->_internal.name_length;
+  for (int32_t i = 0; i < _az_KEYVAULT_KEY_FIELDS_LENGTH; ++i)
+  {
+    int32_t const length = az_span_length(*fields[i]);
+    if (length > 0)
+    {
+      memcpy(ptr, az_span_ptr(*fields[i]), (size_t)length);
+      *fields[i] = az_span_init(ptr, length, length);
+      ptr += length;
+    }
+  }
+
+  entry->_internal.key = stored;
+  return AZ_OK;
+}
+
+// Copies the cached key to the buffer of the response, so that it stays valid while the cache is
+// changed by other threads.
+static AZ_NODISCARD az_result _az_keyvault_key_cache_copy(
+    az_keyvault_key_cache_entry const* entry,
+    az_http_response* response,
+    az_keyvault_key* out_key)
+{
+  *out_key = entry->_internal.key;
+  az_span* fields[_az_KEYVAULT_KEY_FIELDS_LENGTH];
+  _az_keyvault_key_get_fields(out_key, fields);
+
+  az_span remaining = response->_internal.http_response;
+  remaining = az_span_init(az_span_ptr(remaining), 0, az_span_capacity(remaining));
+  for (int32_t i = 0; i < _az_KEYVAULT_KEY_FIELDS_LENGTH; ++i)
+  {
+    int32_t const length = az_span_length(*fields[i]);
+    if (length > 0)
+    {
+      uint8_t* const ptr = az_span_ptr(remaining) + az_span_length(remaining);
+      AZ_RETURN_IF_FAILED(az_span_append(remaining, *fields[i], &remaining));
+      *fields[i] = az_span_init(ptr, length, length);
+    }
+  }
+
+  return AZ_OK;
+}
+
+static void _az_keyvault_key_cache_use(
+    az_keyvault_key_cache* cache,
+    az_keyvault_key_cache_entry* entry)
+{
+  entry->_internal.last_use = ++cache->_internal.uses;
+}
+
+static AZ_NODISCARD az_result _az_keyvault_key_cache_fetch(
+    az_keyvault_key_cache* cache,
+    az_context* context,
+    az_span key_name,
+    az_http_response* response,
+    az_keyvault_key* out_key)
+{
+  AZ_RETURN_IF_FAILED(az_keyvault_keys_key_get(
+      cache->_internal.client, context, key_name, AZ_SPAN_NULL, response));
+
+  az_http_response_status_line status_line = { 0 };
+  AZ_RETURN_IF_FAILED(az_http_response_get_status_line(response, &status_line));
+  if (status_line.status_code == AZ_HTTP_STATUS_CODE_NOT_FOUND)
+  {
+    return AZ_ERROR_ITEM_NOT_FOUND;
+  }
+
+  // E.g. 401, 429 once the retries are done, or 5xx.
+  if (status_line.status_code != AZ_HTTP_STATUS_CODE_OK)
+  {
+    return AZ_ERROR_HTTP_UNEXPECTED_STATUS_CODE;
+  }
+
+  az_span body = AZ_SPAN_NULL;
+  AZ_RETURN_IF_FAILED(az_http_response_get_body(response, &body));
+  return az_keyvault_key_parse(body, out_key);
+}
+
+// Ends the fetch of an entry, the cache being locked: stores the key got, and wakes up the gets
+// waiting for it.
+static void _az_keyvault_key_cache_end_fetch(
+    az_keyvault_key_cache* cache,
+    az_keyvault_key_cache_entry* entry,
+    int64_t now_msec,
+    az_result result,
+    az_keyvault_key const* key)
+{
+  az_keyvault_key_cache_options const* const options = &cache->_internal.options;
+  if (az_succeeded(result)
+      && entry->_internal.name_length > 0
+      && az_succeeded(_az_keyvault_key_cache_store(cache, entry, key)))
+  {
+    entry->_internal.refresh_at_msec = now_msec + options->ttl_msec - options->refresh_msec;
+    entry->_internal.expires_at_msec = now_msec + options->ttl_msec;
+  }
+  else if (now_msec < entry->_internal.expires_at_msec)
+  {
+    // The cached key is still valid: it is refreshed again later, so that a failing service
+    // doesn't get a request for every refresh.
+    int64_t const refresh_at_msec
+        = now_msec + options->refresh_msec / _az_KEYVAULT_KEY_CACHE_REFRESH_ATTEMPTS;
+    entry->_internal.refresh_at_msec = refresh_at_msec < entry->_internal.expires_at_msec
+        ? refresh_at_msec
+        : entry->_internal.expires_at_msec;
+  }
+  else
+  {
+    // A key too big for the cache, or that couldn't be got, is not kept.
+    entry->_internal.name_length = 0;
+  }
+
+  entry->_internal.in_flight = false;
+  entry->_internal.fetch_result = result;
+  ++entry->_internal.fetches;
+  _az_keyvault_key_cache_notify(cache);
+}
+
+AZ_NODISCARD az_result az_keyvault_key_cache_get(
+    az_keyvault_key_cache* cache,
+    az_context* context,
+    az_span key_name,
+    int64_t now_msec,
+    az_http_response* response,
+    az_keyvault_key* out_key)
+{
+  AZ_PRECONDITION_NOT_NULL(cache);
+  AZ_PRECONDITION_VALID_SPAN(key_name, 1, false);
+  AZ_PRECONDITION_NOT_NULL(response);
+  AZ_PRECONDITION_NOT_NULL(out_key);
+
+  AZ_RETURN_IF_FAILED(_az_keyvault_key_cache_lock(cache));
+
+  az_keyvault_key_cache_entry* entry = NULL;
+  az_keyvault_key_cache_entry* waited = NULL;
+  uint32_t waited_fetches = 0;
+  bool cached = true;
+  while (true)
+  {
+    // The gets waiting for the same fetch get its error, instead of sending a request each.
+    if (waited != NULL && waited->_internal.fetches != waited_fetches
+        && az_failed(waited->_internal.fetch_result))
+    {
+      az_result const result = waited->_internal.fetch_result;
+      _az_keyvault_key_cache_unlock(cache);
+      return result;
+    }
+
+    entry = _az_keyvault_key_cache_find(cache, key_name);
+
+    // A cached key is served even while it is refreshed.
+    if (entry != NULL && now_msec < entry->_internal.expires_at_msec)
+    {
+      _az_keyvault_key_cache_use(cache, entry);
+      az_result const result = _az_keyvault_key_cache_copy(entry, response, out_key);
+      _az_keyvault_key_cache_unlock(cache);
+      return result;
+    }
+
+    if (entry == NULL || !entry->_internal.in_flight)
+    {
+      break;
+    }
+
+    if (waited != entry)
+    {
+      waited = entry;
+      waited_fetches = entry->_internal.fetches;
+    }
+
+    if (!_az_keyvault_key_cache_wait(cache))
+    {
+      // The key is got without the cache.
+      entry = NULL;
+      cached = false;
+      break;
+    }
+  }
+
+  if (entry == NULL && cached)
+  {
+    entry = _az_keyvault_key_cache_take(cache);
+    if (entry != NULL && az_failed(_az_keyvault_key_cache_reserve(cache, entry, key_name)))
+    {
+      entry->_internal.name_length = 0;
+      entry = NULL;
+    }
+  }
+
+  if (entry != NULL)
+  {
+    _az_keyvault_key_cache_use(cache, entry);
+    entry->_internal.in_flight = true;
+  }
+  _az_keyvault_key_cache_unlock(cache);
+
+  // The key returned points into the response.
+  az_result const result
+      = _az_keyvault_key_cache_fetch(cache, context, key_name, response, out_key);
+
+  if (entry != NULL)
+  {
+    az_result const locked = _az_keyvault_key_cache_lock(cache);
+    (void)locked;
+    _az_keyvault_key_cache_end_fetch(cache, entry, now_msec, result, out_key);
+    _az_keyvault_key_cache_unlock(cache);
+  }
+
+  return result;
+}
+
+AZ_NODISCARD az_result az_keyvault_key_cache_refresh(
+    az_keyvault_key_cache* cache,
+    az_context* context,
+    int64_t now_msec,
+    az_http_response* response)
+{
+  AZ_PRECONDITION_NOT_NULL(cache);
+  AZ_PRECONDITION_NOT_NULL(response);
+
+  az_span const response_buffer = response->_internal.http_response;
+  az_result refresh_result = AZ_OK;
+
+  AZ_RETURN_IF_FAILED(_az_keyvault_key_cache_lock(cache));
+  for (int32_t i = 0; i < cache->_internal.entries_length; ++i)
+  {
+    az_keyvault_key_cache_entry* const entry = &cache->_internal.entries[i];
+    if (entry->_internal.name_length == 0 || entry->_internal.in_flight
+        || now_msec < entry->_internal.refresh_at_msec)
+    {
+      continue;
+    }
+
+    // The name is copied, as the entry may be removed while the cache is unlocked.
+    uint8_t* const name_ptr = az_span_ptr(response_buffer);
+    int32_t const name_length = entry->_internal.name_length;
+    if (name_length > az_span_capacity(response_buffer))
+    {
+      refresh_result = AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY;
+      continue;
+    }
+    memcpy(name_ptr, entry->_internal.slot, (size_t)name_length);
+    entry->_internal.in_flight = true;
+    _az_keyvault_key_cache_unlock(cache);
+
+    // The request is written after the name, in the rest of the buffer.
+    az_keyvault_key key = { 0 };
+    az_result result = az_http_response_init(
+        response,
+        az_span_init(
+            name_ptr + name_length, 0, az_span_capacity(response_buffer) - name_length));
+    if (az_succeeded(result))
+    {
+      result = _az_keyvault_key_cache_fetch(
+          cache, context, az_span_init(name_ptr, name_length, name_length), response, &key);
+    }
+
+    az_result const locked = _az_keyvault_key_cache_lock(cache);
+    (void)locked;
+    _az_keyvault_key_cache_end_fetch(cache, entry, now_msec, result, &key);
+    if (az_failed(result))
+    {
+      refresh_result = result;
+    }
+  }
+  _az_keyvault_key_cache_unlock(cache);
+
+  az_result const reset = az_http_response_init(
+      response, az_span_init(az_span_ptr(response_buffer), 0, az_span_capacity(response_buffer)));
+  (void)reset;
+  return refresh_result;
+}
+
+void az_keyvault_key_cache_remove(az_keyvault_key_cache* cache, az_span key_name)
+{
+  AZ_PRECONDITION_NOT_NULL(cache);
+
+  az_result const locked = _az_keyvault_key_cache_lock(cache);
+  (void)locked;
+
+  az_keyvault_key_cache_entry* const entry = _az_keyvault_key_cache_find(cache, key_name);
+  if (entry != NULL)
+  {
+    // An entry being fetched is not taken before the fetch ends, which then doesn't store its key.
+    entry->_internal.name_length = 0;
+    entry->_internal.refresh_at_msec = 0;
+    entry->_internal.expires_at_msec = 0;
+  }
+
+  _az_keyvault_key_cache_unlock(cache);
+}
@@ -0,0 +1,165 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "keyvault_test_server.h"
+
+#include <az_context.h>
+#include <az_http.h>
+#include <az_http_transport.h>
+#include <az_keyvault.h>
+#include <az_span.h>
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include <_az_cfg.h>
+
+// Stops at the index given as user context.
+static az_result
+test_each_on_response(void* user_context, int32_t index, az_http_response* response)
+{
+  (void)response;
+  int32_t* const stop_index = (int32_t*)user_context;
+  return index == *stop_index ? AZ_ERROR_ARG : AZ_OK;
+}
+
+void test_keyvault_each(void** state)
+{
+  (void)state;
+
+  keyvault_test_server server = {
+    .requests = 0,
+    .response = AZ_SPAN_FROM_STR("HTTP/1.1 200 OK\r\n\r\n{}"),
+  };
+  az_credential_client_secret credential;
+  az_keyvault_keys_client client;
+  keyvault_test_client_init(&server, &credential, &client);
+
+  az_span const key_names[] = {
+    AZ_SPAN_LITERAL_FROM_STR("a"),
+    AZ_SPAN_LITERAL_FROM_STR("missing"),
+    AZ_SPAN_LITERAL_FROM_STR("b"),
+  };
+  az_keyvault_keys_key_result results[3];
+  uint8_t response_buffer[256];
+  az_http_response response;
+  assert_true(az_http_response_init(&response, AZ_SPAN_FROM_BUFFER(response_buffer)) == AZ_OK);
+
+  // A key that is not found doesn't stop the others, and results are in order.
+  assert_true(
+      az_keyvault_keys_key_get_each(
+          &client, 1, &az_context_app, key_names, 3, &response, NULL, NULL, results)
+      == AZ_OK);
+  assert_true(server.requests == 3);
+  assert_true(az_span_is_content_equal(server.method, az_http_method_get()));
+  assert_true(results[0].result == AZ_OK && results[0].status_code == AZ_HTTP_STATUS_CODE_OK);
+  assert_true(
+      results[1].result == AZ_OK && results[1].status_code == AZ_HTTP_STATUS_CODE_NOT_FOUND);
+  assert_true(results[2].result == AZ_OK && results[2].status_code == AZ_HTTP_STATUS_CODE_OK);
+
+  // Keys are created with the same body.
+  assert_true(
+      az_keyvault_keys_key_create_each(
+          &client,
+          1,
+          &az_context_app,
+          key_names,
+          3,
+          az_keyvault_web_key_type_rsa(),
+          NULL,
+          &response,
+          NULL,
+          NULL,
+          results)
+      == AZ_OK);
+  assert_true(server.requests == 6);
+  assert_true(az_span_is_content_equal(server.method, az_http_method_post()));
+  assert_true(az_span_is_content_equal(server.body, AZ_SPAN_FROM_STR("{\"kty\":\"RSA\"}")));
+
+  // Keys are not sent when the body doesn't fit in its buffer, and their results say so.
+  uint8_t tag_value[AZ_HTTP_REQUEST_BODY_BUF_SIZE];
+  memset(tag_value, 'a', sizeof(tag_value));
+  az_pair tags[] = {
+    az_pair_init(AZ_SPAN_FROM_STR("tag"), AZ_SPAN_FROM_INITIALIZED_BUFFER(tag_value)),
+    az_pair_init(AZ_SPAN_NULL, AZ_SPAN_NULL),
+  };
+  az_keyvault_create_key_options create_options = az_keyvault_create_key_options_default();
+  create_options.tags = tags;
+  assert_true(
+      az_keyvault_keys_key_create_each(
+          &client,
+          1,
+          &az_context_app,
+          key_names,
+          3,
+          az_keyvault_web_key_type_rsa(),
+          &create_options,
+          &response,
+          NULL,
+          NULL,
+          results)
+      == AZ_ERROR_INSUFFICIENT_SPAN_CAPACITY);
+  assert_true(server.requests == 6);
+  for (int32_t i = 0; i < 3; ++i)
+  {
+    assert_true(results[i].result == AZ_ERROR_CANCELED);
+    assert_true(results[i].status_code == AZ_HTTP_STATUS_CODE_NONE);
+  }
+
+  // An error of the application stops the keys left.
+  int32_t stop_index = 0;
+  assert_true(
+      az_keyvault_keys_key_delete_each(
+          &client,
+          1,
+          &az_context_app,
+          key_names,
+          3,
+          &response,
+          test_each_on_response,
+          &stop_index,
+          results)
+      == AZ_ERROR_ARG);
+  assert_true(server.requests == 7);
+  assert_true(az_span_is_content_equal(server.method, az_http_method_delete()));
+  assert_true(results[0].result == AZ_OK && results[0].status_code == AZ_HTTP_STATUS_CODE_OK);
+  assert_true(results[1].result == AZ_ERROR_CANCELED);
+  assert_true(results[2].result == AZ_ERROR_CANCELED);
+
+  // A canceled context stops it too.
+  az_context context = az_context_with_expiration(&az_context_app, 100);
+  az_context_cancel(&context);
+  assert_true(
+      az_keyvault_keys_key_get_each(
+          &client, 1, &context, key_names, 3, &response, NULL, NULL, results)
+      == AZ_ERROR_CANCELED);
+  assert_true(server.requests == 7);
+  assert_true(results[0].result == AZ_ERROR_CANCELED);
+
+  // With several clients, each key is sent once by one of them, and results are still in order.
+  keyvault_test_server servers[2] = { server, server };
+  az_credential_client_secret credentials[2];
+  az_keyvault_keys_client clients[2];
+  uint8_t response_buffers[2][256];
+  az_http_response responses[2];
+  for (int32_t i = 0; i < 2; ++i)
+  {
+    servers[i].requests = 0;
+    keyvault_test_client_init(&servers[i], &credentials[i], &clients[i]);
+    assert_true(
+        az_http_response_init(&responses[i], AZ_SPAN_FROM_BUFFER(response_buffers[i])) == AZ_OK);
+  }
+  assert_true(
+      az_keyvault_keys_key_get_each(
+          clients, 2, &az_context_app, key_names, 3, responses, NULL, NULL, results)
+      == AZ_OK);
+  assert_true(servers[0].requests + servers[1].requests == 3);
+  assert_true(results[0].result == AZ_OK && results[0].status_code == AZ_HTTP_STATUS_CODE_OK);
+  assert_true(
+      results[1].result == AZ_OK && results[1].status_code == AZ_HTTP_STATUS_CODE_NOT_FOUND);
+  assert_true(results[2].result == AZ_OK && results[2].status_code == AZ_HTTP_STATUS_CODE_OK);
+}
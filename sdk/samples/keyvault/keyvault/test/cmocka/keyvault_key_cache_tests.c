@@ -0,0 +1,163 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "keyvault_test_server.h"
+
+#include <az_http.h>
+#include <az_keyvault.h>
+#include <az_span.h>
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+#include <cmocka.h>
+
+#include <_az_cfg.h>
+
+static void test_key_cache_get(
+    az_keyvault_key_cache* cache,
+    az_span key_name,
+    int64_t now_msec,
+    az_span expected_kid)
+{
+  uint8_t response_buffer[512];
+  az_http_response response;
+  assert_true(az_http_response_init(&response, AZ_SPAN_FROM_BUFFER(response_buffer)) == AZ_OK);
+
+  az_keyvault_key key = { 0 };
+  assert_true(
+      az_keyvault_key_cache_get(cache, &az_context_app, key_name, now_msec, &response, &key)
+      == AZ_OK);
+  assert_true(az_span_is_content_equal(key.kid, expected_kid));
+  assert_true(az_span_is_content_equal(key.kty, az_keyvault_web_key_type_rsa()));
+  assert_true(az_span_is_content_equal(key.e, AZ_SPAN_FROM_STR("AQAB")));
+
+  // The key points into the response, even when it comes from the cache.
+  assert_true(az_span_ptr(key.kid) >= response_buffer);
+  assert_true(az_span_ptr(key.kid) < response_buffer + sizeof(response_buffer));
+}
+
+static az_result test_key_cache_refresh(az_keyvault_key_cache* cache, int64_t now_msec)
+{
+  uint8_t response_buffer[512];
+  az_http_response response;
+  assert_true(az_http_response_init(&response, AZ_SPAN_FROM_BUFFER(response_buffer)) == AZ_OK);
+  return az_keyvault_key_cache_refresh(cache, &az_context_app, now_msec, &response);
+}
+
+void test_keyvault_key_parse(void** state)
+{
+  (void)state;
+
+  az_keyvault_key key = { 0 };
+  assert_true(
+      az_keyvault_key_parse(
+          AZ_SPAN_FROM_STR("{\"key\":{\"kid\":\"https://vault/keys/k/1\",\"kty\":\"EC\","
+                           "\"key_ops\":[\"sign\",\"verify\"],\"crv\":\"P-256\",\"x\":\"eA\","
+                           "\"y\":\"eQ\"},\"attributes\":{\"enabled\":true}}"),
+          &key)
+      == AZ_OK);
+  assert_true(az_span_is_content_equal(key.kid, AZ_SPAN_FROM_STR("https://vault/keys/k/1")));
+  assert_true(az_span_is_content_equal(key.kty, az_keyvault_web_key_type_ec()));
+  assert_true(az_span_is_content_equal(key.crv, AZ_SPAN_FROM_STR("P-256")));
+  assert_true(az_span_is_content_equal(key.x, AZ_SPAN_FROM_STR("eA")));
+  assert_true(az_span_is_content_equal(key.y, AZ_SPAN_FROM_STR("eQ")));
+  assert_true(az_span_length(key.n) == 0);
+  assert_true(az_span_length(key.e) == 0);
+
+  assert_true(
+      az_keyvault_key_parse(AZ_SPAN_FROM_STR("{\"error\":{\"code\":\"KeyNotFound\"}}"), &key)
+      == AZ_ERROR_ITEM_NOT_FOUND);
+}
+
+void test_keyvault_key_cache(void** state)
+{
+  (void)state;
+
+  keyvault_test_server server = {
+    .requests = 0,
+    .response = AZ_SPAN_FROM_STR("HTTP/1.1 200 OK\r\n"
+                                 "\r\n"
+                                 "{\"key\":{\"kid\":\"https://vault/keys/k/1\",\"kty\":\"RSA\","
+                                 "\"n\":\"AQID\",\"e\":\"AQAB\"}}"),
+  };
+  az_credential_client_secret credential;
+  az_keyvault_keys_client client;
+  keyvault_test_client_init(&server, &credential, &client);
+
+  az_keyvault_key_cache_entry entries[2];
+  uint8_t buffer[2 * 64];
+  az_keyvault_key_cache_options const options = { .ttl_msec = 1000, .refresh_msec = 100 };
+  az_keyvault_key_cache cache;
+  assert_true(
+      az_keyvault_key_cache_init(
+          &cache, &client, entries, 2, AZ_SPAN_FROM_BUFFER(buffer), &options)
+      == AZ_OK);
+
+  az_span const v1 = AZ_SPAN_FROM_STR("https://vault/keys/k/1");
+  az_span const v2 = AZ_SPAN_FROM_STR("https://vault/keys/k/2");
+
+  // The key is got once, then served from the cache until it expires, without waiting for the
+  // refreshes.
+  test_key_cache_get(&cache, AZ_SPAN_FROM_STR("k"), 0, v1);
+  test_key_cache_get(&cache, AZ_SPAN_FROM_STR("k"), 950, v1);
+  assert_true(server.requests == 1);
+  assert_true(test_key_cache_refresh(&cache, 899) == AZ_OK);
+  assert_true(server.requests == 1);
+
+  // A failed refresh keeps the cached key until it expires, and is sent again a quarter of the
+  // refresh time later.
+  server.response = AZ_SPAN_FROM_STR("HTTP/1.1 500 Internal Server Error\r\n\r\n");
+  assert_true(test_key_cache_refresh(&cache, 900) == AZ_ERROR_HTTP_UNEXPECTED_STATUS_CODE);
+  assert_true(server.requests == 2);
+  test_key_cache_get(&cache, AZ_SPAN_FROM_STR("k"), 910, v1);
+  assert_true(test_key_cache_refresh(&cache, 924) == AZ_OK);
+  assert_true(server.requests == 2);
+  assert_true(test_key_cache_refresh(&cache, 925) == AZ_ERROR_HTTP_UNEXPECTED_STATUS_CODE);
+  assert_true(server.requests == 3);
+
+  // A successful refresh replaces it.
+  server.response = AZ_SPAN_FROM_STR("HTTP/1.1 200 OK\r\n"
+                                     "\r\n"
+                                     "{\"key\":{\"kid\":\"https://vault/keys/k/2\",\"kty\":\"RSA\","
+                                     "\"n\":\"AQID\",\"e\":\"AQAB\"}}");
+  assert_true(test_key_cache_refresh(&cache, 950) == AZ_OK);
+  assert_true(server.requests == 4);
+  test_key_cache_get(&cache, AZ_SPAN_FROM_STR("k"), 1800, v2);
+  assert_true(server.requests == 4);
+
+  // The least recently used key is replaced.
+  test_key_cache_get(&cache, AZ_SPAN_FROM_STR("a"), 1800, v2);
+  test_key_cache_get(&cache, AZ_SPAN_FROM_STR("k"), 1800, v2);
+  test_key_cache_get(&cache, AZ_SPAN_FROM_STR("b"), 1800, v2);
+  test_key_cache_get(&cache, AZ_SPAN_FROM_STR("k"), 1800, v2);
+  assert_true(server.requests == 6);
+  test_key_cache_get(&cache, AZ_SPAN_FROM_STR("a"), 1800, v2);
+  assert_true(server.requests == 7);
+
+  // A removed or expired key is got again, and errors are returned without a cached key.
+  az_keyvault_key_cache_remove(&cache, AZ_SPAN_FROM_STR("k"));
+  test_key_cache_get(&cache, AZ_SPAN_FROM_STR("k"), 1800, v2);
+  assert_true(server.requests == 8);
+
+  server.response = AZ_SPAN_FROM_STR("HTTP/1.1 500 Internal Server Error\r\n\r\n");
+  uint8_t response_buffer[512];
+  az_http_response response;
+  assert_true(az_http_response_init(&response, AZ_SPAN_FROM_BUFFER(response_buffer)) == AZ_OK);
+  az_keyvault_key key = { 0 };
+  assert_true(
+      az_keyvault_key_cache_get(
+          &cache, &az_context_app, AZ_SPAN_FROM_STR("k"), 2800, &response, &key)
+      == AZ_ERROR_HTTP_UNEXPECTED_STATUS_CODE);
+  assert_true(server.requests == 9);
+
+  // Only a key that doesn't exist is not found.
+  server.response = AZ_SPAN_FROM_STR("HTTP/1.1 404 Not Found\r\n\r\n");
+  assert_true(az_http_response_init(&response, AZ_SPAN_FROM_BUFFER(response_buffer)) == AZ_OK);
+  assert_true(
+      az_keyvault_key_cache_get(
+          &cache, &az_context_app, AZ_SPAN_FROM_STR("k"), 2800, &response, &key)
+      == AZ_ERROR_ITEM_NOT_FOUND);
+  assert_true(server.requests == 10);
+}
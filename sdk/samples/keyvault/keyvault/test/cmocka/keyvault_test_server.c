@@ -0,0 +1,73 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "keyvault_test_server.h"
+
+#include <az_http_transport.h>
+
+#include <setjmp.h>
+#include <stdarg.h>
+
+#include <cmocka.h>
+
+#include <_az_cfg.h>
+
+// Runs before the policies that send the requests, so they are never sent.
+static az_result keyvault_test_server_policy(
+    _az_http_policy* p_policies,
+    void* p_options,
+    _az_http_request* p_request,
+    az_http_response* p_response)
+{
+  (void)p_policies;
+  keyvault_test_server* const server = (keyvault_test_server*)p_options;
+  ++server->requests;
+
+  az_span url = AZ_SPAN_NULL;
+  az_span body = AZ_SPAN_NULL;
+  AZ_RETURN_IF_FAILED(az_http_request_get_parts(p_request, &server->method, &url, &body));
+  server->body = AZ_SPAN_FROM_BUFFER(server->body_buffer);
+  if (az_span_length(body) > 0)
+  {
+    AZ_RETURN_IF_FAILED(az_span_copy(server->body, body, &server->body));
+  }
+
+  az_span const response = az_span_find(url, AZ_SPAN_FROM_STR("/missing")) != -1
+      ? AZ_SPAN_FROM_STR("HTTP/1.1 404 Not Found\r\n\r\n")
+      : server->response;
+
+  az_span written = p_response->_internal.http_response;
+  AZ_RETURN_IF_FAILED(az_span_copy(written, response, &written));
+  return az_http_response_init(p_response, written);
+}
+
+void keyvault_test_client_init(
+    keyvault_test_server* server,
+    az_credential_client_secret* credential,
+    az_keyvault_keys_client* client)
+{
+  // The pipeline keeps a copy of the policies.
+  az_http_user_policy const policies[] = {
+    {
+        .process = keyvault_test_server_policy,
+        .options = server,
+        .position = AZ_HTTP_POLICY_POSITION_PER_CALL,
+    },
+  };
+  az_keyvault_keys_client_options client_options = az_keyvault_keys_client_options_default();
+  client_options.policies = policies;
+  client_options.policies_length = 1;
+
+  assert_true(
+      az_credential_client_secret_init(
+          credential,
+          AZ_SPAN_FROM_STR("tenant"),
+          AZ_SPAN_FROM_STR("client"),
+          AZ_SPAN_FROM_STR("secret"))
+      == AZ_OK);
+
+  assert_true(
+      az_keyvault_keys_client_init(
+          client, AZ_SPAN_FROM_STR("https://vault"), credential, &client_options)
+      == AZ_OK);
+}
@@ -0,0 +1,34 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#ifndef _az_KEYVAULT_TEST_SERVER_H
+#define _az_KEYVAULT_TEST_SERVER_H
+
+#include <az_credentials.h>
+#include <az_http.h>
+#include <az_keyvault.h>
+#include <az_span.h>
+
+#include <stdint.h>
+
+#include <_az_cfg_prefix.h>
+
+// Answers the requests of a keyvault client instead of the service.
+typedef struct
+{
+  int32_t requests;
+  az_span response; // Sent for every request, but keys named "missing" are not found.
+  az_http_method method; // Of the last request.
+  uint8_t body_buffer[64];
+  az_span body; // Of the last request, copied to body_buffer.
+} keyvault_test_server;
+
+// Initializes a client whose requests are answered by the server. The credential is only stored.
+void keyvault_test_client_init(
+    keyvault_test_server* server,
+    az_credential_client_secret* credential,
+    az_keyvault_keys_client* client);
+
+#include <_az_cfg_suffix.h>
+
+#endif // _az_KEYVAULT_TEST_SERVER_H
@@ -19,11 +19,17 @@ AZ_NODISCARD az_result _az_keyvault_keys_key_create_build_json_body(
     az_span* http_body);
 
 void test_keyvault(void** state);
+void test_keyvault_key_parse(void** state);
+void test_keyvault_key_cache(void** state);
+void test_keyvault_each(void** state);
 
 int main(void)
 {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_keyvault),
+    cmocka_unit_test(test_keyvault_key_parse),
+    cmocka_unit_test(test_keyvault_key_cache),
+    cmocka_unit_test(test_keyvault_each),
   };
 
   return cmocka_run_group_tests_name("az_keyvault", tests, NULL, NULL);
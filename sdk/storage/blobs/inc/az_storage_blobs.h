@@ -8,6 +8,8 @@
 #include <az_context.h>
 #include <az_credentials.h>
 #include <az_http.h>
+#include <az_http_metrics.h>
+#include <az_http_tracing.h>
 #include <az_result.h>
 #include <az_span.h>
 
@@ -20,6 +22,10 @@ static az_span const AZ_STORAGE_API_VERSION = AZ_SPAN_LITERAL_FROM_STR("2019-02-
 typedef struct
 {
   az_http_policy_retry_options retry;
+  az_http_metrics* metrics; ///< Where to record requests latency, NULL to not record it.
+  az_http_tracing_options* tracing; ///< Where to export requests spans, NULL to not trace them.
+  az_http_user_policy const* policies; ///< Policies added to the pipeline, NULL for none.
+  int32_t policies_length; ///< Up to #AZ_HTTP_PIPELINE_USER_POLICIES_MAX.
   struct
   {
     _az_http_policy_apiversion_options api_version;
@@ -38,6 +44,9 @@ typedef struct
     _az_http_pipeline pipeline;
     az_storage_blobs_blob_client_options options;
     _az_credential* credential;
+    // The constant parts of the upload requests, built in url_buffer and upload_headers.
+    _az_http_prepared_request upload;
+    az_pair upload_headers[3];
   } _internal;
 } az_storage_blobs_blob_client;
 
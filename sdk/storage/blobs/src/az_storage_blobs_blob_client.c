@@ -43,6 +43,10 @@ AZ_NODISCARD az_storage_blobs_blob_client_options az_storage_blobs_blob_client_o
       ._telemetry_options = _az_http_policy_telemetry_options_default(),
     },
     .retry = az_http_policy_retry_options_default(),
+    .metrics = NULL,
+    .tracing = NULL,
+    .policies = NULL,
+    .policies_length = 0,
   };
 
   options.retry.max_retries = 5;
@@ -68,60 +72,97 @@ AZ_NODISCARD az_result az_storage_blobs_blob_client_init(
       .uri = AZ_SPAN_FROM_BUFFER(self->_internal.url_buffer),
       .options = *options,
       .credential = cred,
-      .pipeline = (_az_http_pipeline){
-        ._internal = {
-          .p_policies = {
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_apiversion,
-                .p_options= &self->_internal.options._internal.api_version,
-              },
-            },
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_uniquerequestid,
-                .p_options = NULL,
-              },
-            },
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_telemetry,
-                .p_options = &self->_internal.options._internal._telemetry_options,
-              },
-            },
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_retry,
-                .p_options = &self->_internal.options.retry,
-              },
-            },
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_credential,
-                .p_options = cred,
-              },
-            },
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_logging,
-                .p_options = NULL,
-              },
-            },
-            {
-              ._internal = {
-                .process = az_http_pipeline_policy_transport,
-                .p_options = NULL,
-              },
-            },
-          },
-        }
-      }
     }
   };
 
+  // The policies of the application are inserted among these by az_http_pipeline_init.
+  _az_http_policy const policies[] = {
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_metrics,
+        .p_options = options->metrics,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_apiversion,
+        .p_options = &self->_internal.options._internal.api_version,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_uniquerequestid,
+        .p_options = NULL,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_tracing,
+        .p_options = options->tracing,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_telemetry,
+        .p_options = &self->_internal.options._internal._telemetry_options,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_retry,
+        .p_options = &self->_internal.options.retry,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_credential,
+        .p_options = cred,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_logging,
+        .p_options = NULL,
+      },
+    },
+    {
+      ._internal = {
+        .process = az_http_pipeline_policy_transport,
+        .p_options = NULL,
+      },
+    },
+  };
+  AZ_RETURN_IF_FAILED(az_http_pipeline_init(
+      &self->_internal.pipeline,
+      policies,
+      (int32_t)(sizeof(policies) / sizeof(policies[0])),
+      options->policies,
+      options->policies_length));
+
   // Copy url to client buffer so customer can re-use buffer on his/her side
   AZ_RETURN_IF_FAILED(az_span_copy(self->_internal.uri, uri, &self->_internal.uri));
 
+  // Build the constant headers of the upload requests once: version, blob type and content type.
+  _az_http_request request;
+  AZ_RETURN_IF_FAILED(az_http_request_init(
+      &request,
+      &az_context_app,
+      az_http_method_put(),
+      self->_internal.uri,
+      az_span_init(
+          (uint8_t*)self->_internal.upload_headers, 0, sizeof(self->_internal.upload_headers)),
+      AZ_SPAN_NULL));
+
+  AZ_RETURN_IF_FAILED(
+      az_http_request_set_api_version(&request, &self->_internal.options._internal.api_version));
+  AZ_RETURN_IF_FAILED(az_http_request_append_header(
+      &request, AZ_STORAGE_BLOBS_BLOB_HEADER_X_MS_BLOB_TYPE, AZ_STORAGE_BLOBS_BLOB_TYPE_BLOCKBLOB));
+  AZ_RETURN_IF_FAILED(az_http_request_append_header(
+      &request, AZ_HTTP_HEADER_CONTENT_TYPE, AZ_SPAN_FROM_STR("text/plain")));
+
+  AZ_RETURN_IF_FAILED(
+      az_http_prepared_request_init(&self->_internal.upload, az_http_method_put(), &request));
+
   AZ_RETURN_IF_FAILED(
       _az_credential_set_scopes(cred, AZ_SPAN_FROM_STR("https://storage.azure.com/.default")));
 
@@ -147,23 +188,18 @@ AZ_NODISCARD az_result az_storage_blobs_blob_upload(
   }
   (void)opt;
 
-  // Request buffer
-  // create request buffer TODO: define size for a blob upload
   uint8_t url_buffer[AZ_HTTP_REQUEST_URL_BUF_SIZE];
-  az_span request_url_span = AZ_SPAN_FROM_BUFFER(url_buffer);
-  // copy url from client
-  AZ_RETURN_IF_FAILED(az_span_copy(request_url_span, client->_internal.uri, &request_url_span));
   uint8_t headers_buffer[_az_STORAGE_HTTP_REQUEST_HEADER_BUF_SIZE];
-  az_span request_headers_span = AZ_SPAN_FROM_BUFFER(headers_buffer);
 
-  // create request
+  // create request with the version, blob type and content type headers
   _az_http_request hrb;
-  AZ_RETURN_IF_FAILED(az_http_request_init(
-      &hrb, context, az_http_method_put(), request_url_span, request_headers_span, content));
-
-  // add blob type to request
-  AZ_RETURN_IF_FAILED(az_http_request_append_header(
-      &hrb, AZ_STORAGE_BLOBS_BLOB_HEADER_X_MS_BLOB_TYPE, AZ_STORAGE_BLOBS_BLOB_TYPE_BLOCKBLOB));
+  AZ_RETURN_IF_FAILED(az_http_request_init_prepared(
+      &hrb,
+      context,
+      &client->_internal.upload,
+      AZ_SPAN_FROM_BUFFER(url_buffer),
+      AZ_SPAN_FROM_BUFFER(headers_buffer),
+      content));
 
   //
   uint8_t content_length[_az_INT64_AS_STR_BUF_SIZE] = { 0 };
@@ -174,10 +210,6 @@ AZ_NODISCARD az_result az_storage_blobs_blob_upload(
   AZ_RETURN_IF_FAILED(
       az_http_request_append_header(&hrb, AZ_HTTP_HEADER_CONTENT_LENGTH, content_length_builder));
 
-  // add blob type to request
-  AZ_RETURN_IF_FAILED(az_http_request_append_header(
-      &hrb, AZ_HTTP_HEADER_CONTENT_TYPE, AZ_SPAN_FROM_STR("text/plain")));
-
   // start pipeline
   return az_http_pipeline_process(&client->_internal.pipeline, &hrb, response);
 }